@@ -76,12 +76,28 @@ References:
 // Volume Master
 #define VOLUME_MASTER(Volume)		(((Volume) > 100)? 24 :((uint8_t)(((Volume) * 48)))
 
+// Command queue: register writes are sent by I2C interrupt, callers never wait for the bus
+#define CS43L22_QUEUE_SIZE			32u		// Queued writes and sync points, power of two
+#define CS43L22_FLUSH_TIMEOUT		100u	// ms to drain the queue where a caller must wait
+#define CS43L22_BURST_MAX			8u		// Adjacent registers merged into one auto-increment write
+#define CS43L22_MAP_INCR			0x80u	// MAP auto-increment bit of the register address byte
+
+//Called from the I2C interrupt once every command queued before it is on the codec
+typedef void (*CS43L22_CallbackTypeDef)(void *ctx);
+
 /* CS43L22 Codec Driver library function prototypes */
 
-void CS43L22_Init(I2C_HandleTypeDef i2c_handle, uint8_t outputDevice);
+void CS43L22_Init(I2C_HandleTypeDef *i2c_handle, uint8_t outputDevice);
 void CS43L22_SetVolume(uint8_t volume);
 void CS43L22_SetMute(uint8_t cmd);
 void CS43L22_Start(void);
 void CS43L22_Stop(void);
+void CS43L22_Sync(CS43L22_CallbackTypeDef callback, void *ctx);
+bool CS43L22_Flush(uint32_t timeout);
+bool CS43L22_IsBusy(void);
+uint32_t CS43L22_GetErrors(void);
+uint32_t CS43L22_GetQueueStalls(void);
+uint32_t CS43L22_GetSkippedWrites(void);
+bool CS43L22_ReadRegister(uint8_t reg, uint8_t *value);
 
 #endif
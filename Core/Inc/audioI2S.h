@@ -22,6 +22,8 @@ References:
 /* I2S Audio library function prototypes */
 
 void audioI2S_setHandle(I2S_HandleTypeDef *pI2Shandle);
+bool audioI2S_isSupportedFreq(uint32_t audioFreq);
+uint32_t audioI2S_nearestFreq(uint32_t audioFreq);
 bool audioI2S_init(uint32_t audioFreq);
 bool audioI2S_play(uint16_t* pDataBuf, uint32_t len);
 bool audioI2S_changeBuffer(uint16_t* pDataBuf, uint32_t len);
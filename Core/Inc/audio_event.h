@@ -0,0 +1,49 @@
+/*
+Library:				audio_event.h
+Written by:				Shridattha M Hebbar
+Date Written:			16/10/2026
+Description:			Lock-free single-producer/single-consumer queue of buffer-ready events from the
+						I2S DMA callbacks (producer, interrupt context) to wavPlayer_process() (consumer,
+						main loop). Every event keeps its own sequence number and slot index, so a late
+						main loop sees each slot it has to refill instead of only the newest one.
+References:
+			1) L. Lamport, "Specifying concurrent program modules", ACM TOPLAS, 1983
+*/
+
+#ifndef AUDIO_EVENT_H_
+#define AUDIO_EVENT_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+//Queue depth in events, a power of two. One event per freed slot of the audio ring, so this
+//is the number of slots the main loop may fall behind before events are lost.
+#ifndef AUDIO_EVENT_QUEUE_SIZE
+#define AUDIO_EVENT_QUEUE_SIZE  16u
+#endif
+
+//Buffer-ready event: the DMA finished reading this slot, it may be refilled
+typedef struct
+{
+  uint32_t seq;       // Event number since audioEvent_reset(), counts dropped events too
+  uint8_t  slot;      // Slot of the audio ring
+}AUDIO_EventTypeDef;
+
+//Queue state. head is written by the producer only, tail by the consumer only.
+typedef struct
+{
+  AUDIO_EventTypeDef events[AUDIO_EVENT_QUEUE_SIZE];
+  volatile uint32_t head;         // Events pushed (free running)
+  volatile uint32_t tail;         // Events popped (free running)
+  volatile uint32_t seq;          // Events produced, pushed or dropped
+  volatile uint32_t overruns;     // Events dropped because the queue was full
+}AUDIO_EventQueueTypeDef;
+
+/* Audio event queue function prototypes */
+
+void audioEvent_reset(AUDIO_EventQueueTypeDef *queue);
+bool audioEvent_push(AUDIO_EventQueueTypeDef *queue, uint8_t slot);
+bool audioEvent_pop(AUDIO_EventQueueTypeDef *queue, AUDIO_EventTypeDef *event);
+uint32_t audioEvent_produced(const AUDIO_EventQueueTypeDef *queue);
+
+#endif /* AUDIO_EVENT_H_ */
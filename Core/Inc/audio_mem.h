@@ -0,0 +1,32 @@
+/*
+Library:				audio_mem.h
+Written by:				Shridattha M Hebbar
+Date Written:			16/10/2026
+Description:			Static memory pool for per-stream audio buffers (echo delay line, ...).
+						The pool is reset for every file so buffers can be sized from the stream
+						and whatever a stream does not need stays available to the other stages.
+*/
+
+#ifndef AUDIO_MEM_H_
+#define AUDIO_MEM_H_
+
+#include <stdint.h>
+
+//Pool size in bytes, the default matches the former fixed 48000 x int16 echo buffer
+#ifndef AUDIO_MEM_POOL_SIZE
+#define AUDIO_MEM_POOL_SIZE  (96u * 1024u)
+#endif
+
+//Core coupled RAM (64 KB on the STM32F407): CPU access only, for buffers no DMA touches
+#ifndef AUDIO_CCMRAM
+#define AUDIO_CCMRAM  __attribute__((section(".ccmram")))
+#endif
+
+/* Audio memory pool function prototypes */
+
+void audioMem_reset(void);
+void *audioMem_alloc(uint32_t bytes);
+uint32_t audioMem_available(void);
+uint32_t audioMem_used(void);
+
+#endif /* AUDIO_MEM_H_ */
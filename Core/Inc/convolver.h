@@ -0,0 +1,107 @@
+/*
+Library:				convolver.h
+Written by:				Shridattha M Hebbar
+Date Written:			16/10/2026
+Description:			Partitioned overlap-save convolution of 16-bit PCM with an arbitrary impulse
+						response, e.g. a room or plate response loaded from a WAV file.
+						The IR is cut into segments of equally sized partitions. The head segment uses
+						partitions of B frames (the engine latency) and is computed every block of B
+						frames. Tail segments use larger partitions, Bs = B * CONV_SEGMENT_GROWTH^s,
+						and their work for one block of Bs frames is spread over the next Bs / B blocks,
+						so long IRs run at the latency of B without one block doing all the work.
+References:
+			1) F. Wefers, "Partitioned convolution algorithms for real-time auralization", 2015
+			2) W. G. Gardner, "Efficient convolution without input-output delay", JAES, 1995
+*/
+
+#ifndef CONVOLVER_H_
+#define CONVOLVER_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "rfft.h"
+
+//Convolution Parameters
+#define CONV_PARTITION_FRAMES  128   // Default partition size, one player half buffer of stereo frames
+#define CONV_MAX_CHANNELS      2     // Stream and IR channels supported
+#define CONV_MAX_SEGMENTS      3     // Partition sizes per engine (128, 1K, 8K frames by default)
+#define CONV_SEGMENT_GROWTH    8     // Partition size ratio between neighbouring segments
+
+/* Non-uniform partition layout
+ * A tail segment's result for a block is complete Bs / B blocks after the block was read,
+ * so segment s must start at IR frame 2 * Bs - 2 * B. This fixes the partition count of
+ * every segment but the last; convolver_plan() fills them in for an IR length.
+ */
+typedef struct
+{
+  uint8_t  segments;                          // Segments in use, 1 gives a uniform engine
+  uint32_t blockFrames[CONV_MAX_SEGMENTS];    // Partition size of every segment, [0] is B
+  uint32_t partitions[CONV_MAX_SEGMENTS];     // Partitions of every segment
+}CONV_LayoutTypeDef;
+
+//One segment of equally sized partitions
+typedef struct
+{
+  RFFT_HandleTypeDef fft;                   // Length 2Bs real FFT
+  uint32_t blockFrames;                     // Partition size Bs in frames
+  uint32_t offset;                          // First IR frame of the segment
+  uint32_t partitions;                      // IR partitions the segment holds
+  uint32_t irPartitions;                    // IR partitions loaded
+  uint32_t fill;                            // Frames of the next block in window[]
+  uint32_t fdlPos;                          // Newest spectrum in the frequency domain delay line
+  uint32_t steps;                           // Blocks of B frames one block of this segment is spread over
+  uint32_t step;                            // Next step of the running block, steps when idle
+  uint32_t cost;                            // Work units of one block
+  uint32_t costDone;                        // Work units done in the running block
+  uint32_t unit;                            // Next work unit of the running block
+  uint32_t blockEnd;                        // Input frame count at the end of the running block
+  uint32_t resultStart;                     // Output frame of result[c][0]
+  float   *window[CONV_MAX_CHANNELS];       // 2Bs input samples: previous block, next block
+  float   *fdl[CONV_MAX_CHANNELS];          // Input spectra, partitions x 2Bs floats
+  float   *ir[CONV_MAX_CHANNELS];           // IR partition spectra, partitions x 2Bs floats
+  float   *acc[CONV_MAX_CHANNELS];          // 2Bs floats, spectrum accumulator of the running block
+  float   *result[CONV_MAX_CHANNELS];       // Bs output samples of the last finished block
+}CONV_SegmentTypeDef;
+
+//Convolution engine state, all buffers live in one block handed to convolver_init()
+typedef struct
+{
+  CONV_SegmentTypeDef seg[CONV_MAX_SEGMENTS];
+  uint8_t  segments;
+  uint32_t blockFrames;                     // Base partition size B in frames (latency of the engine)
+  uint16_t channels;                        // Stream samples per frame
+  uint16_t irChannels;                      // 1: one IR for every channel, else one IR per channel
+  uint32_t irFrames;                        // IR frames loaded
+  uint8_t  loadSeg;                         // Segment the next IR frame goes to
+  uint32_t irFill;                          // Frames staged in the partition being loaded
+  uint32_t pos;                             // Frame position inside the current input block
+  uint32_t frames;                          // Input frames up to the current block
+  float    dryGain;                         // Gain of the (delayed) input in the output
+  float    wetGain;                         // Gain of the convolved signal in the output
+  float   *input[CONV_MAX_CHANNELS];        // 2B input samples: previous block, current block
+  float   *output[CONV_MAX_CHANNELS];       // B wet samples of the last computed block
+}CONV_HandleTypeDef;
+
+/* Convolution library function prototypes */
+
+uint32_t convolver_memBytes(uint32_t blockFrames, uint32_t partitions, uint16_t channels, uint16_t irChannels);
+bool convolver_init(CONV_HandleTypeDef *hconv, void *mem, uint32_t blockFrames, uint32_t partitions,
+                    uint16_t channels, uint16_t irChannels);
+void convolver_plan(CONV_LayoutTypeDef *layout, uint32_t blockFrames, uint32_t irFrames, uint8_t maxSegments);
+uint32_t convolver_layoutBytes(const CONV_LayoutTypeDef *layout, uint16_t channels, uint16_t irChannels);
+bool convolver_initLayout(CONV_HandleTypeDef *hconv, void *mem, const CONV_LayoutTypeDef *layout,
+                          uint16_t channels, uint16_t irChannels);
+void convolver_loadIR(CONV_HandleTypeDef *hconv, const int16_t *ir, uint32_t frames);
+void convolver_commitIR(CONV_HandleTypeDef *hconv);
+uint32_t convolver_irCapacity(const CONV_HandleTypeDef *hconv);
+void convolver_setMix(CONV_HandleTypeDef *hconv, float dry, float wet);
+void convolver_process(CONV_HandleTypeDef *hconv, int16_t *buffer, uint32_t size);
+void convolver_clear(CONV_HandleTypeDef *hconv);
+
+/* Player convolution (engine behind applyConvolution) */
+
+uint32_t convolver_configure(uint32_t irFrames, uint16_t channels, uint16_t irChannels);
+CONV_HandleTypeDef *convolver_getDefault(void);
+void applyConvolution(int16_t *buffer, uint32_t size);
+
+#endif /* CONVOLVER_H_ */
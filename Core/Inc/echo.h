@@ -0,0 +1,140 @@
+/*
+Library:				echo.h
+Written by:				Shridattha M Hebbar
+Date Written:			16/10/2026
+Description:			Sparse multi-tap echo engine applied in place on 16-bit PCM.
+						The impulse response h[n] = δ[n] + Σ αk·δ[n − Dk] generalises the single echo
+						h[n] = δ[n] + αδ[n − D]; all taps read one shared delay line.
+*/
+
+#ifndef ECHO_H_
+#define ECHO_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "sample_codec.h"
+
+//Echo Effect Parameters
+#define ECHO_DELAY_MS       1000  // Default echo delay, the delay line is sized from it per stream
+#define ECHO_MAX_TAPS       8     // Maximum number of echo taps per engine
+#define ECHO_GAIN_UNITY     32768 // Tap gain of 1.0 in Q15
+#define ECHO_MAX_CHANNELS   2     // Channels supported by ADPCM storage (others fall back to PCM16)
+#define ECHO_ADPCM_BLOCK_FRAMES  128  // Frames per ADPCM block, each block starts with a header per channel
+#define ECHO_FEEDBACK_MAX   31130 // Largest feedback loop gain Σ|gk| in Q15 (0.95), keeps repeats decaying
+#define ECHO_DAMPING_DEFAULT 0.3f // Default feedback damping, fraction of the one-pole low-pass memory
+
+/* Echo kernel selection (build time)
+ * 1 : Q15 fixed point multi-tap engine (SIMD on Cortex-M4, portable C elsewhere). The taps
+ *     multiply two samples per 32-bit word (SMULBB/SMULTB); a single tap at a steady gain also
+ *     finishes two samples per word with QADD16
+ * 0 : Float single-tap kernel (kept for comparison, taps and feedback mode are ignored)
+ *
+ * Q15 reference, the fixed point engine is bit-exact to it:
+ *   G    = clamp(round(master gain * 32768), 0, 32767)
+ *   gk   = (tap gain k * G) >> 15
+ *   y[n] = sat16(x[n] + Σk ((x[n − Dk] * gk) >> 15))      '>>' is an arithmetic shift
+ * where n counts samples of one channel and Dk is the tap delay in frames.
+ *
+ * Feedback mode recirculates the output instead of the input, with a one-pole low-pass
+ * (coefficient a = damping in Q15) in the loop:
+ *   gk   scaled down so that Σ|gk| <= ECHO_FEEDBACK_MAX
+ *   v[n] = Σk ((y[n − Dk] * gk) >> 15)
+ *   l[n] = l[n − 1] + (((v[n] − l[n − 1]) * (32768 − a)) >> 15)
+ *   y[n] = sat16(x[n] + l[n])
+ *
+ * A block after echo_rampGain() steps the master gain per sample from G0 to G1 instead:
+ *   r[i] = G0 * 32768 + (i + 1) * (((G1 − G0) * 32768) / size),  Gi = min(r[i] >> 15, limit)
+ *   v[n] = (Σk ((x[n − Dk] * tap gain k) >> 15) * Gi) >> 15      (y[n − Dk] in feedback mode)
+ * ('/' truncates towards zero, G1 < G0 gives a negative step)
+ * with tap gains clipped to 32767 and limit keeping Σ|tap gain k| * Gi <= ECHO_FEEDBACK_MAX << 15
+ * in feedback mode. Blocks with a steady gain use the reference above.
+ */
+#ifndef ECHO_USE_Q15
+#define ECHO_USE_Q15  1
+#endif
+
+//Delay line storage format, samples are encoded on write and decoded on read
+typedef enum
+{
+  ECHO_STORAGE_PCM16 = 0,   // Raw 16-bit samples
+  ECHO_STORAGE_MULAW,       // G.711 µ-law, 8 bits per sample (2x the delay per byte)
+  ECHO_STORAGE_ADPCM,       // IMA-ADPCM, 4 bits per sample plus 4 header bytes per channel and block (~3.8x)
+}ECHO_StorageTypeDef;
+
+//Echo topology
+typedef enum
+{
+  ECHO_MODE_FIR = 0,        // Taps read the dry input: one repeat per tap
+  ECHO_MODE_FEEDBACK,       // Taps read the output (recursive comb): decaying repeats, damped per pass
+}ECHO_ModeTypeDef;
+
+//Echo tap: one non-zero coefficient of the impulse response
+typedef struct
+{
+  uint32_t delay;   // Delay in frames, 1 to delay line length
+  int32_t  gain;    // Relative gain in Q15, ECHO_GAIN_UNITY = 1.0, negative values invert the echo
+}ECHO_TapTypeDef;
+
+//Echo tap of the player pattern, independent of the stream sample rate
+typedef struct
+{
+  uint32_t delayMs; // Delay in milliseconds
+  int32_t  gain;    // Relative gain in Q15, ECHO_GAIN_UNITY = 1.0
+}ECHO_PatternTapTypeDef;
+
+//Echo engine state
+typedef struct
+{
+  void     *line;                         // Delay line storing the dry input, interleaved frames
+  ECHO_StorageTypeDef storage;            // Delay line sample format
+  uint32_t frames;                        // Delay line length in frames (longest usable delay)
+  uint16_t channels;                      // Samples per frame
+  uint32_t length;                        // Delay line length in samples (frames * channels)
+  uint32_t writeIndex;                    // Next delay line sample to be written
+  int16_t  masterGain;                    // Q15 master gain applied to every tap (echo decay factor)
+  int16_t  targetGain;                    // Q15 master gain at the end of the next block (echo_rampGain)
+  int16_t  rampLimit;                     // Ramp: largest master gain, keeps a feedback loop below one
+  int32_t  rampGain;                      // Ramp: master gain of the running block in Q30
+  int32_t  rampStep;                      // Ramp: Q30 gain step per sample
+  uint8_t  numTaps;
+  ECHO_TapTypeDef taps[ECHO_MAX_TAPS];
+  uint32_t readIndex[ECHO_MAX_TAPS];      // Delay line read position of every tap, in samples
+  uint32_t minDelay;                      // Shortest tap delay in samples, bounds the processing span
+  uint32_t blockSamples;                  // ADPCM: samples per block
+  uint32_t blockBytes;                    // ADPCM: bytes per block including headers
+  ADPCM_StateTypeDef writeState[ECHO_MAX_CHANNELS];              // ADPCM: encoder state
+  ADPCM_StateTypeDef readState[ECHO_MAX_TAPS][ECHO_MAX_CHANNELS]; // ADPCM: decoder state of every tap
+  ECHO_ModeTypeDef mode;                  // FIR or feedback
+  int16_t  damping;                       // Feedback: Q15 low-pass coefficient, 0 = no damping
+  int32_t  dampState[ECHO_MAX_CHANNELS];  // Feedback: low-pass state per channel
+}ECHO_HandleTypeDef;
+
+extern float echoDecayFactor;  // Attenuation of echo (0.0 to 1.0)
+
+/* Echo library function prototypes */
+
+uint32_t echo_msToFrames(uint32_t delayMs, uint32_t sampleRate);
+uint32_t echo_lineBytes(uint32_t frames, uint16_t channels, ECHO_StorageTypeDef storage);
+void echo_init(ECHO_HandleTypeDef *hecho, void *line, uint32_t frames, uint16_t channels,
+               ECHO_StorageTypeDef storage);
+bool echo_setTaps(ECHO_HandleTypeDef *hecho, const ECHO_TapTypeDef *taps, uint8_t numTaps);
+void echo_setGain(ECHO_HandleTypeDef *hecho, float gain);
+void echo_rampGain(ECHO_HandleTypeDef *hecho, float gain);
+bool echo_setMode(ECHO_HandleTypeDef *hecho, ECHO_ModeTypeDef mode);
+void echo_setDamping(ECHO_HandleTypeDef *hecho, float damping);
+void echo_process(ECHO_HandleTypeDef *hecho, int16_t *buffer, uint32_t size);
+void echo_clear(ECHO_HandleTypeDef *hecho);
+int16_t echo_gainQ15(float gain);
+
+/* Player echo (engine behind applyEcho) */
+
+uint32_t echo_configure(uint32_t sampleRate, uint16_t channels, uint32_t delayMs,
+                        ECHO_StorageTypeDef storage);
+bool echo_setPattern(const ECHO_PatternTapTypeDef *taps, uint8_t numTaps);
+void echo_setDefaultMode(ECHO_ModeTypeDef mode, float damping);
+ECHO_HandleTypeDef *echo_getDefault(void);
+void applyEcho(int16_t *buffer, uint32_t size);
+void applyEchoFloat(int16_t *buffer, uint32_t size);
+void echo_reset(void);
+
+#endif /* ECHO_H_ */
@@ -0,0 +1,40 @@
+/*
+Library:				pcm_convert.h
+Written by:				Shridattha M Hebbar
+Date Written:			16/10/2026
+Description:			Sample format conversion from WAV data to the player's internal format,
+						16-bit interleaved stereo. Sources are 8-bit unsigned, 16/24/32-bit signed or
+						32-bit float PCM, mono or stereo. Mono is copied to both channels, wider
+						samples are truncated to their top 16 bits and float is scaled, rounded and
+						saturated. The integer kernels work on whole 32-bit words and write one stereo
+						frame per word, so there is no per-byte loop on the hot path.
+References:
+			1) Microsoft/IBM, "Multimedia Programming Interface and Data Specifications 1.0", 1991
+*/
+
+#ifndef PCM_CONVERT_H_
+#define PCM_CONVERT_H_
+
+#include <stdint.h>
+
+#define PCM_OUT_FRAME_BYTES   4u    // Internal frame: two int16 samples
+#define PCM_MAX_FRAME_BYTES   8u    // Largest source frame: 32-bit stereo
+
+//Convert frames of source data at src to 16-bit stereo at dst (word aligned, frames * 4 bytes)
+typedef void (*PCM_ConvertFunc)(const uint8_t *src, int16_t *dst, uint32_t frames);
+
+/* Format conversion function prototypes */
+
+PCM_ConvertFunc pcmConvert_select(uint16_t encoding, uint16_t bitsPerSample, uint16_t channels);
+void pcmConvert_u8Mono(const uint8_t *src, int16_t *dst, uint32_t frames);
+void pcmConvert_u8Stereo(const uint8_t *src, int16_t *dst, uint32_t frames);
+void pcmConvert_s16Mono(const uint8_t *src, int16_t *dst, uint32_t frames);
+void pcmConvert_s16Stereo(const uint8_t *src, int16_t *dst, uint32_t frames);
+void pcmConvert_s24Mono(const uint8_t *src, int16_t *dst, uint32_t frames);
+void pcmConvert_s24Stereo(const uint8_t *src, int16_t *dst, uint32_t frames);
+void pcmConvert_s32Mono(const uint8_t *src, int16_t *dst, uint32_t frames);
+void pcmConvert_s32Stereo(const uint8_t *src, int16_t *dst, uint32_t frames);
+void pcmConvert_f32Mono(const uint8_t *src, int16_t *dst, uint32_t frames);
+void pcmConvert_f32Stereo(const uint8_t *src, int16_t *dst, uint32_t frames);
+
+#endif /* PCM_CONVERT_H_ */
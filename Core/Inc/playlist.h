@@ -0,0 +1,36 @@
+/*
+Library:				playlist.h
+Written by:				Shridattha M Hebbar
+Date Written:			16/10/2026
+Description:			Playlist engine on top of the WAV player. While a track plays, the next one is
+						opened, parsed and queued with wavPlayer_queueNext(), so its first chunks are read
+						ahead and playback moves on to it at the sample boundary: no gap, no PLL or I2S
+						re-initialisation, and the echo tail carries into the new track. A next track at
+						another sample rate cannot follow gaplessly; it is started once the current one
+						has played out.
+*/
+
+#ifndef PLAYLIST_H_
+#define PLAYLIST_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define PLAYLIST_MAX_TRACKS     32u
+#define PLAYLIST_PATH_MAX       64u     // Path bytes, terminator included
+#define PLAYLIST_NONE           0xFFFFFFFFu
+
+/* Playlist function prototypes */
+
+void playlist_clear(void);
+bool playlist_add(const char *path);
+uint32_t playlist_getCount(void);
+void playlist_setLoop(bool loop);
+bool playlist_start(uint32_t index);
+void playlist_process(void);
+void playlist_stop(void);
+bool playlist_isFinished(void);
+uint32_t playlist_getCurrent(void);
+uint32_t playlist_getRestarts(void);
+
+#endif /* PLAYLIST_H_ */
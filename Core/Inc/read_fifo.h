@@ -0,0 +1,82 @@
+/*
+Library:				read_fifo.h
+Written by:				Shridattha M Hebbar
+Date Written:			16/10/2026
+Description:			Read-ahead FIFO between FatFs and the audio refill path. The FIFO is filled in
+						large chunks that start on chunk (and so sector and cluster) boundaries of the
+						file, so FatFs reads whole sectors straight into it with one multi-sector MSC
+						command per chunk. The refill path takes blocks out of it without touching the
+						file system. With the FatFs fast-seek option the file's cluster chain is mapped
+						once at open, so neither reads nor seeks follow the FAT afterwards. A second
+						file can be chained behind the region being played: reading ahead continues
+						into it, so the next file's first chunks are buffered before they are needed.
+References:
+			1) ChaN, "FatFs - Generic FAT Filesystem Module", application notes on performance
+*/
+
+#ifndef READ_FIFO_H_
+#define READ_FIFO_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "fatfs.h"
+
+//Fast-seek option of the FatFs build (R0.13 and later name it FF_USE_FASTSEEK, older releases _USE_FASTSEEK)
+#if defined(FF_USE_FASTSEEK)
+#define READ_FIFO_FASTSEEK    FF_USE_FASTSEEK
+#elif defined(_USE_FASTSEEK)
+#define READ_FIFO_FASTSEEK    _USE_FASTSEEK
+#else
+#define READ_FIFO_FASTSEEK    0
+#endif
+
+//Chunk size limits, the chunk is the file system cluster clamped to this range
+#define READ_FIFO_MIN_CHUNK   4096u
+#define READ_FIFO_MAX_CHUNK   32768u
+
+/* FIFO indices are file offsets: byte n of the file lives at buf[(n + base) % size]. size and
+ * base are multiples of the chunk, so a chunk read never wraps around the end of the buffer.
+ */
+typedef struct
+{
+  FIL      *file;
+  uint32_t start;           // File offset of the first byte
+  uint32_t end;             // File offset at which reading stops
+  uint32_t unit;            // Bytes are handed out in multiples of this (the frame size)
+  uint32_t base;            // Buffer offset of file offset 0, modulo size
+}READ_FIFO_RegionTypeDef;
+
+typedef struct
+{
+  FIL      *file;
+  uint8_t  *buf;
+  uint32_t size;            // Buffer bytes, a multiple of chunk
+  uint32_t chunk;           // Read size in bytes, a power of two
+  uint32_t unit;            // Bytes are handed out in multiples of this (the frame size)
+  uint32_t base;            // Buffer offset of file offset 0, modulo size
+  uint32_t head;            // File offset of the next byte read from the file (of next once filling it)
+  uint32_t tail;            // File offset of the next byte handed out
+  uint32_t end;             // File offset at which reading stops
+  READ_FIFO_RegionTypeDef next;   // Region chained behind this one
+  bool     chained;         // next is set
+  bool     fillingNext;     // Reading ahead has moved on to next, head is its offset
+  uint32_t gap;             // Buffer bytes skipped between the regions to keep next chunk aligned
+  uint32_t reads;           // f_read calls
+  uint32_t underruns;       // readFifo_read() calls that found fewer bytes than asked before the end
+  FRESULT  error;           // Last file system error, FR_OK when none
+}READ_FIFO_HandleTypeDef;
+
+/* Read-ahead FIFO function prototypes */
+
+bool readFifo_mapFile(FIL *file, DWORD *map, UINT entries);
+bool readFifo_init(READ_FIFO_HandleTypeDef *hfifo, FIL *file, void *mem, uint32_t size,
+                   uint32_t start, uint32_t end, uint32_t unit);
+bool readFifo_seek(READ_FIFO_HandleTypeDef *hfifo, uint32_t offset);
+bool readFifo_chain(READ_FIFO_HandleTypeDef *hfifo, FIL *file, uint32_t start, uint32_t end, uint32_t unit);
+bool readFifo_nextRegion(READ_FIFO_HandleTypeDef *hfifo);
+uint32_t readFifo_fill(READ_FIFO_HandleTypeDef *hfifo, uint32_t maxChunks);
+uint32_t readFifo_read(READ_FIFO_HandleTypeDef *hfifo, void *dst, uint32_t bytes);
+uint32_t readFifo_level(const READ_FIFO_HandleTypeDef *hfifo);
+bool readFifo_isEnd(const READ_FIFO_HandleTypeDef *hfifo);
+
+#endif /* READ_FIFO_H_ */
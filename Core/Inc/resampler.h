@@ -0,0 +1,59 @@
+/*
+Library:				resampler.h
+Written by:				Shridattha M Hebbar
+Date Written:			16/10/2026
+Description:			Streaming polyphase sample-rate converter for 16-bit interleaved stereo, used to
+						play files whose rate has no I2S PLL setting at the nearest rate that has one.
+						The prototype low-pass is a Kaiser windowed sinc cut at the lower of the two
+						Nyquist rates, split into phases of a few taps each. The output position
+						advances by exactly inRate / outRate input frames per output frame, so the pitch
+						is exact. When the ratio needs no more phases than the quality allows, every
+						output sample falls on a phase of the table; otherwise the nearest phase is used.
+References:
+			1) R. E. Crochiere, L. R. Rabiner, "Multirate Digital Signal Processing", 1983
+			2) J. F. Kaiser, "Nonrecursive digital filter design using the I0-sinh window function", 1974
+*/
+
+#ifndef RESAMPLER_H_
+#define RESAMPLER_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define RESAMPLER_BLOCK_FRAMES  256u    // Input frames accepted per resampler_writeBuffer() beyond the taps
+
+//Quality / cost trade-off: taps per output sample (times the ratio when downsampling, up to 64)
+//and most phases in the table
+typedef enum
+{
+  RESAMPLER_QUALITY_FAST = 0,        // 8 taps, 64 phases
+  RESAMPLER_QUALITY_BALANCED,        // 16 taps, 128 phases
+  RESAMPLER_QUALITY_HIGH,            // 32 taps, 256 phases
+}RESAMPLER_QualityTypeDef;
+
+//Resampler state, coefficients and input history live in one block handed to resampler_init()
+typedef struct
+{
+  uint32_t inRate;          // Input rate divided by gcd(inRate, outRate)
+  uint32_t outRate;         // Output rate divided by the same
+  uint16_t taps;            // Taps per phase, even
+  uint16_t phases;          // Phases in the table
+  int16_t *coeffs;          // phases x taps, Q15
+  int16_t *hist;            // (taps + RESAMPLER_BLOCK_FRAMES) stereo frames of input
+  uint32_t fill;            // Frames in hist
+  uint32_t pos;             // Frame of hist at the first tap of the next output
+  uint32_t acc;             // Fraction of a frame past pos, in 1/outRate units
+}RESAMPLER_HandleTypeDef;
+
+/* Resampler function prototypes */
+
+uint32_t resampler_memBytes(RESAMPLER_QualityTypeDef quality, uint32_t inRate, uint32_t outRate);
+bool resampler_init(RESAMPLER_HandleTypeDef *hrs, void *mem, RESAMPLER_QualityTypeDef quality,
+                    uint32_t inRate, uint32_t outRate);
+void resampler_reset(RESAMPLER_HandleTypeDef *hrs);
+uint32_t resampler_inputFrames(const RESAMPLER_HandleTypeDef *hrs, uint32_t outFrames);
+int16_t *resampler_writeBuffer(RESAMPLER_HandleTypeDef *hrs, uint32_t *frames);
+void resampler_commit(RESAMPLER_HandleTypeDef *hrs, uint32_t frames);
+uint32_t resampler_process(RESAMPLER_HandleTypeDef *hrs, int16_t *out, uint32_t frames);
+
+#endif /* RESAMPLER_H_ */
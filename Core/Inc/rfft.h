@@ -0,0 +1,47 @@
+/*
+Library:				rfft.h
+Written by:				Shridattha M Hebbar
+Date Written:			16/10/2026
+Description:			Single precision real FFT (radix-2, power of two lengths) for the convolution
+						engine. A length N real transform runs as an N/2 point complex FFT plus a split
+						step, so it costs about half a complex transform of the same length.
+References:
+			1) H. V. Sorensen et al., "Real-valued fast Fourier transform algorithms",
+			   IEEE Trans. ASSP, 1987
+*/
+
+#ifndef RFFT_H_
+#define RFFT_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Packed spectrum layout of a length N transform (N floats, same as CMSIS-DSP arm_rfft_fast_f32):
+ *   [0] = Re X[0]      (DC)
+ *   [1] = Re X[N/2]    (Nyquist)
+ *   [2k], [2k + 1] = Re X[k], Im X[k]   for k = 1 .. N/2 - 1
+ */
+
+//Real FFT instance
+typedef struct
+{
+  uint32_t size;        // Transform length N (power of two, >= 4)
+  float   *twiddle;     // N floats: W^k = e^(-2πik/N) for k = 0 .. N/2 - 1, interleaved cos/-sin
+}RFFT_HandleTypeDef;
+
+/* Real FFT function prototypes */
+
+uint32_t rfft_tableBytes(uint32_t size);
+bool rfft_init(RFFT_HandleTypeDef *hfft, float *table, uint32_t size);
+void rfft_forward(const RFFT_HandleTypeDef *hfft, float *buf);
+void rfft_inverse(const RFFT_HandleTypeDef *hfft, float *buf);
+
+/* Resumable transforms: the same work as rfft_forward()/rfft_inverse() split into
+ * rfft_passes() calls of similar cost, so a long transform can be spread over several
+ * audio callbacks. Passes must be run in order 0 .. rfft_passes() - 1.
+ */
+uint32_t rfft_passes(const RFFT_HandleTypeDef *hfft);
+void rfft_forwardPass(const RFFT_HandleTypeDef *hfft, float *buf, uint32_t pass);
+void rfft_inversePass(const RFFT_HandleTypeDef *hfft, float *buf, uint32_t pass);
+
+#endif /* RFFT_H_ */
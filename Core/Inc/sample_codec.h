@@ -0,0 +1,32 @@
+/*
+Library:				sample_codec.h
+Written by:				Shridattha M Hebbar
+Date Written:			16/10/2026
+Description:			Sample codecs for compressed delay line storage: G.711 µ-law (8 bits per
+						sample) and IMA-ADPCM (4 bits per sample).
+References:
+			1) ITU-T Recommendation G.711
+			2) IMA Digital Audio Focus and Technical Working Groups, Recommended Practices for
+			   Enhancing Digital Audio Compatibility in Multimedia Systems (IMA ADPCM)
+*/
+
+#ifndef SAMPLE_CODEC_H_
+#define SAMPLE_CODEC_H_
+
+#include <stdint.h>
+
+//IMA-ADPCM predictor state, one per channel
+typedef struct
+{
+  int16_t predictor;   // Last reconstructed sample
+  uint8_t index;       // Step table index (0 to 88)
+}ADPCM_StateTypeDef;
+
+/* Sample codec function prototypes */
+
+uint8_t mulaw_encode(int16_t sample);
+int16_t mulaw_decode(uint8_t code);
+uint8_t adpcm_encode(ADPCM_StateTypeDef *state, int16_t sample);
+int16_t adpcm_decode(ADPCM_StateTypeDef *state, uint8_t nibble);
+
+#endif /* SAMPLE_CODEC_H_ */
@@ -0,0 +1,99 @@
+/*
+Library:				stage_prof.h
+Written by:				Shridattha M Hebbar
+Date Written:			16/10/2026
+Description:			Cycle budget probes for the playback hot path. Each stage of wavPlayer_process()
+						is timed with the DWT cycle counter on target (a monotonic nanosecond clock on
+						the host build) into min/max/mean and a log2 histogram, and every slot refill
+						records its slack: the time left until the DMA reaches the slot. Build with
+						STAGE_PROF_ENABLE=0 to compile every probe out; the query functions then
+						report nothing.
+*/
+
+#ifndef STAGE_PROF_H_
+#define STAGE_PROF_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "stm32f4xx_hal.h"
+
+#ifndef STAGE_PROF_ENABLE
+#define STAGE_PROF_ENABLE   1
+#endif
+
+#define STAGE_PROF_BINS       32    // Duration histogram: bin k counts 2^k to 2^(k+1) - 1 ticks
+#define STAGE_PROF_SLACK_BINS 10    // Slack histogram: bin 0 late, bin k slack of (k-1)/8 to k/8 of the window, bin 9 more
+
+//Timed stages of the playback hot path
+typedef enum
+{
+  STAGE_PROF_ECHO_SWITCH = 0,   // checkEchoEnable(): echo on/off pin
+  STAGE_PROF_LEVEL_KNOB,        // updateAttenuationFactor(): ADC average and taper
+  STAGE_PROF_SLOT_READ,         // readSlot(): FIFO copy, format conversion, resampling
+  STAGE_PROF_EFFECT,            // applyEffect(): echo or convolution of one slot
+  STAGE_PROF_PAUSE_RAMP,        // applyPauseRamp(): soft pause fades
+  STAGE_PROF_REFILL,            // refillSlot() as a whole
+  STAGE_PROF_FILE_READ,         // readFifo_fill(): f_read of one read-ahead chunk
+  STAGE_PROF_PROCESS,           // wavPlayer_process() as a whole
+  STAGE_PROF_COUNT
+}STAGE_PROF_StageTypeDef;
+
+//Durations of one stage, in ticks (stageProf_tickHz() per second)
+typedef struct
+{
+  uint32_t count;
+  uint32_t min;
+  uint32_t max;
+  uint64_t total;                   // Mean is total / count
+  uint32_t hist[STAGE_PROF_BINS];
+}STAGE_PROF_StatsTypeDef;
+
+//Deadline slack of the slot refills, in ticks
+typedef struct
+{
+  uint32_t count;
+  uint32_t late;                    // Refills finished after the DMA reached the slot
+  int32_t  min;
+  int32_t  max;
+  int64_t  total;                   // Mean is total / count
+  uint32_t window;                  // Time from the DMA freeing a half to reaching its first slot
+  uint32_t hist[STAGE_PROF_SLACK_BINS];
+}STAGE_PROF_SlackTypeDef;
+
+//Time stamp in ticks: core cycles from the DWT on target, nanoseconds on the host build
+#if defined(DWT)
+static inline uint32_t stageProf_now(void)
+{
+  return DWT->CYCCNT;
+}
+#else
+uint32_t stageProf_now(void);
+#endif
+
+//Probes, removed with STAGE_PROF_ENABLE=0
+#if STAGE_PROF_ENABLE
+#define STAGE_PROF_START(var)               uint32_t var = stageProf_now()
+#define STAGE_PROF_END(stage, var)          stageProf_record((stage), (var))
+#define STAGE_PROF_STAMP(dst)               ((dst) = stageProf_now())
+#define STAGE_PROF_SLACK(freedAt, slotsAhead)  stageProf_recordSlack((freedAt), (slotsAhead))
+#else
+#define STAGE_PROF_START(var)
+#define STAGE_PROF_END(stage, var)          ((void)0)
+#define STAGE_PROF_STAMP(dst)               ((void)0)
+#define STAGE_PROF_SLACK(freedAt, slotsAhead)  ((void)0)
+#endif
+
+/* Stage profiler function prototypes */
+
+void stageProf_init(void);
+void stageProf_reset(void);
+void stageProf_setSlotPeriod(uint32_t frames, uint32_t sampleRate, uint32_t windowSlots);
+void stageProf_record(STAGE_PROF_StageTypeDef stage, uint32_t start);
+void stageProf_recordSlack(uint32_t freedAt, uint32_t slotsAhead);
+bool stageProf_getStage(STAGE_PROF_StageTypeDef stage, STAGE_PROF_StatsTypeDef *stats);
+bool stageProf_getSlack(STAGE_PROF_SlackTypeDef *slack);
+uint32_t stageProf_getSlotPeriod(void);
+uint32_t stageProf_tickHz(void);
+const char *stageProf_stageName(STAGE_PROF_StageTypeDef stage);
+
+#endif /* STAGE_PROF_H_ */
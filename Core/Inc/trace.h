@@ -0,0 +1,128 @@
+/*
+Library:				trace.h
+Written by:				Shridattha M Hebbar
+Date Written:			16/10/2026
+Description:			Binary event trace for post-mortem timing analysis. A fixed ring of 8-byte
+						records (time stamp, event type and a 24-bit argument) keeps the last
+						TRACE_RECORDS events. A writer claims its record with one atomic increment
+						(LDREX/STREX on the Cortex-M4), so interrupts and the main loop write without
+						locks or masking. The buffer is laid out as it is saved: trace_save() writes it
+						to the drive, or a debugger dumps the traceBuffer symbol, and the host tool
+						trace_decode turns the file into a timeline. Build with TRACE_ENABLE=0 to
+						compile every event out.
+*/
+
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "stage_prof.h"
+
+#ifndef TRACE_ENABLE
+#define TRACE_ENABLE        1
+#endif
+
+#ifndef TRACE_RECORDS
+#define TRACE_RECORDS       1024u   // Ring length, a power of two (8 KB)
+#endif
+
+#define TRACE_FILE          "trace.bin"
+#define TRACE_MAGIC         0x45435254u     // "TRCE"
+#define TRACE_VERSION       1u
+#define TRACE_ARG_MASK      0x00FFFFFFu
+
+//Event types, the record's top byte
+typedef enum
+{
+  TRACE_EV_NONE = 0,
+  TRACE_EV_DMA_HALF,        // DMA finished a ring half (interrupt), arg: half 0 or 1
+  TRACE_EV_REFILL_START,    // Slot refill started, arg: slot
+  TRACE_EV_REFILL_END,      // Slot refill done, arg: slot
+  TRACE_EV_LATE_REFILL,     // Slot refilled after the DMA had freed the next half, arg: slot
+  TRACE_EV_EVENT_OVERRUN,   // Buffer event dropped, the event queue was full (interrupt), arg: slot
+  TRACE_EV_FILE_READ,       // Read-ahead f_read, arg: bytes read
+  TRACE_EV_UNDERRUN,        // Read-ahead FIFO ran dry, arg: bytes missing
+  TRACE_EV_CODEC_CMD,       // Codec write put on the I2C bus, arg: register | count << 8 | first value << 16
+  TRACE_EV_CODEC_ERROR,     // Codec write failed, arg: register
+  TRACE_EV_PLAYER,          // Player state change, arg: TRACE_PLAYER_... | value << 4
+  TRACE_EV_USB,             // USB host application state, arg: ApplicationTypeDef
+  TRACE_EV_BUTTON,          // User button action, arg: TRACE_BUTTON_...
+  TRACE_EV_MARK,            // Free marker, arg: anything
+  TRACE_EV_COUNT
+}TRACE_EventTypeDef;
+
+//Player state changes, the low 4 bits of a TRACE_EV_PLAYER argument
+typedef enum
+{
+  TRACE_PLAYER_PLAY = 0,    // value: output rate in Hz
+  TRACE_PLAYER_STOP,
+  TRACE_PLAYER_PAUSE,       // Fade out started
+  TRACE_PLAYER_SILENT,      // Fade out done, the ring plays zeros
+  TRACE_PLAYER_POWER_DOWN,  // Pause idle timeout, codec powered down
+  TRACE_PLAYER_RESUME,
+  TRACE_PLAYER_END_OF_FILE,
+  TRACE_PLAYER_TRACK_CHANGE, // Gapless switch to the queued file, value: switches so far
+  TRACE_PLAYER_COUNT
+}TRACE_PlayerEventTypeDef;
+
+//User button actions
+typedef enum
+{
+  TRACE_BUTTON_PLAY = 0,
+  TRACE_BUTTON_PAUSE,
+  TRACE_BUTTON_RESUME,
+  TRACE_BUTTON_STOP,
+  TRACE_BUTTON_COUNT
+}TRACE_ButtonEventTypeDef;
+
+//One event, 8 bytes little endian as saved
+typedef struct
+{
+  uint32_t time;            // stageProf_now() ticks, wrapping
+  uint32_t event;           // Type << 24 | argument
+}TRACE_RecordTypeDef;
+
+//Trace buffer, saved as it is laid out in memory
+typedef struct
+{
+  uint32_t magic;           // TRACE_MAGIC
+  uint16_t version;         // TRACE_VERSION
+  uint16_t recordBytes;     // sizeof(TRACE_RecordTypeDef)
+  uint32_t records;         // Ring length
+  uint32_t tickHz;          // Time stamp rate, set by trace_init()
+  volatile uint32_t head;   // Events written since trace_init(), the next one goes to ring[head % records]
+  uint32_t reserved[3];
+  TRACE_RecordTypeDef ring[TRACE_RECORDS];
+}TRACE_BufferTypeDef;
+
+extern TRACE_BufferTypeDef traceBuffer;
+
+// Record an event, from any context: a counter read, an atomic increment and two stores.
+// The record is claimed before the time is read, so records are in claim order, not time order:
+// an interrupt taken between the two leaves its record after this one with an earlier time.
+static inline void trace_event(TRACE_EventTypeDef type, uint32_t arg)
+{
+  uint32_t index = __atomic_fetch_add(&traceBuffer.head, 1u, __ATOMIC_RELAXED) & (TRACE_RECORDS - 1u);
+
+  traceBuffer.ring[index].time = stageProf_now();
+  traceBuffer.ring[index].event = ((uint32_t)type << 24) | (arg & TRACE_ARG_MASK);
+}
+
+//Event hook, removed with TRACE_ENABLE=0
+#if TRACE_ENABLE
+#define TRACE_EVENT(type, arg)      trace_event((type), (uint32_t)(arg))
+#else
+#define TRACE_EVENT(type, arg)      ((void)0)
+#endif
+
+/* Trace function prototypes */
+
+void trace_init(void);
+bool trace_save(const char *path);
+uint32_t trace_getCount(void);
+const char *trace_eventName(uint8_t type);
+const char *trace_playerName(uint8_t event);
+const char *trace_buttonName(uint8_t event);
+
+#endif /* TRACE_H_ */
@@ -0,0 +1,56 @@
+/*
+Library:				wav_library.h
+Written by:				Shridattha M Hebbar
+Date Written:			16/10/2026
+Description:			Cached index of the WAV files on the USB drive. The format, data chunk index and
+						duration of every .wav file are kept in a binary index file on the drive, one
+						fixed-size record per file keyed by its path, size and modification time. A mount
+						loads the index with one read and is ready at once; the volume is then rescanned
+						in small steps from the main loop. Only files whose key changed, and new files,
+						have their header parsed, and the index is rewritten only when something changed.
+*/
+
+#ifndef WAV_LIBRARY_H_
+#define WAV_LIBRARY_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "fatfs.h"
+
+#define WAV_LIBRARY_FILE            "wavlib.idx"
+#define WAV_LIBRARY_TEMP            "wavlib.tmp"    // New index while a rescan writes it
+#define WAV_LIBRARY_PATH_MAX        64u     // Path bytes from the root, terminator included
+#define WAV_LIBRARY_MAX_DEPTH       4u      // Directory levels scanned, the root included
+#define WAV_LIBRARY_READ_RECORDS    8u      // Index records read at once
+#define WAV_LIBRARY_LOOKAHEAD       16u     // Index records searched for a file that moved up
+#define WAV_LIBRARY_SCAN_STEP       8u      // Directory entries per wavLibrary_process() in the main loop
+
+//Index file record, 96 bytes, little endian as stored on the drive
+typedef struct
+{
+  uint32_t size;            // File size, with date and time the key that tells a file changed
+  uint16_t date;            // FAT modification date
+  uint16_t time;            // FAT modification time
+  uint32_t sampleRate;      // 0 when the file is not a WAV the player supports
+  uint32_t dataOffset;      // File offset of the first frame
+  uint32_t dataBytes;       // Bytes of whole frames
+  uint32_t durationMs;
+  uint16_t encoding;        // WAV_RIFF_PCM or WAV_RIFF_FLOAT
+  uint16_t blockAlign;
+  uint8_t  channels;
+  uint8_t  bitsPerSample;
+  uint16_t reserved;
+  char     path[WAV_LIBRARY_PATH_MAX];
+}WAV_LIBRARY_EntryTypeDef;
+
+/* WAV library function prototypes */
+
+bool wavLibrary_mount(void);
+void wavLibrary_unmount(void);
+bool wavLibrary_process(uint32_t maxEntries);
+bool wavLibrary_isScanning(void);
+uint32_t wavLibrary_getCount(void);
+bool wavLibrary_getEntry(uint32_t index, WAV_LIBRARY_EntryTypeDef *entry);
+uint32_t wavLibrary_getParsed(void);
+
+#endif /* WAV_LIBRARY_H_ */
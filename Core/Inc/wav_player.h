@@ -13,8 +13,40 @@ References:
 
 #include <stdbool.h>
 #include <stdint.h>
+#include "echo.h"
+#include "resampler.h"
 
 
+//Audio ring: slots of slotFrames frames, played by circular DMA (see wavPlayer_setBuffering)
+#define WAV_RING_MAX_BYTES          8192u   // Ring memory, 2048 frames of 16-bit stereo
+#define WAV_RING_MAX_SLOTS          8u
+#define WAV_SLOT_MIN_FRAMES         16u
+
+//Read-ahead FIFO between the USB drive and the audio ring, ~280 ms of 44.1 kHz 16-bit stereo
+#define WAV_FIFO_BYTES              (48u * 1024u)
+//FatFs fast-seek link map of the playing file, 2 DWORDs per fragment plus 2: files of up to 31 fragments
+#define WAV_LINKMAP_ENTRIES         64u
+
+//Buffering profiles: slot frames x slots
+#define WAV_LOW_LATENCY_SLOT_FRAMES 32u     // 4 x 32 frames: 2.9 ms ring at 44.1 kHz, 1.5 ms refill deadline
+#define WAV_LOW_LATENCY_SLOTS       4u
+#define WAV_BALANCED_SLOT_FRAMES    128u    // 2 x 128 frames: the original 1 KB ping-pong buffer
+#define WAV_BALANCED_SLOTS          2u
+#define WAV_THROUGHPUT_SLOT_FRAMES  512u    // 4 x 512 frames: 46 ms ring, 23 ms deadline, 2 KB reads
+#define WAV_THROUGHPUT_SLOTS        4u
+
+//Soft pause: fade length, rounded up to whole slots, and the idle time before the codec powers down
+#define WAV_PAUSE_RAMP_MS           5u
+#define WAV_PAUSE_IDLE_MS           5000u
+#define WAV_PAUSE_IDLE_NEVER        0xFFFFFFFFu
+
+typedef enum
+{
+  WAV_PROFILE_LOW_LATENCY = 0,   // Small blocks, lowest delay from file to output
+  WAV_PROFILE_BALANCED,          // Default
+  WAV_PROFILE_THROUGHPUT,        // Large blocks: fewer USB reads and DSP passes, more margin
+}WAV_ProfileTypeDef;
+
 //Audio buffer state
 typedef enum
 {
@@ -52,12 +84,34 @@ typedef struct
 /* WavPlayer library function prototypes */
 
 bool wavPlayer_fileSelect(const char* filePath);
+bool wavPlayer_queueNext(const char* filePath);
+bool wavPlayer_isNextQueued(void);
+uint32_t wavPlayer_getTrackChanges(void);
 void wavPlayer_play(void);
 void wavPlayer_stop(void);
 void wavPlayer_process(void);
 bool wavPlayer_isFinished(void);
 void wavPlayer_pause(void);
 void wavPlayer_resume(void);
+void wavPlayer_setPauseIdleTimeout(uint32_t ms);
+bool wavPlayer_isPaused(void);
+bool wavPlayer_seek(uint32_t ms);
+uint32_t wavPlayer_getPositionMs(void);
+uint32_t wavPlayer_getLengthMs(void);
+void wavPlayer_setEchoDelay(uint32_t delayMs);
+void wavPlayer_setEchoStorage(ECHO_StorageTypeDef storage);
+void wavPlayer_setEchoMode(ECHO_ModeTypeDef mode, float damping);
+void wavPlayer_setImpulse(const char* filePath);
+uint32_t wavPlayer_getImpulseFrames(void);
+uint32_t wavPlayer_getEchoMemory(void);
+uint32_t wavPlayer_getOverruns(void);
+uint32_t wavPlayer_getLateRefills(void);
+uint32_t wavPlayer_getFifoUnderruns(void);
+bool wavPlayer_isFastSeek(void);
+void wavPlayer_setResampleQuality(RESAMPLER_QualityTypeDef quality);
+uint32_t wavPlayer_getOutputRate(void);
+bool wavPlayer_setBuffering(uint32_t slotFrames, uint8_t slots);
+void wavPlayer_setProfile(WAV_ProfileTypeDef profile);
 
 
 #endif /* WAV_PLAYER_H_ */
@@ -0,0 +1,59 @@
+/*
+Library:				wav_riff.h
+Written by:				Shridattha M Hebbar
+Date Written:			16/10/2026
+Description:			RIFF/WAVE chunk walker. Finds the "fmt " and "data" chunks wherever they are,
+						skipping LIST, fact, cue and other chunks, and records the stream format with
+						the file offset and length of the sample data. Reads go through a callback,
+						so the parser serves FatFs files on the target and memory or host files in tools.
+References:
+			1) Microsoft/IBM, "Multimedia Programming Interface and Data Specifications 1.0", 1991
+			2) Microsoft, "WAVEFORMATEXTENSIBLE", Windows multimedia documentation
+*/
+
+#ifndef WAV_RIFF_H_
+#define WAV_RIFF_H_
+
+#include <stdint.h>
+
+//Sample encodings (format tags, WAVE_FORMAT_EXTENSIBLE is resolved to its sub format)
+#define WAV_RIFF_PCM          0x0001u
+#define WAV_RIFF_FLOAT        0x0003u
+#define WAV_RIFF_EXTENSIBLE   0xFFFEu
+
+#define WAV_RIFF_MAX_CHANNELS 8u
+
+typedef enum
+{
+  WAV_RIFF_OK = 0,
+  WAV_RIFF_ERR_READ,          // The file ended inside a header
+  WAV_RIFF_ERR_NOT_WAVE,      // No RIFF/WAVE signature
+  WAV_RIFF_ERR_NO_FMT,        // No "fmt " chunk before the sample data
+  WAV_RIFF_ERR_NO_DATA,       // No "data" chunk
+  WAV_RIFF_ERR_FORMAT,        // Encoding, sample size or frame layout not supported
+}WAV_RIFF_StatusTypeDef;
+
+//Stream description and data chunk index
+typedef struct
+{
+  uint16_t encoding;          // WAV_RIFF_PCM or WAV_RIFF_FLOAT
+  uint16_t channels;          // Samples per frame, 1 .. WAV_RIFF_MAX_CHANNELS
+  uint32_t sampleRate;        // Frames per second
+  uint16_t blockAlign;        // Bytes per frame
+  uint16_t bitsPerSample;     // Container bits of one sample: 8, 16, 24 or 32 (PCM), 32 (float)
+  uint32_t dataOffset;        // File offset of the first frame
+  uint32_t dataBytes;         // Bytes of whole frames, cut to what the file really holds
+  uint32_t frames;            // dataBytes / blockAlign
+}WAV_RIFF_InfoTypeDef;
+
+//Read bytes at a file offset, returns the bytes read (fewer at the end of the file)
+typedef uint32_t (*WAV_RIFF_ReadFunc)(void *ctx, uint32_t offset, void *dst, uint32_t bytes);
+
+/* RIFF parser function prototypes */
+
+WAV_RIFF_StatusTypeDef wavRiff_parse(WAV_RIFF_InfoTypeDef *info, WAV_RIFF_ReadFunc read, void *ctx,
+                                     uint32_t fileSize);
+uint32_t wavRiff_frameOffset(const WAV_RIFF_InfoTypeDef *info, uint32_t frame);
+uint32_t wavRiff_msToFrame(const WAV_RIFF_InfoTypeDef *info, uint32_t ms);
+
+#endif /* WAV_RIFF_H_ */
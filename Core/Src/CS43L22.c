@@ -12,25 +12,223 @@ References:
 
 
 #include "CS43L22.h"
+#include "trace.h"
 
-static I2C_HandleTypeDef i2cx;
+#define CS43L22_QUEUE_SYNC		0xFFu	// Command register of a sync point, not a codec register
+#define CS43L22_MAP_SIZE		(CS43L22_REG_CHARGE_PUMP_FREQ + 1u)		// Registers held in the shadow
+
+static I2C_HandleTypeDef *i2cx;		// The handle the I2C interrupt handlers complete transfers on
 extern I2S_HandleTypeDef hi2s3;
 
 uint8_t OutputDev = 0;
 
+//Command queue: written by the caller at cmdHead, sent from cmdTail by the I2C interrupt.
+//The entry at cmdHead collects a burst while burstOpen; it is queued at the end of each call.
+typedef struct
+{
+  uint8_t reg;                        // First register, CS43L22_QUEUE_SYNC for a sync point
+  uint8_t len;                        // Registers written from reg on, by MAP auto-increment when more than one
+  bool ordered;                       // Sent as written: never merged with other writes
+  uint8_t data[CS43L22_BURST_MAX];    // Sent from here, so it stays put until the write completes
+  CS43L22_CallbackTypeDef callback;   // Sync point callback
+  void *ctx;
+}CS43L22_CommandTypeDef;
+
+static CS43L22_CommandTypeDef cmdQueue[CS43L22_QUEUE_SIZE];
+static volatile uint32_t cmdHead = 0;
+static volatile uint32_t cmdTail = 0;
+static volatile bool cmdBusy = false;		// A write is on the bus, its completion interrupt sends the next
+static volatile uint32_t cmdErrors = 0;
+static uint32_t cmdStalls = 0;
+static bool burstOpen = false;
+
+//Shadow of the register map: the values the codec holds once the queue has drained. A register
+//enters it when it is read or written; until then writes to it always go out.
+static uint8_t regShadow[CS43L22_MAP_SIZE];
+static volatile bool regValid[CS43L22_MAP_SIZE];	// Cleared when a write to the register failed
+static uint32_t regSkipped = 0;
+
 //--------------------------------------------------------------//
 //---------------------- Static functions ----------------------//
 //--------------------------------------------------------------//
 
-// (1): Write to register
+// Status and ID registers are read-only and change on their own, so they are never cached
+static bool isCached(uint8_t reg)
+{
+	return reg < CS43L22_MAP_SIZE && reg != CS43L22_REG_ID && reg != CS43L22_REG_OVF_CLK_STATUS
+	       && reg != CS43L22_REG_VP_BATTERY_LEVEL && reg != CS43L22_REG_SPEAKER_STATUS;
+}
+
+// A failed write leaves the codec's value unknown, so the next write of those registers must go out
+static void invalidate(const CS43L22_CommandTypeDef *cmd)
+{
+	for (uint32_t i = 0; i < cmd->len; i++)
+	{
+		if (cmd->reg + i < (uint32_t)CS43L22_MAP_SIZE)
+		{
+			regValid[cmd->reg + i] = false;
+		}
+	}
+}
+
+// Run the sync points at the tail of the queue and put the next write on the bus. Called from
+// the I2C interrupt, or by the caller when the bus is idle (no interrupt can then be pending).
+static void sendNext(void)
+{
+	while (cmdTail != cmdHead)
+	{
+		CS43L22_CommandTypeDef *cmd = &cmdQueue[cmdTail & (CS43L22_QUEUE_SIZE - 1u)];
+
+		if (cmd->reg != CS43L22_QUEUE_SYNC)
+		{
+			uint16_t map = (cmd->len > 1u) ? (cmd->reg | CS43L22_MAP_INCR) : cmd->reg;
+
+			cmdBusy = true;
+			if (HAL_I2C_Mem_Write_IT(i2cx, DAC_I2C_ADDR, map, I2C_MEMADD_SIZE_8BIT, cmd->data, cmd->len) == HAL_OK)
+			{
+				TRACE_EVENT(TRACE_EV_CODEC_CMD, cmd->reg | ((uint32_t)cmd->len << 8) | ((uint32_t)cmd->data[0] << 16));
+				return;
+			}
+			cmdBusy = false;
+			cmdErrors++;			// Not sent, keep the rest of the queue going
+			TRACE_EVENT(TRACE_EV_CODEC_ERROR, cmd->reg);
+			invalidate(cmd);
+		}
+		else if (cmd->callback)
+		{
+			cmd->callback(cmd->ctx);
+		}
+		cmdTail++;
+	}
+}
+
+// Queue the open burst, the interrupt may send it from now on
+static void closeBurst(void)
+{
+	if (burstOpen)
+	{
+		burstOpen = false;
+		cmdHead++;
+		if (!cmdBusy)
+		{
+			sendNext();
+		}
+	}
+}
+
+// The entry at cmdHead, waiting for the interrupt to free one only when the queue is full.
+// reg names the command in the error count and trace when the wait times out.
+static CS43L22_CommandTypeDef *newCommand(uint8_t reg)
+{
+	closeBurst();
+	if (cmdHead - cmdTail >= CS43L22_QUEUE_SIZE)
+	{
+		uint32_t start = HAL_GetTick();
+
+		cmdStalls++;
+		while (cmdHead - cmdTail >= CS43L22_QUEUE_SIZE)
+		{
+			if (HAL_GetTick() - start > CS43L22_FLUSH_TIMEOUT)
+			{
+				cmdErrors++;		// Bus stuck, the command is lost
+				TRACE_EVENT(TRACE_EV_CODEC_ERROR, reg);
+				return NULL;
+			}
+		}
+	}
+	return &cmdQueue[cmdHead & (CS43L22_QUEUE_SIZE - 1u)];
+}
+
+// Update the shadow and add the write to the open burst when it extends or overlaps it,
+// otherwise start a new one. Writes of the value the codec already holds are dropped.
+static void queueWrite(uint8_t reg, uint8_t value, bool ordered)
+{
+	CS43L22_CommandTypeDef *cmd = &cmdQueue[cmdHead & (CS43L22_QUEUE_SIZE - 1u)];
+
+	if (isCached(reg))
+	{
+		if (!ordered && regValid[reg] && regShadow[reg] == value)
+		{
+			regSkipped++;
+			return;
+		}
+		regShadow[reg] = value;
+		regValid[reg] = true;
+	}
+	if (burstOpen && !ordered && !cmd->ordered && reg >= cmd->reg && reg <= cmd->reg + cmd->len
+	    && (uint32_t)(reg - cmd->reg) < CS43L22_BURST_MAX)
+	{
+		cmd->data[reg - cmd->reg] = value;
+		if (reg == cmd->reg + cmd->len)
+		{
+			cmd->len++;
+		}
+		return;
+	}
+	cmd = newCommand(reg);
+	if (cmd == NULL)
+	{
+		if (isCached(reg))		// The codec may not hold the shadow value
+		{
+			regValid[reg] = false;
+		}
+		return;
+	}
+	cmd->reg = reg;
+	cmd->len = 1;
+	cmd->ordered = ordered;
+	cmd->data[0] = value;
+	cmd->callback = NULL;
+	burstOpen = true;
+	if (ordered)
+	{
+		closeBurst();
+	}
+}
+
+// (1): Write to register, queued and merged into auto-increment bursts
 static void write_register(uint8_t reg, uint8_t *data)
 {
-	 HAL_I2C_Mem_Write(&i2cx, DAC_I2C_ADDR, (uint16_t)reg, I2C_MEMADD_SIZE_8BIT, data, 1, 100);
+	queueWrite(reg, *data, false);
+}
+// (1b): Write to register, queued on its own even when the value is unchanged (hidden register sequences)
+static void write_register_ordered(uint8_t reg, uint8_t *data)
+{
+	queueWrite(reg, *data, true);
+}
+// Fill the shadow of count registers from first on with one auto-increment read, after the queued writes
+static bool readRegisters(uint8_t first, uint8_t count)
+{
+	uint16_t map = (count > 1u) ? (first | CS43L22_MAP_INCR) : first;
+
+	if (!CS43L22_Flush(CS43L22_FLUSH_TIMEOUT)
+	    || HAL_I2C_Mem_Read(i2cx, DAC_I2C_ADDR, map, I2C_MEMADD_SIZE_8BIT, &regShadow[first], count, 100) != HAL_OK)
+	{
+		return false;
+	}
+	for (uint8_t reg = first; reg < first + count; reg++)
+	{
+		regValid[reg] = isCached(reg);
+	}
+	return true;
 }
-// (2): Read from register
-static void read_register(uint8_t reg, uint8_t *data)
+// (2): Read from register: the shadow when it holds the register, otherwise the codec after the queued writes
+static bool read_register(uint8_t reg, uint8_t *data)
 {
-	 HAL_I2C_Mem_Write(&i2cx, DAC_I2C_ADDR, (uint16_t)reg, I2C_MEMADD_SIZE_8BIT, data, 1, 100);
+	if (isCached(reg))
+	{
+		if (!regValid[reg] && !readRegisters(reg, 1))
+		{
+			return false;
+		}
+		*data = regShadow[reg];
+		return true;
+	}
+	if (!CS43L22_Flush(CS43L22_FLUSH_TIMEOUT))
+	{
+		return false;
+	}
+	return HAL_I2C_Mem_Read(i2cx, DAC_I2C_ADDR, (uint16_t)reg, I2C_MEMADD_SIZE_8BIT, data, 1, 100) == HAL_OK;
 }
 
 //--------------------------------------------------------------//
@@ -40,20 +238,32 @@ static void read_register(uint8_t reg, uint8_t *data)
 
 /**
   * @brief Initializes the audio codec and the control interface.
-  * @param i2c_handle: I2C Handle configured for CS43L22 (Generally I2C1)
+  * @note Reads the register map, then waits until the settings are on the codec. Writes of
+  *       values the codec already holds are skipped. Later calls only queue their writes.
+  * @param i2c_handle: I2C Handle configured for CS43L22 (Generally I2C1), with its event and
+  *                    error interrupts enabled; kept by reference
   * @param OutputDevice: can be OUTPUT_DEVICE_SPEAKER, OUTPUT_DEVICE_HEADPHONE,
   *                       OUTPUT_DEVICE_BOTH or OUTPUT_DEVICE_AUTO .
   * @retval none
   */
 
-void CS43L22_Init(I2C_HandleTypeDef i2c_handle, uint8_t outputDevice)
+void CS43L22_Init(I2C_HandleTypeDef *i2c_handle, uint8_t outputDevice)
 {
   uint8_t Data;
 	__HAL_UNLOCK(&hi2s3);     // THIS IS EXTREMELY IMPORTANT FOR I2S3 TO WORK!!
 	__HAL_I2S_ENABLE(&hi2s3); // THIS IS EXTREMELY IMPORTANT FOR I2S3 TO WORK!!
 	HAL_GPIO_WritePin(GPIOD, GPIO_PIN_4, GPIO_PIN_SET);
 
+	CS43L22_Flush(CS43L22_FLUSH_TIMEOUT);
 	i2cx = i2c_handle;	// Get the I2C handle
+	// The codec keeps its registers over an MCU reset, so they are read, not assumed. One burst
+	// covers the power, clock, interface and passthrough registers set below.
+	for (uint8_t reg = 0; reg < CS43L22_MAP_SIZE; reg++)
+	{
+		regValid[reg] = false;
+	}
+	readRegisters(CS43L22_REG_POWER_CTL1, CS43L22_REG_PASSTHR_B_SELECT - CS43L22_REG_POWER_CTL1 + 1u);
+	readRegisters(CONFIG_32, 1);		// For CS43L22_Start(), which must not wait for a read
 
 	Data = 0x01;
 	write_register(CS43L22_REG_POWER_CTL1, &Data);	// Keep Codec powered OFF
@@ -110,12 +320,10 @@ void CS43L22_Init(I2C_HandleTypeDef i2c_handle, uint8_t outputDevice)
 	write_register(CS43L22_REG_PASSTHR_B_SELECT, &Data);
 
 	// Miscellaneous register settings
-	read_register(CS43L22_REG_MISC_CTL, &Data);
 	Data = 0x02;
 	write_register(CS43L22_REG_MISC_CTL, &Data);
 
 	// Unmute headphone and speaker
-	read_register(CS43L22_REG_PLAYBACK_CTL2, &Data);
 	Data = 0x00;
 	write_register(CS43L22_REG_PLAYBACK_CTL2, &Data);
 
@@ -125,6 +333,7 @@ void CS43L22_Init(I2C_HandleTypeDef i2c_handle, uint8_t outputDevice)
 	write_register(CS43L22_REG_PASSTHR_B_VOL, &Data);
 	write_register(CS43L22_REG_PCMA_VOL, &Data);
 	write_register(CS43L22_REG_PCMB_VOL, &Data);
+	CS43L22_Flush(CS43L22_FLUSH_TIMEOUT);
 }
 
 /**
@@ -166,6 +375,7 @@ void CS43L22_SetVolume(uint8_t volume)
 	/* Set the Master volume */
 	write_register(CS43L22_REG_MASTER_A_VOL, &Data);
 	write_register(CS43L22_REG_MASTER_B_VOL, &Data);
+	closeBurst();
 }
 
 /**
@@ -195,11 +405,12 @@ void CS43L22_SetMute(uint8_t cmd)
     Data= 0xAF;
     write_register(CS43L22_REG_POWER_CTL2,&Data);
   }
+  closeBurst();
 }
 
 /**
   * @brief Start the audio Codec play feature.
-  * @note For this codec no Play options are required.
+  * @note For this codec no Play options are required. The writes are queued, see CS43L22_Sync().
   * @param None
   * @retval None
   */
@@ -209,28 +420,30 @@ void CS43L22_Start(void)
   uint8_t Data;
   CS43L22_SetMute(AUDIO_MUTE_OFF);
 
+  // Hidden register sequence from the errata, every write must reach the codec in this order
   Data = 0x99;
-  write_register(CONFIG_00, &Data);		// Write 0x99 to register 0x00.
+  write_register_ordered(CONFIG_00, &Data);		// Write 0x99 to register 0x00.
   Data = 0x80;
-  write_register(CONFIG_47, &Data);		// Write 0x80 to register 0x47.
+  write_register_ordered(CONFIG_47, &Data);		// Write 0x80 to register 0x47.
 
   read_register(CONFIG_32, &Data);
   Data |= 0x80;
-  write_register(CONFIG_32, &Data);		// Write '1'b to bit 7 in register 0x32.
+  write_register_ordered(CONFIG_32, &Data);		// Write '1'b to bit 7 in register 0x32.
 
-  read_register(CONFIG_32, &Data);
   Data &= ~(0x80);
-  write_register(CONFIG_32, &Data);		// Write '0'b to bit 7 in register 0x32.
+  write_register_ordered(CONFIG_32, &Data);		// Write '0'b to bit 7 in register 0x32.
 
   Data = 0x00;
-  write_register(CONFIG_00, &Data);		// Write 0x00 to register 0x00.
+  write_register_ordered(CONFIG_00, &Data);		// Write 0x00 to register 0x00.
 
   Data = 0x9E;
   write_register(CS43L22_REG_POWER_CTL1, &Data);		//Set the "Power Ctl 1" register (0x02) to 0x9E
+  closeBurst();
 }
 
 /**
   * @brief Stops audio Codec playing. It powers down the codec.
+  * @note The writes are queued, see CS43L22_Sync().
   * @param None
   *
   * @retval None
@@ -244,4 +457,138 @@ void CS43L22_Stop(void)
   write_register(CS43L22_REG_MISC_CTL, &Data);
   Data = 0x9F;
 	write_register(CS43L22_REG_POWER_CTL1, &Data);
+	closeBurst();
+}
+
+/**
+  * @brief Queue a sync point after the commands queued so far.
+  * @param callback: called from the I2C interrupt once they are on the codec, or at once
+  *                  when the queue is empty
+  * @param ctx: passed to callback
+  * @retval None
+  */
+
+void CS43L22_Sync(CS43L22_CallbackTypeDef callback, void *ctx)
+{
+	CS43L22_CommandTypeDef *cmd = newCommand(CS43L22_QUEUE_SYNC);
+
+	if (cmd == NULL)
+	{
+		return;
+	}
+	cmd->reg = CS43L22_QUEUE_SYNC;
+	cmd->len = 0;
+	cmd->callback = callback;
+	cmd->ctx = ctx;
+	burstOpen = true;
+	closeBurst();
+}
+
+/**
+  * @brief Wait until every queued command is on the codec.
+  * @param timeout: milliseconds to wait
+  * @retval false when the queue did not drain in time
+  */
+
+bool CS43L22_Flush(uint32_t timeout)
+{
+	uint32_t start;
+
+	closeBurst();
+	start = HAL_GetTick();
+	while (cmdTail != cmdHead)
+	{
+		if (HAL_GetTick() - start > timeout)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+/**
+  * @brief Whether queued commands are still going out.
+  * @param None
+  * @retval true while the queue holds commands
+  */
+
+bool CS43L22_IsBusy(void)
+{
+	return burstOpen || cmdTail != cmdHead;
+}
+
+/**
+  * @brief Register writes that failed on the bus and were skipped, and commands dropped
+  *        because the queue stayed full for CS43L22_FLUSH_TIMEOUT.
+  * @param None
+  * @retval error count since power-up
+  */
+
+uint32_t CS43L22_GetErrors(void)
+{
+	return cmdErrors;
+}
+
+/**
+  * @brief Times a caller waited for a free queue entry.
+  * @param None
+  * @retval stall count since power-up, 0 when CS43L22_QUEUE_SIZE is large enough
+  */
+
+uint32_t CS43L22_GetQueueStalls(void)
+{
+	return cmdStalls;
+}
+
+/**
+  * @brief Register writes dropped because the codec already held the value.
+  * @param None
+  * @retval skipped writes since power-up
+  */
+
+uint32_t CS43L22_GetSkippedWrites(void)
+{
+	return regSkipped;
+}
+
+/**
+  * @brief Read a codec register: from the shadow for control registers, from the codec
+  *        (after the queued writes) for the ID and status registers.
+  * @param reg: register address
+  * @param value: register contents
+  * @retval false when the codec did not answer
+  */
+
+bool CS43L22_ReadRegister(uint8_t reg, uint8_t *value)
+{
+	return read_register(reg, value);
+}
+
+/**
+  * @brief I2C completion interrupts: send the next queued command
+  * @param hi2c: I2C handle
+  * @retval None
+  */
+
+void HAL_I2C_MemTxCpltCallback(I2C_HandleTypeDef *hi2c)
+{
+	if (hi2c == i2cx)
+	{
+		cmdBusy = false;
+		cmdTail++;
+		sendNext();
+	}
+}
+
+void HAL_I2C_ErrorCallback(I2C_HandleTypeDef *hi2c)
+{
+	if (hi2c == i2cx)
+	{
+		cmdErrors++;
+		TRACE_EVENT(TRACE_EV_CODEC_ERROR, cmdQueue[cmdTail & (CS43L22_QUEUE_SIZE - 1u)].reg);
+		invalidate(&cmdQueue[cmdTail & (CS43L22_QUEUE_SIZE - 1u)]);
+		cmdBusy = false;
+		cmdTail++;
+		sendNext();
+	}
 }
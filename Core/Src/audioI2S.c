@@ -16,8 +16,10 @@ References:
 const uint32_t I2SFreq[8] = {8000, 11025, 16000, 22050, 32000, 44100, 48000, 96000};
 const uint32_t I2SPLLN[8] = {256, 429, 213, 429, 426, 271, 258, 344};
 const uint32_t I2SPLLR[8] = {5, 4, 4, 4, 4, 6, 3, 1};
+#define I2S_FREQ_COUNT  (sizeof(I2SFreq) / sizeof(I2SFreq[0]))
 
 static I2S_HandleTypeDef *hAudioI2S;
+static uint32_t i2sAudioFreq = 0;   // Rate the PLL and I2S are set up for, 0 before the first init
 
 //--------------------------------------------------------------//
 //---------------------- Static functions ----------------------//
@@ -32,7 +34,7 @@ static void audioI2S_pllClockConfig(uint32_t audioFreq)
   RCC_PeriphCLKInitTypeDef rccclkinit;
   uint8_t index = 0, freqindex = 0xFF;
 
-  for(index = 0; index < 8; index++)
+  for(index = 0; index < I2S_FREQ_COUNT; index++)
   {
     if(I2SFreq[index] == audioFreq)
     {
@@ -42,7 +44,7 @@ static void audioI2S_pllClockConfig(uint32_t audioFreq)
   /* Enable PLLI2S clock */
   HAL_RCCEx_GetPeriphCLKConfig(&rccclkinit);
   /* PLLI2S_VCO Input = HSE_VALUE/PLL_M = 1 Mhz */
-  if ((freqindex & 0x7) == 0)
+  if (freqindex < I2S_FREQ_COUNT)
   {
     /* I2S clock config
     PLLI2S_VCO = f(VCO clock) = f(PLLI2S clock input) * (PLLI2SN/PLLM)
@@ -64,6 +66,22 @@ static void audioI2S_pllClockConfig(uint32_t audioFreq)
   }
 }
 
+/**
+ * @brief Codec sync point callbacks: move the DMA once the queued codec writes are done
+ * @param ctx: unused
+ */
+static void audioI2S_dmaPause(void *ctx)
+{
+  (void)ctx;
+  HAL_I2S_DMAPause(hAudioI2S);
+}
+
+static void audioI2S_dmaResume(void *ctx)
+{
+  (void)ctx;
+  HAL_I2S_DMAResume(hAudioI2S);
+}
+
 /**
  * @brief update I2S peripheral with selected Sampling Frequency
  * @param audioFreq: Sampling Frequency of the given audio.
@@ -109,18 +127,65 @@ void audioI2S_setHandle(I2S_HandleTypeDef *pI2Shandle)
   hAudioI2S = pI2Shandle;
 }
 
+/**
+ * @brief Whether the I2S PLL has a setting for a sampling frequency
+ * @param audioFreq: sampling frequency in Hz
+ * @retval true when audioFreq is in the PLL table
+ */
+bool audioI2S_isSupportedFreq(uint32_t audioFreq)
+{
+  for(uint8_t index = 0; index < I2S_FREQ_COUNT; index++)
+  {
+    if(I2SFreq[index] == audioFreq)
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * @brief Output frequency to play a sampling frequency at
+ * @param audioFreq: sampling frequency in Hz
+ * @retval audioFreq when supported, else the lowest supported frequency above it (so no
+ *         audio band is lost), or the highest supported frequency
+ */
+uint32_t audioI2S_nearestFreq(uint32_t audioFreq)
+{
+  for(uint8_t index = 0; index < I2S_FREQ_COUNT; index++)
+  {
+    if(I2SFreq[index] >= audioFreq)
+    {
+      return I2SFreq[index];
+    }
+  }
+  return I2SFreq[I2S_FREQ_COUNT - 1];
+}
+
 /* I2S Audio library function definitions */
 /**
  * @brief Initialises I2S Audio settings
+ * @note Does nothing when the rate is the one already set up
  * @param audioFreq - WAV file Audio sampling rate (44.1KHz, 48KHz, ...)
  * @retval state - true: Successfully, false: Failed
  */
 bool audioI2S_init(uint32_t audioFreq)
 {
+  //Same rate as the last stream: the PLL and I2S are set up already, and re-locking the PLL
+  //only adds a gap between tracks
+  if(audioFreq == i2sAudioFreq)
+  {
+    return true;
+  }
   //Update PLL Clock Frequency setting
   audioI2S_pllClockConfig(audioFreq);
   //Update I2S peripheral sampling frequency
-  I2S3_freqUpdate(audioFreq);
+  if(!I2S3_freqUpdate(audioFreq))
+  {
+    i2sAudioFreq = 0;
+    return false;
+  }
+  i2sAudioFreq = audioFreq;
   return true;
 }
 
@@ -152,6 +217,7 @@ bool audioI2S_changeBuffer(uint16_t* pDataBuf, uint32_t len)
 
 /**
  * @brief Pause audio out
+ * @note Returns at once: the codec powers down by I2C interrupt and the DMA pauses after it.
  * @param None
  * @retvalue None
  */
@@ -159,18 +225,19 @@ bool audioI2S_changeBuffer(uint16_t* pDataBuf, uint32_t len)
 void audioI2S_pause(void)
 {
   CS43L22_Stop();
-  HAL_I2S_DMAPause(hAudioI2S);
+  CS43L22_Sync(audioI2S_dmaPause, NULL);
 }
 
 /**
  * @brief Resume audio out
+ * @note Returns at once: the DMA resumes after any pending codec writes, then the codec powers up.
  * @param None
  * @retvalue None
  */
 void audioI2S_resume(void)
 {
+  CS43L22_Sync(audioI2S_dmaResume, NULL);
   CS43L22_Start();
-  HAL_I2S_DMAResume(hAudioI2S);
 }
 
 /**
@@ -185,12 +252,14 @@ void audioI2S_setVolume(uint8_t volume)
 
 /**
  * @brief Stop audio
+ * @note Waits for the codec to power down before the DMA stops, so the next play starts clean.
  * @param None
  * @retvalue None
  */
 void audioI2S_stop(void)
 {
   CS43L22_Stop();
+  CS43L22_Flush(CS43L22_FLUSH_TIMEOUT);
   HAL_I2S_DMAStop(hAudioI2S);
 }
 
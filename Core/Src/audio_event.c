@@ -0,0 +1,81 @@
+/*
+Library:				audio_event.c
+Written by:				Shridattha M Hebbar
+Date Written:			16/10/2026
+Description:			Lock-free single-producer/single-consumer event queue. Each index is written by
+						one side only; the acquire/release pairs order the event data against the index
+						updates, which on a Cortex-M4 costs a DMB and no interrupt masking.
+*/
+
+#include "audio_event.h"
+
+//--------------------------------------------------------------//
+//---------------------- Public Functions ----------------------//
+//--------------------------------------------------------------//
+
+/**
+ * @brief Empty the queue and clear its counters
+ * @note Call only while the producer is stopped (DMA not running).
+ * @param queue: event queue
+ * @retval None
+ */
+void audioEvent_reset(AUDIO_EventQueueTypeDef *queue)
+{
+	queue->head = 0;
+	queue->tail = 0;
+	queue->seq = 0;
+	queue->overruns = 0;
+}
+
+/**
+ * @brief Queue a buffer-ready event, producer side (interrupt context)
+ * @param queue: event queue
+ * @param slot: slot of the audio ring that became free
+ * @retval false when the queue was full and the event was dropped (counted in overruns)
+ */
+bool audioEvent_push(AUDIO_EventQueueTypeDef *queue, uint8_t slot)
+{
+	uint32_t head = queue->head;
+	uint32_t tail = __atomic_load_n(&queue->tail, __ATOMIC_ACQUIRE);
+	uint32_t seq = queue->seq;
+
+	__atomic_store_n(&queue->seq, seq + 1u, __ATOMIC_RELAXED);
+	if (head - tail >= AUDIO_EVENT_QUEUE_SIZE)
+	{
+		queue->overruns++;
+		return false;
+	}
+	queue->events[head & (AUDIO_EVENT_QUEUE_SIZE - 1u)].seq = seq;
+	queue->events[head & (AUDIO_EVENT_QUEUE_SIZE - 1u)].slot = slot;
+	__atomic_store_n(&queue->head, head + 1u, __ATOMIC_RELEASE);	// Publish the event
+	return true;
+}
+
+/**
+ * @brief Take the oldest event, consumer side (main loop)
+ * @param queue: event queue
+ * @param event: filled with the event
+ * @retval false when the queue is empty
+ */
+bool audioEvent_pop(AUDIO_EventQueueTypeDef *queue, AUDIO_EventTypeDef *event)
+{
+	uint32_t tail = queue->tail;
+
+	if (__atomic_load_n(&queue->head, __ATOMIC_ACQUIRE) == tail)
+	{
+		return false;
+	}
+	*event = queue->events[tail & (AUDIO_EVENT_QUEUE_SIZE - 1u)];
+	__atomic_store_n(&queue->tail, tail + 1u, __ATOMIC_RELEASE);	// Slot free for the producer
+	return true;
+}
+
+/**
+ * @brief Events produced so far, including dropped ones
+ * @param queue: event queue
+ * @retval sequence number the next event will get
+ */
+uint32_t audioEvent_produced(const AUDIO_EventQueueTypeDef *queue)
+{
+	return __atomic_load_n(&queue->seq, __ATOMIC_ACQUIRE);
+}
@@ -0,0 +1,64 @@
+/*
+Library:				audio_mem.c
+Written by:				Shridattha M Hebbar
+Date Written:			16/10/2026
+Description:			Static memory pool for per-stream audio buffers. Allocation is a bump pointer,
+						everything is released at once by audioMem_reset().
+*/
+
+#include <stddef.h>
+#include "audio_mem.h"
+
+#define AUDIO_MEM_ALIGN  8u
+
+static uint8_t audioMemPool[AUDIO_MEM_POOL_SIZE] __attribute__((aligned(AUDIO_MEM_ALIGN)));
+static uint32_t audioMemUsed = 0;
+
+//--------------------------------------------------------------//
+//---------------------- Public Functions ----------------------//
+//--------------------------------------------------------------//
+
+/**
+ * @brief Release every buffer taken from the pool
+ * @param None
+ * @retval None
+ */
+void audioMem_reset(void)
+{
+  audioMemUsed = 0;
+}
+
+/**
+ * @brief Take a buffer from the pool
+ * @param bytes: buffer size
+ * @retval 8-byte aligned buffer, NULL when the pool cannot hold it
+ */
+void *audioMem_alloc(uint32_t bytes)
+{
+  uint32_t size = (bytes + AUDIO_MEM_ALIGN - 1u) & ~(AUDIO_MEM_ALIGN - 1u);
+  void *p;
+
+  if(bytes == 0 || size > AUDIO_MEM_POOL_SIZE - audioMemUsed)
+  {
+    return NULL;
+  }
+  p = &audioMemPool[audioMemUsed];
+  audioMemUsed += size;
+  return p;
+}
+
+/**
+ * @brief Bytes still free in the pool
+ */
+uint32_t audioMem_available(void)
+{
+  return AUDIO_MEM_POOL_SIZE - audioMemUsed;
+}
+
+/**
+ * @brief Bytes handed out since the last reset
+ */
+uint32_t audioMem_used(void)
+{
+  return audioMemUsed;
+}
@@ -0,0 +1,595 @@
+/*
+Library:				convolver.c
+Written by:				Shridattha M Hebbar
+Date Written:			16/10/2026
+Description:			Partitioned overlap-save convolution of 16-bit PCM with an arbitrary impulse
+						response, e.g. a room or plate response loaded from a WAV file.
+						The IR is cut into segments of equally sized partitions. The head segment uses
+						partitions of B frames (the engine latency) and is computed every block of B
+						frames. Tail segments use larger partitions, Bs = B * CONV_SEGMENT_GROWTH^s,
+						and their work for one block of Bs frames is spread over the next Bs / B blocks,
+						so long IRs run at the latency of B without one block doing all the work.
+References:
+			1) F. Wefers, "Partitioned convolution algorithms for real-time auralization", 2015
+			2) W. G. Gardner, "Efficient convolution without input-output delay", JAES, 1995
+*/
+
+#include <math.h>
+#include <string.h>
+#include "convolver.h"
+#include "echo.h"
+#include "audio_mem.h"
+
+//Work units of a segment block, used to spread it evenly over its steps
+#define CONV_COST_PASS  1u    // One FFT pass (reordering, butterfly stage or split)
+#define CONV_COST_MAC   2u    // One partition multiply-add, about two butterfly stages
+
+//Player convolution engine, configured per stream by convolver_configure()
+static CONV_HandleTypeDef convDefault;
+
+//--------------------------------------------------------------//
+//---------------------- Static functions ----------------------//
+//--------------------------------------------------------------//
+
+// Round and saturate to 16 bits
+static inline int16_t sat16f(float x)
+{
+	if (x >= 32767.0f)
+		return 32767;
+	if (x <= -32768.0f)
+		return -32768;
+	return (int16_t)lrintf(x);
+}
+
+// Packed spectrum multiply-add: acc += x * h
+static void spectrumMac(float *acc, const float *x, const float *h, uint32_t n)
+{
+	acc[0] += x[0] * h[0];								// DC and Nyquist are real
+	acc[1] += x[1] * h[1];
+	for (uint32_t k = 2; k < n; k += 2)
+	{
+		acc[k] += x[k] * h[k] - x[k + 1] * h[k + 1];
+		acc[k + 1] += x[k] * h[k + 1] + x[k + 1] * h[k];
+	}
+}
+
+// Transform the IR partition being staged in a segment and move on to the next one
+static void irPartitionDone(CONV_HandleTypeDef *hconv, CONV_SegmentTypeDef *seg)
+{
+	const uint32_t n = 2 * seg->blockFrames;
+
+	for (uint16_t c = 0; c < hconv->irChannels; c++)
+	{
+		float *slot = seg->ir[c] + seg->irPartitions * n;
+		memset(&slot[hconv->irFill], 0, (n - hconv->irFill) * sizeof(float));
+		rfft_forward(&seg->fft, slot);
+	}
+	seg->irPartitions++;
+	hconv->irFill = 0;
+}
+
+// Run one work unit of a segment block: a forward FFT pass, a partition multiply-add or an inverse FFT pass
+static uint32_t segmentUnit(const CONV_HandleTypeDef *hconv, CONV_SegmentTypeDef *seg, uint32_t unit)
+{
+	const uint32_t n = 2 * seg->blockFrames;
+	const uint32_t passes = rfft_passes(&seg->fft);
+	const uint32_t perChannel = 2 * passes + seg->partitions;
+	const uint16_t c = (uint16_t)(unit / perChannel);
+	uint32_t v = unit % perChannel;
+
+	if (v < passes)
+	{
+		rfft_forwardPass(&seg->fft, seg->fdl[c] + seg->fdlPos * n, v);
+		return CONV_COST_PASS;
+	}
+	v -= passes;
+	if (v < seg->partitions)
+	{
+		// Y = Σj X[i - j] H[j], partition j pairs with the spectrum j blocks back
+		if (v < seg->irPartitions)
+		{
+			uint32_t slot = (seg->fdlPos >= v) ? seg->fdlPos - v : seg->fdlPos + seg->partitions - v;
+			spectrumMac(seg->acc[c], seg->fdl[c] + slot * n,
+			            seg->ir[(hconv->irChannels == 1) ? 0 : c] + v * n, n);
+		}
+		return CONV_COST_MAC;
+	}
+	rfft_inversePass(&seg->fft, seg->acc[c], v - seg->partitions);
+	return CONV_COST_PASS;
+}
+
+// A block of Bs input frames is complete: queue its spectrum and start the work on it
+static void segmentStart(const CONV_HandleTypeDef *hconv, CONV_SegmentTypeDef *seg)
+{
+	const uint32_t bs = seg->blockFrames;
+
+	seg->fdlPos = (seg->fdlPos + 1 == seg->partitions) ? 0 : seg->fdlPos + 1;
+	for (uint16_t c = 0; c < hconv->channels; c++)
+	{
+		memcpy(seg->fdl[c] + seg->fdlPos * 2 * bs, seg->window[c], 2 * bs * sizeof(float));
+		memcpy(seg->window[c], &seg->window[c][bs], bs * sizeof(float));
+		memset(seg->acc[c], 0, 2 * bs * sizeof(float));
+	}
+	seg->blockEnd = hconv->frames;
+	seg->step = 0;
+	seg->unit = 0;
+	seg->costDone = 0;
+}
+
+// One step of the running segment block, an even share of its work; the last step publishes the result
+static void segmentStep(const CONV_HandleTypeDef *hconv, CONV_SegmentTypeDef *seg)
+{
+	const uint32_t units = hconv->channels * (2 * rfft_passes(&seg->fft) + seg->partitions);
+	const uint32_t target = (uint32_t)((uint64_t)seg->cost * (seg->step + 1) / seg->steps);
+
+	while (seg->costDone < target && seg->unit < units)
+	{
+		seg->costDone += segmentUnit(hconv, seg, seg->unit++);
+	}
+	if (++seg->step == seg->steps)
+	{
+		// Overlap-save: only the second half is free of circular wrap
+		for (uint16_t c = 0; c < hconv->channels; c++)
+		{
+			memcpy(seg->result[c], &seg->acc[c][seg->blockFrames], seg->blockFrames * sizeof(float));
+		}
+		seg->resultStart = seg->blockEnd - seg->blockFrames + seg->offset;
+	}
+}
+
+// One block of B frames is complete: feed every segment and sum their results for the block
+static void convolveBlock(CONV_HandleTypeDef *hconv)
+{
+	const uint32_t b = hconv->blockFrames;
+	uint32_t outStart;
+
+	hconv->frames += b;
+	outStart = hconv->frames - b;
+	for (uint8_t s = 0; s < hconv->segments; s++)
+	{
+		CONV_SegmentTypeDef *seg = &hconv->seg[s];
+		for (uint16_t c = 0; c < hconv->channels; c++)
+		{
+			memcpy(&seg->window[c][seg->blockFrames + seg->fill], &hconv->input[c][b], b * sizeof(float));
+		}
+		seg->fill += b;
+		if (seg->fill == seg->blockFrames)
+		{
+			while (seg->step < seg->steps)
+			{
+				segmentStep(hconv, seg);			// Never expected, the schedule finishes in time
+			}
+			segmentStart(hconv, seg);
+			seg->fill = 0;
+		}
+		if (seg->step < seg->steps)
+			segmentStep(hconv, seg);
+	}
+
+	for (uint16_t c = 0; c < hconv->channels; c++)
+	{
+		float *out = hconv->output[c];
+		memset(out, 0, b * sizeof(float));
+		for (uint8_t s = 0; s < hconv->segments; s++)
+		{
+			const CONV_SegmentTypeDef *seg = &hconv->seg[s];
+			int32_t i0 = (int32_t)(outStart - seg->resultStart);
+			if (i0 < 0 || (uint32_t)i0 + b > seg->blockFrames)
+				continue;							// Output before the first result, silent input
+			for (uint32_t i = 0; i < b; i++)
+			{
+				out[i] += seg->result[c][i0 + i];
+			}
+		}
+		memcpy(hconv->input[c], &hconv->input[c][b], b * sizeof(float));
+	}
+}
+
+// Largest IR length up to irFrames whose planned layout fits in the given memory
+static uint32_t fitLayout(CONV_LayoutTypeDef *layout, uint32_t irFrames, uint16_t channels, uint16_t irChannels,
+                          uint8_t maxSegments, uint32_t bytes)
+{
+	uint32_t lo = 0, hi = irFrames;
+
+	while (lo < hi)
+	{
+		uint32_t mid = lo + (hi - lo + 1) / 2;
+		convolver_plan(layout, CONV_PARTITION_FRAMES, mid, maxSegments);
+		if (convolver_layoutBytes(layout, channels, irChannels) <= bytes)
+			lo = mid;
+		else
+			hi = mid - 1;
+	}
+	convolver_plan(layout, CONV_PARTITION_FRAMES, lo ? lo : 1, maxSegments);
+	if (convolver_layoutBytes(layout, channels, irChannels) > bytes)
+		return 0;
+	return lo;
+}
+
+//--------------------------------------------------------------//
+//---------------------- Public Functions ----------------------//
+//--------------------------------------------------------------//
+
+/**
+ * @brief Memory needed by a uniformly partitioned engine
+ * @param blockFrames: partition size B in frames, a power of two from 2
+ * @param partitions: IR partitions, the longest IR is blockFrames * partitions frames
+ * @param channels: stream samples per frame
+ * @param irChannels: 1 for one IR shared by all channels, else channels
+ * @retval bytes
+ */
+uint32_t convolver_memBytes(uint32_t blockFrames, uint32_t partitions, uint16_t channels, uint16_t irChannels)
+{
+	CONV_LayoutTypeDef layout = { 1, { blockFrames }, { partitions } };
+	return convolver_layoutBytes(&layout, channels, irChannels);
+}
+
+/**
+ * @brief Initialise a uniformly partitioned engine on a caller supplied memory block
+ * @note The engine starts with an empty IR (silent wet path); load one with
+ *       convolver_loadIR() and convolver_commitIR().
+ * @param hconv: engine state
+ * @param mem: convolver_memBytes() bytes, 4-byte aligned
+ * @param blockFrames: partition size B in frames, also the engine latency
+ * @param partitions: IR partitions the block holds
+ * @param channels: stream samples per frame (1 to CONV_MAX_CHANNELS)
+ * @param irChannels: 1 for one IR shared by all channels, else channels
+ * @retval false when the layout is not supported
+ */
+bool convolver_init(CONV_HandleTypeDef *hconv, void *mem, uint32_t blockFrames, uint32_t partitions,
+                    uint16_t channels, uint16_t irChannels)
+{
+	CONV_LayoutTypeDef layout = { 1, { blockFrames }, { partitions } };
+	return convolver_initLayout(hconv, mem, &layout, channels, irChannels);
+}
+
+/**
+ * @brief Plan a non-uniform layout for an IR: partitions grow by CONV_SEGMENT_GROWTH per segment
+ * @param layout: filled in
+ * @param blockFrames: head partition size B in frames (the engine latency)
+ * @param irFrames: impulse response length in frames
+ * @param maxSegments: segments allowed, 1 plans a uniform engine
+ * @retval None
+ */
+void convolver_plan(CONV_LayoutTypeDef *layout, uint32_t blockFrames, uint32_t irFrames, uint8_t maxSegments)
+{
+	uint32_t offset = 0;
+
+	if (maxSegments > CONV_MAX_SEGMENTS)
+		maxSegments = CONV_MAX_SEGMENTS;
+	memset(layout, 0, sizeof(*layout));
+	for (uint8_t s = 0; s < maxSegments; s++)
+	{
+		uint32_t bs = blockFrames;
+		for (uint8_t g = 0; g < s; g++)
+		{
+			bs *= CONV_SEGMENT_GROWTH;
+		}
+		uint32_t next = 2 * bs * CONV_SEGMENT_GROWTH - 2 * blockFrames;		// Start of the next segment
+
+		layout->segments = s + 1;
+		layout->blockFrames[s] = bs;
+		if (s + 1 < maxSegments && irFrames > next)
+		{
+			layout->partitions[s] = (next - offset) / bs;
+			offset = next;
+		}
+		else
+		{
+			layout->partitions[s] = (irFrames > offset) ? (irFrames - offset + bs - 1) / bs : 1;
+			break;
+		}
+	}
+}
+
+/**
+ * @brief Memory needed by an engine with the given layout
+ * @param layout: partition layout
+ * @param channels: stream samples per frame
+ * @param irChannels: 1 for one IR shared by all channels, else channels
+ * @retval bytes
+ */
+uint32_t convolver_layoutBytes(const CONV_LayoutTypeDef *layout, uint16_t channels, uint16_t irChannels)
+{
+	const uint32_t b = layout->blockFrames[0];
+	uint32_t floats = channels * 3 * b;										// Input, output
+	uint32_t bytes = 0;
+
+	for (uint8_t s = 0; s < layout->segments; s++)
+	{
+		const uint32_t bs = layout->blockFrames[s];
+		const uint32_t p = layout->partitions[s];
+		bytes += rfft_tableBytes(2 * bs);
+		floats += channels * (2 * bs + p * 2 * bs + 2 * bs + bs);			// Window, input spectra, accumulator, result
+		floats += irChannels * p * 2 * bs;									// IR spectra
+	}
+	return bytes + floats * (uint32_t)sizeof(float);
+}
+
+/**
+ * @brief Initialise an engine with a (non-uniform) partition layout on a caller supplied memory block
+ * @note The engine starts with an empty IR (silent wet path); load one with
+ *       convolver_loadIR() and convolver_commitIR().
+ * @param hconv: engine state
+ * @param mem: convolver_layoutBytes() bytes, 4-byte aligned
+ * @param layout: partition layout, see convolver_plan()
+ * @param channels: stream samples per frame (1 to CONV_MAX_CHANNELS)
+ * @param irChannels: 1 for one IR shared by all channels, else channels
+ * @retval false when the layout is not supported
+ */
+bool convolver_initLayout(CONV_HandleTypeDef *hconv, void *mem, const CONV_LayoutTypeDef *layout,
+                          uint16_t channels, uint16_t irChannels)
+{
+	const uint32_t b = layout->blockFrames[0];
+	uint32_t offset = 0;
+	float *p = mem;
+
+	memset(hconv, 0, sizeof(*hconv));
+	if (!mem || layout->segments == 0 || layout->segments > CONV_MAX_SEGMENTS || channels == 0
+	    || channels > CONV_MAX_CHANNELS || (irChannels != 1 && irChannels != channels))
+		return false;
+
+	hconv->segments = layout->segments;
+	hconv->blockFrames = b;
+	hconv->channels = channels;
+	hconv->irChannels = irChannels;
+	hconv->dryGain = 1.0f;
+	hconv->wetGain = 1.0f;
+	for (uint16_t c = 0; c < channels; c++)
+	{
+		hconv->input[c] = p;
+		p += 2 * b;
+		hconv->output[c] = p;
+		p += b;
+	}
+
+	for (uint8_t s = 0; s < layout->segments; s++)
+	{
+		CONV_SegmentTypeDef *seg = &hconv->seg[s];
+		const uint32_t bs = layout->blockFrames[s];
+		const uint32_t n = 2 * bs;
+
+		// Partition sizes are powers of two, each a multiple of the previous one, and a tail
+		// segment must start where its first result is just in time
+		if (layout->partitions[s] == 0 || bs < b || bs % b || (s && bs <= layout->blockFrames[s - 1])
+		    || (s && offset != 2 * bs - 2 * b) || !rfft_init(&seg->fft, p, n))
+			return false;
+		p += n;
+
+		seg->blockFrames = bs;
+		seg->offset = offset;
+		seg->partitions = layout->partitions[s];
+		seg->steps = bs / b;
+		seg->cost = channels * (2 * rfft_passes(&seg->fft) * CONV_COST_PASS + seg->partitions * CONV_COST_MAC);
+		for (uint16_t c = 0; c < channels; c++)
+		{
+			seg->window[c] = p;
+			p += n;
+			seg->fdl[c] = p;
+			p += seg->partitions * n;
+			seg->acc[c] = p;
+			p += n;
+			seg->result[c] = p;
+			p += bs;
+		}
+		for (uint16_t c = 0; c < irChannels; c++)
+		{
+			seg->ir[c] = p;
+			memset(p, 0, seg->partitions * n * sizeof(float));
+			p += seg->partitions * n;
+		}
+		offset += seg->partitions * bs;
+	}
+	convolver_clear(hconv);
+	return true;
+}
+
+/**
+ * @brief Append impulse response frames, may be called repeatedly to stream a long IR from a file
+ * @note Frames beyond the engine capacity are ignored. Finish with convolver_commitIR().
+ * @param hconv: engine state
+ * @param ir: interleaved 16-bit IR samples, irChannels per frame, full scale = 1.0
+ * @param frames: number of frames
+ * @retval None
+ */
+void convolver_loadIR(CONV_HandleTypeDef *hconv, const int16_t *ir, uint32_t frames)
+{
+	for (uint32_t f = 0; f < frames; f++)
+	{
+		while (hconv->loadSeg < hconv->segments
+		       && hconv->seg[hconv->loadSeg].irPartitions == hconv->seg[hconv->loadSeg].partitions)
+		{
+			hconv->loadSeg++;
+		}
+		if (hconv->loadSeg == hconv->segments)
+			return;
+
+		CONV_SegmentTypeDef *seg = &hconv->seg[hconv->loadSeg];
+		const uint32_t n = 2 * seg->blockFrames;
+		// Fold the 1/N of the unnormalised inverse FFT into the IR
+		const float scale = 1.0f / (32768.0f * (float)n);
+		for (uint16_t c = 0; c < hconv->irChannels; c++)
+		{
+			seg->ir[c][seg->irPartitions * n + hconv->irFill] = (float)ir[f * hconv->irChannels + c] * scale;
+		}
+		hconv->irFrames++;
+		if (++hconv->irFill == seg->blockFrames)
+			irPartitionDone(hconv, seg);
+	}
+}
+
+/**
+ * @brief Transform the last, partly filled, IR partition
+ * @param hconv: engine state
+ * @retval None
+ */
+void convolver_commitIR(CONV_HandleTypeDef *hconv)
+{
+	if (hconv->irFill && hconv->loadSeg < hconv->segments)
+		irPartitionDone(hconv, &hconv->seg[hconv->loadSeg]);
+}
+
+/**
+ * @brief Longest IR the engine holds
+ * @param hconv: engine state
+ * @retval frames
+ */
+uint32_t convolver_irCapacity(const CONV_HandleTypeDef *hconv)
+{
+	uint32_t frames = 0;
+
+	for (uint8_t s = 0; s < hconv->segments; s++)
+	{
+		frames += hconv->seg[s].partitions * hconv->seg[s].blockFrames;
+	}
+	return frames;
+}
+
+/**
+ * @brief Set the output mix
+ * @param hconv: engine state
+ * @param dry: gain of the input, delayed by one partition to line up with the wet signal
+ * @param wet: gain of the convolved signal
+ * @retval None
+ */
+void convolver_setMix(CONV_HandleTypeDef *hconv, float dry, float wet)
+{
+	hconv->dryGain = dry;
+	hconv->wetGain = wet;
+}
+
+/**
+ * @brief Convolve a buffer in place, output is delayed by the head partition size B
+ * @param hconv: engine state
+ * @param buffer: interleaved 16-bit PCM
+ * @param size: number of samples, whole frames
+ * @retval None
+ */
+void convolver_process(CONV_HandleTypeDef *hconv, int16_t *buffer, uint32_t size)
+{
+	const uint32_t b = hconv->blockFrames;
+	const uint16_t channels = hconv->channels;
+	uint32_t frames;
+
+	if (!channels)
+		return;
+
+	frames = size / channels;
+	while (frames)
+	{
+		uint32_t n = b - hconv->pos;
+		if (n > frames)
+			n = frames;
+		for (uint16_t c = 0; c < channels; c++)
+		{
+			float *prev = &hconv->input[c][hconv->pos];
+			float *cur = &hconv->input[c][b + hconv->pos];
+			const float *wet = &hconv->output[c][hconv->pos];
+			int16_t *s = &buffer[c];
+			for (uint32_t i = 0; i < n; i++, s += channels)
+			{
+				cur[i] = (float)*s;
+				*s = sat16f(hconv->dryGain * prev[i] + hconv->wetGain * wet[i]);
+			}
+		}
+		buffer += n * channels;
+		frames -= n;
+		hconv->pos += n;
+		if (hconv->pos == b)
+		{
+			convolveBlock(hconv);
+			hconv->pos = 0;
+		}
+	}
+}
+
+/**
+ * @brief Clear the input history, the loaded IR is kept
+ * @param hconv: engine state
+ * @retval None
+ */
+void convolver_clear(CONV_HandleTypeDef *hconv)
+{
+	const uint32_t b = hconv->blockFrames;
+
+	for (uint16_t c = 0; c < hconv->channels; c++)
+	{
+		memset(hconv->input[c], 0, 2 * b * sizeof(float));
+		memset(hconv->output[c], 0, b * sizeof(float));
+	}
+	for (uint8_t s = 0; s < hconv->segments; s++)
+	{
+		CONV_SegmentTypeDef *seg = &hconv->seg[s];
+		const uint32_t n = 2 * seg->blockFrames;
+		for (uint16_t c = 0; c < hconv->channels; c++)
+		{
+			memset(seg->window[c], 0, n * sizeof(float));
+			memset(seg->fdl[c], 0, seg->partitions * n * sizeof(float));
+			memset(seg->acc[c], 0, n * sizeof(float));
+			memset(seg->result[c], 0, seg->blockFrames * sizeof(float));
+		}
+		seg->fill = 0;
+		seg->fdlPos = 0;
+		seg->step = seg->steps;						// Idle
+		seg->resultStart = seg->offset - seg->blockFrames;
+	}
+	hconv->pos = 0;
+	hconv->frames = 0;
+}
+
+/**
+ * @brief Size the player convolution engine for an IR, taking it from the audio memory pool
+ * @note Call after audioMem_reset(). The uniform or non-uniform layout that holds more of
+ *       the IR is used; if the pool is too small the IR is truncated to fit.
+ * @param irFrames: impulse response length in frames
+ * @param channels: stream channel count
+ * @param irChannels: IR channel count, 1 or channels
+ * @retval bytes reserved, 0 when no engine could be set up
+ */
+uint32_t convolver_configure(uint32_t irFrames, uint16_t channels, uint16_t irChannels)
+{
+	CONV_LayoutTypeDef uniform, layout;
+	uint32_t uniformFrames, frames, bytes;
+	void *mem;
+
+	memset(&convDefault, 0, sizeof(convDefault));
+	if (irFrames == 0)
+		return 0;
+	uniformFrames = fitLayout(&uniform, irFrames, channels, irChannels, 1, audioMem_available());
+	frames = fitLayout(&layout, irFrames, channels, irChannels, CONV_MAX_SEGMENTS, audioMem_available());
+	if (uniformFrames >= frames)
+	{
+		layout = uniform;
+		frames = uniformFrames;
+	}
+	if (frames == 0)
+		return 0;
+
+	bytes = convolver_layoutBytes(&layout, channels, irChannels);
+	mem = audioMem_alloc(bytes);
+	if (!convolver_initLayout(&convDefault, mem, &layout, channels, irChannels))
+		return 0;
+	return bytes;
+}
+
+/**
+ * @brief Player convolution engine
+ * @param None
+ * @retval engine configured by convolver_configure()
+ */
+CONV_HandleTypeDef *convolver_getDefault(void)
+{
+	return &convDefault;
+}
+
+/**
+ * @brief Convolve a player buffer with the loaded IR, the ADC knob sets the wet level
+ * @param buffer: interleaved 16-bit PCM
+ * @param size: number of samples
+ * @retval None
+ */
+void applyConvolution(int16_t *buffer, uint32_t size)
+{
+	convolver_setMix(&convDefault, 1.0f, echoDecayFactor);
+	convolver_process(&convDefault, buffer, size);
+}
@@ -0,0 +1,913 @@
+/*
+Library:				echo.c
+Written by:				Shridattha M Hebbar
+Date Written:			16/10/2026
+Description:			Sparse multi-tap echo engine applied in place on 16-bit PCM, with raw or
+						compressed (µ-law, IMA-ADPCM) delay line storage.
+						Kept separate from the player so it can be benchmarked on the host.
+*/
+
+#include <string.h>
+#include "echo.h"
+#include "audio_mem.h"
+
+#if defined(__ARM_FEATURE_DSP) && (__ARM_FEATURE_DSP == 1)
+#include <arm_acle.h>
+#define ECHO_SIMD  1
+#else
+#define ECHO_SIMD  0
+#endif
+
+//Samples accumulated per pass over the taps (bounded further by the shortest delay and wrap points)
+#define ECHO_SPAN_MAX  128
+
+float echoDecayFactor = 0.8f;  // Attenuation of echo (0.0 to 1.0) Default set to 80 %
+
+//Engine used by applyEcho(), its delay line is taken from the audio memory pool per stream
+static ECHO_HandleTypeDef echoDefault;
+
+//Player tap pattern in milliseconds, empty means a single tap at the requested delay
+static ECHO_PatternTapTypeDef echoPattern[ECHO_MAX_TAPS];
+static uint8_t echoPatternTaps = 0;
+
+//Player echo topology, applied to the default engine at once and at every echo_configure()
+static ECHO_ModeTypeDef echoMode = ECHO_MODE_FIR;
+static float echoDamping = ECHO_DAMPING_DEFAULT;
+
+//µ-law decode table, filled when the first µ-law delay line is initialised
+static int16_t mulawTable[256];
+static bool mulawTableReady = false;
+
+//ADPCM block header per channel: predictor (2 bytes, little endian), step index, reserved
+#define ADPCM_HEADER_BYTES  4u
+
+//--------------------------------------------------------------//
+//---------------------- Static functions ----------------------//
+//--------------------------------------------------------------//
+
+// Saturate to the int16 range
+static inline int16_t sat16(int32_t x)
+{
+#if ECHO_SIMD
+	return (int16_t)__ssat(x, 16);
+#else
+	if (x > 32767)
+		x = 32767;
+	else if (x < -32768)
+		x = -32768;
+	return (int16_t)x;
+#endif
+}
+
+#if ECHO_SIMD
+// Two packed samples per word; memcpy keeps the access legal and compiles to a single LDR/STR
+static inline int32_t read_q15x2(const int16_t *p)
+{
+	int32_t v;
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+static inline void write_q15x2(int16_t *p, int32_t v)
+{
+	memcpy(p, &v, sizeof(v));
+}
+#endif
+
+// acc[i] (+)= (delay[i] * gain) >> 15 over n samples; the first tap initialises acc
+static void tapAccumulate(int32_t *acc, const int16_t *delay, uint32_t n, int16_t gain, bool first)
+{
+	uint32_t i = 0;
+#if ECHO_SIMD
+	if (first)
+	{
+		for (; i + 1 < n; i += 2)
+		{
+			int32_t d = read_q15x2(&delay[i]);
+			acc[i] = __smulbb(d, gain) >> 15;			// Bottom sample * g
+			acc[i + 1] = __smultb(d, gain) >> 15;		// Top sample * g
+		}
+	}
+	else
+	{
+		for (; i + 1 < n; i += 2)
+		{
+			int32_t d = read_q15x2(&delay[i]);
+			acc[i] += __smulbb(d, gain) >> 15;
+			acc[i + 1] += __smultb(d, gain) >> 15;
+		}
+	}
+#else
+	if (first)
+	{
+		for (; i + 1 < n; i += 2)
+		{
+			acc[i] = ((int32_t)delay[i] * gain) >> 15;
+			acc[i + 1] = ((int32_t)delay[i + 1] * gain) >> 15;
+		}
+	}
+	else
+	{
+		for (; i + 1 < n; i += 2)
+		{
+			acc[i] += ((int32_t)delay[i] * gain) >> 15;
+			acc[i + 1] += ((int32_t)delay[i + 1] * gain) >> 15;
+		}
+	}
+#endif
+	if (i < n)
+	{
+		int32_t w = ((int32_t)delay[i] * gain) >> 15;
+		acc[i] = first ? w : acc[i] + w;
+	}
+}
+
+// Last tap fused with the output stage: y = sat16(x + acc + ((delay * gain) >> 15)), dry x stored
+static void tapFinish(int16_t *buffer, int16_t *store, const int32_t *acc, const int16_t *delay,
+                      uint32_t n, int16_t gain)
+{
+	if (acc)
+	{
+		for (uint32_t i = 0; i < n; i++)
+		{
+			int16_t x = buffer[i];
+			int32_t w = acc[i] + (((int32_t)delay[i] * gain) >> 15);
+			store[i] = x;							// Store dry input for future delay
+			buffer[i] = sat16(x + w);
+		}
+	}
+	else
+	{
+		uint32_t i = 0;
+#if ECHO_SIMD
+		// Single tap: the wet term fits 16 bits, so two samples finish with one QADD16
+		for (; i + 1 < n; i += 2)
+		{
+			int32_t x = read_q15x2(&buffer[i]);
+			int32_t d = read_q15x2(&delay[i]);
+			int32_t lo = __smulbb(d, gain) >> 15;		// Bottom sample * g
+			int32_t hi = __smultb(d, gain) >> 15;		// Top sample * g
+			int32_t wet = (int32_t)(((uint32_t)lo & 0xFFFFu) | ((uint32_t)hi << 16));
+			write_q15x2(&store[i], x);					// Store dry input for future delay
+			write_q15x2(&buffer[i], (int32_t)__qadd16(x, wet));
+		}
+#endif
+		for (; i < n; i++)
+		{
+			int16_t x = buffer[i];
+			int32_t w = ((int32_t)delay[i] * gain) >> 15;
+			store[i] = x;
+			buffer[i] = sat16(x + w);
+		}
+	}
+}
+
+// Gain ramp: scale the tap sum by a master gain stepping linearly towards its target, per sample
+static void rampScale(ECHO_HandleTypeDef *hecho, int32_t *acc, uint32_t n)
+{
+	int32_t ramp = hecho->rampGain;
+	const int32_t step = hecho->rampStep;
+	const int32_t limit = hecho->rampLimit;
+
+	for (uint32_t i = 0; i < n; i++)
+	{
+		ramp += step;
+		int32_t g = ramp >> 15;
+		if (g > limit)
+			g = limit;
+		acc[i] = (int32_t)(((int64_t)acc[i] * g) >> 15);
+	}
+	hecho->rampGain = ramp;
+}
+
+// FIR output stage from a finished tap sum: y = sat16(x + acc), dry x stored
+static void accFinish(int16_t *buffer, int16_t *store, const int32_t *acc, uint32_t n)
+{
+	for (uint32_t i = 0; i < n; i++)
+	{
+		int16_t x = buffer[i];
+		store[i] = x;
+		buffer[i] = sat16(x + acc[i]);
+	}
+}
+
+// Feedback mode output stage: damp the summed taps, add the input and recirculate the result
+static void feedbackFinish(ECHO_HandleTypeDef *hecho, int16_t *buffer, int16_t *store, const int32_t *acc, uint32_t n)
+{
+	// |acc| and |l| stay below 32768 because Σ|gk| < 1, so (v - l) * coeff fits in 32 bits
+	const int32_t coeff = ECHO_GAIN_UNITY - hecho->damping;
+	const uint16_t channels = hecho->channels;
+	uint16_t c = (uint16_t)(hecho->writeIndex % channels);
+
+	if (channels == 2 && c == 0 && !(n & 1u))
+	{
+		// Stereo: two independent recurrences per frame, states kept in registers
+		int32_t l0 = hecho->dampState[0], l1 = hecho->dampState[1];
+		for (uint32_t i = 0; i < n; i += 2)
+		{
+			l0 += ((acc[i] - l0) * coeff) >> 15;
+			l1 += ((acc[i + 1] - l1) * coeff) >> 15;
+			int16_t y0 = sat16(buffer[i] + l0);
+			int16_t y1 = sat16(buffer[i + 1] + l1);
+			buffer[i] = store[i] = y0;
+			buffer[i + 1] = store[i + 1] = y1;
+		}
+		hecho->dampState[0] = l0;
+		hecho->dampState[1] = l1;
+		return;
+	}
+	for (uint32_t i = 0; i < n; i++)
+	{
+		int32_t *l = &hecho->dampState[c];
+		*l += ((acc[i] - *l) * coeff) >> 15;
+		int16_t y = sat16(buffer[i] + *l);
+		buffer[i] = y;
+		store[i] = y;							// Recirculate the wet output
+		if (++c == channels)
+			c = 0;
+	}
+}
+
+// Storage actually used for a format request (ADPCM state is kept for up to ECHO_MAX_CHANNELS)
+static ECHO_StorageTypeDef echoStorageFor(ECHO_StorageTypeDef storage, uint16_t channels)
+{
+#if ECHO_USE_Q15
+	if (storage == ECHO_STORAGE_ADPCM && channels > ECHO_MAX_CHANNELS)
+		return ECHO_STORAGE_PCM16;
+	return storage;
+#else
+	(void)storage; (void)channels;
+	return ECHO_STORAGE_PCM16;				// The float kernel reads raw samples only
+#endif
+}
+
+// Decode n samples of tap k from a coded delay line into dst (the span does not wrap)
+static void lineRead(ECHO_HandleTypeDef *hecho, uint8_t k, int16_t *dst, uint32_t n)
+{
+	uint32_t pos = hecho->readIndex[k];
+
+	if (hecho->storage == ECHO_STORAGE_MULAW)
+	{
+		const uint8_t *src = (const uint8_t*)hecho->line + pos;
+		for (uint32_t i = 0; i < n; i++)
+		{
+			dst[i] = mulawTable[src[i]];
+		}
+	}
+	else
+	{
+		const uint32_t headerBytes = hecho->channels * ADPCM_HEADER_BYTES;
+		const uint32_t chMask = hecho->channels - 1u;		// 1 or 2 channels
+		ADPCM_StateTypeDef *state = hecho->readState[k];
+		uint32_t block = pos / hecho->blockSamples;
+		uint32_t off = pos - block * hecho->blockSamples;
+		const uint8_t *blk = (const uint8_t*)hecho->line + block * hecho->blockBytes;
+
+		for (uint32_t i = 0; i < n; i++)
+		{
+			if (off == 0)
+			{
+				// Block start: restart every channel from the state the encoder saved
+				for (uint32_t c = 0; c < hecho->channels; c++)
+				{
+					const uint8_t *h = &blk[c * ADPCM_HEADER_BYTES];
+					state[c].predictor = (int16_t)(h[0] | (h[1] << 8));
+					state[c].index = h[2];
+				}
+			}
+			uint8_t byte = blk[headerBytes + (off >> 1)];
+			dst[i] = adpcm_decode(&state[off & chMask], (off & 1u) ? (byte >> 4) : (byte & 0x0F));
+			if (++off == hecho->blockSamples)
+			{
+				off = 0;
+				blk += hecho->blockBytes;
+			}
+		}
+	}
+}
+
+// Encode n dry samples into a coded delay line at the write position (the span does not wrap)
+static void lineWrite(ECHO_HandleTypeDef *hecho, const int16_t *src, uint32_t n)
+{
+	uint32_t pos = hecho->writeIndex;
+
+	if (hecho->storage == ECHO_STORAGE_MULAW)
+	{
+		uint8_t *dst = (uint8_t*)hecho->line + pos;
+		for (uint32_t i = 0; i < n; i++)
+		{
+			dst[i] = mulaw_encode(src[i]);
+		}
+	}
+	else
+	{
+		const uint32_t headerBytes = hecho->channels * ADPCM_HEADER_BYTES;
+		const uint32_t chMask = hecho->channels - 1u;
+		ADPCM_StateTypeDef *state = hecho->writeState;
+		uint32_t block = pos / hecho->blockSamples;
+		uint32_t off = pos - block * hecho->blockSamples;
+		uint8_t *blk = (uint8_t*)hecho->line + block * hecho->blockBytes;
+
+		for (uint32_t i = 0; i < n; i++)
+		{
+			if (off == 0)
+			{
+				for (uint32_t c = 0; c < hecho->channels; c++)
+				{
+					uint8_t *h = &blk[c * ADPCM_HEADER_BYTES];
+					h[0] = (uint8_t)state[c].predictor;
+					h[1] = (uint8_t)((uint16_t)state[c].predictor >> 8);
+					h[2] = state[c].index;
+					h[3] = 0;
+				}
+			}
+			uint8_t code = adpcm_encode(&state[off & chMask], src[i]);
+			uint8_t *byte = &blk[headerBytes + (off >> 1)];
+			*byte = (off & 1u) ? (uint8_t)((*byte & 0x0F) | (code << 4)) : (uint8_t)((*byte & 0xF0) | code);
+			if (++off == hecho->blockSamples)
+			{
+				off = 0;
+				blk += hecho->blockBytes;
+			}
+		}
+	}
+}
+
+// Bring an ADPCM tap decoder to its read position by decoding from the start of its block
+static void adpcmSeek(ECHO_HandleTypeDef *hecho, uint8_t k)
+{
+	int16_t scratch[ECHO_SPAN_MAX];
+	uint32_t target = hecho->readIndex[k];
+
+	hecho->readIndex[k] = target - target % hecho->blockSamples;
+	while (hecho->readIndex[k] < target)
+	{
+		uint32_t n = target - hecho->readIndex[k];
+		if (n > ECHO_SPAN_MAX)
+			n = ECHO_SPAN_MAX;
+		lineRead(hecho, k, scratch, n);
+		hecho->readIndex[k] += n;
+	}
+}
+
+// Coded delay line path of echo_process(): taps are decoded into a span buffer first
+static void echoProcessCoded(ECHO_HandleTypeDef *hecho, int16_t *buffer, uint32_t size, const int16_t *gain,
+                             bool ramp)
+{
+	int32_t acc[ECHO_SPAN_MAX];
+	int16_t dec[ECHO_SPAN_MAX] __attribute__((aligned(4)));
+	int16_t dry[ECHO_SPAN_MAX];
+	const uint32_t length = hecho->length;
+	const uint8_t numTaps = hecho->numTaps;
+	const bool feedback = (hecho->mode == ECHO_MODE_FEEDBACK);
+
+	while (size)
+	{
+		uint32_t n = size;
+		if (n > ECHO_SPAN_MAX)
+			n = ECHO_SPAN_MAX;
+		if (n > hecho->minDelay)
+			n = hecho->minDelay;
+		if (n > length - hecho->writeIndex)
+			n = length - hecho->writeIndex;
+		for (uint8_t k = 0; k < numTaps; k++)
+		{
+			if (n > length - hecho->readIndex[k])
+				n = length - hecho->readIndex[k];
+		}
+
+		if (numTaps == 0)
+			memcpy(dry, buffer, n * sizeof(buffer[0]));
+		for (uint8_t k = 0; k < numTaps; k++)
+		{
+			lineRead(hecho, k, dec, n);
+			if (k + 1 < numTaps || feedback || ramp)
+				tapAccumulate(acc, dec, n, gain[k], k == 0);
+			else
+				tapFinish(buffer, dry, (k == 0) ? NULL : acc, dec, n, gain[k]);
+			hecho->readIndex[k] += n;
+			if (hecho->readIndex[k] == length)
+				hecho->readIndex[k] = 0;
+		}
+		if (ramp && numTaps)
+			rampScale(hecho, acc, n);
+		if (feedback && numTaps)
+			feedbackFinish(hecho, buffer, dry, acc, n);
+		else if (ramp && numTaps)
+			accFinish(buffer, dry, acc, n);
+		lineWrite(hecho, dry, n);
+
+		hecho->writeIndex += n;
+		if (hecho->writeIndex == length)
+			hecho->writeIndex = 0;
+		buffer += n;
+		size -= n;
+	}
+}
+
+// Convert the player pattern to frames for the default engine, clipped to its delay line
+static bool echoApplyPattern(uint32_t sampleRate, uint32_t delayMs)
+{
+	ECHO_TapTypeDef taps[ECHO_MAX_TAPS];
+	uint8_t numTaps = echoPatternTaps;
+
+	if (!echoDefault.line)
+		return false;
+	if (numTaps == 0)
+	{
+		taps[0].delay = echo_msToFrames(delayMs, sampleRate);
+		taps[0].gain = ECHO_GAIN_UNITY;
+		numTaps = 1;
+	}
+	else
+	{
+		for (uint8_t k = 0; k < numTaps; k++)
+		{
+			taps[k].delay = echo_msToFrames(echoPattern[k].delayMs, sampleRate);
+			taps[k].gain = echoPattern[k].gain;
+		}
+	}
+	for (uint8_t k = 0; k < numTaps; k++)
+	{
+		if (taps[k].delay > echoDefault.frames)
+			taps[k].delay = echoDefault.frames;
+		if (taps[k].delay == 0)
+			taps[k].delay = 1;
+	}
+	return echo_setTaps(&echoDefault, taps, numTaps);
+}
+
+//--------------------------------------------------------------//
+//---------------------- Public Functions ----------------------//
+//--------------------------------------------------------------//
+
+/**
+ * @brief Convert a delay in milliseconds to frames at the given sample rate (rounded)
+ * @param delayMs: delay in milliseconds
+ * @param sampleRate: frames per second
+ * @retval delay in frames
+ */
+uint32_t echo_msToFrames(uint32_t delayMs, uint32_t sampleRate)
+{
+	return (uint32_t)(((uint64_t)delayMs * sampleRate + 500u) / 1000u);
+}
+
+/**
+ * @brief Delay line storage needed for the given length
+ * @param frames: delay line length in frames
+ * @param channels: samples per frame
+ * @param storage: delay line sample format
+ * @retval bytes
+ */
+uint32_t echo_lineBytes(uint32_t frames, uint16_t channels, ECHO_StorageTypeDef storage)
+{
+	switch (echoStorageFor(storage, channels))
+	{
+	case ECHO_STORAGE_MULAW:
+		return frames * channels;
+	case ECHO_STORAGE_ADPCM:
+	{
+		uint32_t blocks = (frames + ECHO_ADPCM_BLOCK_FRAMES - 1u) / ECHO_ADPCM_BLOCK_FRAMES;
+		return blocks * channels * (ADPCM_HEADER_BYTES + ECHO_ADPCM_BLOCK_FRAMES / 2u);
+	}
+	case ECHO_STORAGE_PCM16:
+	default:
+		return frames * channels * (uint32_t)sizeof(int16_t);
+	}
+}
+
+/**
+ * @brief Initialise an echo engine on a caller supplied delay line
+ * @param hecho: engine state
+ * @param line: delay line storage of echo_lineBytes() bytes (4-byte aligned), cleared here
+ * @param frames: delay line length in frames, the longest usable tap delay
+ *                (ADPCM rounds it up to whole blocks, which echo_lineBytes() accounts for)
+ * @param channels: samples per interleaved frame
+ * @param storage: delay line sample format
+ * @retval None
+ */
+void echo_init(ECHO_HandleTypeDef *hecho, void *line, uint32_t frames, uint16_t channels,
+               ECHO_StorageTypeDef storage)
+{
+	memset(hecho, 0, sizeof(*hecho));
+	hecho->storage = echoStorageFor(storage, channels);
+	if (hecho->storage == ECHO_STORAGE_ADPCM)
+	{
+		frames = (frames + ECHO_ADPCM_BLOCK_FRAMES - 1u) / ECHO_ADPCM_BLOCK_FRAMES * ECHO_ADPCM_BLOCK_FRAMES;
+		hecho->blockSamples = ECHO_ADPCM_BLOCK_FRAMES * channels;
+		hecho->blockBytes = channels * (ADPCM_HEADER_BYTES + ECHO_ADPCM_BLOCK_FRAMES / 2u);
+	}
+	else if (hecho->storage == ECHO_STORAGE_MULAW && !mulawTableReady)
+	{
+		for (uint32_t c = 0; c < 256; c++)
+		{
+			mulawTable[c] = mulaw_decode((uint8_t)c);
+		}
+		mulawTableReady = true;
+	}
+	hecho->line = line;
+	hecho->frames = frames;
+	hecho->channels = channels;
+	hecho->length = frames * channels;
+	hecho->minDelay = hecho->length;
+	hecho->masterGain = echo_gainQ15(echoDecayFactor);
+	hecho->targetGain = hecho->masterGain;
+	echo_clear(hecho);
+}
+
+/**
+ * @brief Set the echo taps, e.g. one tap for slap-back, several for multi-echo or rhythmic patterns
+ * @param hecho: engine state
+ * @param taps: tap list, delays must be between 1 and the delay line length in frames
+ * @param numTaps: number of taps, 0 to ECHO_MAX_TAPS (0 passes audio through dry)
+ * @retval true when the taps were accepted
+ */
+bool echo_setTaps(ECHO_HandleTypeDef *hecho, const ECHO_TapTypeDef *taps, uint8_t numTaps)
+{
+	uint32_t minDelay = hecho->length;
+
+	if (numTaps > ECHO_MAX_TAPS)
+		return false;
+	for (uint8_t k = 0; k < numTaps; k++)
+	{
+		if (taps[k].delay == 0 || taps[k].delay > hecho->frames)
+			return false;
+	}
+
+	for (uint8_t k = 0; k < numTaps; k++)
+	{
+		int32_t gain = taps[k].gain;
+		if (gain > ECHO_GAIN_UNITY)
+			gain = ECHO_GAIN_UNITY;
+		else if (gain < -ECHO_GAIN_UNITY)
+			gain = -ECHO_GAIN_UNITY;
+		hecho->taps[k].delay = taps[k].delay;
+		hecho->taps[k].gain = gain;
+
+		// Read position trails the write position by the tap delay, whole frames keep channels apart
+		uint32_t delay = taps[k].delay * hecho->channels;
+		hecho->readIndex[k] = hecho->writeIndex + hecho->length - delay;
+		if (hecho->readIndex[k] >= hecho->length)
+			hecho->readIndex[k] -= hecho->length;
+
+		if (hecho->storage == ECHO_STORAGE_ADPCM)
+			adpcmSeek(hecho, k);
+
+		if (delay < minDelay)
+			minDelay = delay;
+	}
+	hecho->numTaps = numTaps;
+	hecho->minDelay = minDelay;
+	return true;
+}
+
+/**
+ * @brief Set the master gain that scales every tap (echo decay factor)
+ * @param hecho: engine state
+ * @param gain: 0.0 to 1.0
+ * @retval None
+ */
+void echo_setGain(ECHO_HandleTypeDef *hecho, float gain)
+{
+	hecho->masterGain = echo_gainQ15(gain);
+	hecho->targetGain = hecho->masterGain;
+}
+
+/**
+ * @brief Move the master gain to a new value over the next processed block, without zipper noise
+ * @note The gain steps linearly per sample from the current to the new value across the next
+ *       echo_process() call, so live control changes once per block at most.
+ * @param hecho: engine state
+ * @param gain: 0.0 to 1.0
+ * @retval None
+ */
+void echo_rampGain(ECHO_HandleTypeDef *hecho, float gain)
+{
+	hecho->targetGain = echo_gainQ15(gain);
+}
+
+/**
+ * @brief Select FIR (repeat the input) or feedback (repeat the output) echo, can be switched while running
+ * @param hecho: engine state
+ * @param mode: ECHO_MODE_FIR or ECHO_MODE_FEEDBACK
+ * @retval false when feedback is asked for more than ECHO_MAX_CHANNELS channels
+ */
+bool echo_setMode(ECHO_HandleTypeDef *hecho, ECHO_ModeTypeDef mode)
+{
+	if (mode == ECHO_MODE_FEEDBACK && hecho->channels > ECHO_MAX_CHANNELS)
+		return false;
+	if (mode != hecho->mode)
+		memset(hecho->dampState, 0, sizeof(hecho->dampState));
+	hecho->mode = mode;
+	return true;
+}
+
+/**
+ * @brief Set the high frequency loss per feedback pass
+ * @param hecho: engine state
+ * @param damping: 0.0 (bright, no damping) to 1.0 (loop frozen), one-pole low-pass memory
+ * @retval None
+ */
+void echo_setDamping(ECHO_HandleTypeDef *hecho, float damping)
+{
+	hecho->damping = echo_gainQ15(damping);
+}
+
+/**
+ * @brief Run the echo engine in place, bit-exact to the Q15 reference in echo.h
+ * @param hecho: engine state
+ * @param buffer: interleaved 16-bit samples (4-byte aligned)
+ * @param size: number of samples (not bytes) in buffer, whole frames
+ * @retval None
+ */
+void echo_process(ECHO_HandleTypeDef *hecho, int16_t *buffer, uint32_t size)
+{
+	int32_t acc[ECHO_SPAN_MAX];
+	int16_t gain[ECHO_MAX_TAPS];
+	const uint32_t length = hecho->length;
+	const uint8_t numTaps = hecho->numTaps;
+	const bool feedback = (hecho->mode == ECHO_MODE_FEEDBACK);
+	const bool ramp = (hecho->targetGain != hecho->masterGain) && numTaps && size;
+	int16_t *line = hecho->line;
+	int32_t loopGain = 0;
+
+	if (!line)
+		return;
+
+	if (ramp)
+	{
+		// Gain change: taps at their own gain, the master gain moves across the block in rampScale()
+		for (uint8_t k = 0; k < numTaps; k++)
+		{
+			int32_t g = hecho->taps[k].gain;
+			gain[k] = (int16_t)((g > 32767) ? 32767 : g);
+			loopGain += (gain[k] < 0) ? -gain[k] : gain[k];
+		}
+		hecho->rampGain = (int32_t)hecho->masterGain << 15;
+		hecho->rampStep = (int32_t)(hecho->targetGain - hecho->masterGain) * 32768 / (int32_t)size;	// Not << 15, the change may be negative
+		hecho->rampLimit = 32767;
+		if (feedback && loopGain > ECHO_FEEDBACK_MAX)
+			hecho->rampLimit = (int16_t)(((int32_t)ECHO_FEEDBACK_MAX << 15) / loopGain);
+	}
+	else
+	{
+		// Effective Q15 gain per tap for this block
+		for (uint8_t k = 0; k < numTaps; k++)
+		{
+			gain[k] = (int16_t)((hecho->taps[k].gain * hecho->masterGain) >> 15);
+			loopGain += (gain[k] < 0) ? -gain[k] : gain[k];
+		}
+		// Feedback: keep the loop gain below one whatever the taps and the ADC ask for
+		if (feedback && loopGain > ECHO_FEEDBACK_MAX)
+		{
+			for (uint8_t k = 0; k < numTaps; k++)
+			{
+				gain[k] = (int16_t)(gain[k] * ECHO_FEEDBACK_MAX / loopGain);
+			}
+		}
+	}
+	hecho->masterGain = hecho->targetGain;		// Reached at the end of this block
+
+	if (hecho->storage != ECHO_STORAGE_PCM16)
+	{
+		echoProcessCoded(hecho, buffer, size, gain, ramp);
+		return;
+	}
+
+	while (size)
+	{
+		// Contiguous span: no wrap of the write or any read position, and no tap reads a
+		// sample that this span has still to write (span <= shortest delay)
+		uint32_t n = size;
+		if ((numTaps > 1 || feedback || ramp) && n > ECHO_SPAN_MAX)
+			n = ECHO_SPAN_MAX;							// Partial sums held in acc[]
+		if (n > hecho->minDelay)
+			n = hecho->minDelay;
+		if (n > length - hecho->writeIndex)
+			n = length - hecho->writeIndex;
+		for (uint8_t k = 0; k < numTaps; k++)
+		{
+			if (n > length - hecho->readIndex[k])
+				n = length - hecho->readIndex[k];
+		}
+
+		// Cost per span scales with the number of taps, not with the delay length
+		int16_t *store = &line[hecho->writeIndex];
+		if (numTaps == 0)
+		{
+			memcpy(store, buffer, n * sizeof(buffer[0]));
+		}
+		else
+		{
+			for (uint8_t k = 0; k < numTaps; k++)
+			{
+				const int16_t *delay = &line[hecho->readIndex[k]];
+				if (k + 1 < numTaps || feedback || ramp)
+					tapAccumulate(acc, delay, n, gain[k], k == 0);
+				else
+					tapFinish(buffer, store, (k == 0) ? NULL : acc, delay, n, gain[k]);
+				hecho->readIndex[k] += n;
+				if (hecho->readIndex[k] == length)
+					hecho->readIndex[k] = 0;
+			}
+			if (ramp)
+				rampScale(hecho, acc, n);
+			if (feedback)
+				feedbackFinish(hecho, buffer, store, acc, n);
+			else if (ramp)
+				accFinish(buffer, store, acc, n);
+		}
+
+		hecho->writeIndex += n;
+		if (hecho->writeIndex == length)
+			hecho->writeIndex = 0;
+		buffer += n;
+		size -= n;
+	}
+}
+
+/**
+ * @brief Clear the delay line of an echo engine
+ * @param hecho: engine state
+ * @retval None
+ */
+void echo_clear(ECHO_HandleTypeDef *hecho)
+{
+	// Silence is code 0xFF in µ-law; all-zero blocks (headers included) decode to silence in ADPCM
+	memset(hecho->line, (hecho->storage == ECHO_STORAGE_MULAW) ? mulaw_encode(0) : 0,
+	       echo_lineBytes(hecho->frames, hecho->channels, hecho->storage));
+	memset(hecho->writeState, 0, sizeof(hecho->writeState));
+	memset(hecho->readState, 0, sizeof(hecho->readState));
+	memset(hecho->dampState, 0, sizeof(hecho->dampState));
+}
+
+/**
+ * @brief Convert a 0.0 to 1.0 gain to Q15, rounded and clamped to 0..32767
+ * @param gain: linear gain
+ * @retval Q15 gain
+ */
+int16_t echo_gainQ15(float gain)
+{
+	if (!(gain > 0.0f))
+		return 0;
+	if (gain >= 32767.0f / 32768.0f)
+		return 32767;
+	return (int16_t)(gain * 32768.0f + 0.5f);
+}
+
+/**
+ * @brief Size the player delay line for a stream, taking it from the audio memory pool
+ * @note Call after audioMem_reset(). If the pool is too small the line is shortened to fit.
+ * @param sampleRate: stream sample rate
+ * @param channels: stream channel count
+ * @param delayMs: requested echo delay, longer pattern taps extend it
+ * @param storage: delay line sample format, compressed formats trade fidelity for delay length
+ * @retval bytes reserved for the delay line
+ */
+uint32_t echo_configure(uint32_t sampleRate, uint16_t channels, uint32_t delayMs,
+                        ECHO_StorageTypeDef storage)
+{
+	uint32_t frames, bytes, unit, unitFrames;
+	void *line;
+
+	for (uint8_t k = 0; k < echoPatternTaps; k++)
+	{
+		if (echoPattern[k].delayMs > delayMs)
+			delayMs = echoPattern[k].delayMs;
+	}
+	if (channels == 0)
+		channels = 1;
+
+	// Smallest allocation unit: one frame, or one block for ADPCM
+	unitFrames = (echoStorageFor(storage, channels) == ECHO_STORAGE_ADPCM) ? ECHO_ADPCM_BLOCK_FRAMES : 1u;
+	unit = echo_lineBytes(unitFrames, channels, storage);
+
+	frames = echo_msToFrames(delayMs, sampleRate);
+	if (echo_lineBytes(frames, channels, storage) > audioMem_available())
+		frames = audioMem_available() / unit * unitFrames;
+	if (frames == 0)
+		frames = 1;
+	bytes = echo_lineBytes(frames, channels, storage);
+	line = audioMem_alloc(bytes);
+	if (!line)
+	{
+		memset(&echoDefault, 0, sizeof(echoDefault));
+		return 0;
+	}
+
+	echo_init(&echoDefault, line, frames, channels, storage);
+	echoApplyPattern(sampleRate, delayMs);
+	echo_setMode(&echoDefault, echoMode);
+	echo_setDamping(&echoDefault, echoDamping);
+	return bytes;
+}
+
+/**
+ * @brief Set the tap pattern used by applyEcho(), applied from the next echo_configure()
+ * @param taps: tap list with delays in milliseconds
+ * @param numTaps: number of taps, 0 restores the single tap at the requested delay
+ * @retval true when the pattern was accepted
+ */
+bool echo_setPattern(const ECHO_PatternTapTypeDef *taps, uint8_t numTaps)
+{
+	if (numTaps > ECHO_MAX_TAPS)
+		return false;
+	memcpy(echoPattern, taps, numTaps * sizeof(taps[0]));
+	echoPatternTaps = numTaps;
+	return true;
+}
+
+/**
+ * @brief Set the topology used by applyEcho(), takes effect at once
+ * @param mode: ECHO_MODE_FIR or ECHO_MODE_FEEDBACK
+ * @param damping: feedback high frequency loss per pass, 0.0 to 1.0
+ * @retval None
+ */
+void echo_setDefaultMode(ECHO_ModeTypeDef mode, float damping)
+{
+	echoMode = mode;
+	echoDamping = damping;
+	if (echoDefault.line)
+	{
+		echo_setMode(&echoDefault, mode);
+		echo_setDamping(&echoDefault, damping);
+	}
+}
+
+/**
+ * @brief Engine used by applyEcho()
+ */
+ECHO_HandleTypeDef *echo_getDefault(void)
+{
+	return &echoDefault;
+}
+
+/**
+ * @brief Echo Generator, kernel selected by ECHO_USE_Q15
+ * @param buffer: interleaved 16-bit samples, processed in place
+ * @param size: number of samples (not bytes) in buffer
+ * @retval None
+ */
+void applyEcho(int16_t *buffer, uint32_t size)
+{
+#if ECHO_USE_Q15
+	echo_rampGain(&echoDefault, echoDecayFactor);
+	echo_process(&echoDefault, buffer, size);
+#else
+	applyEchoFloat(buffer, size);
+#endif
+}
+
+/**
+ * @brief Float echo kernel, single tap at the full delay line length
+ * @param buffer: interleaved 16-bit samples, processed in place
+ * @param size: number of samples (not bytes) in buffer
+ * @retval None
+ */
+void applyEchoFloat(int16_t *buffer, uint32_t size)
+{
+  // Impulse response for a single echo: h[n] = δ[n] + ECHO_DECAY_FACTOR * δ[n - D]
+  // Since h[n] is sparse, we only need to handle the non-zero taps at n=0 and n=D
+
+	int16_t *echoBuffer = echoDefault.line;
+	uint32_t echoLength = echoDefault.length;
+	uint32_t echoBufferIndex = echoDefault.writeIndex;
+
+	if (!echoBuffer || echoDefault.storage != ECHO_STORAGE_PCM16)
+		return;
+
+	for (uint32_t i = 0; i < size; i++)
+	{
+		int16_t currentSample = buffer[i];		// Read current sample
+
+		int16_t delayedSample = echoBuffer[echoBufferIndex];		// Read delayed sample from echo buffer
+
+		// Convolution: y[n] = x[n] + echoDecayFactor * x[n - D]
+
+		int32_t outputSample = (int32_t)currentSample + (int32_t)(delayedSample * echoDecayFactor);
+
+		// Clip to prevent overflow
+		if (outputSample > 32767)
+			outputSample = 32767;
+		else if (outputSample < -32768)
+			outputSample = -32768;
+
+		echoBuffer[echoBufferIndex] = currentSample;				// Store current sample in echo buffer for future delay
+
+		buffer[i] = (int16_t)outputSample;		// Update output buffer
+
+		echoBufferIndex = (echoBufferIndex + 1) % echoLength;		// Update echo buffer index (circular buffer)
+		}
+	echoDefault.writeIndex = echoBufferIndex;
+}
+
+/**
+ * @brief Clear the delay line used by applyEcho()
+ * @param None
+ * @retval None
+ */
+void echo_reset(void)
+{
+	if (echoDefault.line)
+		echo_clear(&echoDefault);
+}
@@ -27,6 +27,10 @@
 #include "CS43L22.h"
 #include "audioI2S.h"
 #include "wav_player.h"
+#include "playlist.h"
+#include "wav_library.h"
+#include "stage_prof.h"
+#include "trace.h"
 
 /* USER CODE END Includes */
 
@@ -49,6 +53,7 @@ extern ApplicationTypeDef Appli_state;
 
 /* Private variables ---------------------------------------------------------*/
 ADC_HandleTypeDef hadc1;
+DMA_HandleTypeDef hdma_adc1;
 
 I2C_HandleTypeDef hi2c1;
 
@@ -57,7 +62,10 @@ DMA_HandleTypeDef hdma_spi3_tx;
 
 /* USER CODE BEGIN PV */
 
-#define WAV_FILE "audio_2.wav"
+//Played in order without gaps between tracks at the same sample rate, missing files are skipped.
+//Used until the library index of the drive lists a playable file.
+static const char *const wavFiles[] = { "audio_1.wav", "audio_2.wav", "audio_3.wav" };
+#define IR_FILE  "impulse.wav"   // Optional room/plate response, the echo is used when it is missing
 
 /* USER CODE END PV */
 
@@ -71,6 +79,8 @@ static void MX_ADC1_Init(void);
 void MX_USB_HOST_Process(void);
 
 /* USER CODE BEGIN PFP */
+static void waitPlaying(uint32_t ms);
+static void buildPlaylist(void);
 
 /* USER CODE END PFP */
 
@@ -103,7 +113,8 @@ int main(void)
   SystemClock_Config();
 
   /* USER CODE BEGIN SysInit */
-
+  stageProf_init();              // Cycle counter for the playback stage probes, runs at the core clock set above
+  trace_init();                  // Event trace, time stamped with that counter
   /* USER CODE END SysInit */
 
   /* Initialize all configured peripherals */
@@ -116,12 +127,13 @@ int main(void)
   MX_USB_HOST_Init();
   /* USER CODE BEGIN 2 */
 
-  CS43L22_Init(hi2c1, OUTPUT_DEVICE_SPEAKER);
+  CS43L22_Init(&hi2c1, OUTPUT_DEVICE_SPEAKER);
   CS43L22_SetVolume(80); // 0-100
   audioI2S_setHandle(&hi2s3);
 
   bool isSdCardMounted=0;
   bool pauseResumeToggle=0;
+  ApplicationTypeDef lastAppliState = APPLICATION_IDLE;
 
   /* USER CODE END 2 */
 
@@ -133,6 +145,11 @@ int main(void)
     MX_USB_HOST_Process();
 
     /* USER CODE BEGIN 3 */
+    if(Appli_state != lastAppliState)
+    {
+    	TRACE_EVENT(TRACE_EV_USB, Appli_state);
+    	lastAppliState = Appli_state;
+    }
 
 
     if(Appli_state == APPLICATION_START)
@@ -142,6 +159,7 @@ int main(void)
     else if(Appli_state == APPLICATION_DISCONNECT)
     {
     	HAL_GPIO_WritePin(GPIOD, GPIO_PIN_12, GPIO_PIN_RESET);
+        wavLibrary_unmount();
         f_mount(NULL, (TCHAR const*)"", 0);
         isSdCardMounted = 0;
     }
@@ -151,18 +169,22 @@ int main(void)
     	if(!isSdCardMounted)
         {
     		f_mount(&USBHFatFS, (const TCHAR*)USBHPath, 0);
+    		wavLibrary_mount();          // Ready with the last index, the rescan runs below while idle
             isSdCardMounted = 1;
         }
+    	wavLibrary_process(WAV_LIBRARY_SCAN_STEP);
     	if(HAL_GPIO_ReadPin(GPIOA, GPIO_PIN_0))
     	{
     		HAL_GPIO_WritePin(GPIOD, GPIO_PIN_13, GPIO_PIN_SET);
+    		TRACE_EVENT(TRACE_EV_BUTTON, TRACE_BUTTON_PLAY);
             HAL_Delay(500);
-            wavPlayer_fileSelect(WAV_FILE);
-            wavPlayer_play();
+            wavPlayer_setImpulse(IR_FILE);
+            buildPlaylist();
+            playlist_start(0);
 
-            while(!wavPlayer_isFinished())
+            while(!playlist_isFinished())
             {
-            	wavPlayer_process();
+            	playlist_process();
 
             	if(HAL_GPIO_ReadPin(GPIOA, GPIO_PIN_0))
                 {
@@ -170,22 +192,26 @@ int main(void)
             		if(pauseResumeToggle)
             		{
             			HAL_GPIO_WritePin(GPIOD, GPIO_PIN_14, GPIO_PIN_SET);
+            			TRACE_EVENT(TRACE_EV_BUTTON, TRACE_BUTTON_PAUSE);
                         wavPlayer_pause();
-                        HAL_Delay(200);
+                        waitPlaying(200);
             		}
             		else
             		{
             			HAL_GPIO_WritePin(GPIOD, GPIO_PIN_14, GPIO_PIN_RESET);
-            			HAL_Delay(1000);
+            			waitPlaying(1000);
             			if(HAL_GPIO_ReadPin(GPIOA, GPIO_PIN_0))
             			{
-            				wavPlayer_stop();
+            				TRACE_EVENT(TRACE_EV_BUTTON, TRACE_BUTTON_STOP);
+            				playlist_stop();
             			}
+            			TRACE_EVENT(TRACE_EV_BUTTON, TRACE_BUTTON_RESUME);
             			wavPlayer_resume();
             		}
                 }
             }
             wavPlayer_stop();
+            trace_save(TRACE_FILE);       // The session's events on the drive, for trace_decode
             HAL_GPIO_WritePin(GPIOD, GPIO_PIN_13, GPIO_PIN_RESET);
             HAL_GPIO_WritePin(GPIOD, GPIO_PIN_12, GPIO_PIN_SET);
             HAL_Delay(500);
@@ -261,16 +287,16 @@ static void MX_ADC1_Init(void)
   /** Configure the global features of the ADC (Clock, Resolution, Data Alignment and number of conversion)
   */
   hadc1.Instance = ADC1;
-  hadc1.Init.ClockPrescaler = ADC_CLOCK_SYNC_PCLK_DIV4;
+  hadc1.Init.ClockPrescaler = ADC_CLOCK_SYNC_PCLK_DIV8;
   hadc1.Init.Resolution = ADC_RESOLUTION_12B;
   hadc1.Init.ScanConvMode = DISABLE;
-  hadc1.Init.ContinuousConvMode = DISABLE;
+  hadc1.Init.ContinuousConvMode = ENABLE;
   hadc1.Init.DiscontinuousConvMode = DISABLE;
   hadc1.Init.ExternalTrigConvEdge = ADC_EXTERNALTRIGCONVEDGE_NONE;
   hadc1.Init.ExternalTrigConv = ADC_SOFTWARE_START;
   hadc1.Init.DataAlign = ADC_DATAALIGN_RIGHT;
   hadc1.Init.NbrOfConversion = 1;
-  hadc1.Init.DMAContinuousRequests = DISABLE;
+  hadc1.Init.DMAContinuousRequests = ENABLE;
   hadc1.Init.EOCSelection = ADC_EOC_SINGLE_CONV;
   if (HAL_ADC_Init(&hadc1) != HAL_OK)
   {
@@ -281,13 +307,33 @@ static void MX_ADC1_Init(void)
   */
   sConfig.Channel = ADC_CHANNEL_1;
   sConfig.Rank = 1;
-  sConfig.SamplingTime = ADC_SAMPLETIME_3CYCLES;
+  sConfig.SamplingTime = ADC_SAMPLETIME_480CYCLES;
   if (HAL_ADC_ConfigChannel(&hadc1, &sConfig) != HAL_OK)
   {
     Error_Handler();
   }
   /* USER CODE BEGIN ADC1_Init 2 */
 
+  /* Echo level knob: 84 MHz / 8 / (480 + 12) cycles gives ~21 kHz continuous conversions,
+   * copied by DMA2 Stream0 into a circular buffer that the player reads when it refills.
+   * The stream interrupt is left disabled in the NVIC, so the knob costs no CPU time.
+   */
+  hdma_adc1.Instance = DMA2_Stream0;
+  hdma_adc1.Init.Channel = DMA_CHANNEL_0;
+  hdma_adc1.Init.Direction = DMA_PERIPH_TO_MEMORY;
+  hdma_adc1.Init.PeriphInc = DMA_PINC_DISABLE;
+  hdma_adc1.Init.MemInc = DMA_MINC_ENABLE;
+  hdma_adc1.Init.PeriphDataAlignment = DMA_PDATAALIGN_HALFWORD;
+  hdma_adc1.Init.MemDataAlignment = DMA_MDATAALIGN_HALFWORD;
+  hdma_adc1.Init.Mode = DMA_CIRCULAR;
+  hdma_adc1.Init.Priority = DMA_PRIORITY_LOW;
+  hdma_adc1.Init.FIFOMode = DMA_FIFOMODE_DISABLE;
+  if (HAL_DMA_Init(&hdma_adc1) != HAL_OK)
+  {
+    Error_Handler();
+  }
+  __HAL_LINKDMA(&hadc1, DMA_Handle, hdma_adc1);
+
   /* USER CODE END ADC1_Init 2 */
 
 }
@@ -368,6 +414,7 @@ static void MX_DMA_Init(void)
 
   /* DMA controller clock enable */
   __HAL_RCC_DMA1_CLK_ENABLE();
+  __HAL_RCC_DMA2_CLK_ENABLE();
 
   /* DMA interrupt init */
   /* DMA1_Stream5_IRQn interrupt configuration */
@@ -431,6 +478,40 @@ static void MX_GPIO_Init(void)
 
 /* USER CODE BEGIN 4 */
 
+// Debounce wait that keeps the player refilling: a soft pause fades out and plays silence only
+// while wavPlayer_process() runs, and the playlist only moves on to the next track while it runs
+static void waitPlaying(uint32_t ms)
+{
+  uint32_t start = HAL_GetTick();
+
+  while (HAL_GetTick() - start < ms)
+  {
+    playlist_process();
+  }
+}
+
+// Playlist of the playable files in the library index, or the default files before the first scan
+static void buildPlaylist(void)
+{
+  WAV_LIBRARY_EntryTypeDef entry;
+
+  playlist_clear();
+  for(uint32_t i = 0; i < wavLibrary_getCount() && playlist_getCount() < PLAYLIST_MAX_TRACKS; i++)
+  {
+    if(wavLibrary_getEntry(i, &entry) && entry.sampleRate != 0)
+    {
+      playlist_add(entry.path);
+    }
+  }
+  if(playlist_getCount() == 0)
+  {
+    for(uint32_t i = 0; i < sizeof(wavFiles) / sizeof(wavFiles[0]); i++)
+    {
+      playlist_add(wavFiles[i]);
+    }
+  }
+}
+
 /* USER CODE END 4 */
 
 /**
@@ -0,0 +1,321 @@
+/*
+Library:				pcm_convert.c
+Written by:				Shridattha M Hebbar
+Date Written:			16/10/2026
+Description:			Sample format conversion to 16-bit stereo, see pcm_convert.h. The integer
+						kernels load whole words and assemble output frames with shifts and masks
+						(little-endian data, as on the Cortex-M4 and the host), so they need neither
+						byte loads nor the DSP extension and run the same on target and host.
+*/
+
+#include <string.h>
+#include "pcm_convert.h"
+#include "wav_riff.h"
+
+//--------------------------------------------------------------//
+//---------------------- Static functions ----------------------//
+//--------------------------------------------------------------//
+
+// Word access that is legal at any alignment; compiles to a single LDR/STR on the Cortex-M4
+static inline uint32_t load32(const uint8_t *p)
+{
+	uint32_t v;
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+static inline void store32(int16_t *p, uint32_t v)
+{
+	memcpy(p, &v, sizeof(v));
+}
+
+// Stereo frame of one 16-bit sample in both channels
+static inline uint32_t dup16(uint32_t s)
+{
+	return (s & 0xFFFFu) * 0x00010001u;
+}
+
+// Top 16 bits of the 24-bit sample at p
+static inline uint32_t top24(const uint8_t *p)
+{
+	return (uint32_t)p[1] | (uint32_t)p[2] << 8;
+}
+
+// Float sample to int16: scaled by 32768, rounded to nearest, saturated, NaN to 0
+static inline int16_t floatToS16(float x)
+{
+	float v = x * 32768.0f;
+
+	if (v > -32768.0f && v < 32767.0f)
+		return (int16_t)(v + ((v < 0.0f) ? -0.5f : 0.5f));
+	return (v > 0.0f) ? 32767 : (v < 0.0f) ? -32768 : 0;
+}
+
+static inline float loadFloat(const uint8_t *p)
+{
+	float v;
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+//--------------------------------------------------------------//
+//---------------------- Public Functions ----------------------//
+//--------------------------------------------------------------//
+
+/**
+ * @brief Conversion kernel for a source format
+ * @param encoding: WAV_RIFF_PCM or WAV_RIFF_FLOAT
+ * @param bitsPerSample: 8, 16, 24 or 32 (PCM), 32 (float)
+ * @param channels: 1 or 2
+ * @retval kernel, NULL when the format is not supported
+ */
+PCM_ConvertFunc pcmConvert_select(uint16_t encoding, uint16_t bitsPerSample, uint16_t channels)
+{
+	static const PCM_ConvertFunc pcm[4][2] = {
+		{ pcmConvert_u8Mono,  pcmConvert_u8Stereo },
+		{ pcmConvert_s16Mono, pcmConvert_s16Stereo },
+		{ pcmConvert_s24Mono, pcmConvert_s24Stereo },
+		{ pcmConvert_s32Mono, pcmConvert_s32Stereo },
+	};
+
+	if (channels < 1 || channels > 2)
+		return NULL;
+	if (encoding == WAV_RIFF_FLOAT)
+		return (bitsPerSample == 32) ? ((channels == 1) ? pcmConvert_f32Mono : pcmConvert_f32Stereo) : NULL;
+	if (encoding != WAV_RIFF_PCM || (bitsPerSample & 7u) || bitsPerSample < 8 || bitsPerSample > 32)
+		return NULL;
+	return pcm[bitsPerSample / 8u - 1u][channels - 1u];
+}
+
+/**
+ * @brief 8-bit unsigned mono, four frames per source word
+ * @param src: source frames
+ * @param dst: 16-bit stereo output, word aligned
+ * @param frames: frames to convert
+ * @retval None
+ */
+void pcmConvert_u8Mono(const uint8_t *src, int16_t *dst, uint32_t frames)
+{
+	uint32_t i = 0;
+
+	for (; i + 4 <= frames; i += 4)
+	{
+		uint32_t x = load32(&src[i]) ^ 0x80808080u;		// Offset binary to two's complement bytes
+		store32(&dst[2 * i], (x & 0xFFu) * 0x01000100u);	// Byte to the top of both halves
+		store32(&dst[2 * i + 2], ((x >> 8) & 0xFFu) * 0x01000100u);
+		store32(&dst[2 * i + 4], ((x >> 16) & 0xFFu) * 0x01000100u);
+		store32(&dst[2 * i + 6], (x >> 24) * 0x01000100u);
+	}
+	for (; i < frames; i++)
+	{
+		store32(&dst[2 * i], (uint32_t)(src[i] ^ 0x80u) * 0x01000100u);
+	}
+}
+
+/**
+ * @brief 8-bit unsigned stereo, two frames per source word
+ * @param src: source frames
+ * @param dst: 16-bit stereo output, word aligned
+ * @param frames: frames to convert
+ * @retval None
+ */
+void pcmConvert_u8Stereo(const uint8_t *src, int16_t *dst, uint32_t frames)
+{
+	uint32_t i = 0;
+
+	for (; i + 2 <= frames; i += 2)
+	{
+		uint32_t x = load32(&src[2 * i]) ^ 0x80808080u;
+		store32(&dst[2 * i], ((x << 8) & 0x0000FF00u) | ((x << 16) & 0xFF000000u));
+		store32(&dst[2 * i + 2], ((x >> 8) & 0x0000FF00u) | (x & 0xFF000000u));
+	}
+	for (; i < frames; i++)
+	{
+		uint32_t l = src[2 * i] ^ 0x80u, r = src[2 * i + 1] ^ 0x80u;
+		store32(&dst[2 * i], l << 8 | r << 24);
+	}
+}
+
+/**
+ * @brief 16-bit mono, two frames per source word
+ * @param src: source frames
+ * @param dst: 16-bit stereo output, word aligned
+ * @param frames: frames to convert
+ * @retval None
+ */
+void pcmConvert_s16Mono(const uint8_t *src, int16_t *dst, uint32_t frames)
+{
+	uint32_t i = 0;
+
+	for (; i + 2 <= frames; i += 2)
+	{
+		uint32_t w = load32(&src[2 * i]);
+		store32(&dst[2 * i], dup16(w));
+		store32(&dst[2 * i + 2], (w & 0xFFFF0000u) | (w >> 16));
+	}
+	for (; i < frames; i++)
+	{
+		store32(&dst[2 * i], dup16((uint32_t)src[2 * i] | (uint32_t)src[2 * i + 1] << 8));
+	}
+}
+
+/**
+ * @brief 16-bit stereo, already the internal format
+ * @param src: source frames
+ * @param dst: 16-bit stereo output
+ * @param frames: frames to copy
+ * @retval None
+ */
+void pcmConvert_s16Stereo(const uint8_t *src, int16_t *dst, uint32_t frames)
+{
+	memcpy(dst, src, frames * PCM_OUT_FRAME_BYTES);
+}
+
+/**
+ * @brief 24-bit mono, four frames per three source words
+ * @param src: source frames
+ * @param dst: 16-bit stereo output, word aligned
+ * @param frames: frames to convert
+ * @retval None
+ */
+void pcmConvert_s24Mono(const uint8_t *src, int16_t *dst, uint32_t frames)
+{
+	uint32_t i = 0;
+
+	for (; i + 4 <= frames; i += 4)
+	{
+		const uint8_t *p = &src[3 * i];
+		uint32_t w0 = load32(p), w1 = load32(p + 4), w2 = load32(p + 8);
+		store32(&dst[2 * i], dup16(w0 >> 8));					// Bytes 1, 2
+		store32(&dst[2 * i + 2], dup16(w1));					// Bytes 4, 5
+		store32(&dst[2 * i + 4], dup16(w1 >> 24 | w2 << 8));	// Bytes 7, 8
+		store32(&dst[2 * i + 6], dup16(w2 >> 16));				// Bytes 10, 11
+	}
+	for (; i < frames; i++)
+	{
+		store32(&dst[2 * i], dup16(top24(&src[3 * i])));
+	}
+}
+
+/**
+ * @brief 24-bit stereo, two frames per three source words
+ * @param src: source frames
+ * @param dst: 16-bit stereo output, word aligned
+ * @param frames: frames to convert
+ * @retval None
+ */
+void pcmConvert_s24Stereo(const uint8_t *src, int16_t *dst, uint32_t frames)
+{
+	uint32_t i = 0;
+
+	for (; i + 2 <= frames; i += 2)
+	{
+		const uint8_t *p = &src[6 * i];
+		uint32_t w0 = load32(p), w1 = load32(p + 4), w2 = load32(p + 8);
+		store32(&dst[2 * i], ((w0 >> 8) & 0xFFFFu) | w1 << 16);
+		store32(&dst[2 * i + 2], (w1 >> 24) | ((w2 & 0xFFu) << 8) | (w2 & 0xFFFF0000u));
+	}
+	for (; i < frames; i++)
+	{
+		store32(&dst[2 * i], top24(&src[6 * i]) | top24(&src[6 * i + 3]) << 16);
+	}
+}
+
+/**
+ * @brief 32-bit mono, one frame per source word
+ * @param src: source frames
+ * @param dst: 16-bit stereo output, word aligned
+ * @param frames: frames to convert
+ * @retval None
+ */
+void pcmConvert_s32Mono(const uint8_t *src, int16_t *dst, uint32_t frames)
+{
+	uint32_t i = 0;
+
+	for (; i + 2 <= frames; i += 2)
+	{
+		uint32_t w0 = load32(&src[4 * i]), w1 = load32(&src[4 * i + 4]);
+		store32(&dst[2 * i], (w0 & 0xFFFF0000u) | (w0 >> 16));
+		store32(&dst[2 * i + 2], (w1 & 0xFFFF0000u) | (w1 >> 16));
+	}
+	for (; i < frames; i++)
+	{
+		uint32_t w = load32(&src[4 * i]);
+		store32(&dst[2 * i], (w & 0xFFFF0000u) | (w >> 16));
+	}
+}
+
+/**
+ * @brief 32-bit stereo, one frame per two source words
+ * @param src: source frames
+ * @param dst: 16-bit stereo output, word aligned
+ * @param frames: frames to convert
+ * @retval None
+ */
+void pcmConvert_s32Stereo(const uint8_t *src, int16_t *dst, uint32_t frames)
+{
+	uint32_t i = 0;
+
+	for (; i + 2 <= frames; i += 2)
+	{
+		const uint8_t *p = &src[8 * i];
+		store32(&dst[2 * i], (load32(p) >> 16) | (load32(p + 4) & 0xFFFF0000u));
+		store32(&dst[2 * i + 2], (load32(p + 8) >> 16) | (load32(p + 12) & 0xFFFF0000u));
+	}
+	for (; i < frames; i++)
+	{
+		store32(&dst[2 * i], (load32(&src[8 * i]) >> 16) | (load32(&src[8 * i + 4]) & 0xFFFF0000u));
+	}
+}
+
+/**
+ * @brief 32-bit float mono
+ * @param src: source frames
+ * @param dst: 16-bit stereo output
+ * @param frames: frames to convert
+ * @retval None
+ */
+void pcmConvert_f32Mono(const uint8_t *src, int16_t *dst, uint32_t frames)
+{
+	uint32_t i = 0;
+
+	for (; i + 2 <= frames; i += 2)
+	{
+		int16_t a = floatToS16(loadFloat(&src[4 * i]));
+		int16_t b = floatToS16(loadFloat(&src[4 * i + 4]));
+		dst[2 * i] = a;
+		dst[2 * i + 1] = a;
+		dst[2 * i + 2] = b;
+		dst[2 * i + 3] = b;
+	}
+	for (; i < frames; i++)
+	{
+		dst[2 * i] = dst[2 * i + 1] = floatToS16(loadFloat(&src[4 * i]));
+	}
+}
+
+/**
+ * @brief 32-bit float stereo
+ * @param src: source frames
+ * @param dst: 16-bit stereo output
+ * @param frames: frames to convert
+ * @retval None
+ */
+void pcmConvert_f32Stereo(const uint8_t *src, int16_t *dst, uint32_t frames)
+{
+	uint32_t i = 0;
+
+	for (; i + 2 <= frames; i += 2)
+	{
+		const uint8_t *p = &src[8 * i];
+		dst[2 * i] = floatToS16(loadFloat(p));
+		dst[2 * i + 1] = floatToS16(loadFloat(p + 4));
+		dst[2 * i + 2] = floatToS16(loadFloat(p + 8));
+		dst[2 * i + 3] = floatToS16(loadFloat(p + 12));
+	}
+	for (; i < frames; i++)
+	{
+		dst[2 * i] = floatToS16(loadFloat(&src[8 * i]));
+		dst[2 * i + 1] = floatToS16(loadFloat(&src[8 * i + 4]));
+	}
+}
@@ -0,0 +1,232 @@
+/*
+Library:				playlist.c
+Written by:				Shridattha M Hebbar
+Date Written:			16/10/2026
+Description:			Playlist engine, see playlist.h. The next track is queued with the player as
+						soon as the current one has started, so its header parse and first reads happen
+						a whole track ahead of the switch. The player counts its gapless switches; the
+						playlist follows that count to know which track is playing.
+*/
+
+#include "playlist.h"
+#include "wav_player.h"
+#include <string.h>
+
+static char tracks[PLAYLIST_MAX_TRACKS][PLAYLIST_PATH_MAX];
+static uint32_t trackCount = 0;
+static bool loopAll = false;
+static bool active = false;
+static uint32_t current = PLAYLIST_NONE;	// Track handed to the audio ring
+static uint32_t queued = PLAYLIST_NONE;		// Track queued with the player for a gapless switch
+static uint32_t tried = PLAYLIST_NONE;		// Next track already offered to the player
+static uint32_t lastChanges;				// wavPlayer_getTrackChanges() at the last switch seen
+static uint32_t restarts = 0;				// Tracks that could not follow gaplessly
+
+//--------------------------------------------------------------//
+//---------------------- Static functions ----------------------//
+//--------------------------------------------------------------//
+
+// Track after index, PLAYLIST_NONE at the end of a playlist that does not loop
+
+static uint32_t nextIndex(uint32_t index)
+{
+	if (index + 1u < trackCount)
+	{
+		return index + 1u;
+	}
+	return loopAll ? 0u : PLAYLIST_NONE;
+}
+
+// Select and play the first track from index on that opens, one pass over the playlist at most
+
+static bool startFrom(uint32_t index)
+{
+	for (uint32_t n = 0; n < trackCount && index != PLAYLIST_NONE; n++)
+	{
+		if (wavPlayer_fileSelect(tracks[index]))
+		{
+			wavPlayer_play();
+			current = index;
+			queued = PLAYLIST_NONE;
+			tried = PLAYLIST_NONE;
+			lastChanges = wavPlayer_getTrackChanges();
+			return true;
+		}
+		index = nextIndex(index);
+	}
+	return false;
+}
+
+//--------------------------------------------------------------//
+//---------------------- Public Functions ----------------------//
+//--------------------------------------------------------------//
+
+/**
+ * @brief Remove every track
+ * @note Stops playback first.
+ * @param None
+ * @retval None
+ */
+void playlist_clear(void)
+{
+	playlist_stop();
+	trackCount = 0;
+	current = PLAYLIST_NONE;
+}
+
+/**
+ * @brief Append a track
+ * @param path: path to .wav file in the USB Drive, copied
+ * @retval false when the playlist is full or the path longer than PLAYLIST_PATH_MAX - 1
+ */
+bool playlist_add(const char *path)
+{
+	size_t len = strlen(path);
+
+	if (trackCount >= PLAYLIST_MAX_TRACKS || len >= PLAYLIST_PATH_MAX)
+	{
+		return false;
+	}
+	memcpy(tracks[trackCount], path, len + 1u);
+	trackCount++;
+	return true;
+}
+
+/**
+ * @brief Tracks in the playlist
+ * @param None
+ * @retval track count
+ */
+uint32_t playlist_getCount(void)
+{
+	return trackCount;
+}
+
+/**
+ * @brief Continue with the first track after the last one
+ * @note Takes effect for the next track queued; the track after the current one may be queued already.
+ * @param loop: true to repeat the playlist until playlist_stop()
+ * @retval None
+ */
+void playlist_setLoop(bool loop)
+{
+	loopAll = loop;
+}
+
+/**
+ * @brief Start playing at a track
+ * @note Tracks that are missing or unsupported are skipped.
+ * @param index: first track, from 0
+ * @retval false when no track from index on can be played
+ */
+bool playlist_start(uint32_t index)
+{
+	playlist_stop();
+	if (index >= trackCount)
+	{
+		return false;
+	}
+	active = startFrom(index);
+	return active;
+}
+
+/**
+ * @brief Run the player and move through the playlist, call from the main loop in place of wavPlayer_process()
+ * @param None
+ * @retval None
+ */
+void playlist_process(void)
+{
+	uint32_t changes, next;
+
+	if (!active)
+	{
+		return;
+	}
+	wavPlayer_process();
+
+	//The player moved on to the queued track at the sample boundary
+	changes = wavPlayer_getTrackChanges();
+	if (changes != lastChanges)
+	{
+		lastChanges = changes;
+		current = queued;
+		queued = PLAYLIST_NONE;
+		tried = PLAYLIST_NONE;
+	}
+
+	//Played out without a queued track: the next one is at another rate (or missing), start it
+	if (wavPlayer_isFinished())
+	{
+		next = nextIndex(current);
+		if (next != PLAYLIST_NONE && startFrom(next))
+		{
+			restarts++;
+		}
+		else
+		{
+			active = false;
+		}
+		return;
+	}
+
+	//Queue the next track once per track, its header and first chunks are read well before the switch
+	if (queued == PLAYLIST_NONE && tried == PLAYLIST_NONE)
+	{
+		next = nextIndex(current);
+		if (next != PLAYLIST_NONE)
+		{
+			tried = next;
+			if (wavPlayer_queueNext(tracks[next]))
+			{
+				queued = next;
+			}
+		}
+	}
+}
+
+/**
+ * @brief Stop playback
+ * @param None
+ * @retval None
+ */
+void playlist_stop(void)
+{
+	if (active)
+	{
+		wavPlayer_stop();
+		active = false;
+	}
+}
+
+/**
+ * @brief Whether the playlist has played out or was stopped
+ * @param None
+ * @retval true when nothing is playing
+ */
+bool playlist_isFinished(void)
+{
+	return !active;
+}
+
+/**
+ * @brief Track being played
+ * @note Moves on when the first frame of the next track goes into the audio ring, one ring
+ *       length ahead of when it is heard.
+ * @param None
+ * @retval track index, PLAYLIST_NONE before the first start
+ */
+uint32_t playlist_getCurrent(void)
+{
+	return current;
+}
+
+/**
+ * @brief Tracks started after the previous one played out instead of gaplessly
+ * @param None
+ * @retval restarts since power up, each one re-clocks the I2S if the rate changed
+ */
+uint32_t playlist_getRestarts(void)
+{
+	return restarts;
+}
@@ -0,0 +1,287 @@
+/*
+Library:				read_fifo.c
+Written by:				Shridattha M Hebbar
+Date Written:			16/10/2026
+Description:			Read-ahead FIFO between FatFs and the audio refill path, see read_fifo.h.
+*/
+
+#include <string.h>
+#include "read_fifo.h"
+#include "trace.h"
+
+//Sector size of the FatFs build (R0.13 and later name it FF_MAX_SS, older releases _MAX_SS)
+#if defined(FF_MAX_SS)
+#define READ_FIFO_SECTOR  FF_MAX_SS
+#else
+#define READ_FIFO_SECTOR  _MAX_SS
+#endif
+
+//--------------------------------------------------------------//
+//---------------------- Static functions ----------------------//
+//--------------------------------------------------------------//
+
+// Cluster size of the volume clamped to the chunk range, reduced until it divides the buffer
+static uint32_t chunkFor(const FIL *file, uint32_t size)
+{
+	uint32_t cluster = READ_FIFO_MIN_CHUNK;
+	uint32_t chunk = READ_FIFO_MIN_CHUNK;
+
+	if (file->obj.fs)
+	{
+		cluster = (uint32_t)file->obj.fs->csize * READ_FIFO_SECTOR;
+	}
+	while (chunk < READ_FIFO_MAX_CHUNK && chunk < cluster && size % (2u * chunk) == 0)
+	{
+		chunk *= 2u;
+	}
+	return chunk;
+}
+
+// Bytes buffered from the tail on: the rest of the region, and once reading ahead has moved on,
+// the gap and what has been read of the next region
+static uint32_t bufferedBytes(const READ_FIFO_HandleTypeDef *hfifo)
+{
+	if (hfifo->fillingNext)
+		return hfifo->end - hfifo->tail + hfifo->gap + (hfifo->head - hfifo->next.start);
+	return hfifo->head - hfifo->tail;
+}
+
+// Move reading ahead on to the chained region. Its first byte goes to the next buffer offset that
+// has the same position within a chunk, so its chunk reads stay aligned and never wrap.
+static bool fillNext(READ_FIFO_HandleTypeDef *hfifo)
+{
+	uint32_t pos = (hfifo->head + hfifo->base) % hfifo->size;
+	uint32_t gap = (hfifo->next.start - pos) % hfifo->chunk;	// chunk is a power of two
+
+	hfifo->gap = gap;
+	hfifo->next.base = (pos + gap + hfifo->size - hfifo->next.start % hfifo->size) % hfifo->size;
+	hfifo->head = hfifo->next.start;
+	hfifo->fillingNext = true;
+	hfifo->error = f_lseek(hfifo->next.file, hfifo->next.start);
+	return hfifo->error == FR_OK;
+}
+
+//--------------------------------------------------------------//
+//---------------------- Public Functions ----------------------//
+//--------------------------------------------------------------//
+
+/**
+ * @brief Map the cluster chain of an open file for FatFs fast-seek
+ * @note A file of n fragments needs 2n + 2 entries. Without the map, or when the file is too
+ *       fragmented for it, FatFs follows the FAT chain as usual.
+ * @param file: open file
+ * @param map: link map storage, must stay valid until the file is closed
+ * @param entries: DWORDs in map
+ * @retval true when reads and seeks of the file now use the map
+ */
+bool readFifo_mapFile(FIL *file, DWORD *map, UINT entries)
+{
+#if READ_FIFO_FASTSEEK
+	map[0] = entries;
+	file->cltbl = map;
+	if (f_lseek(file, CREATE_LINKMAP) == FR_OK)
+		return true;
+	file->cltbl = NULL;
+#else
+	(void)file;
+	(void)map;
+	(void)entries;
+#endif
+	return false;
+}
+
+/**
+ * @brief Start reading a file region through the FIFO
+ * @param hfifo: FIFO state
+ * @param file: open file, the FIFO owns its read position from now on
+ * @param mem: buffer, word aligned
+ * @param size: buffer bytes, a multiple of READ_FIFO_MIN_CHUNK
+ * @param start: file offset of the first byte to read
+ * @param end: file offset at which reading stops
+ * @param unit: bytes are handed out in whole multiples of this, e.g. the frame size
+ * @retval false when the buffer size is not supported or the seek fails
+ */
+bool readFifo_init(READ_FIFO_HandleTypeDef *hfifo, FIL *file, void *mem, uint32_t size,
+                   uint32_t start, uint32_t end, uint32_t unit)
+{
+	memset(hfifo, 0, sizeof(*hfifo));
+	if (size == 0 || size % READ_FIFO_MIN_CHUNK)
+		return false;
+	hfifo->file = file;
+	hfifo->buf = mem;
+	hfifo->size = size;
+	hfifo->chunk = chunkFor(file, size);
+	hfifo->unit = unit ? unit : 1u;
+	hfifo->head = start;
+	hfifo->tail = start;
+	hfifo->end = (end < start) ? start : end;
+	hfifo->error = f_lseek(file, start);
+	return hfifo->error == FR_OK;
+}
+
+/**
+ * @brief Chain a file region behind the one being read, for gapless playback
+ * @note Reading ahead continues into it once the current region is read to its end; the
+ *       reader moves on to it with readFifo_nextRegion(). file's position is set then.
+ * @param hfifo: FIFO state
+ * @param file: open file on the same volume, owned by the FIFO from now on
+ * @param start: file offset of the first byte to read
+ * @param end: file offset at which reading stops
+ * @param unit: bytes of the region are handed out in whole multiples of this
+ * @retval false when a region is chained already
+ */
+bool readFifo_chain(READ_FIFO_HandleTypeDef *hfifo, FIL *file, uint32_t start, uint32_t end, uint32_t unit)
+{
+	if (hfifo->chained)
+		return false;
+	hfifo->next.file = file;
+	hfifo->next.start = start;
+	hfifo->next.end = (end < start) ? start : end;
+	hfifo->next.unit = unit ? unit : 1u;
+	hfifo->chained = true;
+	return true;
+}
+
+/**
+ * @brief Hand out the chained region from now on
+ * @note Call once readFifo_isEnd() reports the current region handed out. The bytes already
+ *       read ahead of the chained region stay in the FIFO.
+ * @param hfifo: FIFO state
+ * @retval false when no region is chained or its seek fails
+ */
+bool readFifo_nextRegion(READ_FIFO_HandleTypeDef *hfifo)
+{
+	if (!hfifo->chained || (!hfifo->fillingNext && !fillNext(hfifo)))
+		return false;
+	hfifo->file = hfifo->next.file;
+	hfifo->unit = hfifo->next.unit;
+	hfifo->base = hfifo->next.base;
+	hfifo->tail = hfifo->next.start;
+	hfifo->end = hfifo->next.end;
+	hfifo->chained = false;
+	hfifo->fillingNext = false;
+	hfifo->gap = 0;
+	return true;
+}
+
+/**
+ * @brief Continue reading at another offset of the region
+ * @note A forward jump into the buffered data only drops bytes. Any other jump empties the
+ *       FIFO and costs one f_lseek(), which with a fast-seek link map does not walk the FAT.
+ * @param hfifo: FIFO state
+ * @param offset: file offset of the next byte to hand out, clamped to the end of the region
+ * @retval false when the seek fails
+ */
+bool readFifo_seek(READ_FIFO_HandleTypeDef *hfifo, uint32_t offset)
+{
+	if (offset > hfifo->end)
+		offset = hfifo->end;
+	if (offset >= hfifo->tail && offset <= (hfifo->fillingNext ? hfifo->end : hfifo->head))
+	{
+		hfifo->tail = offset;
+		return true;
+	}
+	hfifo->fillingNext = false;					// The chained region is read ahead again later
+	hfifo->gap = 0;
+	hfifo->head = offset;
+	hfifo->tail = offset;
+	hfifo->error = f_lseek(hfifo->file, offset);
+	return hfifo->error == FR_OK;
+}
+
+/**
+ * @brief Read ahead while there is room for the next chunk
+ * @note The first read only runs up to the next chunk boundary, every later read is one aligned
+ *       chunk. At the end of the region reading continues with a chained one. Call from the
+ *       main loop; maxChunks bounds the time spent in the file system.
+ * @param hfifo: FIFO state
+ * @param maxChunks: most reads to issue
+ * @retval bytes read
+ */
+uint32_t readFifo_fill(READ_FIFO_HandleTypeDef *hfifo, uint32_t maxChunks)
+{
+	uint32_t total = 0;
+
+	while (maxChunks-- && hfifo->error == FR_OK)
+	{
+		READ_FIFO_RegionTypeDef cur = { hfifo->file, 0, hfifo->end, hfifo->unit, hfifo->base };
+		READ_FIFO_RegionTypeDef *region = hfifo->fillingNext ? &hfifo->next : &cur;
+		uint32_t want;
+		UINT got = 0;
+
+		if (hfifo->head >= region->end)
+		{
+			if (hfifo->fillingNext || !hfifo->chained || !fillNext(hfifo))
+				break;
+			region = &hfifo->next;
+			if (hfifo->head >= region->end)
+				break;
+		}
+		want = hfifo->chunk - hfifo->head % hfifo->chunk;
+		if (want > region->end - hfifo->head)
+			want = region->end - hfifo->head;
+		if (hfifo->size - bufferedBytes(hfifo) < want)
+			break;										// No room for the next chunk yet
+		hfifo->error = f_read(region->file, &hfifo->buf[(hfifo->head + region->base) % hfifo->size], want, &got);
+		hfifo->reads++;
+		TRACE_EVENT(TRACE_EV_FILE_READ, got);
+		hfifo->head += got;
+		total += got;
+		if (got < want)
+		{
+			region->end = hfifo->head;					// File shorter than its header claims
+			if (region == &cur)
+				hfifo->end = hfifo->head;
+		}
+	}
+	return total;
+}
+
+/**
+ * @brief Take bytes out of the FIFO
+ * @param hfifo: FIFO state
+ * @param dst: destination
+ * @param bytes: bytes wanted, a multiple of the unit
+ * @retval bytes copied, a multiple of the unit; less than asked when the FIFO ran dry or the region ended
+ */
+uint32_t readFifo_read(READ_FIFO_HandleTypeDef *hfifo, void *dst, uint32_t bytes)
+{
+	uint32_t level = (hfifo->fillingNext ? hfifo->end : hfifo->head) - hfifo->tail;
+	uint32_t pos = (hfifo->tail + hfifo->base) % hfifo->size;
+	uint32_t first;
+
+	if (bytes > level)
+	{
+		if (hfifo->tail + level < hfifo->end)
+		{
+			hfifo->underruns++;
+			TRACE_EVENT(TRACE_EV_UNDERRUN, bytes - level);
+		}
+		bytes = level - level % hfifo->unit;				// Never split a frame
+	}
+	first = (bytes < hfifo->size - pos) ? bytes : hfifo->size - pos;
+	memcpy(dst, &hfifo->buf[pos], first);
+	memcpy((uint8_t*)dst + first, hfifo->buf, bytes - first);
+	hfifo->tail += bytes;
+	return bytes;
+}
+
+/**
+ * @brief Bytes buffered and not yet handed out
+ * @param hfifo: FIFO state
+ * @retval bytes, including any read ahead of a chained region
+ */
+uint32_t readFifo_level(const READ_FIFO_HandleTypeDef *hfifo)
+{
+	return bufferedBytes(hfifo) - hfifo->gap;
+}
+
+/**
+ * @brief Whether every byte of the region has been handed out
+ * @param hfifo: FIFO state
+ * @retval true at the end of the region
+ */
+bool readFifo_isEnd(const READ_FIFO_HandleTypeDef *hfifo)
+{
+	return hfifo->tail >= hfifo->end;
+}
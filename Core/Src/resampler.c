@@ -0,0 +1,281 @@
+/*
+Library:				resampler.c
+Written by:				Shridattha M Hebbar
+Date Written:			16/10/2026
+Description:			Polyphase sample-rate converter, see resampler.h. The coefficient table is
+						designed once per stream in resampler_init(), and each output frame then costs
+						one pass of taps multiply-accumulates per channel over the input history. The
+						rates are reduced by their gcd and the position kept as a whole frame plus a
+						remainder in 1/outRate units, so no rounding error builds up over a long file.
+*/
+
+#include <math.h>
+#include <string.h>
+#include "resampler.h"
+
+#define RESAMPLER_PI        3.14159265358979f
+#define RESAMPLER_MAX_TAPS  64u     // Taps per phase when a downsampling ratio widens the filter
+
+//Prototype filter of each quality
+typedef struct
+{
+  uint16_t taps;           // Taps per phase
+  uint16_t maxPhases;      // Phases when the ratio needs more
+  float rolloff;           // Cutoff as a fraction of the lower Nyquist rate
+  float beta;              // Kaiser window shape
+}RESAMPLER_DesignTypeDef;
+
+static const RESAMPLER_DesignTypeDef resamplerDesign[] = {
+	{ 8u,  64u,  0.85f, 5.0f },		// RESAMPLER_QUALITY_FAST
+	{ 16u, 128u, 0.90f, 7.0f },		// RESAMPLER_QUALITY_BALANCED
+	{ 32u, 256u, 0.94f, 9.0f },		// RESAMPLER_QUALITY_HIGH
+};
+
+//--------------------------------------------------------------//
+//---------------------- Static functions ----------------------//
+//--------------------------------------------------------------//
+
+static uint32_t gcd(uint32_t a, uint32_t b)
+{
+	while (b != 0)
+	{
+		uint32_t t = a % b;
+		a = b;
+		b = t;
+	}
+	return a;
+}
+
+// Design for a quality and a reduced ratio. Phases: one per output frame of the ratio's period
+// when that fits, otherwise the quality's maximum. Taps: the quality's count of output periods,
+// so downsampling by N takes N times the taps for the same transition band at the output.
+static const RESAMPLER_DesignTypeDef *design(RESAMPLER_QualityTypeDef quality, uint32_t inRate, uint32_t outRate,
+                                             uint32_t *taps, uint32_t *phases)
+{
+	const RESAMPLER_DesignTypeDef *d;
+
+	if ((uint32_t)quality >= sizeof(resamplerDesign) / sizeof(resamplerDesign[0]))
+		quality = RESAMPLER_QUALITY_BALANCED;
+	d = &resamplerDesign[quality];
+	*taps = d->taps * ((inRate + outRate - 1u) / outRate);
+	if (*taps > RESAMPLER_MAX_TAPS)
+		*taps = RESAMPLER_MAX_TAPS;
+	*phases = (outRate <= d->maxPhases) ? outRate : d->maxPhases;
+	return d;
+}
+
+// Modified Bessel function of the first kind, order 0, by its power series
+static float besselI0(float x)
+{
+	float sum = 1.0f, term = 1.0f;
+	float q = x * x * 0.25f;
+
+	for (uint32_t k = 1; k < 32u; k++)
+	{
+		term *= q / (float)(k * k);
+		sum += term;
+		if (term < sum * 1e-8f)
+			break;
+	}
+	return sum;
+}
+
+// Fill the phases x taps Q15 table. Phase p of tap k weighs the input frame lying
+// k - (taps/2 - 1) - p/phases frames from the output; every phase is normalised to unity gain.
+static void designCoeffs(RESAMPLER_HandleTypeDef *hrs, const RESAMPLER_DesignTypeDef *d)
+{
+	float half = (float)(hrs->taps / 2u);
+	float cutoff = d->rolloff * ((hrs->outRate < hrs->inRate) ? (float)hrs->outRate / (float)hrs->inRate : 1.0f);
+	float i0Beta = besselI0(d->beta);
+	float h[RESAMPLER_MAX_TAPS];
+
+	for (uint32_t p = 0; p < hrs->phases; p++)
+	{
+		float sum = 0.0f;
+
+		for (uint32_t k = 0; k < hrs->taps; k++)
+		{
+			float t = (float)k - (half - 1.0f) - (float)p / (float)hrs->phases;
+			float x = RESAMPLER_PI * cutoff * t;
+			float w = t / half;
+			float s = (x == 0.0f) ? 1.0f : sinf(x) / x;
+			w = (w > -1.0f && w < 1.0f) ? besselI0(d->beta * sqrtf(1.0f - w * w)) / i0Beta : 0.0f;
+			h[k] = cutoff * s * w;
+			sum += h[k];
+		}
+		for (uint32_t k = 0; k < hrs->taps; k++)
+		{
+			float v = h[k] / sum * 32768.0f;
+			v += (v < 0.0f) ? -0.5f : 0.5f;
+			hrs->coeffs[p * hrs->taps + k] = (v >= 32767.0f) ? 32767 : (v <= -32768.0f) ? -32768 : (int16_t)v;
+		}
+	}
+}
+
+static inline int16_t saturate16(int32_t x)
+{
+	return (x > 32767) ? 32767 : (x < -32768) ? -32768 : (int16_t)x;
+}
+
+//--------------------------------------------------------------//
+//---------------------- Public Functions ----------------------//
+//--------------------------------------------------------------//
+
+/**
+ * @brief Memory resampler_init() needs for a conversion
+ * @param quality: filter quality
+ * @param inRate: input sample rate in Hz
+ * @param outRate: output sample rate in Hz
+ * @retval bytes, 0 when a rate is 0
+ */
+uint32_t resampler_memBytes(RESAMPLER_QualityTypeDef quality, uint32_t inRate, uint32_t outRate)
+{
+	uint32_t div, taps, phases;
+
+	if (inRate == 0 || outRate == 0)
+		return 0;
+	div = gcd(inRate, outRate);
+	design(quality, inRate / div, outRate / div, &taps, &phases);
+	return phases * taps * sizeof(int16_t) + (taps + RESAMPLER_BLOCK_FRAMES) * 2u * sizeof(int16_t);
+}
+
+/**
+ * @brief Design the filter for a conversion and clear the history
+ * @param hrs: resampler handle
+ * @param mem: resampler_memBytes() bytes, 4-byte aligned, owned by the resampler until re-initialised
+ * @param quality: filter quality
+ * @param inRate: input sample rate in Hz
+ * @param outRate: output sample rate in Hz
+ * @retval true on success, false when a rate is 0 or mem is NULL
+ */
+bool resampler_init(RESAMPLER_HandleTypeDef *hrs, void *mem, RESAMPLER_QualityTypeDef quality,
+                    uint32_t inRate, uint32_t outRate)
+{
+	const RESAMPLER_DesignTypeDef *d;
+	uint32_t div, taps, phases;
+
+	if (mem == NULL || inRate == 0 || outRate == 0)
+		return false;
+	div = gcd(inRate, outRate);
+	hrs->inRate = inRate / div;
+	hrs->outRate = outRate / div;
+	d = design(quality, hrs->inRate, hrs->outRate, &taps, &phases);
+	hrs->taps = (uint16_t)taps;
+	hrs->phases = (uint16_t)phases;
+	hrs->coeffs = (int16_t *)mem;
+	hrs->hist = hrs->coeffs + phases * taps;
+	designCoeffs(hrs, d);
+	resampler_reset(hrs);
+	return true;
+}
+
+/**
+ * @brief Drop the input history, e.g. after a seek. The next input frame is the first output frame.
+ * @param hrs: resampler handle
+ * @retval None
+ */
+void resampler_reset(RESAMPLER_HandleTypeDef *hrs)
+{
+	hrs->fill = hrs->taps / 2u - 1u;		// Silence before the first frame fills the leading taps
+	hrs->pos = 0;
+	hrs->acc = 0;
+	memset(hrs->hist, 0, hrs->fill * 2u * sizeof(int16_t));
+}
+
+/**
+ * @brief Input frames still to be committed before outFrames output frames can be produced
+ * @param hrs: resampler handle
+ * @param outFrames: output frames wanted
+ * @retval input frames, 0 when the history already covers them
+ */
+uint32_t resampler_inputFrames(const RESAMPLER_HandleTypeDef *hrs, uint32_t outFrames)
+{
+	uint64_t total;
+	uint32_t last, rem;
+
+	if (outFrames == 0)
+		return 0;
+	total = hrs->acc + (uint64_t)(outFrames - 1u) * hrs->inRate;
+	last = hrs->pos + (uint32_t)(total / hrs->outRate);
+	rem = (uint32_t)(total % hrs->outRate);
+	if ((rem * hrs->phases + hrs->outRate / 2u) / hrs->outRate == hrs->phases)
+		last++;									// Rounds to phase 0 of the next frame
+	last += hrs->taps;
+	return (last > hrs->fill) ? last - hrs->fill : 0;
+}
+
+/**
+ * @brief Space for new input frames at the end of the history
+ * @param hrs: resampler handle
+ * @param frames: set to the frames that fit, at least RESAMPLER_BLOCK_FRAMES
+ * @retval where to write the 16-bit stereo frames, then call resampler_commit()
+ */
+int16_t *resampler_writeBuffer(RESAMPLER_HandleTypeDef *hrs, uint32_t *frames)
+{
+	if (hrs->pos != 0)
+	{
+		hrs->fill -= hrs->pos;
+		memmove(hrs->hist, &hrs->hist[2u * hrs->pos], hrs->fill * 2u * sizeof(int16_t));
+		hrs->pos = 0;
+	}
+	*frames = hrs->taps + RESAMPLER_BLOCK_FRAMES - hrs->fill;
+	return &hrs->hist[2u * hrs->fill];
+}
+
+/**
+ * @brief Append frames written through resampler_writeBuffer() to the history
+ * @param hrs: resampler handle
+ * @param frames: frames written, at most what resampler_writeBuffer() allowed
+ * @retval None
+ */
+void resampler_commit(RESAMPLER_HandleTypeDef *hrs, uint32_t frames)
+{
+	hrs->fill += frames;
+}
+
+/**
+ * @brief Produce output frames from the history
+ * @param hrs: resampler handle
+ * @param out: 16-bit stereo output
+ * @param frames: output frames wanted
+ * @retval frames produced, fewer when the history runs out
+ */
+uint32_t resampler_process(RESAMPLER_HandleTypeDef *hrs, int16_t *out, uint32_t frames)
+{
+	const uint32_t taps = hrs->taps;
+	uint32_t n;
+
+	for (n = 0; n < frames; n++)
+	{
+		uint32_t phase = (hrs->phases == hrs->outRate) ? hrs->acc		// Exact ratio: one phase per remainder
+		               : (hrs->acc * hrs->phases + hrs->outRate / 2u) / hrs->outRate;
+		uint32_t base = hrs->pos;
+		const int16_t *c, *x;
+		int32_t l = 1 << 14, r = 1 << 14;
+
+		if (phase == hrs->phases)
+		{
+			phase = 0;
+			base++;
+		}
+		if (base + taps > hrs->fill)
+			break;
+		c = &hrs->coeffs[phase * taps];
+		x = &hrs->hist[2u * base];
+		for (uint32_t k = 0; k < taps; k += 2)
+		{
+			l += c[k] * x[2 * k] + c[k + 1] * x[2 * k + 2];
+			r += c[k] * x[2 * k + 1] + c[k + 1] * x[2 * k + 3];
+		}
+		out[2 * n] = saturate16(l >> 15);
+		out[2 * n + 1] = saturate16(r >> 15);
+
+		hrs->acc += hrs->inRate;
+		while (hrs->acc >= hrs->outRate)
+		{
+			hrs->acc -= hrs->outRate;
+			hrs->pos++;
+		}
+	}
+	return n;
+}
@@ -0,0 +1,230 @@
+/*
+Library:				rfft.c
+Written by:				Shridattha M Hebbar
+Date Written:			16/10/2026
+Description:			Single precision real FFT (radix-2, power of two lengths) for the convolution
+						engine. A length N real transform runs as an N/2 point complex FFT plus a split
+						step, so it costs about half a complex transform of the same length.
+References:
+			1) H. V. Sorensen et al., "Real-valued fast Fourier transform algorithms",
+			   IEEE Trans. ASSP, 1987
+*/
+
+#include <math.h>
+#include "rfft.h"
+
+//--------------------------------------------------------------//
+//---------------------- Static functions ----------------------//
+//--------------------------------------------------------------//
+
+// Bit reversed reordering of m complex points (interleaved re/im)
+static void bitReverse(float *buf, uint32_t m)
+{
+	for (uint32_t i = 1, j = 0; i < m; i++)
+	{
+		uint32_t bit = m >> 1;
+		for (; j & bit; bit >>= 1)
+		{
+			j ^= bit;
+		}
+		j ^= bit;
+		if (i < j)
+		{
+			float tr = buf[2 * i], ti = buf[2 * i + 1];
+			buf[2 * i] = buf[2 * j];
+			buf[2 * i + 1] = buf[2 * j + 1];
+			buf[2 * j] = tr;
+			buf[2 * j + 1] = ti;
+		}
+	}
+}
+
+// One radix-2 butterfly stage of an m point complex FFT, twiddles W_m^j = W_2m^(2j) from the real table
+static void cfftStage(const float *tw, float *buf, uint32_t m, uint32_t len, bool inverse)
+{
+	uint32_t half = len >> 1;
+	uint32_t step = 2 * (m / len);
+
+	for (uint32_t j = 0; j < half; j++)
+	{
+		float wr = tw[2 * j * step];
+		float wi = inverse ? -tw[2 * j * step + 1] : tw[2 * j * step + 1];
+		for (uint32_t i = j; i < m; i += len)
+		{
+			float *a = &buf[2 * i];
+			float *b = &buf[2 * (i + half)];
+			float tr = wr * b[0] - wi * b[1];
+			float ti = wr * b[1] + wi * b[0];
+			b[0] = a[0] - tr;
+			b[1] = a[1] - ti;
+			a[0] += tr;
+			a[1] += ti;
+		}
+	}
+}
+
+// Split the m point complex FFT of the even/odd samples into the real spectrum
+static void forwardSplit(const float *tw, float *buf, uint32_t m)
+{
+	float z0r = buf[0], z0i = buf[1];
+	buf[0] = z0r + z0i;
+	buf[1] = z0r - z0i;
+
+	// X[k] = E + W^k O, X[m - k] = conj(E - W^k O)
+	for (uint32_t k = 1; k <= m / 2; k++)
+	{
+		float *p = &buf[2 * k];
+		float *q = &buf[2 * (m - k)];
+		float er = 0.5f * (p[0] + q[0]);
+		float ei = 0.5f * (p[1] - q[1]);
+		float or_ = 0.5f * (p[1] + q[1]);
+		float oi = 0.5f * (q[0] - p[0]);
+		float wr = tw[2 * k], wi = tw[2 * k + 1];
+		float tr = wr * or_ - wi * oi;
+		float ti = wr * oi + wi * or_;
+		p[0] = er + tr;
+		p[1] = ei + ti;
+		q[0] = er - tr;
+		q[1] = ti - ei;
+	}
+}
+
+// Merge a real spectrum into the m point complex spectrum of the even/odd samples (times 2)
+static void inverseMerge(const float *tw, float *buf, uint32_t m)
+{
+	float x0 = buf[0], xm = buf[1];
+	buf[0] = x0 + xm;
+	buf[1] = x0 - xm;
+
+	// E = X[k] + conj(X[m - k]), O = (X[k] - conj(X[m - k])) W^-k, Z[k] = E + iO
+	for (uint32_t k = 1; k <= m / 2; k++)
+	{
+		float *p = &buf[2 * k];
+		float *q = &buf[2 * (m - k)];
+		float er = p[0] + q[0];
+		float ei = p[1] - q[1];
+		float dr = p[0] - q[0];
+		float di = p[1] + q[1];
+		float wr = tw[2 * k], wi = -tw[2 * k + 1];
+		float or_ = wr * dr - wi * di;
+		float oi = wr * di + wi * dr;
+		p[0] = er - oi;
+		p[1] = ei + or_;
+		q[0] = er + oi;
+		q[1] = or_ - ei;
+	}
+}
+
+//--------------------------------------------------------------//
+//---------------------- Public Functions ----------------------//
+//--------------------------------------------------------------//
+
+/**
+ * @brief Twiddle table size for a transform length
+ * @param size: transform length N
+ * @retval bytes
+ */
+uint32_t rfft_tableBytes(uint32_t size)
+{
+	return size * (uint32_t)sizeof(float);
+}
+
+/**
+ * @brief Initialise a real FFT instance
+ * @param hfft: instance
+ * @param table: rfft_tableBytes(size) bytes for the twiddle factors
+ * @param size: transform length N, a power of two from 4
+ * @retval false when the length is not supported
+ */
+bool rfft_init(RFFT_HandleTypeDef *hfft, float *table, uint32_t size)
+{
+	if (size < 4 || (size & (size - 1)))
+		return false;
+
+	for (uint32_t k = 0; k < size / 2; k++)
+	{
+		double a = 2.0 * M_PI * (double)k / (double)size;
+		table[2 * k] = (float)cos(a);
+		table[2 * k + 1] = (float)-sin(a);
+	}
+	hfft->size = size;
+	hfft->twiddle = table;
+	return true;
+}
+
+/**
+ * @brief Forward transform in place
+ * @param hfft: instance
+ * @param buf: N real samples in, packed spectrum out (see rfft.h)
+ * @retval None
+ */
+void rfft_forward(const RFFT_HandleTypeDef *hfft, float *buf)
+{
+	for (uint32_t pass = 0; pass < rfft_passes(hfft); pass++)
+	{
+		rfft_forwardPass(hfft, buf, pass);
+	}
+}
+
+/**
+ * @brief Inverse transform in place, unnormalised
+ * @note The result is N times the original samples, callers fold 1/N into their own gains.
+ * @param hfft: instance
+ * @param buf: packed spectrum in, N real samples out
+ * @retval None
+ */
+void rfft_inverse(const RFFT_HandleTypeDef *hfft, float *buf)
+{
+	for (uint32_t pass = 0; pass < rfft_passes(hfft); pass++)
+	{
+		rfft_inversePass(hfft, buf, pass);
+	}
+}
+
+/**
+ * @brief Number of passes of a resumable transform
+ * @param hfft: instance
+ * @retval log2(N/2) butterfly stages plus reordering and split
+ */
+uint32_t rfft_passes(const RFFT_HandleTypeDef *hfft)
+{
+	return (uint32_t)__builtin_ctz(hfft->size / 2) + 2u;
+}
+
+/**
+ * @brief One pass of the forward transform
+ * @param hfft: instance
+ * @param buf: transform buffer, as for rfft_forward()
+ * @param pass: 0 reorders, 1 .. passes - 2 are butterfly stages, the last splits the spectrum
+ * @retval None
+ */
+void rfft_forwardPass(const RFFT_HandleTypeDef *hfft, float *buf, uint32_t pass)
+{
+	const uint32_t m = hfft->size / 2;
+
+	if (pass == 0)
+		bitReverse(buf, m);
+	else if (pass + 1 < rfft_passes(hfft))
+		cfftStage(hfft->twiddle, buf, m, 1u << pass, false);
+	else
+		forwardSplit(hfft->twiddle, buf, m);
+}
+
+/**
+ * @brief One pass of the inverse transform
+ * @param hfft: instance
+ * @param buf: transform buffer, as for rfft_inverse()
+ * @param pass: 0 merges the spectrum, 1 reorders, 2 .. passes - 1 are butterfly stages
+ * @retval None
+ */
+void rfft_inversePass(const RFFT_HandleTypeDef *hfft, float *buf, uint32_t pass)
+{
+	const uint32_t m = hfft->size / 2;
+
+	if (pass == 0)
+		inverseMerge(hfft->twiddle, buf, m);
+	else if (pass == 1)
+		bitReverse(buf, m);
+	else
+		cfftStage(hfft->twiddle, buf, m, 1u << (pass - 1), true);
+}
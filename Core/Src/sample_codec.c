@@ -0,0 +1,165 @@
+/*
+Library:				sample_codec.c
+Written by:				Shridattha M Hebbar
+Date Written:			16/10/2026
+Description:			Sample codecs for compressed delay line storage: G.711 µ-law (8 bits per
+						sample) and IMA-ADPCM (4 bits per sample).
+References:
+			1) ITU-T Recommendation G.711
+			2) IMA Digital Audio Focus and Technical Working Groups, Recommended Practices for
+			   Enhancing Digital Audio Compatibility in Multimedia Systems (IMA ADPCM)
+*/
+
+#include "sample_codec.h"
+
+//µ-law constants
+#define MULAW_BIAS  0x84
+#define MULAW_CLIP  32635
+
+//IMA-ADPCM quantiser step sizes
+static const int16_t adpcmStepTable[89] =
+{
+  7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+  50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230, 253, 279, 307,
+  337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066,
+  2272, 2499, 2749, 3024, 3327, 3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899,
+  15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
+};
+
+//IMA-ADPCM step index adjustment per code
+static const int8_t adpcmIndexTable[16] =
+{
+  -1, -1, -1, -1, 2, 4, 6, 8,
+  -1, -1, -1, -1, 2, 4, 6, 8
+};
+
+//--------------------------------------------------------------//
+//---------------------- Static functions ----------------------//
+//--------------------------------------------------------------//
+
+// Apply a code to the predictor, shared by encoder and decoder so both track the same state
+static inline int16_t adpcmUpdate(ADPCM_StateTypeDef *state, uint8_t code, int32_t delta)
+{
+  int32_t predictor = state->predictor + ((code & 8) ? -delta : delta);
+  int32_t index = state->index + adpcmIndexTable[code];
+
+  if (predictor > 32767)
+    predictor = 32767;
+  else if (predictor < -32768)
+    predictor = -32768;
+  if (index < 0)
+    index = 0;
+  else if (index > 88)
+    index = 88;
+
+  state->predictor = (int16_t)predictor;
+  state->index = (uint8_t)index;
+  return state->predictor;
+}
+
+//--------------------------------------------------------------//
+//---------------------- Public Functions ----------------------//
+//--------------------------------------------------------------//
+
+/**
+ * @brief G.711 µ-law encoder
+ * @param sample: 16-bit linear sample
+ * @retval 8-bit µ-law code
+ */
+uint8_t mulaw_encode(int16_t sample)
+{
+  int32_t s = sample;
+  uint8_t sign = 0;
+  uint8_t exponent, mantissa;
+
+  if (s < 0)
+  {
+    s = -s;
+    sign = 0x80;
+  }
+  if (s > MULAW_CLIP)
+    s = MULAW_CLIP;
+  s += MULAW_BIAS;
+
+  exponent = (uint8_t)(31 - __builtin_clz((uint32_t)s >> 7));	// Segment, 0 to 7
+  mantissa = (uint8_t)((s >> (exponent + 3)) & 0x0F);
+  return (uint8_t)~(sign | (exponent << 4) | mantissa);
+}
+
+/**
+ * @brief G.711 µ-law decoder
+ * @param code: 8-bit µ-law code
+ * @retval 16-bit linear sample
+ */
+int16_t mulaw_decode(uint8_t code)
+{
+  int32_t s;
+
+  code = (uint8_t)~code;
+  s = ((((int32_t)code & 0x0F) << 3) + MULAW_BIAS) << ((code >> 4) & 0x07);
+  s -= MULAW_BIAS;
+  return (int16_t)((code & 0x80) ? -s : s);
+}
+
+/**
+ * @brief IMA-ADPCM encoder, updates the state exactly as the decoder will
+ * @param state: channel predictor state
+ * @param sample: 16-bit linear sample
+ * @retval 4-bit code
+ */
+uint8_t adpcm_encode(ADPCM_StateTypeDef *state, int16_t sample)
+{
+  int32_t step = adpcmStepTable[state->index];
+  int32_t diff = (int32_t)sample - state->predictor;
+  int32_t delta = step >> 3;
+  uint8_t code = 0;
+
+  if (diff < 0)
+  {
+    code = 8;
+    diff = -diff;
+  }
+  if (diff >= step)
+  {
+    code |= 4;
+    diff -= step;
+    delta += step;
+  }
+  step >>= 1;
+  if (diff >= step)
+  {
+    code |= 2;
+    diff -= step;
+    delta += step;
+  }
+  step >>= 1;
+  if (diff >= step)
+  {
+    code |= 1;
+    delta += step;
+  }
+
+  adpcmUpdate(state, code, delta);
+  return code;
+}
+
+/**
+ * @brief IMA-ADPCM decoder
+ * @param state: channel predictor state
+ * @param nibble: 4-bit code
+ * @retval 16-bit linear sample
+ */
+int16_t adpcm_decode(ADPCM_StateTypeDef *state, uint8_t nibble)
+{
+  int32_t step = adpcmStepTable[state->index];
+  int32_t delta = step >> 3;
+
+  nibble &= 0x0F;
+  if (nibble & 4)
+    delta += step;
+  if (nibble & 2)
+    delta += step >> 1;
+  if (nibble & 1)
+    delta += step >> 2;
+  return adpcmUpdate(state, nibble, delta);
+}
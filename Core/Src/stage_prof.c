@@ -0,0 +1,228 @@
+/*
+Library:				stage_prof.c
+Written by:				Shridattha M Hebbar
+Date Written:			16/10/2026
+Description:			Cycle budget probes, see stage_prof.h. A probe costs two counter reads and one
+						stageProf_record(): a compare for min and max, an add and a count-leading-zeros
+						for the histogram bin. Everything is updated from the main loop only; the DMA
+						interrupt just stores the time a half was freed.
+*/
+
+#include "stage_prof.h"
+#include <string.h>
+#if !defined(DWT)
+#include <time.h>
+#endif
+
+static STAGE_PROF_StatsTypeDef stageStats[STAGE_PROF_COUNT];
+static STAGE_PROF_SlackTypeDef slackStats;
+static uint32_t slotPeriod = 0;		// Ticks one slot plays for
+
+static const char *const stageNames[STAGE_PROF_COUNT] = {
+	"echo switch", "level knob", "slot read", "effect", "pause ramp", "refill", "file read", "process",
+};
+
+//--------------------------------------------------------------//
+//---------------------- Static functions ----------------------//
+//--------------------------------------------------------------//
+
+// Histogram bin of a duration: floor(log2(ticks)), 0 for 0 and 1 tick
+
+static inline uint32_t durationBin(uint32_t ticks)
+{
+	return (ticks > 1u) ? 31u - (uint32_t)__builtin_clz(ticks) : 0u;
+}
+
+//--------------------------------------------------------------//
+//---------------------- Public Functions ----------------------//
+//--------------------------------------------------------------//
+
+#if !defined(DWT)
+/**
+ * @brief Time stamp of the host build
+ * @param None
+ * @retval monotonic clock in nanoseconds, wrapping at 2^32
+ */
+uint32_t stageProf_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint32_t)((uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec);
+}
+#endif
+
+/**
+ * @brief Start the cycle counter and clear the statistics
+ * @note Call once after the clock setup. Turns on the DWT, which the debugger may also use.
+ * @param None
+ * @retval None
+ */
+void stageProf_init(void)
+{
+#if defined(DWT)
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CYCCNT = 0;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+	stageProf_reset();
+}
+
+/**
+ * @brief Clear the statistics of every stage and the slack
+ * @param None
+ * @retval None
+ */
+void stageProf_reset(void)
+{
+	memset(stageStats, 0, sizeof(stageStats));
+	for (uint32_t s = 0; s < STAGE_PROF_COUNT; s++)
+	{
+		stageStats[s].min = UINT32_MAX;
+	}
+	memset(slackStats.hist, 0, sizeof(slackStats.hist));
+	slackStats.count = 0;
+	slackStats.late = 0;
+	slackStats.min = INT32_MAX;
+	slackStats.max = INT32_MIN;
+	slackStats.total = 0;
+}
+
+/**
+ * @brief Set the slot timing the slack is measured against, called by wavPlayer_play()
+ * @param frames: frames per slot
+ * @param sampleRate: output rate
+ * @param windowSlots: slots the DMA plays between freeing a half and reaching it again
+ * @retval None
+ */
+void stageProf_setSlotPeriod(uint32_t frames, uint32_t sampleRate, uint32_t windowSlots)
+{
+	slotPeriod = (sampleRate != 0u) ? (uint32_t)((uint64_t)frames * stageProf_tickHz() / sampleRate) : 0u;
+	slackStats.window = slotPeriod * windowSlots;
+}
+
+/**
+ * @brief Record the duration of a stage, use through STAGE_PROF_START / STAGE_PROF_END
+ * @param stage: stage timed
+ * @param start: stageProf_now() at the start of the stage
+ * @retval None
+ */
+void stageProf_record(STAGE_PROF_StageTypeDef stage, uint32_t start)
+{
+	const uint32_t ticks = stageProf_now() - start;
+	STAGE_PROF_StatsTypeDef *s = &stageStats[stage];
+
+	s->count++;
+	s->total += ticks;
+	if (ticks < s->min)
+	{
+		s->min = ticks;
+	}
+	if (ticks > s->max)
+	{
+		s->max = ticks;
+	}
+	s->hist[durationBin(ticks)]++;
+}
+
+/**
+ * @brief Record the slack of a refill that has just finished, use through STAGE_PROF_SLACK
+ * @param freedAt: stageProf_now() when the DMA freed the slot's half
+ * @param slotsAhead: slots the DMA plays from then until it reaches this slot
+ * @retval None
+ */
+void stageProf_recordSlack(uint32_t freedAt, uint32_t slotsAhead)
+{
+	const int32_t slack = (int32_t)(slotPeriod * slotsAhead - (stageProf_now() - freedAt));
+	uint32_t bin;
+
+	slackStats.count++;
+	slackStats.total += slack;
+	if (slack < slackStats.min)
+	{
+		slackStats.min = slack;
+	}
+	if (slack > slackStats.max)
+	{
+		slackStats.max = slack;
+	}
+	if (slack < 0)
+	{
+		slackStats.late++;
+		bin = 0;
+	}
+	else
+	{
+		bin = (slackStats.window != 0u) ? 1u + (uint32_t)((uint64_t)slack * 8u / slackStats.window) : 1u;
+		if (bin >= STAGE_PROF_SLACK_BINS)
+		{
+			bin = STAGE_PROF_SLACK_BINS - 1u;
+		}
+	}
+	slackStats.hist[bin]++;
+}
+
+/**
+ * @brief Statistics of one stage
+ * @param stage: stage to query
+ * @param stats: filled with the durations since the last reset, min is UINT32_MAX while count is 0
+ * @retval false when the probes are compiled out or the stage is unknown
+ */
+bool stageProf_getStage(STAGE_PROF_StageTypeDef stage, STAGE_PROF_StatsTypeDef *stats)
+{
+	if (!STAGE_PROF_ENABLE || stage >= STAGE_PROF_COUNT)
+	{
+		return false;
+	}
+	*stats = stageStats[stage];
+	return true;
+}
+
+/**
+ * @brief Deadline slack of the slot refills
+ * @param slack: filled with the slack since the last reset, negative values were late
+ * @retval false when the probes are compiled out
+ */
+bool stageProf_getSlack(STAGE_PROF_SlackTypeDef *slack)
+{
+	if (!STAGE_PROF_ENABLE)
+	{
+		return false;
+	}
+	*slack = slackStats;
+	return true;
+}
+
+/**
+ * @brief Ticks one slot plays for, the budget of one refill on average
+ * @param None
+ * @retval ticks, 0 before the first wavPlayer_play()
+ */
+uint32_t stageProf_getSlotPeriod(void)
+{
+	return slotPeriod;
+}
+
+/**
+ * @brief Tick rate of the statistics
+ * @param None
+ * @retval core clock on target, 1 GHz (nanoseconds) on the host build
+ */
+uint32_t stageProf_tickHz(void)
+{
+#if defined(DWT)
+	return SystemCoreClock;
+#else
+	return 1000000000u;
+#endif
+}
+
+/**
+ * @brief Printable stage name
+ * @param stage: stage
+ * @retval name, "?" for an unknown stage
+ */
+const char *stageProf_stageName(STAGE_PROF_StageTypeDef stage)
+{
+	return (stage < STAGE_PROF_COUNT) ? stageNames[stage] : "?";
+}
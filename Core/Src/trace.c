@@ -0,0 +1,118 @@
+/*
+Library:				trace.c
+Written by:				Shridattha M Hebbar
+Date Written:			16/10/2026
+Description:			Binary event trace, see trace.h. Events are written by the inline trace_event();
+						this file holds the buffer, saving it to the drive and the event names the
+						host decoder prints.
+*/
+
+#include "trace.h"
+#include "fatfs.h"
+#include <string.h>
+
+#if (TRACE_RECORDS & (TRACE_RECORDS - 1u)) != 0u
+#error "TRACE_RECORDS must be a power of two"
+#endif
+
+//Not in core coupled RAM: f_write() hands the buffer to the USB host driver
+TRACE_BufferTypeDef traceBuffer = {
+	.magic = TRACE_MAGIC,
+	.version = TRACE_VERSION,
+	.recordBytes = sizeof(TRACE_RecordTypeDef),
+	.records = TRACE_RECORDS,
+};
+
+static const char *const eventNames[TRACE_EV_COUNT] = {
+	"none", "dma half", "refill start", "refill end", "late refill", "event overrun", "file read", "underrun",
+	"codec write", "codec error", "player", "usb", "button", "mark",
+};
+
+static const char *const playerNames[TRACE_PLAYER_COUNT] = {
+	"play", "stop", "pause", "silent", "power down", "resume", "end of file", "track change",
+};
+
+static const char *const buttonNames[TRACE_BUTTON_COUNT] = {
+	"play", "pause", "resume", "stop",
+};
+
+//--------------------------------------------------------------//
+//---------------------- Public Functions ----------------------//
+//--------------------------------------------------------------//
+
+/**
+ * @brief Clear the trace and start recording from the first record
+ * @note Call after stageProf_init(), the time stamps come from its counter.
+ * @param None
+ * @retval None
+ */
+void trace_init(void)
+{
+	memset(traceBuffer.ring, 0, sizeof(traceBuffer.ring));
+	traceBuffer.tickHz = stageProf_tickHz();
+	traceBuffer.head = 0;
+}
+
+/**
+ * @brief Write the trace buffer to a file on the drive, for trace_decode on a PC
+ * @note Events keep being recorded; call it when playback has stopped so the ring holds still.
+ * @param path: file to create or overwrite, e.g. TRACE_FILE
+ * @retval true when the whole buffer was written
+ */
+bool trace_save(const char *path)
+{
+	FIL file;
+	UINT written = 0;
+	FRESULT res;
+
+	if (f_open(&file, path, FA_WRITE | FA_CREATE_ALWAYS) != FR_OK)
+	{
+		return false;
+	}
+	res = f_write(&file, &traceBuffer, sizeof(traceBuffer), &written);
+	if (f_close(&file) != FR_OK)
+	{
+		res = FR_DISK_ERR;
+	}
+	return res == FR_OK && written == sizeof(traceBuffer);
+}
+
+/**
+ * @brief Events recorded since trace_init()
+ * @param None
+ * @retval event count, the ring holds the last TRACE_RECORDS of them
+ */
+uint32_t trace_getCount(void)
+{
+	return traceBuffer.head;
+}
+
+/**
+ * @brief Printable event type
+ * @param type: record type byte
+ * @retval name, "?" for an unknown type
+ */
+const char *trace_eventName(uint8_t type)
+{
+	return (type < TRACE_EV_COUNT) ? eventNames[type] : "?";
+}
+
+/**
+ * @brief Printable player state change
+ * @param event: low 4 bits of a TRACE_EV_PLAYER argument
+ * @retval name, "?" for an unknown change
+ */
+const char *trace_playerName(uint8_t event)
+{
+	return (event < TRACE_PLAYER_COUNT) ? playerNames[event] : "?";
+}
+
+/**
+ * @brief Printable button action
+ * @param event: TRACE_EV_BUTTON argument
+ * @retval name, "?" for an unknown action
+ */
+const char *trace_buttonName(uint8_t event)
+{
+	return (event < TRACE_BUTTON_COUNT) ? buttonNames[event] : "?";
+}
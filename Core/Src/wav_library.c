@@ -0,0 +1,438 @@
+/*
+Library:				wav_library.c
+Written by:				Shridattha M Hebbar
+Date Written:			16/10/2026
+Description:			WAV library index, see wav_library.h. A rescan walks the directories in the
+						order FatFs lists them, which stays the same while the drive is not written, and
+						compares each .wav file with the index record at the same position. A match
+						costs no file access beyond the directory entry. A file that was deleted shifts
+						the records; those after it are found within the lookahead and still match.
+						The new index goes to a temporary file from the first difference on and replaces
+						the old one when the scan ends, so a pulled drive never leaves a broken index.
+*/
+
+#include "wav_library.h"
+#include "wav_riff.h"
+#include "pcm_convert.h"
+#include <string.h>
+
+#define WAV_LIBRARY_MAGIC     0x42494C57u   // "WLIB"
+#define WAV_LIBRARY_VERSION   1u
+
+//Index file header, followed by count records
+typedef struct
+{
+  uint32_t magic;
+  uint16_t version;
+  uint16_t recordBytes;     // sizeof(WAV_LIBRARY_EntryTypeDef) of the writer
+  uint32_t count;           // Records in the file
+  uint32_t reserved;
+}WAV_LIBRARY_HeaderTypeDef;
+
+//Loaded index
+static FIL indexFile;
+static bool indexOpen = false;
+static uint32_t indexCount = 0;
+static WAV_LIBRARY_EntryTypeDef readBuf[WAV_LIBRARY_READ_RECORDS];
+static uint32_t bufFirst;                   // Index of readBuf[0]
+static uint32_t bufCount = 0;               // Records in readBuf
+
+//Rescan state: a stack of open directories, the path of the innermost one and the output index
+static bool scanning = false;
+static DIR dirStack[WAV_LIBRARY_MAX_DEPTH];
+static uint16_t pathLen[WAV_LIBRARY_MAX_DEPTH];
+static uint8_t depth;
+static char scanPath[WAV_LIBRARY_PATH_MAX];
+static FILINFO fileInfo;
+static uint32_t cursor;                     // Next old record a file is compared with
+static uint32_t outCount;                   // Records of the new index
+static FIL tempFile;
+static bool tempOpen;                       // The new index differs from the old one and is being written
+static bool tempError;                      // A write of the new index failed or came up short (drive full)
+static FIL parseFile;
+static uint32_t parsed;                     // Headers parsed by the current or last scan
+
+//--------------------------------------------------------------//
+//---------------------- Static functions ----------------------//
+//--------------------------------------------------------------//
+
+// Read bytes of an open file for the RIFF parser
+
+static uint32_t readFile(void *ctx, uint32_t offset, void *dst, uint32_t bytes)
+{
+	UINT readBytes = 0;
+
+	if (f_lseek((FIL*)ctx, offset) != FR_OK || f_read((FIL*)ctx, dst, bytes, &readBytes) != FR_OK)
+	{
+		return 0;
+	}
+	return readBytes;
+}
+
+// Open the index file and check its header, an empty library when it is missing or damaged
+
+static void loadIndex(void)
+{
+	WAV_LIBRARY_HeaderTypeDef header;
+	UINT readBytes = 0;
+
+	indexCount = 0;
+	bufCount = 0;
+	if (f_open(&indexFile, WAV_LIBRARY_FILE, FA_READ) != FR_OK)
+	{
+		return;
+	}
+	indexOpen = true;
+	if (f_read(&indexFile, &header, sizeof(header), &readBytes) == FR_OK && readBytes == sizeof(header)
+	    && header.magic == WAV_LIBRARY_MAGIC && header.version == WAV_LIBRARY_VERSION
+	    && header.recordBytes == sizeof(WAV_LIBRARY_EntryTypeDef)
+	    && f_size(&indexFile) >= sizeof(header) + (FSIZE_t)header.count * sizeof(WAV_LIBRARY_EntryTypeDef))
+	{
+		indexCount = header.count;
+	}
+}
+
+// Old index record, read WAV_LIBRARY_READ_RECORDS at a time
+
+static bool readRecord(uint32_t index, WAV_LIBRARY_EntryTypeDef *entry)
+{
+	UINT readBytes = 0;
+
+	if (index >= indexCount)
+	{
+		return false;
+	}
+	if (index < bufFirst || index >= bufFirst + bufCount)
+	{
+		bufFirst = index;
+		bufCount = 0;
+		if (f_lseek(&indexFile, sizeof(WAV_LIBRARY_HeaderTypeDef) + (FSIZE_t)index * sizeof(*entry)) != FR_OK
+		    || f_read(&indexFile, readBuf, sizeof(readBuf), &readBytes) != FR_OK)
+		{
+			return false;
+		}
+		bufCount = readBytes / sizeof(*entry);
+		if (bufCount == 0)
+		{
+			return false;
+		}
+	}
+	*entry = readBuf[index - bufFirst];
+	return true;
+}
+
+static bool isWavName(const char *name)
+{
+	size_t len = strlen(name);
+	const char *ext = &name[(len > 4) ? len - 4 : 0];
+
+	return len > 4 && ext[0] == '.' && (ext[1] | 0x20) == 'w' && (ext[2] | 0x20) == 'a' && (ext[3] | 0x20) == 'v';
+}
+
+static bool sameKey(const WAV_LIBRARY_EntryTypeDef *entry, const FILINFO *fno)
+{
+	return entry->size == (uint32_t)fno->fsize && entry->date == fno->fdate && entry->time == fno->ftime;
+}
+
+// Record of a new or changed file: its key, and its format from the header when the player supports it
+
+static void describe(WAV_LIBRARY_EntryTypeDef *entry, const char *path, const FILINFO *fno)
+{
+	WAV_RIFF_InfoTypeDef info;
+
+	memset(entry, 0, sizeof(*entry));
+	strcpy(entry->path, path);
+	entry->size = (uint32_t)fno->fsize;
+	entry->date = fno->fdate;
+	entry->time = fno->ftime;
+	parsed++;
+	if (f_open(&parseFile, path, FA_READ) != FR_OK)
+	{
+		return;
+	}
+	if (wavRiff_parse(&info, readFile, &parseFile, (uint32_t)f_size(&parseFile)) == WAV_RIFF_OK
+	    && pcmConvert_select(info.encoding, info.bitsPerSample, info.channels) != NULL)
+	{
+		entry->sampleRate = info.sampleRate;
+		entry->dataOffset = info.dataOffset;
+		entry->dataBytes = info.dataBytes;
+		entry->durationMs = (uint32_t)((uint64_t)info.frames * 1000u / info.sampleRate);
+		entry->encoding = info.encoding;
+		entry->blockAlign = info.blockAlign;
+		entry->channels = (uint8_t)info.channels;
+		entry->bitsPerSample = (uint8_t)info.bitsPerSample;
+	}
+	f_close(&parseFile);
+}
+
+// Stop the scan where it is
+
+static void closeDirs(void)
+{
+	for (int32_t d = depth; d >= 0; d--)
+	{
+		f_closedir(&dirStack[d]);
+	}
+	scanning = false;
+}
+
+// Write to the new index, a failed or short write marks it bad
+
+static void writeTemp(const void *src, UINT bytes)
+{
+	UINT written = 0;
+
+	if (!tempError && (f_write(&tempFile, src, bytes, &written) != FR_OK || written != bytes))
+	{
+		tempError = true;
+	}
+}
+
+// Start writing the new index: a header to patch at the end, then the records so far, which match the old ones
+
+static bool openTemp(void)
+{
+	WAV_LIBRARY_HeaderTypeDef header = { WAV_LIBRARY_MAGIC, WAV_LIBRARY_VERSION, sizeof(WAV_LIBRARY_EntryTypeDef), 0, 0 };
+	WAV_LIBRARY_EntryTypeDef entry;
+
+	if (f_open(&tempFile, WAV_LIBRARY_TEMP, FA_WRITE | FA_CREATE_ALWAYS) != FR_OK)
+	{
+		return false;
+	}
+	tempOpen = true;
+	tempError = false;
+	writeTemp(&header, sizeof(header));
+	for (uint32_t i = 0; i < outCount && readRecord(i, &entry); i++)
+	{
+		writeTemp(&entry, sizeof(entry));
+	}
+	return true;
+}
+
+// Append a record to the new index. unchanged: it is the old record at the same position.
+
+static void emit(const WAV_LIBRARY_EntryTypeDef *entry, bool unchanged)
+{
+	if (!tempOpen && !unchanged && !openTemp())
+	{
+		closeDirs();								// Drive write protected or full: keep the old index
+		return;
+	}
+	if (tempOpen)
+	{
+		writeTemp(entry, sizeof(*entry));
+	}
+	outCount++;
+}
+
+// A .wav file found by the scan: take its old record when the key matches, else parse its header
+
+static void addFile(const char *path, const FILINFO *fno)
+{
+	WAV_LIBRARY_EntryTypeDef entry;
+	uint32_t match = 0xFFFFFFFFu;
+
+	for (uint32_t k = 0; k < WAV_LIBRARY_LOOKAHEAD && readRecord(cursor + k, &entry); k++)
+	{
+		if (strcmp(entry.path, path) == 0)
+		{
+			if (sameKey(&entry, fno))
+			{
+				match = cursor + k;
+			}
+			cursor += k + 1u;						// Records skipped over are deleted files
+			break;
+		}
+	}
+	if (match == 0xFFFFFFFFu)
+	{
+		describe(&entry, path, fno);
+	}
+	emit(&entry, match == outCount);
+}
+
+// End of the scan: replace the index when the new one differs and was written whole. On a failed
+// write the old index stays, stale but complete, so the next mount is not a cold start.
+
+static void finishScan(void)
+{
+	WAV_LIBRARY_HeaderTypeDef header = { WAV_LIBRARY_MAGIC, WAV_LIBRARY_VERSION, sizeof(WAV_LIBRARY_EntryTypeDef), 0, 0 };
+
+	scanning = false;
+	if (!tempOpen && (outCount == indexCount || !openTemp()))
+	{
+		return;										// Unchanged, nothing is written
+	}
+	header.count = outCount;
+	if (f_lseek(&tempFile, 0) != FR_OK)
+	{
+		tempError = true;
+	}
+	writeTemp(&header, sizeof(header));
+	if (f_close(&tempFile) != FR_OK)
+	{
+		tempError = true;
+	}
+	tempOpen = false;
+	if (tempError)
+	{
+		f_unlink(WAV_LIBRARY_TEMP);
+		return;
+	}
+	if (indexOpen)
+	{
+		f_close(&indexFile);
+		indexOpen = false;
+	}
+	f_unlink(WAV_LIBRARY_FILE);
+	f_rename(WAV_LIBRARY_TEMP, WAV_LIBRARY_FILE);
+	loadIndex();
+}
+
+//--------------------------------------------------------------//
+//---------------------- Public Functions ----------------------//
+//--------------------------------------------------------------//
+
+/**
+ * @brief Load the index of a newly mounted drive and start a rescan
+ * @note Call after f_mount(). The library is usable at once with the entries of the last scan;
+ *       wavLibrary_process() brings it up to date.
+ * @param None
+ * @retval true when an index was loaded, false on a drive without one (the first scan builds it)
+ */
+bool wavLibrary_mount(void)
+{
+	wavLibrary_unmount();
+	loadIndex();
+	depth = 0;
+	pathLen[0] = 0;
+	scanPath[0] = '\0';
+	cursor = 0;
+	outCount = 0;
+	tempOpen = false;
+	parsed = 0;
+	scanning = f_opendir(&dirStack[0], "") == FR_OK;
+	return indexCount > 0;
+}
+
+/**
+ * @brief Forget the drive, e.g. on USB disconnect
+ * @param None
+ * @retval None
+ */
+void wavLibrary_unmount(void)
+{
+	if (scanning)
+	{
+		closeDirs();
+	}
+	if (tempOpen)
+	{
+		f_close(&tempFile);
+		tempOpen = false;
+	}
+	if (indexOpen)
+	{
+		f_close(&indexFile);
+		indexOpen = false;
+	}
+	indexCount = 0;
+	bufCount = 0;
+}
+
+/**
+ * @brief Continue the rescan, call from the main loop while nothing plays
+ * @param maxEntries: directory entries to look at, bounds the time spent
+ * @retval true while the scan is running
+ */
+bool wavLibrary_process(uint32_t maxEntries)
+{
+	while (maxEntries-- && scanning)
+	{
+		size_t len;
+
+		if (f_readdir(&dirStack[depth], &fileInfo) != FR_OK || fileInfo.fname[0] == '\0')
+		{
+			f_closedir(&dirStack[depth]);
+			if (depth == 0)
+			{
+				finishScan();
+				break;
+			}
+			depth--;
+			scanPath[pathLen[depth]] = '\0';
+			continue;
+		}
+		len = pathLen[depth] + (pathLen[depth] ? 1u : 0u) + strlen(fileInfo.fname);
+		if ((fileInfo.fattrib & (AM_HID | AM_SYS)) || len >= WAV_LIBRARY_PATH_MAX)
+		{
+			continue;
+		}
+		if (pathLen[depth])
+		{
+			scanPath[pathLen[depth]] = '/';
+			strcpy(&scanPath[pathLen[depth] + 1u], fileInfo.fname);
+		}
+		else
+		{
+			strcpy(scanPath, fileInfo.fname);
+		}
+		if (fileInfo.fattrib & AM_DIR)
+		{
+			if (depth + 1u < WAV_LIBRARY_MAX_DEPTH && f_opendir(&dirStack[depth + 1u], scanPath) == FR_OK)
+			{
+				depth++;
+				pathLen[depth] = (uint16_t)len;
+				continue;
+			}
+		}
+		else if (isWavName(fileInfo.fname))
+		{
+			addFile(scanPath, &fileInfo);
+		}
+		scanPath[pathLen[depth]] = '\0';
+	}
+	return scanning;
+}
+
+/**
+ * @brief Whether a rescan is still running
+ * @param None
+ * @retval true until wavLibrary_process() has walked the whole drive
+ */
+bool wavLibrary_isScanning(void)
+{
+	return scanning;
+}
+
+/**
+ * @brief Files in the library
+ * @note During a rescan this is the index of the last completed scan.
+ * @param None
+ * @retval entries
+ */
+uint32_t wavLibrary_getCount(void)
+{
+	return indexCount;
+}
+
+/**
+ * @brief Read a library entry
+ * @param index: entry, from 0
+ * @param entry: filled with the record; sampleRate is 0 for a .wav the player cannot play
+ * @retval false when index is out of range or the index file cannot be read
+ */
+bool wavLibrary_getEntry(uint32_t index, WAV_LIBRARY_EntryTypeDef *entry)
+{
+	return readRecord(index, entry);
+}
+
+/**
+ * @brief File headers parsed by the current or last rescan
+ * @param None
+ * @retval headers parsed, 0 when every file matched the index
+ */
+uint32_t wavLibrary_getParsed(void)
+{
+	return parsed;
+}
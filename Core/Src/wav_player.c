@@ -10,7 +10,20 @@ References:
 
 #include "wav_player.h"
 #include "audioI2S.h"
+#include "echo.h"
+#include "convolver.h"
+#include "audio_mem.h"
+#include "audio_event.h"
+#include "read_fifo.h"
+#include "wav_riff.h"
+#include "pcm_convert.h"
+#include "resampler.h"
+#include "stage_prof.h"
+#include "trace.h"
 #include "fatfs.h"
+#include <math.h>
+#include <string.h>
+#include <stdlib.h>
 
 /* Echo Enable/Disable
  * 1 : Echo Enable
@@ -18,40 +31,115 @@ References:
  */
 uint8_t echoEnabled = 1;
 
+//Requested echo delay, the delay line is sized from it and the stream format at file select
+static uint32_t echoDelayMs = ECHO_DELAY_MS;
+static ECHO_StorageTypeDef echoStorage = ECHO_STORAGE_PCM16;
+static uint32_t echoMemoryBytes = 0;
+
+//Impulse response WAV for the convolution engine, NULL selects the echo engine
+static const char *impulsePath = NULL;
+static FIL impulseFile;
+static bool convolutionActive = false;
+static uint32_t impulseFrames = 0;
+
 //WAV File System variables
-static FIL wavFile;
+static FIL wavFiles[2];					// The playing file and the one queued behind it
+static FIL *wavFile = &wavFiles[0];
+static WAV_RIFF_InfoTypeDef wavInfo;	// Format and data chunk index of the selected file
+static uint32_t playOffset;				// File offset wavPlayer_play() starts at (wavPlayer_seek() before play)
+static bool isStreaming = false;		// Between wavPlayer_play() and the end of the file or wavPlayer_stop()
+
+//Read-ahead FIFO: filled from the file in aligned chunks by the main loop, emptied by slot refills.
+//Only the CPU accesses it (f_read copies from the USB FIFO), so it lives in core coupled RAM.
+static uint8_t wavFifoMem[WAV_FIFO_BYTES] __attribute__((aligned(4))) AUDIO_CCMRAM;
+static READ_FIFO_HandleTypeDef wavFifo;
+//Cluster link maps of wavFiles, built once at open so the hot path never follows the FAT
+static DWORD wavLinkMap[2][WAV_LINKMAP_ENTRIES];
+static bool wavFastSeek = false;
+
+//Gapless playback: the next file is opened, parsed and chained into the read-ahead FIFO while the
+//current one plays. The refill that reaches the end of the current data continues with the next
+//file's first frame. The output rate is the same, so the ring, the I2S clock, the resampler
+//history and the effect state (the echo tail) carry straight across.
+static WAV_RIFF_InfoTypeDef nextInfo;
+static bool nextFastSeek = false;
+static bool nextQueued = false;
+static uint32_t trackChanges = 0;
+static bool outputActive = false;		// DMA and codec running since wavPlayer_play()
 
 extern ADC_HandleTypeDef hadc1;  // analog input control the value of attenuation factor
 
-//WAV Audio Buffer
-static uint32_t fileLength;
-#define AUDIO_BUFFER_SIZE  1024
-static uint8_t audioBuffer[AUDIO_BUFFER_SIZE];
+//Echo level knob: ADC1 converts continuously into adcSamples[] by circular DMA, read without waiting
+#define ADC_SAMPLES        16       // Conversions averaged per reading
+#define ADC_FULL_SCALE     4095     // 12-bit result
+#define ADC_HYSTERESIS     24       // Knob movement ignored as pot and ADC noise, in counts (~0.6 %)
+#define ADC_TAPER_DB       40.0f    // Audio taper: the knob spans -40 dB to 0 dB above its off position
+static __IO uint16_t adcSamples[ADC_SAMPLES];
+static bool adcRunning = false;
+static int32_t adcLevel = -1;       // Filtered knob position in counts, -1 before the first reading
+
+//WAV Audio Buffer: a ring of slots played by circular DMA. Each DMA half/complete event frees the
+//half of the ring just played; its slots are refilled (one file read and one DSP pass each) in order.
+#define AUDIO_BUFFER_SIZE  WAV_RING_MAX_BYTES
+static uint8_t audioBuffer[AUDIO_BUFFER_SIZE] __attribute__((aligned(4)));	// Word aligned for the packed echo kernel
 static __IO uint32_t audioRemainSize = 0;
+static uint32_t ringSlotFrames = WAV_BALANCED_SLOT_FRAMES;	// Requested slot size in frames
+static uint8_t ringSlots = WAV_BALANCED_SLOTS;				// Requested slots in the ring
+static uint32_t slotBytes;									// Slot size of the playing stream in bytes
+static uint8_t slotCount;									// Slots of the playing stream
 
-//Echo Effect Parameters
-#define ECHO_DELAY_SAMPLES  48000 // Delay for 1 seconds at sampling frequency upto 48 kHz.
-float echoDecayFactor = 0.8f;  // Attenuation of echo (0.0 to 1.0) Default set to 80 %
-static int16_t echoBuffer[ECHO_DELAY_SAMPLES];
-static uint32_t echoBufferIndex = 0;
+//Format conversion: the ring always holds 16-bit stereo. Other formats are read from the FIFO
+//into convertBuffer (one slot of the largest source frame) and converted into the ring slot.
+#define CONVERT_BUFFER_SIZE  (WAV_RING_MAX_BYTES / 2u / PCM_OUT_FRAME_BYTES * PCM_MAX_FRAME_BYTES)
+static uint8_t convertBuffer[CONVERT_BUFFER_SIZE] __attribute__((aligned(4))) AUDIO_CCMRAM;
+static PCM_ConvertFunc playerConvert = pcmConvert_s16Stereo;	// Kernel for the selected stream
+static uint16_t fileFrameBytes = PCM_OUT_FRAME_BYTES;			// Bytes per frame in the file
 
+//Sample rate conversion: a stream at a rate the I2S PLL has no setting for is resampled, after
+//format conversion, to the nearest rate it has. Filter table and history come from the audio pool.
+static RESAMPLER_HandleTypeDef playerResampler;
+static RESAMPLER_QualityTypeDef resampleQuality = RESAMPLER_QUALITY_BALANCED;
+static bool resampling = false;
 
 //WAV Player
 static uint32_t samplingFreq;
 static UINT playerReadBytes = 0;
 static bool isFinished=0;
 
-//WAV Player process states
+//WAV Player process states, buffer-ready events come through playerEvents
 typedef enum
 {
   PLAYER_CONTROL_Idle=0,
-  PLAYER_CONTROL_HalfBuffer,
-  PLAYER_CONTROL_FullBuffer,
   PLAYER_CONTROL_EndOfFile,
 }PLAYER_CONTROL_e;
 
+//Half buffers freed by the I2S DMA, queued by the callbacks and refilled by wavPlayer_process()
+static AUDIO_EventQueueTypeDef playerEvents;
+static uint32_t playerLateRefills = 0;    // Halves refilled after the DMA had already moved past them
+#if STAGE_PROF_ENABLE
+static uint32_t slotFreedAt[WAV_RING_MAX_SLOTS];	// stageProf_now() when the DMA freed each slot
+#endif
+
 static volatile PLAYER_CONTROL_e playerControlSM = PLAYER_CONTROL_Idle;
 
+//Soft pause: the output fades to silence and the DMA keeps playing the ring, refilled with zeros,
+//with the codec powered. Resume fades back in from the next file frame. The codec is powered
+//down only when the pause outlasts pauseIdleMs.
+typedef enum
+{
+  PAUSE_Off=0,          // Playing, or fading back in while rampPos < rampFrames
+  PAUSE_RampOut,        // Fading out, the file is still read
+  PAUSE_Silent,         // Ring refilled with zeros, the codec up
+  PAUSE_PowerDown,      // Idle timeout passed: codec powered down, DMA paused
+}PAUSE_State_e;
+
+static PAUSE_State_e pauseState = PAUSE_Off;
+static uint32_t pauseIdleMs = WAV_PAUSE_IDLE_MS;
+static uint32_t pauseTick;              // When the output reached silence
+static uint32_t rampFrames;             // Fade length, whole slots so a fade ends on a slot boundary
+static uint32_t rampPos;                // Frames of gain: rampFrames is full level, 0 is silence
+static uint8_t silentSlots;             // Ring slots already holding zeros
+
 
 //--------------------------------------------------------------//
 //---------------------- Static functions ----------------------//
@@ -79,48 +167,395 @@ static void checkEchoEnable(void)
 	}
 }
 
-// Attenuation Factor Control for User
+// Start the echo level knob conversions, they run in the background until wavPlayer_stop()
+
+static void startAttenuationControl(void)
+{
+	if (!adcRunning && HAL_ADC_Start_DMA(&hadc1, (uint32_t*)adcSamples, ADC_SAMPLES) == HAL_OK)
+	{
+		adcRunning = true;
+	}
+}
+
+// Attenuation Factor Control for User: average of the latest conversions, hysteresis and audio taper.
+// Only reads memory, so it is cheap enough for every refill; the echo engine ramps to the new value.
 
 static void updateAttenuationFactor(void)
 {
-	HAL_ADC_Start(&hadc1);
-	if (HAL_ADC_PollForConversion(&hadc1, 10) == HAL_OK)
+	uint32_t sum = 0;
+	int32_t level;
+
+	if (!adcRunning)
+	{
+		return;
+	}
+	for (uint32_t i = 0; i < ADC_SAMPLES; i++)
+	{
+		sum += adcSamples[i];
+	}
+	level = (int32_t)(sum / ADC_SAMPLES);
+	//Snap the ends so that off and full scale stay reachable through the hysteresis
+	if (level <= ADC_HYSTERESIS)
+	{
+		level = 0;
+	}
+	else if (level >= ADC_FULL_SCALE - ADC_HYSTERESIS)
+	{
+		level = ADC_FULL_SCALE;
+	}
+	if (level == adcLevel || (adcLevel >= 0 && abs(level - adcLevel) <= ADC_HYSTERESIS
+	    && level != 0 && level != ADC_FULL_SCALE))
+	{
+		return;
+	}
+	adcLevel = level;
+	echoDecayFactor = (level == 0) ? 0.0f
+	                : powf(10.0f, ADC_TAPER_DB / 20.0f * ((float)level / ADC_FULL_SCALE - 1.0f));
+}
+
+// RIFF parser reader for an open FatFs file
+
+static uint32_t readFile(void *ctx, uint32_t offset, void *dst, uint32_t bytes)
+{
+	UINT readBytes = 0;
+
+	if (f_lseek((FIL*)ctx, offset) != FR_OK || f_read((FIL*)ctx, dst, bytes, &readBytes) != FR_OK)
+	{
+		return 0;
+	}
+	return readBytes;
+}
+
+// Parse an open WAV file, true when there is a conversion kernel for it (mono or stereo)
+
+static bool parseWav(FIL *file, WAV_RIFF_InfoTypeDef *info)
+{
+	return wavRiff_parse(info, readFile, file, (uint32_t)f_size(file)) == WAV_RIFF_OK
+	    && pcmConvert_select(info->encoding, info->bitsPerSample, info->channels) != NULL;
+}
+
+// Load the impulse response WAV into the convolution engine, sized for the selected stream
+
+static bool loadImpulse(uint16_t channels)
+{
+	WAV_RIFF_InfoTypeDef irInfo;
+	UINT readBytes = 0;
+	uint32_t remaining, sampleBytes;
+	CONV_HandleTypeDef *hconv;
+	PCM_ConvertFunc convert;
+
+	impulseFrames = 0;
+	if (!impulsePath || f_open(&impulseFile, impulsePath, FA_READ) != FR_OK)
+	{
+		return false;
+	}
+	if (!parseWav(&impulseFile, &irInfo) || convolver_configure(irInfo.frames, channels, irInfo.channels) == 0
+	    || f_lseek(&impulseFile, irInfo.dataOffset) != FR_OK)
+	{
+		f_close(&impulseFile);
+		return false;
+	}
+
+	//Stream the IR through the audio buffer, which is free until playback starts
+	hconv = convolver_getDefault();
+	remaining = irInfo.dataBytes;
+	if (irInfo.frames > convolver_irCapacity(hconv))
+	{
+		remaining = convolver_irCapacity(hconv) * irInfo.blockAlign;
+	}
+	//Samples are converted to 16 bits in pairs with the stereo kernel, so the channel count is kept
+	convert = pcmConvert_select(irInfo.encoding, irInfo.bitsPerSample, 2);
+	sampleBytes = irInfo.bitsPerSample / 8u;
+	while (remaining)
+	{
+		UINT chunk = (AUDIO_BUFFER_SIZE / 2u - 2u) * sampleBytes;		// 16-bit output, with the pad, fits audioBuffer
+		uint32_t samples;
+		if (chunk > CONVERT_BUFFER_SIZE - PCM_MAX_FRAME_BYTES)
+		{
+			chunk = CONVERT_BUFFER_SIZE - PCM_MAX_FRAME_BYTES;
+		}
+		chunk -= chunk % irInfo.blockAlign;
+		if (chunk > remaining)
+		{
+			chunk = remaining;
+		}
+		if (f_read(&impulseFile, convertBuffer, chunk, &readBytes) != FR_OK || readBytes < irInfo.blockAlign)
+		{
+			break;
+		}
+		readBytes -= readBytes % irInfo.blockAlign;
+		samples = readBytes / sampleBytes;
+		memset(&convertBuffer[readBytes], 0, sampleBytes);		// Pad an odd sample count to a pair
+		convert(convertBuffer, (int16_t*)audioBuffer, (samples + 1u) / 2u);
+		convolver_loadIR(hconv, (const int16_t*)audioBuffer, readBytes / irInfo.blockAlign);
+		impulseFrames += readBytes / irInfo.blockAlign;
+		remaining -= readBytes;
+	}
+	convolver_commitIR(hconv);
+	f_close(&impulseFile);
+	return true;
+}
+
+// Apply the selected effect in place: convolution when an IR is loaded, else echo
+
+static void applyEffect(int16_t *buffer, uint32_t size)
+{
+	if (convolutionActive)
 	{
-		uint32_t adcValue = HAL_ADC_GetValue(&hadc1);
-		echoDecayFactor = (float)(adcValue/4095.0f);
+		applyConvolution(buffer, size);
+	}
+	else
+	{
+		applyEcho(buffer, size);
 	}
-	HAL_ADC_Stop(&hadc1);
 }
 
-// Echo Generator Function Prototype
+// Set up the resampler from the selected stream rate to samplingFreq
 
-static void applyEcho(int16_t *buffer, uint32_t size)
+static bool initResampler(void)
 {
-  // Impulse response for a single echo: h[n] = δ[n] + ECHO_DECAY_FACTOR * δ[n - ECHO_DELAY_SAMPLES]
-  // Since h[n] is sparse, we only need to handle the non-zero taps at n=0 and n=ECHO_DELAY_SAMPLES
+	uint32_t bytes = resampler_memBytes(resampleQuality, wavInfo.sampleRate, samplingFreq);
+
+	return resampler_init(&playerResampler, audioMem_alloc(bytes), resampleQuality, wavInfo.sampleRate, samplingFreq);
+}
 
-	for (uint32_t i = 0; i < size; i++)
+// The file queued behind the playing one, the other of wavFiles
+
+static FIL *queuedFile(void)
+{
+	return (wavFile == &wavFiles[0]) ? &wavFiles[1] : &wavFiles[0];
+}
+
+// Close a queued next file that will not be played
+
+static void dropQueued(void)
+{
+	if (nextQueued)
 	{
-		int16_t currentSample = buffer[i];		// Read current sample
+		f_close(queuedFile());
+		nextQueued = false;
+	}
+}
 
-		int16_t delayedSample = echoBuffer[echoBufferIndex];		// Read delayed sample from echo buffer
+// The playing file's data is used up: hand out the queued next file from its first frame
+
+static bool switchTrack(void)
+{
+	if (!nextQueued || !readFifo_nextRegion(&wavFifo))
+	{
+		return false;
+	}
+	f_close(wavFile);
+	wavFile = queuedFile();
+	wavInfo = nextInfo;
+	wavFastSeek = nextFastSeek;
+	fileFrameBytes = wavInfo.blockAlign;
+	playerConvert = pcmConvert_select(wavInfo.encoding, wavInfo.bitsPerSample, wavInfo.channels);
+	nextQueued = false;
+	trackChanges++;
+	TRACE_EVENT(TRACE_EV_PLAYER, TRACE_PLAYER_TRACK_CHANGE | (trackChanges << 4));
+	return true;
+}
 
-		// Convolution: y[n] = x[n] + echoDecayFactor * x[n - ECHO_DELAY_SAMPLES]
+// Data bytes still to be handed out, a queued next file included
 
-		int32_t outputSample = (int32_t)currentSample + (int32_t)(delayedSample * echoDecayFactor);
+static uint32_t streamRemaining(void)
+{
+	return wavFifo.end - wavFifo.tail + (nextQueued ? nextInfo.dataBytes : 0u);
+}
 
-		// Clip to prevent overflow
-		if (outputSample > 32767)
-			outputSample = 32767;
-		else if (outputSample < -32768)
-			outputSample = -32768;
+// Read up to frames frames from the read-ahead FIFO, converted to 16-bit stereo at dst. At the
+// end of the playing file's data a queued next file takes over within the block.
+// Returns the frames read, *fileBytes the file bytes used.
 
-		echoBuffer[echoBufferIndex] = currentSample;				// Store current sample in echo buffer for future delay
+static uint32_t readFrames(int16_t *dst, uint32_t frames, uint32_t *fileBytes)
+{
+	uint32_t done = 0;
 
-		buffer[i] = (int16_t)outputSample;		// Update output buffer
+	*fileBytes = 0;
+	while (done < frames)
+	{
+		uint32_t want = frames - done;
+		uint32_t readBytes;
 
-		echoBufferIndex = (echoBufferIndex + 1) % ECHO_DELAY_SAMPLES;		// Update echo buffer index (circular buffer)
+		if (playerConvert == pcmConvert_s16Stereo)
+		{
+			readBytes = readFifo_read(&wavFifo, &dst[2 * done], want * PCM_OUT_FRAME_BYTES);	// Internal format, no conversion: one copy from the FIFO
 		}
+		else
+		{
+			if (want > CONVERT_BUFFER_SIZE / fileFrameBytes)
+			{
+				want = CONVERT_BUFFER_SIZE / fileFrameBytes;
+			}
+			readBytes = readFifo_read(&wavFifo, convertBuffer, want * fileFrameBytes);
+			playerConvert(convertBuffer, &dst[2 * done], readBytes / fileFrameBytes);
+		}
+		*fileBytes += readBytes;
+		done += readBytes / fileFrameBytes;
+		if (readBytes < want * fileFrameBytes && !(readFifo_isEnd(&wavFifo) && switchTrack()))
+		{
+			break;										// FIFO dry or end of data
+		}
+	}
+	return done;
+}
+
+// Produce frames of the output rate at dst, reading from the FIFO into the resampler only the
+// input those frames need. Returns the frames produced, *fileBytes the file bytes used.
+
+static uint32_t resampleFrames(int16_t *dst, uint32_t frames, uint32_t *fileBytes)
+{
+	uint32_t done = resampler_process(&playerResampler, dst, frames);
+
+	*fileBytes = 0;
+	while (done < frames)
+	{
+		uint32_t room, readBytes, got;
+		uint32_t need = resampler_inputFrames(&playerResampler, frames - done);
+		int16_t *in = resampler_writeBuffer(&playerResampler, &room);
+
+		if (need > room)
+		{
+			need = room;
+		}
+		got = readFrames(in, need, &readBytes);
+		resampler_commit(&playerResampler, got);
+		*fileBytes += readBytes;
+		done += resampler_process(&playerResampler, &dst[2 * done], frames - done);
+		if (got < need)
+		{
+			break;										// FIFO dry or end of data
+		}
+	}
+	return done;
+}
+
+// Fill one slot of the audio ring from the read-ahead FIFO, converted to 16-bit stereo at the
+// output rate. Returns the file bytes used.
+
+static uint32_t readSlot(uint8_t slot)
+{
+	int16_t *dst = (int16_t*)&audioBuffer[slot * slotBytes];
+	uint32_t frames = slotBytes / PCM_OUT_FRAME_BYTES;
+	uint32_t readBytes, done;
+
+	if (resampling)
+	{
+		done = resampleFrames(dst, frames, &readBytes);
+	}
+	else
+	{
+		done = readFrames(dst, frames, &readBytes);
+	}
+	if (done < frames)
+	{
+		memset(&dst[2 * done], 0, (frames - done) * PCM_OUT_FRAME_BYTES);	// FIFO ran dry: silence, not stale audio
+	}
+	return readBytes;
+}
+
+// File bytes one slot plays, the end of the file is near when less than this remains
+
+static uint32_t slotFileBytes(void)
+{
+	uint32_t frames = slotBytes / PCM_OUT_FRAME_BYTES;
+
+	if (resampling)
+	{
+		frames = (uint32_t)((uint64_t)frames * wavInfo.sampleRate / samplingFreq);
+	}
+	return frames * fileFrameBytes;
+}
+
+// Fade the slot out (soft pause) or in (resume), one gain step per frame. Fades start and end on
+// slot boundaries, so no file frame is dropped and resume continues at the next frame.
+
+static void applyPauseRamp(int16_t *buffer, uint32_t frames)
+{
+	const int32_t step = (int32_t)(65536u / rampFrames);
+
+	for (uint32_t n = 0; n < frames; n++)
+	{
+		int32_t gain;
+
+		if (pauseState == PAUSE_RampOut)
+		{
+			rampPos -= (rampPos > 0u) ? 1u : 0u;
+		}
+		else if (rampPos < rampFrames)
+		{
+			rampPos++;
+		}
+		gain = (rampPos == rampFrames) ? 65536 : (int32_t)rampPos * step;
+		buffer[2 * n] = (int16_t)((buffer[2 * n] * gain) >> 16);
+		buffer[2 * n + 1] = (int16_t)((buffer[2 * n + 1] * gain) >> 16);
+	}
+	if (pauseState == PAUSE_RampOut && rampPos == 0u)
+	{
+		pauseState = PAUSE_Silent;
+		silentSlots = 0;
+		pauseTick = HAL_GetTick();
+		TRACE_EVENT(TRACE_EV_PLAYER, TRACE_PLAYER_SILENT);
+	}
+}
+
+// Refill one slot of the audio ring from the read-ahead FIFO and apply the effect
+
+static void refillSlot(uint8_t slot)
+{
+	uint8_t *dst = &audioBuffer[slot * slotBytes];
+
+	if (pauseState >= PAUSE_Silent || !isStreaming)
+	{
+		if (silentSlots < slotCount)
+		{
+			memset(dst, 0, slotBytes);		// Once every slot is zero the DMA plays silence at no cost
+			silentSlots++;
+		}
+		return;
+	}
+	STAGE_PROF_START(readStart);
+	playerReadBytes = readSlot(slot);
+	STAGE_PROF_END(STAGE_PROF_SLOT_READ, readStart);
+	if (audioRemainSize > slotFileBytes())
+	{
+		audioRemainSize = streamRemaining();
+		if (echoEnabled)
+		{
+			STAGE_PROF_START(effectStart);
+			applyEffect((int16_t*)dst, slotBytes / 2); // Process one slot
+			STAGE_PROF_END(STAGE_PROF_EFFECT, effectStart);
+		}
+		if (pauseState == PAUSE_RampOut || rampPos < rampFrames)
+		{
+			STAGE_PROF_START(rampStart);
+			applyPauseRamp((int16_t*)dst, slotBytes / PCM_OUT_FRAME_BYTES);
+			STAGE_PROF_END(STAGE_PROF_PAUSE_RAMP, rampStart);
+		}
+	}
+	else
+	{
+		audioRemainSize = 0;
+		playerControlSM = PLAYER_CONTROL_EndOfFile;
+	}
+}
+
+// Queue the slots of the ring half the DMA has just finished playing (interrupt context)
+
+static void releaseSlots(uint8_t half)
+{
+	uint8_t first = half ? slotCount / 2 : 0;
+
+	TRACE_EVENT(TRACE_EV_DMA_HALF, half);
+	for (uint8_t slot = first; slot < first + slotCount / 2; slot++)
+	{
+		STAGE_PROF_STAMP(slotFreedAt[slot]);
+		if (!audioEvent_push(&playerEvents, slot))
+		{
+			TRACE_EVENT(TRACE_EV_EVENT_OVERRUN, slot);
+		}
+	}
 }
 
 //--------------------------------------------------------------//
@@ -130,26 +565,267 @@ static void applyEcho(int16_t *buffer, uint32_t size)
 /**
  * @brief Select WAV file to play
  * @param filePath: path to .wav file in the USB Drive
- * @retval returns true when file is found in USB Drive
+ * @retval returns true when file is found in USB Drive and holds mono or stereo 8/16/24/32-bit or float PCM
  */
 bool wavPlayer_fileSelect(const char* filePath)
 {
-  WAV_HeaderTypeDef wavHeader;
-  UINT readBytes = 0;
   //Open WAV file
-  if(f_open(&wavFile, filePath, FA_READ) != FR_OK)
+  dropQueued();
+  if(f_open(wavFile, filePath, FA_READ) != FR_OK)
+  {
+    return false;
+  }
+  //Map the cluster chain for fast-seek
+  wavFastSeek = readFifo_mapFile(wavFile, wavLinkMap[wavFile - wavFiles], WAV_LINKMAP_ENTRIES);
+  //Walk the RIFF chunks: format from "fmt ", audio from the "data" chunk only
+  if(!parseWav(wavFile, &wavInfo))
+  {
+    memset(&wavInfo, 0, sizeof(wavInfo));
+    f_close(wavFile);
+    return false;
+  }
+  playOffset = wavInfo.dataOffset;
+  fileFrameBytes = wavInfo.blockAlign;
+  playerConvert = pcmConvert_select(wavInfo.encoding, wavInfo.bitsPerSample, wavInfo.channels);
+  //Play the WAV file with frequency specified in header, resampled when the I2S PLL has no setting for it
+  audioMem_reset();
+  samplingFreq = audioI2S_nearestFreq(wavInfo.sampleRate);
+  resampling = (samplingFreq != wavInfo.sampleRate) && initResampler();
+  if (!resampling)
+  {
+    samplingFreq = wavInfo.sampleRate;
+  }
+  //Set up the effect for this stream, it runs on the converted 16-bit stereo at the output rate:
+  //convolution if an IR loads, else the echo delay line
+  convolutionActive = loadImpulse(2);
+  echoMemoryBytes = convolutionActive ? 0 : echo_configure(samplingFreq, 2, echoDelayMs, echoStorage);
+  return true;
+}
+
+/**
+ * @brief Queue the file to play after the current one, without a gap
+ * @note The file is opened and parsed now, and its first chunks are read ahead as soon as the
+ *       current file's data is all in the FIFO. At the end of the current data the slot refill
+ *       continues with the next file's first frame: no I2S, PLL or codec reconfiguration, and
+ *       the resampler history and echo tail carry across. Only a file at the playing file's
+ *       sample rate can follow gaplessly; play any other one with wavPlayer_fileSelect() and
+ *       wavPlayer_play() once wavPlayer_isFinished().
+ * @param filePath: path to .wav file in the USB Drive
+ * @retval false when nothing is playing, a file is queued already, or the file is missing,
+ *         unsupported or at another sample rate
+ */
+bool wavPlayer_queueNext(const char* filePath)
+{
+  FIL *file = queuedFile();
+
+  if(!isStreaming || nextQueued || playerControlSM != PLAYER_CONTROL_Idle)
+  {
+    return false;
+  }
+  if(f_open(file, filePath, FA_READ) != FR_OK)
+  {
+    return false;
+  }
+  nextFastSeek = readFifo_mapFile(file, wavLinkMap[file - wavFiles], WAV_LINKMAP_ENTRIES);
+  if(!parseWav(file, &nextInfo) || nextInfo.sampleRate != wavInfo.sampleRate
+     || !readFifo_chain(&wavFifo, file, nextInfo.dataOffset, nextInfo.dataOffset + nextInfo.dataBytes, nextInfo.blockAlign))
   {
+    f_close(file);
     return false;
   }
-  //Read WAV file Header
-  f_read(&wavFile, &wavHeader, sizeof(wavHeader), &readBytes);
-  //Get audio data size
-  fileLength = wavHeader.FileSize;
-  //Play the WAV file with frequency specified in header
-  samplingFreq = wavHeader.SampleRate;
+  nextQueued = true;
   return true;
 }
 
+/**
+ * @brief Whether a file is queued behind the playing one
+ * @param None
+ * @retval true from wavPlayer_queueNext() until playback moves on to the file
+ */
+bool wavPlayer_isNextQueued(void)
+{
+  return nextQueued;
+}
+
+/**
+ * @brief Gapless moves on to a queued file
+ * @note Counted when the first frame of the queued file goes into the ring, one ring length
+ *       ahead of when it is heard.
+ * @param None
+ * @retval track changes since power up
+ */
+uint32_t wavPlayer_getTrackChanges(void)
+{
+  return trackChanges;
+}
+
+/**
+ * @brief Set the echo delay, takes effect at the next wavPlayer_fileSelect()
+ * @param delayMs: echo delay in milliseconds
+ * @retval None
+ */
+void wavPlayer_setEchoDelay(uint32_t delayMs)
+{
+	echoDelayMs = delayMs;
+}
+
+/**
+ * @brief Set the echo delay line format, takes effect at the next wavPlayer_fileSelect()
+ * @param storage: ECHO_STORAGE_PCM16, or µ-law/ADPCM for a longer delay from the same memory
+ * @retval None
+ */
+void wavPlayer_setEchoStorage(ECHO_StorageTypeDef storage)
+{
+	echoStorage = storage;
+}
+
+/**
+ * @brief Switch the echo between FIR (one repeat per tap) and feedback (decaying repeats), takes effect at once
+ * @param mode: ECHO_MODE_FIR or ECHO_MODE_FEEDBACK
+ * @param damping: feedback high frequency loss per repeat, 0.0 to 1.0 (ECHO_DAMPING_DEFAULT)
+ * @retval None
+ */
+void wavPlayer_setEchoMode(ECHO_ModeTypeDef mode, float damping)
+{
+	echo_setDefaultMode(mode, damping);
+}
+
+/**
+ * @brief Set the sample rate converter quality, takes effect at the next wavPlayer_fileSelect()
+ * @note Only streams at a rate the I2S PLL has no setting for are resampled. Higher quality
+ *       costs more taps per output frame and a larger table from the audio memory pool.
+ * @param quality: RESAMPLER_QUALITY_FAST, RESAMPLER_QUALITY_BALANCED or RESAMPLER_QUALITY_HIGH
+ * @retval None
+ */
+void wavPlayer_setResampleQuality(RESAMPLER_QualityTypeDef quality)
+{
+	resampleQuality = quality;
+}
+
+/**
+ * @brief Output sample rate of the selected file
+ * @param None
+ * @retval I2S rate in Hz, differs from the file rate when the file is resampled
+ */
+uint32_t wavPlayer_getOutputRate(void)
+{
+	return samplingFreq;
+}
+
+/**
+ * @brief Set the audio ring, takes effect at the next wavPlayer_play()
+ * @note Latency is slots x slotFrames frames; the DMA frees half of the ring at a time, so the
+ *       refill deadline is (slots / 2) x slotFrames frames. Larger slots mean fewer file reads.
+ * @param slotFrames: frames per slot (even), one file read and one DSP pass, from WAV_SLOT_MIN_FRAMES
+ * @param slots: even number of slots from 2 to WAV_RING_MAX_SLOTS
+ * @retval false when the ring would not fit WAV_RING_MAX_BYTES for 16-bit stereo
+ */
+bool wavPlayer_setBuffering(uint32_t slotFrames, uint8_t slots)
+{
+	if (slots < 2 || slots > WAV_RING_MAX_SLOTS || (slots & 1u) || slotFrames < WAV_SLOT_MIN_FRAMES || (slotFrames & 1u)
+	    || slotFrames * slots * 4u > WAV_RING_MAX_BYTES)
+	{
+		return false;
+	}
+	ringSlotFrames = slotFrames;
+	ringSlots = slots;
+	return true;
+}
+
+/**
+ * @brief Select a named buffering profile, takes effect at the next wavPlayer_play()
+ * @param profile: WAV_PROFILE_LOW_LATENCY, WAV_PROFILE_BALANCED or WAV_PROFILE_THROUGHPUT
+ * @retval None
+ */
+void wavPlayer_setProfile(WAV_ProfileTypeDef profile)
+{
+	switch (profile)
+	{
+	case WAV_PROFILE_LOW_LATENCY:
+		wavPlayer_setBuffering(WAV_LOW_LATENCY_SLOT_FRAMES, WAV_LOW_LATENCY_SLOTS);
+		break;
+	case WAV_PROFILE_THROUGHPUT:
+		wavPlayer_setBuffering(WAV_THROUGHPUT_SLOT_FRAMES, WAV_THROUGHPUT_SLOTS);
+		break;
+	default:
+		wavPlayer_setBuffering(WAV_BALANCED_SLOT_FRAMES, WAV_BALANCED_SLOTS);
+		break;
+	}
+}
+
+/**
+ * @brief Select an impulse response WAV (mono or stereo, any format the player plays) to convolve with,
+ *        takes effect at the next wavPlayer_fileSelect()
+ * @note The IR is truncated to what fits in the audio memory pool. The echo engine is used
+ *       when filePath is NULL or the IR cannot be loaded.
+ * @param filePath: path to the IR .wav file in the USB Drive, kept by reference
+ * @retval None
+ */
+void wavPlayer_setImpulse(const char* filePath)
+{
+	impulsePath = filePath;
+}
+
+/**
+ * @brief Impulse response frames loaded for the selected file
+ * @param None
+ * @retval IR length in frames, 0 when the echo engine is in use
+ */
+uint32_t wavPlayer_getImpulseFrames(void)
+{
+	return impulseFrames;
+}
+
+/**
+ * @brief Bytes reserved for the echo delay line of the selected file
+ * @param None
+ * @retval delay line size in bytes
+ */
+uint32_t wavPlayer_getEchoMemory(void)
+{
+	return echoMemoryBytes;
+}
+
+/**
+ * @brief Buffer-ready events dropped because the event queue was full
+ * @param None
+ * @retval events lost since wavPlayer_play(), their halves were replayed with stale audio
+ */
+uint32_t wavPlayer_getOverruns(void)
+{
+	return playerEvents.overruns;
+}
+
+/**
+ * @brief Half buffers refilled late, after the DMA had already freed the next half
+ * @param None
+ * @retval late refills since wavPlayer_play()
+ */
+uint32_t wavPlayer_getLateRefills(void)
+{
+	return playerLateRefills;
+}
+
+/**
+ * @brief Slot refills that found the read-ahead FIFO short of data and played silence
+ * @param None
+ * @retval underruns since wavPlayer_play()
+ */
+uint32_t wavPlayer_getFifoUnderruns(void)
+{
+	return wavFifo.underruns;
+}
+
+/**
+ * @brief Whether the selected file streams with a FatFs fast-seek link map
+ * @param None
+ * @retval false when fast-seek is disabled in ffconf.h or the file has too many fragments
+ */
+bool wavPlayer_isFastSeek(void)
+{
+	return wavFastSeek;
+}
+
 /**
  * @brief WAV File Play
  * @param None
@@ -158,24 +834,57 @@ bool wavPlayer_fileSelect(const char* filePath)
 void wavPlayer_play(void)
 {
 	checkEchoEnable();
-	updateAttenuationFactor();
+	startAttenuationControl();
 	isFinished = false;
 
-	//Initialise I2S Audio Sampling settings
+	//Output still running on silence after the end of a file: stop it before the restart
+	if (outputActive)
+	{
+		audioI2S_stop();
+	}
+	//Initialise I2S Audio Sampling settings, the PLL and I2S are left alone when the rate is unchanged
 	audioI2S_init(samplingFreq);
 
-	//Read Audio data from USB Disk
-	f_lseek(&wavFile, 0);
-	f_read (&wavFile, &audioBuffer[0], AUDIO_BUFFER_SIZE, &playerReadBytes);
-	audioRemainSize = fileLength - playerReadBytes;
+	//Size the ring, every slot holds whole 16-bit stereo frames
+	slotBytes = ringSlotFrames * PCM_OUT_FRAME_BYTES;
+	slotCount = ringSlots;
+	rampFrames = (samplingFreq * WAV_PAUSE_RAMP_MS / 1000u + ringSlotFrames - 1u) / ringSlotFrames * ringSlotFrames;
+	rampPos = rampFrames;
+	pauseState = PAUSE_Off;
+	stageProf_setSlotPeriod(ringSlotFrames, samplingFreq, slotCount / 2u);
+
+	//Read Audio data from USB Disk: fill the read-ahead FIFO, then the ring from it
+	readFifo_init(&wavFifo, wavFile, wavFifoMem, WAV_FIFO_BYTES, playOffset, wavInfo.dataOffset + wavInfo.dataBytes,
+	              fileFrameBytes);
+	if (resampling)
+	{
+		resampler_reset(&playerResampler);
+	}
+	readFifo_fill(&wavFifo, WAV_FIFO_BYTES / READ_FIFO_MIN_CHUNK);
+	playerReadBytes = 0;
+	for (uint8_t slot = 0; slot < slotCount; slot++)
+	{
+		playerReadBytes += readSlot(slot);
+	}
+	audioRemainSize = streamRemaining();
+	isStreaming = true;
+	updateAttenuationFactor();						// The first conversions are in by now
 
 	if (echoEnabled)
 	{
-		//Apply echo to the initial buffer
-		applyEcho((int16_t*)audioBuffer, AUDIO_BUFFER_SIZE / 2);
+		//Apply the effect to the initial ring, one slot at a time as during playback
+		for (uint8_t slot = 0; slot < slotCount; slot++)
+		{
+			applyEffect((int16_t*)&audioBuffer[slot * slotBytes], slotBytes / 2);
+		}
 	}
 	//Start playing the WAV
-	audioI2S_play((uint16_t *)&audioBuffer[0], AUDIO_BUFFER_SIZE);
+	audioEvent_reset(&playerEvents);
+	playerLateRefills = 0;
+	playerControlSM = PLAYER_CONTROL_Idle;
+	audioI2S_play((uint16_t *)&audioBuffer[0], slotBytes * slotCount);
+	outputActive = true;
+	TRACE_EVENT(TRACE_EV_PLAYER, TRACE_PLAYER_PLAY | (samplingFreq << 4));
 }
 
 /**
@@ -185,59 +894,68 @@ void wavPlayer_play(void)
  */
 void wavPlayer_process(void)
 {
+	AUDIO_EventTypeDef event;
+	bool busy = false;				// Refilled or read, idle spins are not timed as a whole
+	uint32_t fileBytes;
+	STAGE_PROF_START(processStart);
+	STAGE_PROF_START(switchStart);
+
 	checkEchoEnable();
+	STAGE_PROF_END(STAGE_PROF_ECHO_SWITCH, switchStart);
+	STAGE_PROF_START(knobStart);
+	updateAttenuationFactor();
+	STAGE_PROF_END(STAGE_PROF_LEVEL_KNOB, knobStart);
 	switch(playerControlSM)
 	{
 	case PLAYER_CONTROL_Idle:
-		break;
-
-	case PLAYER_CONTROL_HalfBuffer:
-		playerReadBytes = 0;
-		playerControlSM = PLAYER_CONTROL_Idle;
-		f_read (&wavFile, &audioBuffer[0], AUDIO_BUFFER_SIZE/2, &playerReadBytes);
-
-		if(audioRemainSize > (AUDIO_BUFFER_SIZE / 2))
+		//Refill every freed slot in DMA order, a late loop catches up instead of skipping slots
+		while (playerControlSM == PLAYER_CONTROL_Idle && audioEvent_pop(&playerEvents, &event))
 		{
-			audioRemainSize -= playerReadBytes;
-			if (echoEnabled)
+			if (audioEvent_produced(&playerEvents) - (event.seq - event.seq % (slotCount / 2u)) > slotCount / 2u)
 			{
-				applyEcho((int16_t*)audioBuffer, AUDIO_BUFFER_SIZE / 4); // Process half buffer
+				playerLateRefills++;	// The DMA freed more slots already and may be reading this one
+				TRACE_EVENT(TRACE_EV_LATE_REFILL, event.slot);
 			}
+			STAGE_PROF_START(refillStart);
+			busy = true;
+			TRACE_EVENT(TRACE_EV_REFILL_START, event.slot);
+			refillSlot(event.slot);
+			TRACE_EVENT(TRACE_EV_REFILL_END, event.slot);
+			STAGE_PROF_END(STAGE_PROF_REFILL, refillStart);
+			//Due when the DMA has played the other half and the slots before this one in its own half
+			STAGE_PROF_SLACK(slotFreedAt[event.slot], slotCount / 2u + event.slot % (slotCount / 2u));
 		}
-		else
-		{
-			audioRemainSize = 0;
-			playerControlSM = PLAYER_CONTROL_EndOfFile;
-		}
-		break;
-
-	case PLAYER_CONTROL_FullBuffer:
-		playerReadBytes = 0;
-		playerControlSM = PLAYER_CONTROL_Idle;
-		f_read (&wavFile, &audioBuffer[AUDIO_BUFFER_SIZE/2], AUDIO_BUFFER_SIZE/2, &playerReadBytes);
-
-		if(audioRemainSize > (AUDIO_BUFFER_SIZE / 2))
+		//Then read ahead, one chunk per call so queued refills never wait behind several reads
+		STAGE_PROF_START(fileStart);
+		fileBytes = readFifo_fill(&wavFifo, 1);
+		if (fileBytes != 0u)
 		{
-			audioRemainSize -= playerReadBytes;
-			if (echoEnabled)
-			{
-				applyEcho((int16_t*)&audioBuffer[AUDIO_BUFFER_SIZE/2], AUDIO_BUFFER_SIZE / 4); // Process second half
-			}
+			STAGE_PROF_END(STAGE_PROF_FILE_READ, fileStart);
+			busy = true;
 		}
-		else
+		if (pauseState == PAUSE_Silent && pauseIdleMs != WAV_PAUSE_IDLE_NEVER && HAL_GetTick() - pauseTick >= pauseIdleMs)
 		{
-			audioRemainSize = 0;
-			playerControlSM = PLAYER_CONTROL_EndOfFile;
+			audioI2S_pause();			// Long pause: power the codec down, the DMA stops once it has muted
+			pauseState = PAUSE_PowerDown;
+			TRACE_EVENT(TRACE_EV_PLAYER, TRACE_PLAYER_POWER_DOWN);
 		}
 		break;
 
 	case PLAYER_CONTROL_EndOfFile:
-		f_close(&wavFile);
+		TRACE_EVENT(TRACE_EV_PLAYER, TRACE_PLAYER_END_OF_FILE);
+		isStreaming = false;						// The refills play silence from now on
+		silentSlots = 0;
+		f_close(wavFile);
+		dropQueued();
 		wavPlayer_reset();
 		isFinished = true;
 		playerControlSM = PLAYER_CONTROL_Idle;
 		break;
 	}
+	if (busy)
+	{
+		STAGE_PROF_END(STAGE_PROF_PROCESS, processStart);
+	}
 }
 
 /**
@@ -247,9 +965,16 @@ void wavPlayer_process(void)
  */
 void wavPlayer_stop(void)
 {
+	TRACE_EVENT(TRACE_EV_PLAYER, TRACE_PLAYER_STOP);
 	audioI2S_stop();
-	f_close(&wavFile);
+	outputActive = false;
+	isStreaming = false;
+	f_close(wavFile);
+	dropQueued();
 	isFinished = true;
+	HAL_ADC_Stop_DMA(&hadc1);
+	adcRunning = false;
+	adcLevel = -1;
 	HAL_GPIO_WritePin(GPIOD, GPIO_PIN_12|GPIO_PIN_13|GPIO_PIN_14|GPIO_PIN_15, GPIO_PIN_RESET);
 	for(int i=0; i<6; i++)
 	{
@@ -260,16 +985,115 @@ void wavPlayer_stop(void)
 
 /**
  * @brief WAV pause/resume
+ * @note Pause fades the output out over WAV_PAUSE_RAMP_MS and keeps the codec and the DMA
+ *       running on silence; wavPlayer_process() must keep being called. Resume fades back in
+ *       from the frame after the last one faded out, starting with the next slot refill. The
+ *       codec powers down after the idle timeout (wavPlayer_setPauseIdleTimeout()), and resume
+ *       then powers it up again first.
  * @param None
  * @retval None
  */
 void wavPlayer_pause(void)
 {
-	audioI2S_pause();
+	if (isStreaming && pauseState == PAUSE_Off)
+	{
+		pauseState = PAUSE_RampOut;
+		TRACE_EVENT(TRACE_EV_PLAYER, TRACE_PLAYER_PAUSE);
+	}
 }
 void wavPlayer_resume(void)
 {
-	audioI2S_resume();
+	if (pauseState != PAUSE_Off)
+	{
+		TRACE_EVENT(TRACE_EV_PLAYER, TRACE_PLAYER_RESUME);
+	}
+	if (pauseState == PAUSE_PowerDown)
+	{
+		audioI2S_resume();
+	}
+	if (pauseState >= PAUSE_Silent)
+	{
+		rampPos = 0;
+	}
+	pauseState = PAUSE_Off;
+}
+
+/**
+ * @brief How long a pause keeps the codec powered
+ * @param ms: idle time before the codec powers down, WAV_PAUSE_IDLE_NEVER to keep it up
+ * @retval None
+ */
+void wavPlayer_setPauseIdleTimeout(uint32_t ms)
+{
+	pauseIdleMs = ms;
+}
+
+/**
+ * @brief Whether playback is paused or fading out for a pause
+ * @param None
+ * @retval true from wavPlayer_pause() to wavPlayer_resume()
+ */
+bool wavPlayer_isPaused(void)
+{
+	return pauseState != PAUSE_Off;
+}
+
+/**
+ * @brief Jump to a time position of the selected file
+ * @note Before wavPlayer_play() this sets where playback starts. During playback the slots
+ *       already in the ring play out, then audio continues from the new position. The data
+ *       chunk index turns the time into a file offset, so a jump is one f_lseek() and one read.
+ * @param ms: milliseconds from the start of the audio, clamped to its length
+ * @retval false when no file is selected or the seek fails
+ */
+bool wavPlayer_seek(uint32_t ms)
+{
+	uint32_t offset = wavRiff_frameOffset(&wavInfo, wavRiff_msToFrame(&wavInfo, ms));
+
+	if (wavInfo.blockAlign == 0)
+		return false;
+	if (!isStreaming)
+	{
+		playOffset = offset;
+		return true;
+	}
+	if (playerControlSM != PLAYER_CONTROL_Idle || !readFifo_seek(&wavFifo, offset))
+		return false;
+	audioRemainSize = streamRemaining();
+	if (resampling)
+	{
+		resampler_reset(&playerResampler);				// No filter history across the jump
+	}
+	readFifo_fill(&wavFifo, 1);						// Data for the next refill, the rest follows in process
+	return true;
+}
+
+/**
+ * @brief Play position of the selected file
+ * @note During playback this is the position of the audio next handed to the ring, one ring
+ *       length (see the buffering profiles) ahead of what is heard.
+ * @param None
+ * @retval milliseconds from the start of the audio
+ */
+uint32_t wavPlayer_getPositionMs(void)
+{
+	uint32_t offset = isStreaming ? wavFifo.tail : playOffset;
+
+	if (wavInfo.blockAlign == 0)
+		return 0;
+	return (uint32_t)((uint64_t)((offset - wavInfo.dataOffset) / wavInfo.blockAlign) * 1000u / wavInfo.sampleRate);
+}
+
+/**
+ * @brief Length of the selected file
+ * @param None
+ * @retval milliseconds of audio in the data chunk
+ */
+uint32_t wavPlayer_getLengthMs(void)
+{
+	if (wavInfo.blockAlign == 0)
+		return 0;
+	return (uint32_t)((uint64_t)wavInfo.frames * 1000u / wavInfo.sampleRate);
 }
 
 /**
@@ -289,10 +1113,9 @@ bool wavPlayer_isFinished(void)
  */
 void audioI2S_halfTransfer_Callback(void)
 {
-	playerControlSM = PLAYER_CONTROL_HalfBuffer;
+	releaseSlots(0);
 }
 void audioI2S_fullTransfer_Callback(void)
 {
-	playerControlSM = PLAYER_CONTROL_FullBuffer;
-
+	releaseSlots(1);
 }
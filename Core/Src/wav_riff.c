@@ -0,0 +1,155 @@
+/*
+Library:				wav_riff.c
+Written by:				Shridattha M Hebbar
+Date Written:			16/10/2026
+Description:			RIFF/WAVE chunk walker, see wav_riff.h. Only chunk headers and the fmt body are
+						read, so parsing costs a few small reads whatever the file size.
+*/
+
+#include "wav_riff.h"
+
+#define RIFF_ID(a, b, c, d)  ((uint32_t)(a) | (uint32_t)(b) << 8 | (uint32_t)(c) << 16 | (uint32_t)(d) << 24)
+#define FMT_BODY_BYTES       40u     // WAVEFORMATEXTENSIBLE, the largest fmt body we look at
+
+//--------------------------------------------------------------//
+//---------------------- Static functions ----------------------//
+//--------------------------------------------------------------//
+
+// Little-endian fields of a byte buffer
+static uint16_t get16(const uint8_t *p)
+{
+	return (uint16_t)(p[0] | p[1] << 8);
+}
+
+static uint32_t get32(const uint8_t *p)
+{
+	return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+// Decode and check a fmt chunk body of len bytes
+static WAV_RIFF_StatusTypeDef parseFmt(WAV_RIFF_InfoTypeDef *info, const uint8_t *fmt, uint32_t len)
+{
+	uint16_t tag;
+
+	if (len < 16)
+		return WAV_RIFF_ERR_FORMAT;
+	tag = get16(&fmt[0]);
+	info->channels = get16(&fmt[2]);
+	info->sampleRate = get32(&fmt[4]);
+	info->blockAlign = get16(&fmt[12]);
+	info->bitsPerSample = get16(&fmt[14]);
+	if (tag == WAV_RIFF_EXTENSIBLE)
+	{
+		if (len < FMT_BODY_BYTES)
+			return WAV_RIFF_ERR_FORMAT;
+		tag = get16(&fmt[24]);						// First two bytes of the sub format GUID
+	}
+	info->encoding = tag;
+
+	if (info->channels == 0 || info->channels > WAV_RIFF_MAX_CHANNELS || info->sampleRate == 0)
+		return WAV_RIFF_ERR_FORMAT;
+	if (tag == WAV_RIFF_PCM)
+	{
+		if (info->bitsPerSample != 8 && info->bitsPerSample != 16 && info->bitsPerSample != 24
+		    && info->bitsPerSample != 32)
+			return WAV_RIFF_ERR_FORMAT;
+	}
+	else if (tag != WAV_RIFF_FLOAT || info->bitsPerSample != 32)
+	{
+		return WAV_RIFF_ERR_FORMAT;
+	}
+	if (info->blockAlign != info->channels * (info->bitsPerSample / 8u))
+		return WAV_RIFF_ERR_FORMAT;
+	return WAV_RIFF_OK;
+}
+
+//--------------------------------------------------------------//
+//---------------------- Public Functions ----------------------//
+//--------------------------------------------------------------//
+
+/**
+ * @brief Walk the chunks of a WAV file and index its sample data
+ * @note The RIFF size and the data size are trusted only as far as the file goes, so streams
+ *       whose writer never patched the sizes (0 or 0xFFFFFFFF) still play to the end.
+ * @param info: stream description, valid when WAV_RIFF_OK is returned
+ * @param read: reader of the file
+ * @param ctx: passed to read
+ * @param fileSize: file size in bytes
+ * @retval WAV_RIFF_OK, or why the file cannot be played
+ */
+WAV_RIFF_StatusTypeDef wavRiff_parse(WAV_RIFF_InfoTypeDef *info, WAV_RIFF_ReadFunc read, void *ctx,
+                                     uint32_t fileSize)
+{
+	uint8_t hdr[12];
+	uint8_t fmt[FMT_BODY_BYTES];
+	uint32_t pos = 12;
+	uint32_t end = fileSize;
+	WAV_RIFF_StatusTypeDef fmtStatus = WAV_RIFF_ERR_NO_FMT;
+
+	if (read(ctx, 0, hdr, 12) != 12)
+		return WAV_RIFF_ERR_READ;
+	if (get32(&hdr[0]) != RIFF_ID('R','I','F','F') || get32(&hdr[8]) != RIFF_ID('W','A','V','E'))
+		return WAV_RIFF_ERR_NOT_WAVE;
+	if (get32(&hdr[4]) >= 4 && get32(&hdr[4]) <= fileSize - 8)
+		end = get32(&hdr[4]) + 8;
+
+	while (pos <= end && end - pos >= 8)
+	{
+		uint32_t id, size;
+
+		if (read(ctx, pos, hdr, 8) != 8)
+			return WAV_RIFF_ERR_READ;
+		id = get32(&hdr[0]);
+		size = get32(&hdr[4]);
+		pos += 8;
+
+		if (id == RIFF_ID('f','m','t',' '))
+		{
+			uint32_t len = (size < FMT_BODY_BYTES) ? size : FMT_BODY_BYTES;
+			if (read(ctx, pos, fmt, len) != len)
+				return WAV_RIFF_ERR_READ;
+			fmtStatus = parseFmt(info, fmt, len);
+		}
+		else if (id == RIFF_ID('d','a','t','a'))
+		{
+			if (fmtStatus != WAV_RIFF_OK)
+				return fmtStatus;
+			if (size == 0 || size > fileSize - pos)
+				size = fileSize - pos;				// Unpatched or truncated stream
+			info->dataOffset = pos;
+			info->frames = size / info->blockAlign;
+			info->dataBytes = info->frames * info->blockAlign;
+			return WAV_RIFF_OK;
+		}
+		if (size > end - pos)
+			break;
+		pos += size + (size & 1u);					// Chunks are padded to even sizes
+	}
+	return (fmtStatus == WAV_RIFF_OK) ? WAV_RIFF_ERR_NO_DATA : fmtStatus;
+}
+
+/**
+ * @brief File offset of a frame, clamped to the end of the data
+ * @param info: parsed stream
+ * @param frame: frame index
+ * @retval file offset
+ */
+uint32_t wavRiff_frameOffset(const WAV_RIFF_InfoTypeDef *info, uint32_t frame)
+{
+	if (frame > info->frames)
+		frame = info->frames;
+	return info->dataOffset + frame * info->blockAlign;
+}
+
+/**
+ * @brief Frame at a time position
+ * @param info: parsed stream
+ * @param ms: milliseconds from the start of the data
+ * @retval frame index, at most info->frames
+ */
+uint32_t wavRiff_msToFrame(const WAV_RIFF_InfoTypeDef *info, uint32_t ms)
+{
+	uint64_t frame = (uint64_t)ms * info->sampleRate / 1000u;
+
+	return (frame > info->frames) ? info->frames : (uint32_t)frame;
+}
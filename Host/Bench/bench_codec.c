@@ -0,0 +1,419 @@
+/*
+Library:				bench_codec.c
+Written by:				Shridattha M Hebbar
+Date Written:			16/10/2026
+Description:			Host check of the CS43L22 control path against the I2C stand-in and its
+						register file: registers written, bus transactions, bus time and how long
+						the caller waits per codec operation, next to the blocking driver that sent
+						every write on its own. A soft pause must fade out and back in without
+						codec writes or lost frames; after the idle timeout the DMA must pause only
+						once the codec has muted. Volume changes during playback must not wait.
+						The codec's registers must end up as the driver's shadow says, also when
+						the codec kept its state over an MCU reset. Commands dropped on a stuck bus
+						must count as errors and their registers be rewritten once it recovers.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include "bench_common.h"
+#include "stm32f4xx_hal.h"
+#include "fatfs.h"
+#include "wav_player.h"
+#include "audioI2S.h"
+#include "CS43L22.h"
+
+#define BENCH_RATE				48000
+#define BENCH_SECONDS			2
+#define BENCH_SINGLE_WRITE_US	290u		// One register per transaction at 100 kHz, the blocking driver
+
+extern I2C_HandleTypeDef hi2c1;
+extern I2S_HandleTypeDef hi2s3;
+
+//I2C counters at the start of an operation
+typedef struct
+{
+	uint32_t writes;
+	uint32_t transfers;
+	uint64_t busUs;
+	uint64_t waitUs;
+}I2cMark_t;
+
+static I2cMark_t mark(void)
+{
+	I2cMark_t m = { hostHal_i2cWriteCount(), hostHal_i2cTransferCount(), hostHal_i2cBusUs(), hostHal_i2cBlockedUs() };
+	return m;
+}
+
+// Let every queued write complete by interrupt
+static void drain(void)
+{
+	while (hostHal_i2cIrq())
+	{
+	}
+}
+
+// Registers, transactions, bus time and caller wait of one operation, the queue drained by interrupt
+// afterwards. singleWrites: the writes the blocking driver made for it, each waited for by the caller.
+static uint32_t report(const char *label, I2cMark_t m, uint32_t singleWrites)
+{
+	uint64_t waitUs = hostHal_i2cBlockedUs() - m.waitUs;
+	uint32_t writes;
+
+	drain();
+	writes = hostHal_i2cWriteCount() - m.writes;
+	printf("%-24s %9u %9u %8.2f %8.2f %10.2f\n", label, writes, hostHal_i2cTransferCount() - m.transfers,
+	       (hostHal_i2cBusUs() - m.busUs) / 1000.0, waitUs / 1000.0, singleWrites * BENCH_SINGLE_WRITE_US / 1000.0);
+	return writes;
+}
+
+// The codec holds what the driver's shadow says, for every control register
+static bool shadowMatches(void)
+{
+	drain();
+	for (uint8_t reg = CS43L22_REG_POWER_CTL1; reg <= CS43L22_REG_CHARGE_PUMP_FREQ; reg++)
+	{
+		uint8_t value;
+		if (reg == CS43L22_REG_OVF_CLK_STATUS || reg == CS43L22_REG_VP_BATTERY_LEVEL || reg == CS43L22_REG_SPEAKER_STATUS)
+			continue;
+		if (!CS43L22_ReadRegister(reg, &value) || value != hostHal_i2cGetRegister(reg))
+			return false;
+	}
+	return true;
+}
+
+static int reportOperations(void)
+{
+	I2cMark_t m;
+	bool ok = true;
+
+	printf("Codec operations over I2C at 100 kHz\n");
+	printf("%-24s %9s %9s %8s %8s %10s\n", "operation", "registers", "transfers", "bus ms", "wait ms",
+	       "blocking ms");
+	m = mark();
+	CS43L22_Init(&hi2c1, OUTPUT_DEVICE_SPEAKER);
+	report("CS43L22_Init", m, 17);
+	ok = ok && hostHal_i2cGetRegister(CS43L22_REG_POWER_CTL2) == 0xFA && hostHal_i2cGetRegister(CS43L22_REG_CLOCKING_CTL) == 0x80
+	        && hostHal_i2cGetRegister(CS43L22_REG_INTERFACE_CTL1) == 0x07 && hostHal_i2cGetRegister(CS43L22_REG_PASSTHR_A_SELECT) == 0x81;
+	m = mark();
+	CS43L22_SetVolume(80);
+	report("CS43L22_SetVolume", m, 4);
+	m = mark();
+	CS43L22_SetVolume(80);
+	ok = ok && report("CS43L22_SetVolume again", m, 4) == 0;
+	m = mark();
+	CS43L22_Start();
+	report("CS43L22_Start", m, 9);
+	m = mark();
+	audioI2S_pause();
+	report("audioI2S_pause", m, 5);
+	m = mark();
+	audioI2S_resume();
+	report("audioI2S_resume", m, 9);
+	m = mark();
+	CS43L22_Stop();
+	report("CS43L22_Stop", m, 5);
+	ok = ok && shadowMatches() && CS43L22_GetErrors() == 0;
+
+	// MCU reset with the codec left running: init must read what it modifies, not assume reset values
+	hostHal_i2cSetRegister(CS43L22_REG_INTERFACE_CTL1, 0x47);
+	hostHal_i2cSetRegister(CS43L22_REG_PASSTHR_A_SELECT, 0x88);
+	hostHal_i2cSetRegister(CS43L22_REG_POWER_CTL1, 0x9E);
+	m = mark();
+	CS43L22_Init(&hi2c1, OUTPUT_DEVICE_SPEAKER);
+	report("CS43L22_Init after reset", m, 17);
+	ok = ok && hostHal_i2cGetRegister(CS43L22_REG_INTERFACE_CTL1) == 0x07 && hostHal_i2cGetRegister(CS43L22_REG_PASSTHR_A_SELECT) == 0x81
+	        && hostHal_i2cGetRegister(CS43L22_REG_POWER_CTL1) == 0x01 && shadowMatches();
+	printf("Codec registers match the shadow, also after an MCU reset %s\n", ok ? "ok" : "FAIL");
+	return ok ? 0 : 1;
+}
+
+// The hidden register sequence of CS43L22_Start() goes out whole and in order, unchanged values included
+static int checkStartSequence(void)
+{
+	uint8_t bit7 = hostHal_i2cGetRegister(CONFIG_32) | 0x80, reg, value;
+	const uint8_t expect[][2] = { { CONFIG_00, 0x99 }, { CONFIG_47, 0x80 }, { CONFIG_32, bit7 },
+	                              { CONFIG_32, (uint8_t)(bit7 & ~0x80) }, { CONFIG_00, 0x00 } };
+	uint32_t index, n = 0;
+	bool ok = true;
+
+	CS43L22_Start();
+	CS43L22_Stop();
+	drain();
+	index = hostHal_i2cWriteCount();
+	CS43L22_Start();
+	drain();
+	for (uint32_t i = index; i < hostHal_i2cWriteCount() && n < 5; i++)
+	{
+		if (hostHal_i2cGetWrite(i, &reg, &value) && reg == expect[n][0])
+		{
+			ok = ok && value == expect[n][1];
+			n++;
+		}
+		else if (n != 0)
+			ok = false;			// Something else inside the sequence
+	}
+	ok = ok && n == 5;
+	printf("Start sequence sent whole and in order on a second start %s\n", ok ? "ok" : "FAIL");
+	CS43L22_Stop();
+	drain();
+	return ok ? 0 : 1;
+}
+
+// Played audio: the half of the ring the DMA has just finished, captured before its refill
+#define CAPTURE_FRAMES			16384u
+static int16_t capture[2 * CAPTURE_FRAMES];
+static uint32_t captured;
+static uint32_t dmaEvents;
+
+// One DMA event: capture the half just played, service the I2C interrupt, then let the player refill
+static void playStep(void)
+{
+	const uint32_t halfFrames = WAV_LOW_LATENCY_SLOT_FRAMES * WAV_LOW_LATENCY_SLOTS / 2u;
+	const int16_t *ring = (const int16_t *)hi2s3.pTxBuffPtr;
+
+	hostHal_i2cIrq();
+	if (!hi2s3.Paused)
+	{
+		const int16_t *half = &ring[2u * halfFrames * (dmaEvents & 1u)];
+		if (captured + halfFrames <= CAPTURE_FRAMES)
+		{
+			memcpy(&capture[2u * captured], half, halfFrames * 4u);
+			captured += halfFrames;
+		}
+		if (dmaEvents++ & 1u)
+			hostHal_i2sFullTransfer();
+		else
+			hostHal_i2sHalfTransfer();
+	}
+	wavPlayer_process();
+}
+
+// Test file: the left channel counts frames, so every played frame tells which file frame it is
+static int16_t frameValue(uint32_t frame)
+{
+	return (int16_t)(1000 + frame % 20000u);
+}
+
+static int16_t nextValue(int16_t v)
+{
+	return (v == 20999) ? 1000 : (int16_t)(v + 1);
+}
+
+// The captured left channel around a pause: full level, the fade out, silence, the fade in, then
+// full level again, every file frame exactly once. Returns the capture frame the fade in starts
+// at, 0 when the audio does not match. *silence gets the silent frames in between.
+static uint32_t checkPauseAudio(uint32_t ramp, uint32_t *silence)
+{
+	const int32_t step = (int32_t)(65536u / ramp);
+	uint32_t i = 0, fadeIn;
+	int16_t v;
+
+	while (i + 1u < captured && capture[2u * (i + 1u)] == nextValue(capture[2u * i]))
+		i++;
+	v = capture[2u * i];
+	for (uint32_t j = 0; j < ramp; j++)
+	{
+		v = nextValue(v);
+		if (++i >= captured || capture[2u * i] != (int16_t)((v * (int32_t)(ramp - 1u - j) * step) >> 16))
+			return 0;
+	}
+	fadeIn = i + 1u;
+	while (fadeIn < captured && capture[2u * fadeIn] == 0)
+		fadeIn++;
+	*silence = fadeIn - i - 1u;
+	i = fadeIn;
+	for (uint32_t j = 0; i < captured; j++, i++)
+	{
+		int32_t gain = (j + 1u >= ramp) ? 65536 : (int32_t)(j + 1u) * step;
+		v = nextValue(v);
+		if (capture[2u * i] != (int16_t)((v * gain) >> 16))
+			return 0;
+	}
+	return fadeIn;
+}
+
+// Start the test file with the low latency profile, capture from the first DMA event
+static void startCapture(void)
+{
+	wavPlayer_setProfile(WAV_PROFILE_LOW_LATENCY);
+	wavPlayer_fileSelect("codec.wav");
+	wavPlayer_play();
+	drain();
+	captured = 0;
+	dmaEvents = 0;
+}
+
+// Soft pause: the output fades out and back in without a single codec write or DMA pause, the audio
+// continues at the next file frame, and resume is heard within one ring of the call
+static int checkSoftPause(uint32_t ramp)
+{
+	const uint32_t ring = WAV_LOW_LATENCY_SLOT_FRAMES * WAV_LOW_LATENCY_SLOTS;
+	uint32_t writes, resumeAt, fadeIn, silence = 0;
+	bool ok, dmaPaused = false;
+
+	wavPlayer_setPauseIdleTimeout(WAV_PAUSE_IDLE_NEVER);
+	startCapture();
+	writes = hostHal_i2cWriteCount();
+	for (uint32_t i = 0; i < 40; i++)
+		playStep();
+	wavPlayer_pause();
+	for (uint32_t i = 0; i < 40; i++)
+	{
+		playStep();
+		dmaPaused = dmaPaused || hi2s3.Paused;
+	}
+	resumeAt = captured + ring;				// The ring holds silence already queued for the DMA
+	wavPlayer_resume();
+	for (uint32_t i = 0; i < 40; i++)
+		playStep();
+	fadeIn = checkPauseAudio(ramp, &silence);
+	ok = fadeIn != 0 && fadeIn <= resumeAt && !dmaPaused && hostHal_i2cWriteCount() == writes
+	     && wavPlayer_getLateRefills() == 0 && wavPlayer_getFifoUnderruns() == 0;
+	printf("\nSoft pause: %u-frame fades, %u silent frames, no codec writes, resume heard after %.2f ms, "
+	       "no frame lost %s\n", ramp, silence, fadeIn ? (fadeIn + ring - resumeAt) * 1000.0 / BENCH_RATE : 0.0,
+	       ok ? "ok" : "FAIL");
+	wavPlayer_stop();
+	return ok ? 0 : 1;
+}
+
+// Idle timeout: the codec powers down, the DMA pauses only after it has muted; resume powers it up
+// and the audio still continues at the next file frame. Volume changes never make the caller wait.
+static int checkIdlePowerDown(uint32_t ramp)
+{
+	uint32_t silence = 0;
+	uint64_t waitUs;
+	bool ok, pausedEarly = false;
+
+	wavPlayer_setPauseIdleTimeout(100);
+	startCapture();
+	waitUs = hostHal_i2cBlockedUs();
+	for (uint32_t i = 0; i < 40; i++)
+		playStep();
+	wavPlayer_pause();
+	for (uint32_t i = 0; i < 40; i++)
+		playStep();
+	ok = !CS43L22_IsBusy() && !hi2s3.Paused;		// Still powered while under the timeout
+	HAL_Delay(150);
+	wavPlayer_process();
+	while (CS43L22_IsBusy())
+	{
+		pausedEarly = pausedEarly || hi2s3.Paused;
+		playStep();
+	}
+	ok = ok && !pausedEarly && hi2s3.Paused && hostHal_i2cGetRegister(CS43L22_REG_POWER_CTL1) == 0x9F
+	     && hostHal_i2cGetRegister(CS43L22_REG_HEADPHONE_A_VOL) == 0x01;
+
+	wavPlayer_resume();
+	audioI2S_setVolume(60);
+	for (uint32_t i = 0; i < 64; i++)
+		playStep();
+	ok = ok && !hi2s3.Paused && !CS43L22_IsBusy() && hostHal_i2cGetRegister(CS43L22_REG_POWER_CTL1) == 0x9E
+	     && checkPauseAudio(ramp, &silence) != 0 && hostHal_i2cBlockedUs() == waitUs && wavPlayer_getLateRefills() == 0
+	     && wavPlayer_getFifoUnderruns() == 0 && CS43L22_GetErrors() == 0 && shadowMatches();
+	printf("Idle pause: codec powered down after the timeout, DMA paused after it muted, resume and volume "
+	       "without waiting (%.2f ms), no frame lost %s\n", (hostHal_i2cBlockedUs() - waitUs) / 1000.0, ok ? "ok" : "FAIL");
+	wavPlayer_stop();
+	wavPlayer_setPauseIdleTimeout(WAV_PAUSE_IDLE_MS);
+	return ok ? 0 : 1;
+}
+
+static int checkPlayback(void)
+{
+	const uint32_t frames = BENCH_SECONDS * BENCH_RATE;
+	const uint32_t slot = WAV_LOW_LATENCY_SLOT_FRAMES;
+	const uint32_t ramp = (BENCH_RATE * WAV_PAUSE_RAMP_MS / 1000u + slot - 1u) / slot * slot;	// As the player rounds it
+	uint8_t *wav = malloc(44 + frames * 4u);
+	int16_t *pcm;
+	int failures = 0;
+
+	if (!wav)
+		return 1;
+	bench_writeWavHeader(wav, BENCH_RATE, 2, 16, frames * 4u);
+	pcm = (int16_t *)(wav + 44);
+	for (uint32_t f = 0; f < frames; f++)
+	{
+		pcm[2 * f] = frameValue(f);
+		pcm[2 * f + 1] = (int16_t)-frameValue(f);
+	}
+	hostFf_addMemFile("codec.wav", wav, 44 + frames * 4u);		// Registered for good, never freed
+
+	failures += checkSoftPause(ramp);
+	failures += checkIdlePowerDown(ramp);
+	wavPlayer_setProfile(WAV_PROFILE_BALANCED);
+	return failures;
+}
+
+// A knob sweep of volume changes larger than the queue: the caller waits only for the overflow
+static void reportVolumeBurst(void)
+{
+	I2cMark_t m = mark();
+	uint32_t stalls = CS43L22_GetQueueStalls(), skipped = CS43L22_GetSkippedWrites();
+
+	for (uint32_t v = 0; v < 50; v++)
+	{
+		CS43L22_SetVolume((uint8_t)(50 + v / 2));
+	}
+	drain();
+	printf("\n50 volume changes at once: %u registers in %u transfers, %.2f ms bus (blocking driver %.2f ms), "
+	       "%u writes skipped, caller waited %.2f ms (%u queue stalls)\n",
+	       hostHal_i2cWriteCount() - m.writes, hostHal_i2cTransferCount() - m.transfers,
+	       (hostHal_i2cBusUs() - m.busUs) / 1000.0, 200 * BENCH_SINGLE_WRITE_US / 1000.0,
+	       CS43L22_GetSkippedWrites() - skipped, (hostHal_i2cBlockedUs() - m.waitUs) / 1000.0,
+	       CS43L22_GetQueueStalls() - stalls);
+}
+
+// A held bus: commands that find the queue full for CS43L22_FLUSH_TIMEOUT are dropped and counted,
+// and the volume lost with them goes out on the next change to it once the bus is back
+static int checkStuckBus(void)
+{
+	const uint8_t volRegs[] = { CS43L22_REG_PASSTHR_A_VOL, CS43L22_REG_PASSTHR_B_VOL,
+	                            CS43L22_REG_MASTER_A_VOL, CS43L22_REG_MASTER_B_VOL };
+	uint8_t target[sizeof(volRegs)];
+	uint32_t errors;
+	bool ok;
+
+	CS43L22_SetVolume(70);
+	drain();
+	for (uint32_t i = 0; i < sizeof(volRegs); i++)
+		target[i] = hostHal_i2cGetRegister(volRegs[i]);
+	CS43L22_SetVolume(60);
+	drain();
+
+	// Volume 65 takes two entries, one for each register pair, and never completes. Of the syncs
+	// after it the last two find the queue full, then each volume 70 write finds it full.
+	errors = CS43L22_GetErrors();
+	hostHal_i2cSetStuck(true);
+	CS43L22_SetVolume(65);
+	for (uint32_t i = 0; i < CS43L22_QUEUE_SIZE; i++)
+		CS43L22_Sync(NULL, NULL);
+	CS43L22_SetVolume(70);
+	ok = CS43L22_GetErrors() - errors == 2 + sizeof(volRegs);
+	printf("\nStuck bus: %u commands dropped, %u counted as errors\n", 2 + (uint32_t)sizeof(volRegs),
+	       CS43L22_GetErrors() - errors);
+	hostHal_i2cSetStuck(false);
+	drain();
+
+	CS43L22_SetVolume(70);
+	drain();
+	for (uint32_t i = 0; i < sizeof(volRegs); i++)
+		ok = ok && hostHal_i2cGetRegister(volRegs[i]) == target[i];
+	ok = ok && shadowMatches();
+	printf("Dropped volume rewritten after the bus recovers %s\n", ok ? "ok" : "FAIL");
+	return ok ? 0 : 1;
+}
+
+int main(void)
+{
+	int failures = 0;
+
+	hostHal_setPin(GPIOA, GPIO_PIN_2, GPIO_PIN_RESET);			// Echo off
+	audioI2S_setHandle(&hi2s3);
+	audioI2S_init(BENCH_RATE);
+
+	failures += reportOperations();
+	failures += checkStartSequence();
+	failures += checkPlayback();
+	reportVolumeBurst();
+	failures += checkStuckBus();
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,105 @@
+/*
+Library:				bench_common.h
+Written by:				Shridattha M Hebbar
+Date Written:			16/10/2026
+Description:			Timing and signal helpers shared by the host benchmark programs.
+*/
+
+#ifndef BENCH_COMMON_H_
+#define BENCH_COMMON_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+//Number of timed repetitions per measurement, the fastest one is reported
+#define BENCH_REPEATS		5
+//Samples processed per repetition, large enough to amortise timer overhead
+#define BENCH_SAMPLES		(1u << 22)
+
+// "--quick" on the command line: run the self-checks and skip the timing tables (the mode ctest uses)
+static inline bool bench_isQuick(int argc, char **argv)
+{
+  for(int i = 1; i < argc; i++)
+  {
+    if(strcmp(argv[i], "--quick") == 0)
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+static inline uint64_t bench_nowNs(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// CPU cycle counter where the host has one (TSC on x86), 0 elsewhere
+static inline uint64_t bench_cycles(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  return 0;
+#endif
+}
+
+// Deterministic pseudo random 16-bit audio (xorshift32), so every run sees the same data
+static inline void bench_fillNoise(int16_t *buf, uint32_t count, uint32_t seed)
+{
+  uint32_t x = seed ? seed : 0x12345678u;
+  for(uint32_t i = 0; i < count; i++)
+  {
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    buf[i] = (int16_t)(x >> 16);
+  }
+}
+
+// Canonical 44-byte PCM WAV header in front of an existing sample area
+static inline void bench_writeWavHeader(uint8_t *hdr, uint32_t sampleRate, uint16_t channels,
+                                        uint16_t bitsPerSample, uint32_t dataBytes)
+{
+  uint16_t blockAlign = (uint16_t)(channels * bitsPerSample / 8);
+  uint32_t byteRate = sampleRate * blockAlign;
+  uint32_t riffSize = 36 + dataBytes;
+  uint32_t fmtSize = 16;
+  uint16_t pcm = 1;
+
+  memcpy(hdr + 0, "RIFF", 4);
+  memcpy(hdr + 4, &riffSize, 4);
+  memcpy(hdr + 8, "WAVE", 4);
+  memcpy(hdr + 12, "fmt ", 4);
+  memcpy(hdr + 16, &fmtSize, 4);
+  memcpy(hdr + 20, &pcm, 2);
+  memcpy(hdr + 22, &channels, 2);
+  memcpy(hdr + 24, &sampleRate, 4);
+  memcpy(hdr + 28, &byteRate, 4);
+  memcpy(hdr + 32, &blockAlign, 2);
+  memcpy(hdr + 34, &bitsPerSample, 2);
+  memcpy(hdr + 36, "data", 4);
+  memcpy(hdr + 40, &dataBytes, 4);
+}
+
+static inline void bench_printRate(const char *label, uint32_t frames, uint64_t ns, uint64_t samples)
+{
+  double nsPerSample = (double)ns / (double)samples;
+  printf("%-28s %6u %10.3f %12.2f\n", label, frames, nsPerSample, 1000.0 / nsPerSample);
+}
+
+static inline void bench_printRateHeader(const char *title)
+{
+  printf("\n%s\n", title);
+  printf("%-28s %6s %10s %12s\n", "kernel", "frames", "ns/sample", "Msamples/s");
+}
+
+#endif /* BENCH_COMMON_H_ */
@@ -0,0 +1,246 @@
+/*
+Library:				bench_conv.c
+Written by:				Shridattha M Hebbar
+Date Written:			16/10/2026
+Description:			Host benchmark of partitioned FFT convolution against direct-form FIR for impulse
+						responses of 32 to 32K taps, to find where the FFT engine takes over.
+						Also checks the FFT engine output against the direct FIR, and times every
+						player sized callback of uniform and non-uniform engines for multi-second IRs.
+*/
+
+#include <math.h>
+#include <stdlib.h>
+#include "bench_common.h"
+#include "convolver.h"
+
+#define BENCH_MIN_TAPS			32		// Below the requested 256 so the crossover shows
+#define BENCH_MAX_TAPS			32768
+#define BENCH_RATE				48000
+#define BENCH_CONV_SAMPLES		(1u << 18)
+#define BENCH_LONG_TAPS			(4u * BENCH_RATE)
+#define BENCH_CALLBACKS			(BENCH_CONV_SAMPLES / CONV_PARTITION_FRAMES)
+
+static int16_t input[BENCH_CONV_SAMPLES];
+static int16_t output[BENCH_CONV_SAMPLES];
+static int16_t impulse[BENCH_LONG_TAPS];
+
+// Room-like IR: noise under an exponential decay reaching -60 dB at the last tap
+static void makeImpulse(int16_t *ir, uint32_t taps)
+{
+	bench_fillNoise(ir, taps, 5);
+	for (uint32_t i = 0; i < taps; i++)
+	{
+		ir[i] = (int16_t)(ir[i] * 0.25 * pow(10.0, -3.0 * i / taps));
+	}
+	ir[0] = 16384;
+}
+
+// Direct-form FIR, history kept twice so every output is one contiguous dot product
+static void directFir(const int16_t *ir, uint32_t taps, const int16_t *in, int16_t *out, uint32_t count)
+{
+	float *hrev = malloc(taps * sizeof(float));
+	float *hist = calloc(2 * taps, sizeof(float));
+	uint32_t w = 0;
+
+	for (uint32_t k = 0; k < taps; k++)
+	{
+		hrev[k] = ir[taps - 1 - k] / 32768.0f;
+	}
+	for (uint32_t n = 0; n < count; n++)
+	{
+		float a0 = 0.0f, a1 = 0.0f, a2 = 0.0f, a3 = 0.0f;
+		w = (w + 1 == taps) ? 0 : w + 1;
+		hist[w] = hist[w + taps] = in[n];
+		const float *x = &hist[w + 1];
+		for (uint32_t k = 0; k + 3 < taps; k += 4)
+		{
+			a0 += hrev[k] * x[k];
+			a1 += hrev[k + 1] * x[k + 1];
+			a2 += hrev[k + 2] * x[k + 2];
+			a3 += hrev[k + 3] * x[k + 3];
+		}
+		float y = (a0 + a1) + (a2 + a3);
+		out[n] = (int16_t)((y > 32767.0f) ? 32767 : (y < -32768.0f) ? -32768 : lrintf(y));
+	}
+	free(hrev);
+	free(hist);
+}
+
+// Partitioned convolution, mono, fed in player sized blocks; wet only.
+// maxSegments 1 gives a uniform engine with partitions of blockFrames.
+static CONV_HandleTypeDef *setupConv(CONV_HandleTypeDef *hconv, void **mem, const int16_t *ir,
+                                     uint32_t taps, uint32_t blockFrames, uint8_t maxSegments)
+{
+	CONV_LayoutTypeDef layout;
+
+	convolver_plan(&layout, blockFrames, taps, maxSegments);
+	*mem = malloc(convolver_layoutBytes(&layout, 1, 1));
+	convolver_initLayout(hconv, *mem, &layout, 1, 1);
+	convolver_loadIR(hconv, ir, taps);
+	convolver_commitIR(hconv);
+	convolver_setMix(hconv, 0.0f, 1.0f);
+	return hconv;
+}
+
+static double timeFir(const int16_t *ir, uint32_t taps)
+{
+	uint32_t count = (1u << 26) / taps;
+	uint64_t best = UINT64_MAX;
+
+	if (count < (1u << 14))
+		count = 1u << 14;
+	if (count > BENCH_CONV_SAMPLES)
+		count = BENCH_CONV_SAMPLES;
+	for (int r = 0; r < BENCH_REPEATS; r++)
+	{
+		uint64_t t0 = bench_nowNs();
+		directFir(ir, taps, input, output, count);
+		uint64_t dt = bench_nowNs() - t0;
+		if (dt < best)
+			best = dt;
+	}
+	return (double)best / count;
+}
+
+static double timeConv(const int16_t *ir, uint32_t taps, uint32_t blockFrames)
+{
+	CONV_HandleTypeDef hconv;
+	void *mem;
+	uint64_t best = UINT64_MAX;
+
+	setupConv(&hconv, &mem, ir, taps, blockFrames, 1);
+	for (int r = 0; r < BENCH_REPEATS; r++)
+	{
+		memcpy(output, input, sizeof(output));
+		uint64_t t0 = bench_nowNs();
+		for (uint32_t pos = 0; pos < BENCH_CONV_SAMPLES; pos += CONV_PARTITION_FRAMES)
+		{
+			convolver_process(&hconv, &output[pos], CONV_PARTITION_FRAMES);
+		}
+		uint64_t dt = bench_nowNs() - t0;
+		if (dt < best)
+			best = dt;
+	}
+	free(mem);
+	return (double)best / BENCH_CONV_SAMPLES;
+}
+
+// FFT engine against the direct FIR, after removing the engine latency
+static int checkConv(uint32_t taps, uint32_t blockFrames, uint8_t maxSegments)
+{
+	const uint32_t count = 1u << 16;
+	static int16_t fir[1u << 16];
+	CONV_HandleTypeDef hconv;
+	void *mem;
+	int maxErr = 0;
+
+	makeImpulse(impulse, taps);
+	directFir(impulse, taps, input, fir, count);
+	setupConv(&hconv, &mem, impulse, taps, blockFrames, maxSegments);
+	memcpy(output, input, count * sizeof(int16_t));
+	for (uint32_t pos = 0; pos < count; pos += 100)			// Blocks that do not line up with B
+	{
+		convolver_process(&hconv, &output[pos], (count - pos < 100) ? count - pos : 100);
+	}
+	for (uint32_t n = 0; n + blockFrames < count; n++)
+	{
+		int err = abs(output[n + blockFrames] - fir[n]);
+		if (err > maxErr)
+			maxErr = err;
+	}
+	free(mem);
+	printf("%-28s %6u taps B=%-5u segments %u max error %d LSB %s\n", "convolver vs direct FIR", taps,
+	       blockFrames, hconv.segments, maxErr, (maxErr <= 2) ? "ok" : "FAIL");
+	return maxErr <= 2 ? 0 : 1;
+}
+
+// Time of every player callback (best of the repeats per callback), mean and worst case in µs
+static void timeCallbacks(const char *label, uint32_t taps, uint32_t blockFrames, uint8_t maxSegments)
+{
+	static uint64_t best[BENCH_CALLBACKS];
+	CONV_HandleTypeDef hconv;
+	void *mem;
+	uint64_t sum = 0, worst = 0;
+
+	setupConv(&hconv, &mem, impulse, taps, blockFrames, maxSegments);
+	for (uint32_t i = 0; i < BENCH_CALLBACKS; i++)
+	{
+		best[i] = UINT64_MAX;
+	}
+	for (int r = 0; r < 3; r++)
+	{
+		convolver_clear(&hconv);
+		memcpy(output, input, sizeof(output));
+		for (uint32_t i = 0; i < BENCH_CALLBACKS; i++)
+		{
+			uint64_t t0 = bench_nowNs();
+			convolver_process(&hconv, &output[i * CONV_PARTITION_FRAMES], CONV_PARTITION_FRAMES);
+			uint64_t dt = bench_nowNs() - t0;
+			if (dt < best[i])
+				best[i] = dt;
+		}
+	}
+	for (uint32_t i = 0; i < BENCH_CALLBACKS; i++)
+	{
+		sum += best[i];
+		if (best[i] > worst)
+			worst = best[i];
+	}
+	printf("%-22s %6.2f s %9.1f ms %10.2f %10.2f %8.1f\n", label, (double)taps / BENCH_RATE,
+	       1000.0 * hconv.blockFrames / BENCH_RATE,
+	       sum / 1000.0 / BENCH_CALLBACKS, worst / 1000.0, (double)worst * BENCH_CALLBACKS / sum);
+	free(mem);
+}
+
+int main(int argc, char **argv)
+{
+	const bool quick = bench_isQuick(argc, argv);
+	int failures = 0;
+	uint32_t crossover = 0;
+
+	bench_fillNoise(input, BENCH_CONV_SAMPLES, 9);
+	for (uint32_t i = 0; i < BENCH_CONV_SAMPLES; i++)
+	{
+		input[i] /= 4;									// -12 dBFS so the IR gain does not clip
+	}
+
+	failures += checkConv(300, 128, 1);
+	failures += checkConv(4096, 128, 1);
+	failures += checkConv(5000, 1024, 1);
+	failures += checkConv(1800, 128, CONV_MAX_SEGMENTS);
+	failures += checkConv(20000, 128, CONV_MAX_SEGMENTS);
+	failures += checkConv(40000, 64, CONV_MAX_SEGMENTS);
+	if (quick)
+		return failures ? 1 : 0;
+
+	printf("\nMono convolution, ns per sample (%u Hz real time = %.0f ns/sample)\n", BENCH_RATE,
+	       1e9 / BENCH_RATE);
+	printf("%8s %10s %12s %12s %12s\n", "taps", "direct", "fft B=128", "fft B=1024", "fft B=4096");
+	for (uint32_t taps = BENCH_MIN_TAPS; taps <= BENCH_MAX_TAPS; taps *= 2)
+	{
+		makeImpulse(impulse, taps);
+		double fir = timeFir(impulse, taps);
+		double fft128 = timeConv(impulse, taps, 128);
+		double fft1k = timeConv(impulse, taps, 1024);
+		double fft4k = timeConv(impulse, taps, 4096);
+		printf("%8u %10.2f %12.2f %12.2f %12.2f\n", taps, fir, fft128, fft1k, fft4k);
+		if (!crossover && fft128 < fir)
+			crossover = taps;
+	}
+	if (crossover)
+		printf("FFT with B=128 is faster than direct FIR from %u taps\n", crossover);
+	printf("Latency: B=128 %.1f ms, B=1024 %.1f ms, B=4096 %.1f ms at %u Hz\n",
+	       128000.0 / BENCH_RATE, 1024000.0 / BENCH_RATE, 4096000.0 / BENCH_RATE, BENCH_RATE);
+
+	printf("\nPer callback of %u frames, mono (deadline %.0f us at %u Hz)\n", CONV_PARTITION_FRAMES,
+	       1e6 * CONV_PARTITION_FRAMES / BENCH_RATE, BENCH_RATE);
+	printf("%-22s %8s %12s %10s %10s %8s\n", "engine", "IR", "latency", "mean us", "max us", "max/mean");
+	makeImpulse(impulse, BENCH_LONG_TAPS);
+	for (uint32_t taps = BENCH_RATE; taps <= BENCH_LONG_TAPS; taps *= 2)
+	{
+		timeCallbacks("uniform B=128", taps, 128, 1);
+		timeCallbacks("uniform B=1024", taps, 1024, 1);
+		timeCallbacks("non-uniform 128/1K/8K", taps, 128, CONV_MAX_SEGMENTS);
+	}
+	return failures ? 1 : 0;
+}
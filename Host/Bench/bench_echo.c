@@ -0,0 +1,770 @@
+/*
+Library:				bench_echo.c
+Written by:				Shridattha M Hebbar
+Date Written:			16/10/2026
+Description:			Host benchmark for the echo kernel and the full wavPlayer_process() refill path.
+						Block sizes run from the 128-frame slot used on target up to 8K frames.
+						Also measures the delay line codecs: cost per sample and echo SNR against PCM16,
+						and checks the feedback echo mode and the gain ramps against scalar models.
+*/
+
+#include <math.h>
+#include <stdlib.h>
+#include "bench_common.h"
+#include "stm32f4xx_hal.h"
+#include "fatfs.h"
+#include "echo.h"
+#include "wav_player.h"
+#include "audioI2S.h"
+#include "audio_mem.h"
+#include "audio_event.h"
+#include "sample_codec.h"
+#include "stage_prof.h"
+#include "trace.h"
+
+#define BENCH_MIN_FRAMES		128
+#define BENCH_MAX_FRAMES		8192
+#define BENCH_CHANNELS			2
+#define BENCH_WAV_SECONDS		20
+#define BENCH_WAV_RATE			48000
+#define BENCH_LAG_HALVES		48		// DMA halves per main loop lag run, the trace holds all of them
+
+extern I2S_HandleTypeDef hi2s3;
+
+static int16_t block[BENCH_MAX_FRAMES * BENCH_CHANNELS];
+
+#define BENCH_LINE_FRAMES		24000
+
+static int16_t benchLine[BENCH_LINE_FRAMES * BENCH_CHANNELS] __attribute__((aligned(4)));
+static ECHO_HandleTypeDef benchEcho;
+
+//Tap patterns benchmarked on the multi-tap engine (stereo, delays in frames)
+static const ECHO_TapTypeDef tapsSingle[] = { { 24000, ECHO_GAIN_UNITY } };
+static const ECHO_TapTypeDef tapsMulti[] = {
+	{ 4800, 26000 }, { 9600, 20000 }, { 14400, 14000 }, { 19200, 8000 },
+};
+static const ECHO_TapTypeDef tapsRhythm[] = {
+	{ 1200, 30000 }, { 3600, -20000 }, { 6000, 18000 }, { 8400, 15000 },
+	{ 12000, 12000 }, { 15600, 9000 }, { 20400, 6000 }, { 24000, 4000 },
+};
+
+typedef void (*EchoKernel_t)(int16_t *buffer, uint32_t size);
+
+static void engineKernel(int16_t *buffer, uint32_t size)
+{
+	echo_process(&benchEcho, buffer, size);
+}
+
+// Echo kernel alone, in place over blocks of the given number of stereo frames
+static void benchKernel(const char *label, EchoKernel_t kernel, uint32_t frames)
+{
+	uint32_t samples = frames * BENCH_CHANNELS;
+	uint32_t blocks = BENCH_SAMPLES / samples;
+	uint64_t best = UINT64_MAX;
+
+	for (int r = 0; r < BENCH_REPEATS; r++)
+	{
+		uint64_t t0 = bench_nowNs();
+		for (uint32_t b = 0; b < blocks; b++)
+		{
+			kernel(block, samples);
+		}
+		uint64_t dt = bench_nowNs() - t0;
+		if (dt < best)
+			best = dt;
+	}
+	bench_printRate(label, frames, best, (uint64_t)blocks * samples);
+}
+
+static void benchEngine(const char *label, const ECHO_TapTypeDef *taps, uint8_t numTaps, uint32_t frames,
+                        ECHO_StorageTypeDef storage)
+{
+	echo_init(&benchEcho, benchLine, BENCH_LINE_FRAMES, BENCH_CHANNELS, storage);
+	echo_setTaps(&benchEcho, taps, numTaps);
+	echo_setGain(&benchEcho, 0.8f);
+	benchKernel(label, engineKernel, frames);
+}
+
+// Engine against the scalar reference documented in echo.h, over several delay line wraps.
+// Compressed storage is checked against the same reference on the codec round trip of x.
+static int checkReference(const char *label, const ECHO_TapTypeDef *taps, uint8_t numTaps,
+                          ECHO_StorageTypeDef storage)
+{
+	static int16_t input[3 * BENCH_LINE_FRAMES * BENCH_CHANNELS + 1000];
+	static int16_t output[sizeof(input) / sizeof(input[0])];
+	static int16_t stored[sizeof(input) / sizeof(input[0])];
+	const uint32_t total = sizeof(input) / sizeof(input[0]);
+	const float gains[] = { 0.0f, 0.25f, 0.8f, 1.0f };
+	ADPCM_StateTypeDef enc[BENCH_CHANNELS] = { { 0, 0 } }, dec[BENCH_CHANNELS] = { { 0, 0 } };
+	int failures = 0;
+
+	bench_fillNoise(input, total, 3);
+	for (uint32_t i = 0; i < 64; i++)
+	{
+		input[i * 997] = (i & 1) ? 32767 : -32768;		// Full scale extremes
+	}
+	for (uint32_t i = 0; i < total; i++)
+	{
+		if (storage == ECHO_STORAGE_MULAW)
+			stored[i] = mulaw_decode(mulaw_encode(input[i]));
+		else if (storage == ECHO_STORAGE_ADPCM)
+			stored[i] = adpcm_decode(&dec[i % BENCH_CHANNELS], adpcm_encode(&enc[i % BENCH_CHANNELS], input[i]));
+		else
+			stored[i] = input[i];
+	}
+
+	for (uint32_t g = 0; g < sizeof(gains) / sizeof(gains[0]) && !failures; g++)
+	{
+		uint32_t pos = 0, step = 1;
+		int32_t master = echo_gainQ15(gains[g]);
+
+		echo_init(&benchEcho, benchLine, BENCH_LINE_FRAMES, BENCH_CHANNELS, storage);
+		echo_setTaps(&benchEcho, taps, numTaps);
+		echo_setGain(&benchEcho, gains[g]);
+		memcpy(output, input, sizeof(input));
+		// Varying whole-frame block sizes so spans split at every kind of wrap point
+		while (pos < total)
+		{
+			uint32_t n = (total - pos < step * BENCH_CHANNELS) ? total - pos : step * BENCH_CHANNELS;
+			echo_process(&benchEcho, &output[pos], n);
+			pos += n;
+			step = (step * 7 + 3) % 1500 + 1;
+		}
+		for (uint32_t i = 0; i < total; i++)
+		{
+			int32_t y = input[i];
+			for (uint8_t k = 0; k < numTaps; k++)
+			{
+				int32_t gk = (taps[k].gain * master) >> 15;
+				uint32_t delay = taps[k].delay * BENCH_CHANNELS;
+				int32_t d = (i >= delay) ? stored[i - delay] : 0;
+				y += (d * gk) >> 15;
+			}
+			y = (y > 32767) ? 32767 : (y < -32768) ? -32768 : y;
+			if (output[i] != (int16_t)y)
+			{
+				printf("%s mismatch: gain %.2f sample %u got %d expected %d\n",
+				       label, (double)gains[g], i, output[i], (int)y);
+				failures++;
+				break;
+			}
+		}
+	}
+	printf("%-28s %s\n", label, failures ? "FAIL" : "bit-exact");
+	return failures;
+}
+
+// Feedback mode against a scalar model of the loop in echo.h, µ-law lines recirculate the coded output
+static int checkFeedback(const char *label, const ECHO_TapTypeDef *taps, uint8_t numTaps,
+                         ECHO_StorageTypeDef storage, float damping)
+{
+	static int16_t input[3 * BENCH_LINE_FRAMES * BENCH_CHANNELS + 1000];
+	static int16_t output[sizeof(input) / sizeof(input[0])];
+	static int16_t stored[sizeof(input) / sizeof(input[0])];
+	const uint32_t total = sizeof(input) / sizeof(input[0]);
+	const float gains[] = { 0.25f, 0.8f, 1.0f };
+	const int32_t coeff = ECHO_GAIN_UNITY - echo_gainQ15(damping);
+	int failures = 0;
+
+	bench_fillNoise(input, total, 4);
+	for (uint32_t g = 0; g < sizeof(gains) / sizeof(gains[0]) && !failures; g++)
+	{
+		uint32_t pos = 0, step = 1;
+		int32_t master = echo_gainQ15(gains[g]);
+		int32_t gk[ECHO_MAX_TAPS], loop = 0, l[BENCH_CHANNELS] = { 0 };
+
+		echo_init(&benchEcho, benchLine, BENCH_LINE_FRAMES, BENCH_CHANNELS, storage);
+		echo_setTaps(&benchEcho, taps, numTaps);
+		echo_setGain(&benchEcho, gains[g]);
+		echo_setMode(&benchEcho, ECHO_MODE_FEEDBACK);
+		echo_setDamping(&benchEcho, damping);
+		memcpy(output, input, sizeof(input));
+		while (pos < total)
+		{
+			uint32_t n = (total - pos < step * BENCH_CHANNELS) ? total - pos : step * BENCH_CHANNELS;
+			echo_process(&benchEcho, &output[pos], n);
+			pos += n;
+			step = (step * 7 + 3) % 1500 + 1;
+		}
+		for (uint8_t k = 0; k < numTaps; k++)
+		{
+			gk[k] = (taps[k].gain * master) >> 15;
+			loop += abs(gk[k]);
+		}
+		for (uint8_t k = 0; k < numTaps && loop > ECHO_FEEDBACK_MAX; k++)
+		{
+			gk[k] = gk[k] * ECHO_FEEDBACK_MAX / loop;
+		}
+		for (uint32_t i = 0; i < total; i++)
+		{
+			int32_t v = 0, *lc = &l[i % BENCH_CHANNELS];
+			for (uint8_t k = 0; k < numTaps; k++)
+			{
+				uint32_t delay = taps[k].delay * BENCH_CHANNELS;
+				int32_t d = (i >= delay) ? stored[i - delay] : 0;
+				v += (d * gk[k]) >> 15;
+			}
+			*lc += ((v - *lc) * coeff) >> 15;
+			int32_t y = input[i] + *lc;
+			y = (y > 32767) ? 32767 : (y < -32768) ? -32768 : y;
+			stored[i] = (storage == ECHO_STORAGE_MULAW) ? mulaw_decode(mulaw_encode((int16_t)y)) : (int16_t)y;
+			if (output[i] != (int16_t)y)
+			{
+				printf("%s mismatch: gain %.2f sample %u got %d expected %d\n",
+				       label, (double)gains[g], i, output[i], (int)y);
+				failures++;
+				break;
+			}
+		}
+	}
+	printf("%-28s %s\n", label, failures ? "FAIL" : "bit-exact");
+	return failures;
+}
+
+// Gain ramps (echo_rampGain on most blocks) against the ramp model in echo.h, feedback without damping
+static int checkRamp(const char *label, const ECHO_TapTypeDef *taps, uint8_t numTaps, ECHO_ModeTypeDef mode)
+{
+	static int16_t input[3 * BENCH_LINE_FRAMES * BENCH_CHANNELS];
+	static int16_t output[sizeof(input) / sizeof(input[0])];
+	static int16_t stored[sizeof(input) / sizeof(input[0])];
+	const uint32_t total = sizeof(input) / sizeof(input[0]);
+	const uint32_t size = 120 * BENCH_CHANNELS;				// Divides total, not a power of two
+	const float gains[] = { 0.2f, 0.9f, 0.9f, 0.5f, 1.0f, 1.0f, 0.0f };
+	const bool feedback = (mode == ECHO_MODE_FEEDBACK);
+	int32_t master = echo_gainQ15(gains[0]);
+	uint32_t blockIndex = 0;
+
+	bench_fillNoise(input, total, 6);
+	echo_init(&benchEcho, benchLine, BENCH_LINE_FRAMES, BENCH_CHANNELS, ECHO_STORAGE_PCM16);
+	echo_setTaps(&benchEcho, taps, numTaps);
+	echo_setGain(&benchEcho, gains[0]);
+	echo_setMode(&benchEcho, mode);
+	memcpy(output, input, sizeof(input));
+	for (uint32_t pos = 0; pos < total; pos += size, blockIndex++)
+	{
+		int32_t target = echo_gainQ15(gains[blockIndex % (sizeof(gains) / sizeof(gains[0]))]);
+		int32_t gk[ECHO_MAX_TAPS], loop = 0, limit = 32767;
+		int32_t ramp = master << 15, step = (target - master) * 32768 / (int32_t)size;
+		bool ramping = (target != master);
+
+		echo_rampGain(&benchEcho, gains[blockIndex % (sizeof(gains) / sizeof(gains[0]))]);
+		echo_process(&benchEcho, &output[pos], size);
+		for (uint8_t k = 0; k < numTaps; k++)
+		{
+			gk[k] = ramping ? ((taps[k].gain > 32767) ? 32767 : taps[k].gain) : (taps[k].gain * master) >> 15;
+			loop += abs(gk[k]);
+		}
+		if (feedback && loop > ECHO_FEEDBACK_MAX)
+		{
+			if (ramping)
+				limit = (ECHO_FEEDBACK_MAX << 15) / loop;
+			else
+				for (uint8_t k = 0; k < numTaps; k++) gk[k] = gk[k] * ECHO_FEEDBACK_MAX / loop;
+		}
+		for (uint32_t i = pos; i < pos + size; i++)
+		{
+			int32_t v = 0, y;
+			for (uint8_t k = 0; k < numTaps; k++)
+			{
+				uint32_t delay = taps[k].delay * BENCH_CHANNELS;
+				int32_t d = (i >= delay) ? stored[i - delay] : 0;
+				v += (d * gk[k]) >> 15;
+			}
+			if (ramping)
+			{
+				ramp += step;
+				int32_t g = ((ramp >> 15) > limit) ? limit : ramp >> 15;
+				v = (int32_t)(((int64_t)v * g) >> 15);
+			}
+			y = input[i] + v;
+			y = (y > 32767) ? 32767 : (y < -32768) ? -32768 : y;
+			stored[i] = feedback ? (int16_t)y : input[i];
+			if (output[i] != (int16_t)y)
+			{
+				printf("%s mismatch: block %u sample %u got %d expected %d\n", label, blockIndex, i, output[i], (int)y);
+				printf("%-28s FAIL\n", label);
+				return 1;
+			}
+		}
+		master = target;
+	}
+	printf("%-28s %s\n", label, "bit-exact");
+	return 0;
+}
+
+static void benchFeedback(const char *label, const ECHO_TapTypeDef *taps, uint8_t numTaps, uint32_t frames)
+{
+	echo_init(&benchEcho, benchLine, BENCH_LINE_FRAMES, BENCH_CHANNELS, ECHO_STORAGE_PCM16);
+	echo_setTaps(&benchEcho, taps, numTaps);
+	echo_setGain(&benchEcho, 0.8f);
+	echo_setMode(&benchEcho, ECHO_MODE_FEEDBACK);
+	echo_setDamping(&benchEcho, ECHO_DAMPING_DEFAULT);
+	benchKernel(label, engineKernel, frames);
+}
+
+// Peak of every repeat of a click through a 100 ms feedback loop at full echoDecayFactor
+static void reportFeedbackDecay(void)
+{
+	static int16_t buf[BENCH_WAV_RATE / 10 * BENCH_CHANNELS];
+	const ECHO_TapTypeDef tap = { BENCH_WAV_RATE / 10, ECHO_GAIN_UNITY };
+	const float dampings[] = { 0.0f, ECHO_DAMPING_DEFAULT, 0.7f };
+
+	printf("\nFeedback echo, peak of each repeat of a full scale click (gain 1.0, 100 ms loop)\n");
+	printf("%-8s", "damping");
+	for (int r = 1; r <= 8; r++)
+	{
+		printf(" %7d", r);
+	}
+	printf(" %7s\n", "r40");
+	for (uint32_t d = 0; d < sizeof(dampings) / sizeof(dampings[0]); d++)
+	{
+		echo_init(&benchEcho, benchLine, BENCH_LINE_FRAMES, BENCH_CHANNELS, ECHO_STORAGE_PCM16);
+		echo_setTaps(&benchEcho, &tap, 1);
+		echo_setGain(&benchEcho, 1.0f);
+		echo_setMode(&benchEcho, ECHO_MODE_FEEDBACK);
+		echo_setDamping(&benchEcho, dampings[d]);
+		printf("%-8.2f", (double)dampings[d]);
+		for (int r = 0; r <= 40; r++)
+		{
+			int32_t peak = 0;
+			memset(buf, 0, sizeof(buf));
+			if (r == 0)
+				buf[0] = buf[1] = 32767;
+			echo_process(&benchEcho, buf, sizeof(buf) / sizeof(buf[0]));
+			for (uint32_t i = 0; i < sizeof(buf) / sizeof(buf[0]); i++)
+			{
+				if (abs(buf[i]) > peak)
+					peak = abs(buf[i]);
+			}
+			if ((r >= 1 && r <= 8) || r == 40)
+				printf(" %7d", (int)peak);
+		}
+		printf("\n");
+	}
+}
+
+// Whole player refill path per buffering profile: simulated DMA callbacks, f_read stand-in and echo
+static void benchPlayer(const char *label, WAV_ProfileTypeDef profile, uint32_t slotFrames, uint32_t slots)
+{
+	const uint32_t dataBytes = BENCH_WAV_SECONDS * BENCH_WAV_RATE * BENCH_CHANNELS * sizeof(int16_t);
+	static uint8_t *wav = NULL;						// Registered once, shared by every profile
+	uint64_t best = UINT64_MAX;
+	uint32_t events = 0, reads = 0;
+
+	if (!wav)
+	{
+		wav = malloc(44 + dataBytes);
+		if (!wav)
+			return;
+		bench_writeWavHeader(wav, BENCH_WAV_RATE, BENCH_CHANNELS, 16, dataBytes);
+		bench_fillNoise((int16_t*)(wav + 44), dataBytes / 2, 7);
+		hostFf_addMemFile("bench.wav", wav, 44 + dataBytes);
+	}
+	hostHal_setPin(GPIOA, GPIO_PIN_2, GPIO_PIN_SET);		// Echo switch on
+	audioI2S_setHandle(&hi2s3);
+	wavPlayer_setProfile(profile);
+
+	for (int r = 0; r < BENCH_REPEATS; r++)
+	{
+		events = 0;
+		reads = hostFf_readCount();
+		wavPlayer_fileSelect("bench.wav");
+		wavPlayer_play();
+		uint64_t t0 = bench_nowNs();
+		while (!wavPlayer_isFinished())
+		{
+			if ((events & 255) == 0)
+				hostHal_setAdcValue(events * 7u);			// Knob turned during playback: gain ramps
+			if (events++ & 1)
+				hostHal_i2sFullTransfer();
+			else
+				hostHal_i2sHalfTransfer();
+			wavPlayer_process();
+			wavPlayer_process();		// Main loop spins at least once between DMA events
+		}
+		uint64_t dt = bench_nowNs() - t0;
+		if (dt < best)
+			best = dt;
+		reads = hostFf_readCount() - reads;
+	}
+	printf("%-18s %6u x %-4u %9.2f %9.2f %10.1f %10.3f %6u\n", label, slots, slotFrames,
+	       1000.0 * slots * slotFrames / BENCH_WAV_RATE, 500.0 * slots * slotFrames / BENCH_WAV_RATE,
+	       (double)reads / BENCH_WAV_SECONDS, (double)best / (dataBytes / 2), wavPlayer_getFifoUnderruns());
+	wavPlayer_setProfile(WAV_PROFILE_BALANCED);
+}
+
+// Stage probes over one playback of bench.wav (registered by benchPlayer): time per stage and refill slack
+static int reportStageProfile(void)
+{
+	const double usPerTick = 1e6 / stageProf_tickHz();
+	STAGE_PROF_StatsTypeDef st, refill;
+	STAGE_PROF_SlackTypeDef slack;
+	uint32_t period;
+	bool ok;
+
+	wavPlayer_fileSelect("bench.wav");
+	wavPlayer_play();
+	stageProf_reset();
+	for (uint32_t events = 0; !wavPlayer_isFinished(); events++)
+	{
+		if (events & 1)
+			hostHal_i2sFullTransfer();
+		else
+			hostHal_i2sHalfTransfer();
+		wavPlayer_process();
+		wavPlayer_process();
+	}
+	period = stageProf_getSlotPeriod();
+	printf("\nStage probes per playback (balanced profile, slot of %.1f us, host clock)\n", period * usPerTick);
+	printf("%-14s %8s %9s %9s %9s %8s\n", "stage", "count", "min us", "mean us", "max us", "% slot");
+	ok = stageProf_getStage(STAGE_PROF_REFILL, &refill) && stageProf_getSlack(&slack) && refill.count > 0;
+	for (uint32_t s = 0; ok && s < STAGE_PROF_COUNT; s++)
+	{
+		double mean;
+
+		stageProf_getStage((STAGE_PROF_StageTypeDef)s, &st);
+		mean = st.count ? (double)st.total / st.count : 0.0;
+		printf("%-14s %8u %9.2f %9.2f %9.2f %8.2f\n", stageProf_stageName((STAGE_PROF_StageTypeDef)s), st.count,
+		       st.count ? st.min * usPerTick : 0.0, mean * usPerTick, st.max * usPerTick, 100.0 * mean / period);
+		if (s != STAGE_PROF_PAUSE_RAMP)
+			ok = st.count > 0 && st.min <= mean && mean <= st.max;
+	}
+	ok = ok && slack.count == refill.count;
+	printf("slack: window %.1f us, min %.1f us, mean %.1f us, %u of %u refills late, histogram (late, 1/8 window steps):",
+	       slack.window * usPerTick, slack.min * usPerTick, slack.count ? (double)slack.total / slack.count * usPerTick
+	       : 0.0, slack.late, slack.count);
+	for (uint32_t b = 0; b < STAGE_PROF_SLACK_BINS; b++)
+		printf(" %u", slack.hist[b]);
+	printf(" %s\n", ok ? "ok" : "FAIL");
+	return ok ? 0 : 1;
+}
+
+// File system work of one playback of bench.wav (registered by benchPlayer): at open and per second
+static void reportFileAccess(UINT fragments)
+{
+	uint32_t openLookups, lookups, window, reads;
+	bool mapped;
+
+	hostFf_setFragments(fragments);
+	openLookups = hostFf_fatLookups();
+	wavPlayer_fileSelect("bench.wav");
+	mapped = wavPlayer_isFastSeek();
+	openLookups = hostFf_fatLookups() - openLookups;
+	lookups = hostFf_fatLookups();
+	window = hostFf_windowBytes();
+	reads = hostFf_readCount();
+	wavPlayer_play();
+	for (uint32_t events = 0; !wavPlayer_isFinished(); events++)
+	{
+		if (events & 1)
+			hostHal_i2sFullTransfer();
+		else
+			hostHal_i2sHalfTransfer();
+		wavPlayer_process();
+	}
+	lookups = hostFf_fatLookups() - lookups;
+	window = hostFf_windowBytes() - window;
+	reads = hostFf_readCount() - reads;
+	printf("%9u %9s %10u %10.1f %10.1f %12.1f\n", fragments, mapped ? "yes" : "no", openLookups,
+	       (double)reads / BENCH_WAV_SECONDS, (double)lookups / BENCH_WAV_SECONDS,
+	       (double)window / BENCH_WAV_SECONDS);
+	hostFf_setFragments(1);
+}
+
+// Main loop falling behind the DMA: every half must still be refilled once, in order
+static int reportLateRefills(void)
+{
+	const WAV_ProfileTypeDef profiles[] = { WAV_PROFILE_BALANCED, WAV_PROFILE_LOW_LATENCY };
+	const char *const names[] = { "balanced", "low latency" };
+	const uint32_t slotCounts[] = { WAV_BALANCED_SLOTS, WAV_LOW_LATENCY_SLOTS };
+	const uint32_t lags[] = { 1, 2, 4, AUDIO_EVENT_QUEUE_SIZE, AUDIO_EVENT_QUEUE_SIZE + 4 };
+	const uint32_t dataBytes = 2 * BENCH_WAV_RATE * BENCH_CHANNELS * sizeof(int16_t);
+	uint8_t *wav = malloc(44 + dataBytes);
+	int failures = 0;
+
+	if (!wav)
+		return 1;
+	bench_writeWavHeader(wav, BENCH_WAV_RATE, BENCH_CHANNELS, 16, dataBytes);
+	bench_fillNoise((int16_t*)(wav + 44), dataBytes / 2, 8);
+	hostFf_addMemFile("late.wav", wav, 44 + dataBytes);
+
+	printf("\nMain loop lag (DMA halves per wavPlayer_process call, event queue of %u, %u halves per run)\n",
+	       AUDIO_EVENT_QUEUE_SIZE, BENCH_LAG_HALVES);
+	printf("%-12s %4s %8s %8s %8s %8s %9s %8s\n", "profile", "lag", "freed", "refills", "late", "expected",
+	       "overruns", "expected");
+	for (uint32_t p = 0; p < sizeof(profiles) / sizeof(profiles[0]); p++)
+	{
+		wavPlayer_setProfile(profiles[p]);
+		for (uint32_t l = 0; l < sizeof(lags) / sizeof(lags[0]); l++)
+		{
+			static uint8_t pending[2 * BENCH_LAG_HALVES * WAV_RING_MAX_SLOTS];
+			const uint32_t lag = lags[l];
+			const uint32_t perHalf = slotCounts[p] / 2u;
+			const uint32_t calls = (BENCH_LAG_HALVES + lag - 1u) / lag;
+			const uint32_t batch = lag * perHalf;
+			// Each call serves one batch: every half but the last was followed by another before it was served
+			const bool drops = batch > AUDIO_EVENT_QUEUE_SIZE;
+			const uint32_t lateExpected = calls * (lag - 1u) * perHalf;
+			const uint32_t overrunsExpected = drops ? calls * (batch - AUDIO_EVENT_QUEUE_SIZE) : 0u;
+			uint32_t head = 0, tail = 0, freed = 0, refills = 0, order = 0;
+			char expected[12] = "-";					// Not modelled once events are dropped
+			bool ok;
+
+			wavPlayer_fileSelect("late.wav");
+			wavPlayer_play();
+			trace_init();
+			for (uint32_t c = 0, events = 0; c < calls; c++)
+			{
+				for (uint32_t e = 0; e < lag; e++)
+				{
+					if (events++ & 1)
+						hostHal_i2sFullTransfer();
+					else
+						hostHal_i2sHalfTransfer();
+				}
+				wavPlayer_process();
+				wavPlayer_process();
+			}
+
+			// Walk the trace: slots are freed per half in DMA order, every freed slot is refilled once, in order
+			for (uint32_t i = 0; i < trace_getCount() && i < TRACE_RECORDS; i++)
+			{
+				const uint32_t ev = traceBuffer.ring[i].event;
+				const uint32_t arg = ev & TRACE_ARG_MASK;
+
+				switch (ev >> 24)
+				{
+				case TRACE_EV_DMA_HALF:
+					for (uint32_t s = 0; s < perHalf; s++)
+						pending[tail++] = (uint8_t)(arg * perHalf + s);
+					freed += perHalf;
+					break;
+				case TRACE_EV_EVENT_OVERRUN:
+					tail--;								// Traced right after its failed push
+					break;
+				case TRACE_EV_REFILL_START:
+					order += (head < tail && pending[head] == arg) ? 0u : 1u;
+					head++;
+					refills++;
+					break;
+				default:
+					break;
+				}
+			}
+			ok = trace_getCount() < TRACE_RECORDS && order == 0 && head == tail
+			  && refills == freed - wavPlayer_getOverruns() && wavPlayer_getOverruns() == overrunsExpected
+			  && (drops || wavPlayer_getLateRefills() == lateExpected);
+			wavPlayer_stop();
+			if (!drops)
+				snprintf(expected, sizeof(expected), "%u", lateExpected);
+			printf("%-12s %4u %8u %8u %8u %8s %9u %8u %s\n", names[p], lag, freed, refills,
+			       wavPlayer_getLateRefills(), expected, wavPlayer_getOverruns(), overrunsExpected, ok ? "ok" : "FAIL");
+			failures += ok ? 0 : 1;
+		}
+	}
+	wavPlayer_setProfile(WAV_PROFILE_BALANCED);
+	free(wav);
+	return failures;
+}
+
+static const char *const storageNames[] = { "pcm16", "mulaw", "adpcm" };
+
+// Delay line reserved at file select for common stream formats
+static void reportDelayLines(void)
+{
+	const uint32_t rates[] = { 8000, 22050, 44100, 48000, 96000 };
+
+	printf("\nEcho delay line for %u ms (pool %u bytes)\n", ECHO_DELAY_MS, AUDIO_MEM_POOL_SIZE);
+	printf("%-8s %-10s %8s %10s %10s\n", "storage", "rate", "channels", "bytes", "delay ms");
+	for (int st = ECHO_STORAGE_PCM16; st <= ECHO_STORAGE_ADPCM; st++)
+	{
+		for (uint32_t r = 0; r < sizeof(rates) / sizeof(rates[0]); r++)
+		{
+			for (uint16_t ch = 1; ch <= 2; ch++)
+			{
+				audioMem_reset();
+				uint32_t bytes = echo_configure(rates[r], ch, ECHO_DELAY_MS, (ECHO_StorageTypeDef)st);
+				ECHO_HandleTypeDef *hecho = echo_getDefault();
+				printf("%-8s %-10u %8u %10u %10.1f\n", storageNames[st], rates[r], ch, bytes,
+				       1000.0 * hecho->frames / rates[r]);
+			}
+		}
+	}
+}
+
+// Encode and decode cost of the delay line codecs, per sample
+static void benchCodecs(void)
+{
+	static uint8_t codes[BENCH_MAX_FRAMES * BENCH_CHANNELS];
+	const uint32_t samples = BENCH_MAX_FRAMES * BENCH_CHANNELS;
+	const uint32_t blocks = BENCH_SAMPLES / samples;
+	volatile uint32_t sink = 0;
+
+	printf("\nDelay line codecs (%u samples per pass)\n", samples);
+	printf("%-28s %10s %12s\n", "codec", "ns/sample", "cycles/sample");
+	for (int op = 0; op < 4; op++)
+	{
+		const char *labels[] = { "mulaw_encode", "mulaw_decode", "adpcm_encode", "adpcm_decode" };
+		uint64_t bestNs = UINT64_MAX, bestCycles = UINT64_MAX;
+
+		for (int r = 0; r < BENCH_REPEATS; r++)
+		{
+			ADPCM_StateTypeDef state = { 0, 0 };
+			uint32_t acc = 0;							// Wraps, it only keeps the decode from being optimised out
+			uint64_t t0 = bench_nowNs(), c0 = bench_cycles();
+			for (uint32_t b = 0; b < blocks; b++)
+			{
+				switch (op)
+				{
+				case 0:
+					for (uint32_t i = 0; i < samples; i++) codes[i] = mulaw_encode(block[i]);
+					break;
+				case 1:
+					for (uint32_t i = 0; i < samples; i++) acc += (uint32_t)mulaw_decode(codes[i]);
+					break;
+				case 2:
+					for (uint32_t i = 0; i < samples; i++) codes[i] = adpcm_encode(&state, block[i]);
+					break;
+				default:
+					for (uint32_t i = 0; i < samples; i++) acc += (uint32_t)adpcm_decode(&state, codes[i]);
+					break;
+				}
+			}
+			uint64_t dc = bench_cycles() - c0, dt = bench_nowNs() - t0;
+			sink += acc;
+			if (dt < bestNs)
+				bestNs = dt;
+			if (dc < bestCycles)
+				bestCycles = dc;
+		}
+		double n = (double)blocks * samples;
+		printf("%-28s %10.3f %12.2f\n", labels[op], bestNs / n, bestCycles / n);
+	}
+	(void)sink;
+}
+
+// Wet signal error of the compressed delay lines against PCM16, on tones plus noise near -12 dBFS
+static void reportStorageSnr(void)
+{
+	static int16_t input[2 * BENCH_LINE_FRAMES * BENCH_CHANNELS];
+	static int16_t ref[sizeof(input) / sizeof(input[0])];
+	static int16_t out[sizeof(input) / sizeof(input[0])];
+	const uint32_t total = sizeof(input) / sizeof(input[0]);
+	const uint32_t start = BENCH_LINE_FRAMES * BENCH_CHANNELS;		// Only samples with an echo
+	const ECHO_TapTypeDef tap = { BENCH_LINE_FRAMES, ECHO_GAIN_UNITY };
+
+	bench_fillNoise(input, total, 11);
+	for (uint32_t i = 0; i < total; i++)
+	{
+		double t = (double)(i / BENCH_CHANNELS) / BENCH_WAV_RATE;
+		double tone = 5000.0 * sin(2.0 * M_PI * 440.0 * t) + 3000.0 * sin(2.0 * M_PI * 3100.0 * t);
+		input[i] = (int16_t)(tone + input[i] / 32);
+	}
+
+	printf("\nCompressed delay line, echo error vs pcm16 (1 tap, unity gain)\n");
+	printf("%-8s %10s %10s\n", "storage", "bytes", "SNR dB");
+	for (int st = ECHO_STORAGE_PCM16; st <= ECHO_STORAGE_ADPCM; st++)
+	{
+		double signal = 0.0, noise = 0.0;
+		int16_t *dst = (st == ECHO_STORAGE_PCM16) ? ref : out;
+
+		echo_init(&benchEcho, benchLine, BENCH_LINE_FRAMES, BENCH_CHANNELS, (ECHO_StorageTypeDef)st);
+		echo_setTaps(&benchEcho, &tap, 1);
+		echo_setGain(&benchEcho, 1.0f);
+		memcpy(dst, input, sizeof(input));
+		for (uint32_t pos = 0; pos < total; pos += BENCH_MIN_FRAMES * BENCH_CHANNELS)
+		{
+			echo_process(&benchEcho, &dst[pos], BENCH_MIN_FRAMES * BENCH_CHANNELS);
+		}
+		for (uint32_t i = start; i < total; i++)
+		{
+			double wet = ref[i] - input[i];
+			double err = (double)dst[i] - ref[i];
+			signal += wet * wet;
+			noise += err * err;
+		}
+		if (noise == 0.0)
+			printf("%-8s %10u %10s\n", storageNames[st], echo_lineBytes(BENCH_LINE_FRAMES, BENCH_CHANNELS,
+			       (ECHO_StorageTypeDef)st), "exact");
+		else
+			printf("%-8s %10u %10.1f\n", storageNames[st], echo_lineBytes(BENCH_LINE_FRAMES, BENCH_CHANNELS,
+			       (ECHO_StorageTypeDef)st), 10.0 * log10(signal / noise));
+	}
+}
+
+int main(int argc, char **argv)
+{
+	const bool quick = bench_isQuick(argc, argv);
+	int failures = 0;
+
+	printf("Engine vs Q15 reference\n");
+	failures += checkReference("1 tap", tapsSingle, 1, ECHO_STORAGE_PCM16);
+	failures += checkReference("4 taps", tapsMulti, 4, ECHO_STORAGE_PCM16);
+	failures += checkReference("8 taps", tapsRhythm, 8, ECHO_STORAGE_PCM16);
+	failures += checkReference("8 taps mulaw", tapsRhythm, 8, ECHO_STORAGE_MULAW);
+	failures += checkReference("1 tap adpcm", tapsSingle, 1, ECHO_STORAGE_ADPCM);
+	failures += checkReference("8 taps adpcm", tapsRhythm, 8, ECHO_STORAGE_ADPCM);
+	failures += checkFeedback("feedback 1 tap", tapsSingle, 1, ECHO_STORAGE_PCM16, 0.0f);
+	failures += checkFeedback("feedback 1 tap damped", tapsSingle, 1, ECHO_STORAGE_PCM16, ECHO_DAMPING_DEFAULT);
+	failures += checkFeedback("feedback 8 taps damped", tapsRhythm, 8, ECHO_STORAGE_PCM16, 0.5f);
+	failures += checkFeedback("feedback 1 tap mulaw", tapsSingle, 1, ECHO_STORAGE_MULAW, ECHO_DAMPING_DEFAULT);
+	failures += checkRamp("gain ramp 4 taps", tapsMulti, 4, ECHO_MODE_FIR);
+	failures += checkRamp("gain ramp feedback 8 taps", tapsRhythm, 8, ECHO_MODE_FEEDBACK);
+
+	echoDecayFactor = 0.8f;
+	bench_fillNoise(block, BENCH_MAX_FRAMES * BENCH_CHANNELS, 1);
+	audioMem_reset();
+	echo_configure(BENCH_WAV_RATE, BENCH_CHANNELS, 500, ECHO_STORAGE_PCM16);	// Line used by applyEchoFloat
+
+	if (!quick)
+	{
+		bench_printRateHeader("Echo kernel (stereo, in place)");
+		for (uint32_t frames = BENCH_MIN_FRAMES; frames <= BENCH_MAX_FRAMES; frames *= 2)
+		{
+			benchKernel("applyEchoFloat", applyEchoFloat, frames);
+			benchEngine("echo_process 1 tap", tapsSingle, 1, frames, ECHO_STORAGE_PCM16);
+			benchEngine("echo_process 4 taps", tapsMulti, 4, frames, ECHO_STORAGE_PCM16);
+			benchEngine("echo_process 8 taps", tapsRhythm, 8, frames, ECHO_STORAGE_PCM16);
+			benchFeedback("echo_process feedback", tapsSingle, 1, frames);
+		}
+
+		bench_printRateHeader("Echo engine per delay line storage (1 tap, stereo, in place)");
+		for (uint32_t frames = BENCH_MIN_FRAMES; frames <= BENCH_MAX_FRAMES; frames *= 8)
+		{
+			benchEngine("echo_process pcm16", tapsSingle, 1, frames, ECHO_STORAGE_PCM16);
+			benchEngine("echo_process mulaw", tapsSingle, 1, frames, ECHO_STORAGE_MULAW);
+			benchEngine("echo_process adpcm", tapsSingle, 1, frames, ECHO_STORAGE_ADPCM);
+			benchEngine("echo_process adpcm 8 taps", tapsRhythm, 8, frames, ECHO_STORAGE_ADPCM);
+		}
+		benchCodecs();
+		reportStorageSnr();
+		reportFeedbackDecay();
+	}
+
+	printf("\nPlayer refill path per buffering profile (%u Hz stereo, echo on, %u KB read-ahead FIFO)\n",
+	       BENCH_WAV_RATE, WAV_FIFO_BYTES / 1024);
+	printf("%-18s %13s %9s %9s %10s %10s %6s\n", "profile", "slots", "ring ms", "margin ms", "f_read/s",
+	       "ns/sample", "underruns");
+	if (!quick)
+		benchPlayer("low latency", WAV_PROFILE_LOW_LATENCY, WAV_LOW_LATENCY_SLOT_FRAMES, WAV_LOW_LATENCY_SLOTS);
+	benchPlayer("balanced", WAV_PROFILE_BALANCED, WAV_BALANCED_SLOT_FRAMES, WAV_BALANCED_SLOTS);	// Registers bench.wav
+	if (!quick)
+		benchPlayer("throughput", WAV_PROFILE_THROUGHPUT, WAV_THROUGHPUT_SLOT_FRAMES, WAV_THROUGHPUT_SLOTS);
+
+	failures += reportStageProfile();
+
+	if (!quick)
+	{
+		printf("\nFile system work per playback (balanced profile, %u entry fast-seek link map, %u KB clusters)\n",
+		       WAV_LINKMAP_ENTRIES, USBHFatFS.csize * FF_MAX_SS / 1024);
+		printf("%9s %9s %10s %10s %10s %12s\n", "fragments", "fast-seek", "open FAT", "f_read/s", "FAT/s",
+		       "window B/s");
+		reportFileAccess(1);
+		reportFileAccess(40);
+	}
+	failures += reportLateRefills();
+
+	if (!quick)
+		reportDelayLines();
+	return failures ? 1 : 0;
+}
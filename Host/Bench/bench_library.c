@@ -0,0 +1,262 @@
+/*
+Library:				bench_library.c
+Written by:				Shridattha M Hebbar
+Date Written:			16/10/2026
+Description:			Host checks and benchmark of the WAV library index on a drive of a few
+						thousand files in nested directories: the first scan, a mount with the index
+						in place, and a rescan after files were added, rewritten and deleted. Reports
+						the file system calls each step makes and checks every entry against the
+						files written. A rescan on a full drive must keep the old index.
+*/
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "bench_common.h"
+#include "fatfs.h"
+#include "wav_library.h"
+#include "wav_riff.h"
+
+#define BENCH_ROOT_FILES	2000
+#define BENCH_ALBUM_FILES	100
+#define BENCH_MAX_FILES		(BENCH_ROOT_FILES + 2 * BENCH_ALBUM_FILES + 16)
+
+//A file written to the drive and the entry expected for it
+typedef struct
+{
+	char path[WAV_LIBRARY_PATH_MAX];
+	uint32_t rate;
+	uint16_t channels;
+	uint16_t bits;
+	uint32_t frames;
+	bool valid;
+	bool present;
+}BenchFile_t;
+
+static BenchFile_t files[BENCH_MAX_FILES];
+static uint32_t fileCount = 0;
+static char rootDir[64];
+
+//File system calls of one step
+typedef struct
+{
+	uint32_t opens, reads, writes, dirBytes;
+	uint64_t ns;
+}BenchCost_t;
+
+static BenchCost_t costStart(void)
+{
+	BenchCost_t c = { hostFf_openCount(), hostFf_readCount(), hostFf_writeCount(), hostFf_dirBytes(), bench_nowNs() };
+	return c;
+}
+
+static BenchCost_t costEnd(BenchCost_t c)
+{
+	c.opens = hostFf_openCount() - c.opens;
+	c.reads = hostFf_readCount() - c.reads;
+	c.writes = hostFf_writeCount() - c.writes;
+	c.dirBytes = hostFf_dirBytes() - c.dirBytes;
+	c.ns = bench_nowNs() - c.ns;
+	return c;
+}
+
+static void printCost(const char *label, BenchCost_t c, uint32_t parsed)
+{
+	printf("%-30s %7u %7u %7u %8.1f %7u %9.2f\n", label, c.opens, c.reads, c.writes, c.dirBytes / 1024.0, parsed,
+	       c.ns / 1e6);
+}
+
+// Write a WAV file of frames frames, or a file that only looks like one
+static void writeFile(const char *path, uint32_t rate, uint16_t channels, uint16_t bits, uint32_t frames, bool valid)
+{
+	const uint32_t bytes = frames * channels * bits / 8u;
+	uint8_t buf[44 + 4096];
+	char full[256];
+	BenchFile_t *f = NULL;
+	FILE *fp;
+
+	for (uint32_t i = 0; i < fileCount && !f; i++)
+		f = (strcmp(files[i].path, path) == 0) ? &files[i] : NULL;
+	if (!f)
+		f = &files[fileCount++];
+	snprintf(f->path, sizeof(f->path), "%s", path);
+	f->rate = rate;
+	f->channels = channels;
+	f->bits = bits;
+	f->frames = frames;
+	f->valid = valid;
+	f->present = true;
+
+	memset(buf, 0, sizeof(buf));
+	bench_writeWavHeader(buf, rate, channels, bits, bytes);
+	if (!valid)
+		memcpy(buf + 8, "AVI ", 4);
+	snprintf(full, sizeof(full), "%s/%s", rootDir, path);
+	fp = fopen(full, "wb");
+	if (fp)
+	{
+		fwrite(buf, 1, 44 + bytes, fp);
+		fclose(fp);
+	}
+}
+
+static void deleteFile(uint32_t i)
+{
+	char full[256];
+
+	snprintf(full, sizeof(full), "%s/%s", rootDir, files[i].path);
+	remove(full);
+	files[i].present = false;
+}
+
+static void writeTrack(const char *fmt, uint32_t n, uint32_t variant)
+{
+	static const uint32_t rates[] = { 44100, 48000, 22050, 96000, 32000 };
+	static const uint16_t bits[] = { 16, 24, 8, 16 };
+	char path[WAV_LIBRARY_PATH_MAX];
+
+	snprintf(path, sizeof(path), fmt, n);
+	writeFile(path, rates[n % 5], (uint16_t)(1 + n % 2), bits[n % 4], 50 + n % 300 + variant, true);
+}
+
+// Every present file has one entry with its format, and nothing else is listed
+static bool checkEntries(uint32_t *wrong)
+{
+	uint32_t expected = 0;
+
+	*wrong = 0;
+	for (uint32_t i = 0; i < fileCount; i++)
+		expected += files[i].present;
+	for (uint32_t e = 0; e < wavLibrary_getCount(); e++)
+	{
+		WAV_LIBRARY_EntryTypeDef entry;
+		const BenchFile_t *f = NULL;
+		bool ok;
+
+		if (!wavLibrary_getEntry(e, &entry))
+		{
+			(*wrong)++;
+			continue;
+		}
+		for (uint32_t i = 0; i < fileCount && !f; i++)
+			f = (files[i].present && strcmp(files[i].path, entry.path) == 0) ? &files[i] : NULL;
+		ok = f != NULL;
+		if (ok && f->valid)
+			ok = entry.sampleRate == f->rate && entry.channels == f->channels && entry.bitsPerSample == f->bits
+			  && entry.dataOffset == 44 && entry.dataBytes == f->frames * f->channels * f->bits / 8u
+			  && entry.durationMs == (uint32_t)((uint64_t)f->frames * 1000u / f->rate) && entry.encoding == WAV_RIFF_PCM;
+		else if (ok)
+			ok = entry.sampleRate == 0;
+		*wrong += ok ? 0 : 1;
+	}
+	return *wrong == 0 && wavLibrary_getCount() == expected;
+}
+
+// Mount and run the rescan to the end
+static BenchCost_t scan(bool *loaded, BenchCost_t *ready)
+{
+	BenchCost_t c = costStart();
+
+	*loaded = wavLibrary_mount();
+	*ready = costEnd(c);
+	while (wavLibrary_process(WAV_LIBRARY_SCAN_STEP))
+	{
+	}
+	return costEnd(c);
+}
+
+int main(void)
+{
+	char cmd[128];
+	uint32_t wrong, total, entryCount;
+	BenchCost_t ready, c;
+	bool loaded, ok;
+	int failures = 0;
+
+	snprintf(rootDir, sizeof(rootDir), "/tmp/bench_library_XXXXXX");
+	if (!mkdtemp(rootDir))
+		return 1;
+	hostFf_setRoot(rootDir);
+	snprintf(cmd, sizeof(cmd), "%s/album1", rootDir);
+	mkdir(cmd, 0755);
+	snprintf(cmd, sizeof(cmd), "%s/album2", rootDir);
+	mkdir(cmd, 0755);
+	snprintf(cmd, sizeof(cmd), "%s/album2/disc1", rootDir);
+	mkdir(cmd, 0755);
+	for (uint32_t n = 0; n < BENCH_ROOT_FILES; n++)
+		writeTrack("track%04u.wav", n, 0);
+	for (uint32_t n = 0; n < BENCH_ALBUM_FILES; n++)
+	{
+		writeTrack("album1/song%03u.WAV", n, 0);
+		writeTrack("album2/disc1/part%03u.wav", n, 0);
+	}
+	writeFile("broken.wav", 48000, 2, 16, 10, false);
+	snprintf(cmd, sizeof(cmd), "%s/notes.txt", rootDir);
+	fclose(fopen(cmd, "w"));
+	snprintf(cmd, sizeof(cmd), "%s/.hidden.wav", rootDir);
+	fclose(fopen(cmd, "w"));
+	total = fileCount;
+
+	printf("WAV library index: %u WAV files in 3 directories, %u-byte records\n", total,
+	       (unsigned)sizeof(WAV_LIBRARY_EntryTypeDef));
+	printf("%-30s %7s %7s %7s %8s %7s %9s\n", "step", "f_open", "f_read", "f_write", "dir KB", "parsed", "host ms");
+
+	// First mount: no index, every header is parsed and the index written
+	c = scan(&loaded, &ready);
+	printCost("first scan (no index)", c, wavLibrary_getParsed());
+	ok = !loaded && checkEntries(&wrong) && wavLibrary_getParsed() == total && c.writes > 0;
+	failures += ok ? 0 : 1;
+	printf("  %u entries, %u wrong %s\n", wavLibrary_getCount(), wrong, ok ? "ok" : "FAIL");
+
+	// Mount with the index: ready after the header read, the rescan parses and writes nothing
+	c = scan(&loaded, &ready);
+	printCost("mount, index ready", ready, 0);
+	printCost("rescan, nothing changed", c, wavLibrary_getParsed());
+	ok = loaded && ready.opens == 1 && ready.reads == 1 && checkEntries(&wrong) && wavLibrary_getParsed() == 0
+	  && c.writes == 0;
+	failures += ok ? 0 : 1;
+	printf("  %u entries, %u wrong, ready after %u open and %u read %s\n", wavLibrary_getCount(), wrong, ready.opens,
+	       ready.reads, ok ? "ok" : "FAIL");
+
+	// Add 7, rewrite 3 with a new length, delete 5: only the 10 new headers are parsed
+	for (uint32_t n = 0; n < 5; n++)
+		deleteFile(100 + 377 * n);
+	for (uint32_t n = 0; n < 3; n++)
+		writeTrack("track%04u.wav", 250 + 600 * n, 7);
+	for (uint32_t n = 0; n < 4; n++)
+		writeTrack("track%04ub.wav", 40 + 500 * n, 0);
+	for (uint32_t n = 0; n < 3; n++)
+		writeTrack("album1/zz_new%u.wav", n, 0);
+	c = scan(&loaded, &ready);
+	printCost("rescan, 10 new or changed", c, wavLibrary_getParsed());
+	ok = loaded && checkEntries(&wrong) && wavLibrary_getParsed() == 10 && wavLibrary_getCount() == total + 2;
+	failures += ok ? 0 : 1;
+	printf("  %u entries, %u wrong %s\n", wavLibrary_getCount(), wrong, ok ? "ok" : "FAIL");
+
+	c = scan(&loaded, &ready);
+	printCost("rescan after the update", c, wavLibrary_getParsed());
+	ok = checkEntries(&wrong) && wavLibrary_getParsed() == 0 && c.writes == 0;
+	failures += ok ? 0 : 1;
+	printf("  %u entries, %u wrong %s\n", wavLibrary_getCount(), wrong, ok ? "ok" : "FAIL");
+
+	// Drive full half way through the new index: the old one stays and loads on the next mount
+	entryCount = wavLibrary_getCount();
+	writeTrack("album1/zz_full.wav", 0, 0);
+	hostFf_setWriteSpace((entryCount / 2u) * sizeof(WAV_LIBRARY_EntryTypeDef));
+	c = scan(&loaded, &ready);
+	hostFf_setWriteSpace(UINT32_MAX);
+	printCost("rescan, drive full", c, wavLibrary_getParsed());
+	snprintf(cmd, sizeof(cmd), "%s/%s", rootDir, WAV_LIBRARY_TEMP);
+	ok = c.writes > 0 && access(cmd, F_OK) != 0;
+	(void)scan(&loaded, &ready);
+	ok = ok && loaded && ready.opens == 1 && wavLibrary_getParsed() == 1 && checkEntries(&wrong);
+	failures += ok ? 0 : 1;
+	printf("  old index of %u entries kept, %u entries after the next rescan, %u wrong %s\n", entryCount,
+	       wavLibrary_getCount(), wrong, ok ? "ok" : "FAIL");
+
+	wavLibrary_unmount();
+	snprintf(cmd, sizeof(cmd), "rm -rf %s", rootDir);
+	if (system(cmd) != 0)
+		printf("could not remove %s\n", rootDir);
+	return failures ? 1 : 0;
+}
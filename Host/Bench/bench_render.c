@@ -0,0 +1,194 @@
+/*
+Library:				bench_render.c
+Written by:				Shridattha M Hebbar
+Date Written:			16/10/2026
+Description:			Host checks and scaling benchmark of the parallel offline renderer: one long
+						file split into chunks and a batch of files, rendered on 1 to N threads. Every
+						output is checked byte for byte against a one-pass render on one thread.
+						N is the CPU count (at least 4), or the first argument. --quick renders files
+						and chunks a tenth as long, on up to 4 threads.
+*/
+
+#include <stdlib.h>
+#include <unistd.h>
+#include "bench_common.h"
+#include "render.h"
+
+#define BENCH_LONG_SECONDS		300u
+#define BENCH_BATCH_FILES		16u
+#define BENCH_BATCH_SECONDS		30u
+
+static char rootDir[64];
+static char inNames[BENCH_BATCH_FILES + 1][128];
+static char refNames[BENCH_BATCH_FILES + 1][128];
+static char outNames[BENCH_BATCH_FILES + 1][128];
+static const char *inPaths[BENCH_BATCH_FILES + 1];
+static const char *refPaths[BENCH_BATCH_FILES + 1];
+static const char *outPaths[BENCH_BATCH_FILES + 1];
+
+// Noise at a quarter of full scale, 16-bit or packed 24-bit
+static void writeNoiseWav(const char *path, uint32_t rate, uint16_t channels, uint16_t bits, uint32_t seconds,
+                          uint32_t seed)
+{
+	const uint32_t samples = rate * channels;
+	int16_t *noise = malloc(samples * sizeof(int16_t));
+	uint8_t *bytes = malloc(samples * 3u);
+	uint8_t hdr[44];
+	FILE *fp = fopen(path, "wb");
+
+	if (!noise || !bytes || !fp)
+		exit(1);
+	bench_writeWavHeader(hdr, rate, channels, bits, seconds * samples * bits / 8u);
+	fwrite(hdr, 1, sizeof(hdr), fp);
+	for (uint32_t s = 0; s < seconds; s++)
+	{
+		bench_fillNoise(noise, samples, seed + s);
+		for (uint32_t i = 0; i < samples; i++)
+		{
+			int16_t v = (int16_t)(noise[i] >> 2);
+
+			if (bits == 24)
+			{
+				bytes[3 * i] = (uint8_t)noise[i];
+				bytes[3 * i + 1] = (uint8_t)v;
+				bytes[3 * i + 2] = (uint8_t)((uint16_t)v >> 8);
+			}
+			else
+				memcpy(&bytes[2 * i], &v, 2);
+		}
+		fwrite(bytes, bits / 8u, samples, fp);
+	}
+	fclose(fp);
+	free(noise);
+	free(bytes);
+}
+
+static bool sameFile(const char *a, const char *b)
+{
+	static uint8_t bufA[1 << 16], bufB[1 << 16];
+	FILE *fa = fopen(a, "rb");
+	FILE *fb = fopen(b, "rb");
+	bool same = fa && fb;
+	size_t na, nb;
+
+	while (same)
+	{
+		na = fread(bufA, 1, sizeof(bufA), fa);
+		nb = fread(bufB, 1, sizeof(bufB), fb);
+		same = na == nb && memcmp(bufA, bufB, na) == 0;
+		if (na == 0)
+			break;
+	}
+	if (fa)
+		fclose(fa);
+	if (fb)
+		fclose(fb);
+	return same;
+}
+
+// One-pass render on one thread into the reference files
+static bool renderReference(const char *const *in, uint32_t count, RENDER_OptionsTypeDef opt)
+{
+	RENDER_StatsTypeDef stats;
+
+	opt.threads = 1;
+	return render_files(in, refPaths, count, &opt, &stats);
+}
+
+// Render on 1 to maxThreads threads, check every output against the reference
+static int scaling(const char *title, const char *const *in, uint32_t count, RENDER_OptionsTypeDef opt,
+                   uint32_t maxThreads)
+{
+	double base = 0;
+	int failures = 0;
+
+	printf("\n%s\n", title);
+	printf("%8s %9s %10s %8s %6s %7s %7s  %s\n", "threads", "wall s", "x realtime", "speedup", "tasks", "stolen",
+	       "prime %", "output");
+	if (!renderReference(in, count, opt))
+	{
+		printf("reference render FAIL\n");
+		return 1;
+	}
+	for (uint32_t threads = 1; threads <= maxThreads; threads = (threads * 2u > maxThreads && threads < maxThreads)
+	                                                            ? maxThreads : threads * 2u)
+	{
+		RENDER_StatsTypeDef stats;
+		bool ok;
+
+		opt.threads = threads;
+		ok = render_files(in, outPaths, count, &opt, &stats);
+		for (uint32_t i = 0; ok && i < count; i++)
+			ok = sameFile(outPaths[i], refPaths[i]);
+		if (threads == 1)
+			base = stats.wallSeconds;
+		printf("%8u %9.3f %10.0f %8.2f %6u %7u %7.1f  %s\n", threads, stats.wallSeconds,
+		       stats.audioSeconds / stats.wallSeconds, base / stats.wallSeconds, stats.tasks, stats.steals,
+		       stats.frames ? 100.0 * stats.primeFrames / stats.frames : 0.0, ok ? "identical" : "FAIL");
+		failures += ok ? 0 : 1;
+	}
+	return failures;
+}
+
+int main(int argc, char **argv)
+{
+	const ECHO_PatternTapTypeDef pattern[] = { { 125, 26000 }, { 375, 18000 }, { 750, 12000 } };
+	const bool quick = bench_isQuick(argc, argv);
+	const uint32_t scale = quick ? 10u : 1u;		// Same chunk seams per file, a tenth of the audio
+	const uint32_t longSeconds = BENCH_LONG_SECONDS / scale, batchSeconds = BENCH_BATCH_SECONDS / scale;
+	uint32_t maxThreads = (argc > 1 && argv[1][0] != '-') ? (uint32_t)atoi(argv[1]) : render_cpuCount();
+	RENDER_OptionsTypeDef opt;
+	char cmd[128], title[96];
+	int failures = 0;
+
+	if (maxThreads < 4 || quick)
+		maxThreads = 4;
+	snprintf(rootDir, sizeof(rootDir), "/tmp/bench_render_XXXXXX");
+	if (!mkdtemp(rootDir))
+		return 1;
+	for (uint32_t i = 0; i <= BENCH_BATCH_FILES; i++)
+	{
+		snprintf(inNames[i], sizeof(inNames[i]), "%s/in%02u.wav", rootDir, i);
+		snprintf(refNames[i], sizeof(refNames[i]), "%s/ref%02u.wav", rootDir, i);
+		snprintf(outNames[i], sizeof(outNames[i]), "%s/out%02u.wav", rootDir, i);
+		inPaths[i] = inNames[i];
+		refPaths[i] = refNames[i];
+		outPaths[i] = outNames[i];
+	}
+	writeNoiseWav(inNames[0], 48000, 2, 16, longSeconds, 1);
+	for (uint32_t i = 1; i <= BENCH_BATCH_FILES; i++)
+		writeNoiseWav(inNames[i], 44100, 1, 24, batchSeconds, 1000u * i);
+
+	printf("Parallel offline render, %u CPU(s), output checked against a one-pass render on one thread\n",
+	       render_cpuCount());
+	render_defaults(&opt);
+	opt.quiet = true;
+	opt.tailMs = 1500;
+	opt.chunkMs = RENDER_CHUNK_MS / scale;
+
+	snprintf(title, sizeof(title), "one %u s 48 kHz stereo file, FIR echo, %u ms chunks", longSeconds, opt.chunkMs);
+	failures += scaling(title, inPaths, 1, opt, maxThreads);
+	snprintf(title, sizeof(title), "batch of 16 x %u s 44.1 kHz 24-bit mono files, FIR echo", batchSeconds);
+	failures += scaling(title, &inPaths[1], BENCH_BATCH_FILES, opt, maxThreads);
+
+	// Three taps on a µ-law line and short chunks: many chunk seams, each primed from the coded line
+	echo_setPattern(pattern, 3);
+	opt.storage = ECHO_STORAGE_MULAW;
+	opt.chunkMs = 3000u / scale;
+	snprintf(title, sizeof(title), "one %u s file, 3-tap FIR echo on a mu-law line, %u ms chunks", longSeconds,
+	         opt.chunkMs);
+	failures += scaling(title, inPaths, 1, opt, maxThreads);
+	echo_setPattern(pattern, 0);
+
+	// Feedback on ADPCM cannot be split: whole files spread over the threads
+	opt.storage = ECHO_STORAGE_ADPCM;
+	opt.mode = ECHO_MODE_FEEDBACK;
+	opt.chunkMs = RENDER_CHUNK_MS / scale;
+	failures += scaling("batch of 16 files, feedback echo on an ADPCM line (files not split)", &inPaths[1],
+	                    BENCH_BATCH_FILES, opt, maxThreads);
+
+	snprintf(cmd, sizeof(cmd), "rm -rf %s", rootDir);
+	if (system(cmd) != 0)
+		printf("could not remove %s\n", rootDir);
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,277 @@
+/*
+Library:				bench_resample.c
+Written by:				Shridattha M Hebbar
+Date Written:			16/10/2026
+Description:			Host checks and benchmark of the polyphase sample-rate converter: error of a
+						resampled sine against the exact sine at the output rate (so pitch and timing
+						are checked along with the noise), rejection of a tone above the output Nyquist
+						rate, output that does not depend on how the input is split into blocks, cost
+						per output sample at each quality, and a file at a rate without a PLL setting
+						played through the player at the nearest supported rate.
+*/
+
+#include <math.h>
+#include <stdlib.h>
+#include "bench_common.h"
+#include "stm32f4xx_hal.h"
+#include "fatfs.h"
+#include "wav_player.h"
+#include "resampler.h"
+#include "audioI2S.h"
+
+#define BENCH_PI				3.14159265358979
+#define BENCH_IN_FRAMES			24000u		// Input per accuracy run
+#define BENCH_SKIP_FRAMES		64u			// Output frames left out of the error, the filter start
+#define BENCH_AMPLITUDE			16000.0
+#define BENCH_OUT_FRAMES		(BENCH_IN_FRAMES * 2u + 64u)
+
+//Rate pair and the output sine error each quality must beat, in dB below the tone
+typedef struct
+{
+	uint32_t inRate;
+	uint32_t outRate;
+	double minSnr[3];
+}RatePair_t;
+
+static const RatePair_t pairs[] = {
+	{ 12000,  16000, { 40.0, 55.0, 70.0 } },
+	{ 24000,  32000, { 40.0, 55.0, 70.0 } },
+	{ 22000,  22050, { 40.0, 50.0, 55.0 } },		// 441 phases needed: nearest of the table
+	{ 88200,  96000, { 40.0, 50.0, 55.0 } },
+	{ 192000, 96000, { 40.0, 55.0, 70.0 } },
+};
+
+static const char *qualityNames[] = { "fast", "balanced", "high" };
+
+extern I2S_HandleTypeDef hi2s3;
+
+static int16_t inBuf[BENCH_IN_FRAMES * 2];
+static int16_t outBuf[BENCH_OUT_FRAMES * 2];
+
+// Stereo sine of freq Hz at rate, the right channel in antiphase
+static void fillSine(int16_t *buf, uint32_t frames, double freq, uint32_t rate)
+{
+	for (uint32_t i = 0; i < frames; i++)
+	{
+		double v = BENCH_AMPLITUDE * sin(2.0 * BENCH_PI * freq * i / rate);
+		buf[2 * i] = (int16_t)lrint(v);
+		buf[2 * i + 1] = (int16_t)lrint(-v);
+	}
+}
+
+// Run frames of input through the resampler in blocks of varying size, returns the output frames
+static uint32_t runResampler(RESAMPLER_HandleTypeDef *hrs, const int16_t *in, uint32_t frames, int16_t *out,
+                             uint32_t outMax, uint32_t seed)
+{
+	uint32_t used = 0, made = 0, x = seed;
+
+	while (used < frames && made < outMax)
+	{
+		uint32_t room, n;
+		int16_t *dst = resampler_writeBuffer(hrs, &room);
+
+		x ^= x << 13;
+		x ^= x >> 17;
+		x ^= x << 5;
+		n = seed ? 1u + x % room : room;
+		if (n > frames - used)
+			n = frames - used;
+		memcpy(dst, &in[2 * used], n * 2 * sizeof(int16_t));
+		resampler_commit(hrs, n);
+		used += n;
+		made += resampler_process(hrs, &out[2 * made], outMax - made);
+	}
+	return made;
+}
+
+// Output error against the exact sine at the output rate, in dB below the tone
+static double sineSnr(const int16_t *out, uint32_t frames, double freq, uint32_t rate)
+{
+	double sig = 0.0, err = 0.0;
+
+	for (uint32_t i = BENCH_SKIP_FRAMES; i < frames; i++)
+	{
+		double v = BENCH_AMPLITUDE * sin(2.0 * BENCH_PI * freq * i / rate);
+		double l = out[2 * i] - v, r = out[2 * i + 1] + v;
+		sig += 2.0 * v * v;
+		err += l * l + r * r;
+	}
+	return 10.0 * log10(sig / (err + 1e-9));
+}
+
+// Level of the output in dB below a full BENCH_AMPLITUDE sine
+static double level(const int16_t *out, uint32_t frames)
+{
+	double e = 0.0;
+
+	for (uint32_t i = BENCH_SKIP_FRAMES; i < frames; i++)
+	{
+		e += (double)out[2 * i] * out[2 * i];
+	}
+	return 10.0 * log10(e / (frames - BENCH_SKIP_FRAMES) / (BENCH_AMPLITUDE * BENCH_AMPLITUDE / 2.0) + 1e-12);
+}
+
+// Sine error at 1 kHz and near the top of the passband, alias rejection on downsampling
+static int checkAccuracy(void)
+{
+	static uint8_t mem[32768] __attribute__((aligned(8)));
+	RESAMPLER_HandleTypeDef hrs;
+	int failures = 0;
+
+	printf("Sine error against the exact output-rate sine (dB below the tone)\n");
+	printf("%-16s %-9s %7s %7s %8s %8s %6s\n", "rates", "quality", "phases", "bytes", "1 kHz",
+	       "0.2 fs", "");
+	for (uint32_t p = 0; p < sizeof(pairs) / sizeof(pairs[0]); p++)
+	{
+		const RatePair_t *rp = &pairs[p];
+		uint32_t lower = (rp->inRate < rp->outRate) ? rp->inRate : rp->outRate;
+
+		for (uint32_t q = 0; q < 3; q++)
+		{
+			RESAMPLER_QualityTypeDef quality = (RESAMPLER_QualityTypeDef)q;
+			uint32_t bytes = resampler_memBytes(quality, rp->inRate, rp->outRate);
+			double snr1, snrHigh;
+			uint32_t made;
+			char label[24];
+			bool ok;
+
+			ok = bytes <= sizeof(mem) && resampler_init(&hrs, mem, quality, rp->inRate, rp->outRate);
+			fillSine(inBuf, BENCH_IN_FRAMES, 1000.0, rp->inRate);
+			made = runResampler(&hrs, inBuf, BENCH_IN_FRAMES, outBuf, BENCH_OUT_FRAMES, 0);
+			snr1 = sineSnr(outBuf, made - 16u, 1000.0, rp->outRate);
+			resampler_reset(&hrs);
+			fillSine(inBuf, BENCH_IN_FRAMES, 0.2 * lower, rp->inRate);
+			made = runResampler(&hrs, inBuf, BENCH_IN_FRAMES, outBuf, BENCH_OUT_FRAMES, 0);
+			snrHigh = sineSnr(outBuf, made - 16u, 0.2 * lower, rp->outRate);
+			ok = ok && snr1 >= rp->minSnr[q] && snrHigh >= rp->minSnr[q] - 20.0;
+			snprintf(label, sizeof(label), "%u -> %u", rp->inRate, rp->outRate);
+			printf("%-16s %-9s %7u %7u %8.1f %8.1f %6s\n", label, qualityNames[q], hrs.phases, bytes, snr1,
+			       snrHigh, ok ? "ok" : "FAIL");
+			failures += ok ? 0 : 1;
+		}
+	}
+
+	// An 80 kHz tone in a 192 kHz stream must not alias to 16 kHz in the 96 kHz output
+	printf("\n80 kHz tone, 192 kHz -> 96 kHz: output level (dB)\n");
+	for (uint32_t q = 0; q < 3; q++)
+	{
+		uint32_t made;
+		double db;
+
+		resampler_init(&hrs, mem, (RESAMPLER_QualityTypeDef)q, 192000, 96000);
+		fillSine(inBuf, BENCH_IN_FRAMES, 80000.0, 192000);
+		made = runResampler(&hrs, inBuf, BENCH_IN_FRAMES, outBuf, BENCH_OUT_FRAMES, 0);
+		db = level(outBuf, made);
+		printf("  %-9s %8.1f %s\n", qualityNames[q], db, db < -30.0 - 15.0 * q ? "ok" : "FAIL");
+		failures += db < -30.0 - 15.0 * q ? 0 : 1;
+	}
+	return failures;
+}
+
+// Feeding the input in random block sizes gives the same output as feeding it whole
+static int checkBlocking(void)
+{
+	static uint8_t mem[32768] __attribute__((aligned(8)));
+	static int16_t ref[BENCH_OUT_FRAMES * 2];
+	RESAMPLER_HandleTypeDef hrs;
+	uint32_t a, b;
+	bool ok;
+
+	bench_fillNoise(inBuf, BENCH_IN_FRAMES * 2, 5);
+	resampler_init(&hrs, mem, RESAMPLER_QUALITY_HIGH, 22000, 22050);
+	a = runResampler(&hrs, inBuf, BENCH_IN_FRAMES, ref, BENCH_OUT_FRAMES, 0);
+	resampler_reset(&hrs);
+	b = runResampler(&hrs, inBuf, BENCH_IN_FRAMES, outBuf, BENCH_OUT_FRAMES, 77);
+	ok = a == b && memcmp(ref, outBuf, a * 2 * sizeof(int16_t)) == 0;
+	printf("\nRandom input blocks give the whole-input output: %u frames %s\n", a, ok ? "ok" : "FAIL");
+	return ok ? 0 : 1;
+}
+
+// Cost per output sample (both channels counted) of each quality
+static void benchResample(void)
+{
+	static uint8_t mem[32768] __attribute__((aligned(8)));
+	RESAMPLER_HandleTypeDef hrs;
+
+	bench_printRateHeader("Resampler throughput, 24 kHz -> 32 kHz (per output sample)");
+	bench_fillNoise(inBuf, BENCH_IN_FRAMES * 2, 9);
+	for (uint32_t q = 0; q < 3; q++)
+	{
+		uint64_t best = UINT64_MAX;
+		uint32_t made = 0;
+
+		resampler_init(&hrs, mem, (RESAMPLER_QualityTypeDef)q, 24000, 32000);
+		for (int r = 0; r < BENCH_REPEATS; r++)
+		{
+			resampler_reset(&hrs);
+			uint64_t t0 = bench_nowNs();
+			made = runResampler(&hrs, inBuf, BENCH_IN_FRAMES, outBuf, BENCH_OUT_FRAMES, 0);
+			__asm__ volatile("" : : "r"(outBuf) : "memory");
+			uint64_t dt = bench_nowNs() - t0;
+			if (dt < best)
+				best = dt;
+		}
+		bench_printRate(qualityNames[q], made, best, (uint64_t)made * 2);
+	}
+}
+
+// A 24 kHz file plays at 32 kHz, the ring holding the resampler's output of the file data
+static int checkPlayer(void)
+{
+	static uint8_t mem[32768] __attribute__((aligned(8)));
+	static const uint32_t rates[][2] = { { 12000, 16000 }, { 24000, 32000 }, { 44100, 44100 },
+	                                     { 64000, 96000 }, { 192000, 96000 } };
+	const uint32_t frames = 24000;
+	uint8_t *wav = malloc(44 + frames * 4);
+	RESAMPLER_HandleTypeDef hrs;
+	const uint32_t outFrames = 3 * WAV_BALANCED_SLOT_FRAMES;
+	int failures = 0;
+	bool ok;
+
+	printf("\nOutput rate for file rates without a PLL setting\n");
+	for (uint32_t k = 0; k < sizeof(rates) / sizeof(rates[0]); k++)
+	{
+		ok = audioI2S_nearestFreq(rates[k][0]) == rates[k][1];
+		printf("  %6u Hz -> %6u Hz %s\n", rates[k][0], audioI2S_nearestFreq(rates[k][0]), ok ? "ok" : "FAIL");
+		failures += ok ? 0 : 1;
+	}
+
+	if (!wav)
+		return failures + 1;
+	bench_writeWavHeader(wav, 24000, 2, 16, frames * 4);
+	bench_fillNoise((int16_t*)(wav + 44), frames * 2, 3);
+	hostFf_addMemFile("rate24k.wav", wav, 44 + frames * 4);		// Registered for good, never freed
+
+	resampler_init(&hrs, mem, RESAMPLER_QUALITY_BALANCED, 24000, 32000);
+	runResampler(&hrs, (const int16_t*)(wav + 44), frames, outBuf, outFrames, 0);
+
+	wavPlayer_setResampleQuality(RESAMPLER_QUALITY_BALANCED);
+	ok = wavPlayer_fileSelect("rate24k.wav") && wavPlayer_getOutputRate() == 32000;
+	wavPlayer_play();
+	ok = ok && hi2s3.Init.AudioFreq == 32000;
+	ok = ok && memcmp(hi2s3.pTxBuffPtr, outBuf, 2 * WAV_BALANCED_SLOT_FRAMES * 4) == 0;
+	hostHal_i2sHalfTransfer();
+	wavPlayer_process();
+	ok = ok && memcmp(hi2s3.pTxBuffPtr, &outBuf[4 * WAV_BALANCED_SLOT_FRAMES], WAV_BALANCED_SLOT_FRAMES * 4) == 0
+	        && wavPlayer_getLengthMs() == 1000 && wavPlayer_getFifoUnderruns() == 0;
+	wavPlayer_stop();
+	printf("  24 kHz file plays at %u Hz, ring matches the resampler %s\n", wavPlayer_getOutputRate(),
+	       ok ? "ok" : "FAIL");
+	return failures + (ok ? 0 : 1);
+}
+
+int main(int argc, char **argv)
+{
+	const bool quick = bench_isQuick(argc, argv);
+	int failures = 0;
+
+	hostHal_setPin(GPIOA, GPIO_PIN_2, GPIO_PIN_RESET);			// Echo off, the ring holds file data
+	audioI2S_setHandle(&hi2s3);
+
+	failures += checkAccuracy();
+	failures += checkBlocking();
+	if (!quick)
+		benchResample();
+	failures += checkPlayer();
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,738 @@
+/*
+Library:				bench_wav.c
+Written by:				Shridattha M Hebbar
+Date Written:			16/10/2026
+Description:			Host checks and benchmark of the WAV stream path: the RIFF chunk walker on
+						well-formed, padded, unpatched and unsupported files, the first audio the player
+						hands to the DMA before and after wavPlayer_seek(), and the file system cost
+						of seeking in a long recording with and without the fast-seek link map.
+						Also checks every format conversion kernel against a per-sample model, times
+						them, and plays mono, 24-bit and float files through the player. A playlist of
+						mixed formats at one rate must come out as one continuous stream, with the echo
+						tail carried across and the I2S clock left alone. The event trace of a playback
+						must hold every DMA half, refill and read in order, and save whole.
+						--save-trace file also writes it for trace_decode, with one DMA half stamped
+						before the record ahead of it as an interrupt between claim and stamp leaves it.
+*/
+
+#include <math.h>
+#include <stdlib.h>
+#include "bench_common.h"
+#include "stm32f4xx_hal.h"
+#include "fatfs.h"
+#include "wav_player.h"
+#include "playlist.h"
+#include "wav_riff.h"
+#include "pcm_convert.h"
+#include "audioI2S.h"
+#include "trace.h"
+#include <unistd.h>
+
+#define BENCH_CHANNELS			2
+#define BENCH_RATE				48000
+#define BENCH_LONG_SECONDS		60
+#define BENCH_SEEKS				200
+#define BENCH_CONV_FRAMES		1001		// Odd, so every kernel runs its tail loop
+#define BENCH_CONV_REPEATS		2000
+
+//Source format of a conversion kernel
+typedef struct
+{
+	const char *label;
+	uint16_t encoding;
+	uint16_t bits;
+	uint16_t channels;
+}PcmFormat_t;
+
+static const PcmFormat_t formats[] = {
+	{ "u8 mono",    WAV_RIFF_PCM,   8,  1 },
+	{ "u8 stereo",  WAV_RIFF_PCM,   8,  2 },
+	{ "s16 mono",   WAV_RIFF_PCM,   16, 1 },
+	{ "s16 stereo", WAV_RIFF_PCM,   16, 2 },
+	{ "s24 mono",   WAV_RIFF_PCM,   24, 1 },
+	{ "s24 stereo", WAV_RIFF_PCM,   24, 2 },
+	{ "s32 mono",   WAV_RIFF_PCM,   32, 1 },
+	{ "s32 stereo", WAV_RIFF_PCM,   32, 2 },
+	{ "f32 mono",   WAV_RIFF_FLOAT, 32, 1 },
+	{ "f32 stereo", WAV_RIFF_FLOAT, 32, 2 },
+};
+
+extern I2S_HandleTypeDef hi2s3;
+
+//In-memory file for the RIFF reader callback
+typedef struct
+{
+	uint8_t *data;
+	uint32_t size;
+}MemFile_t;
+
+//Expected result of one parser case
+typedef struct
+{
+	const char *label;
+	WAV_RIFF_StatusTypeDef status;
+	uint32_t dataOffset;
+	uint32_t frames;
+	uint16_t bits;
+	uint16_t encoding;
+}RiffCase_t;
+
+static uint8_t riffFile[2048];
+
+static uint32_t readMem(void *ctx, uint32_t offset, void *dst, uint32_t bytes)
+{
+	const MemFile_t *mf = ctx;
+
+	if (offset >= mf->size)
+		return 0;
+	if (bytes > mf->size - offset)
+		bytes = mf->size - offset;
+	memcpy(dst, mf->data + offset, bytes);
+	return bytes;
+}
+
+static uint32_t put32(uint32_t pos, uint32_t v)
+{
+	memcpy(&riffFile[pos], &v, 4);
+	return pos + 4;
+}
+
+static uint32_t put16(uint32_t pos, uint16_t v)
+{
+	memcpy(&riffFile[pos], &v, 2);
+	return pos + 2;
+}
+
+static uint32_t putId(uint32_t pos, const char *id)
+{
+	memcpy(&riffFile[pos], id, 4);
+	return pos + 4;
+}
+
+// fmt chunk, WAVEFORMATEXTENSIBLE (40-byte body) when extensible
+static uint32_t putFmt(uint32_t pos, uint16_t tag, uint16_t channels, uint16_t bits, int extensible)
+{
+	uint16_t align = (uint16_t)(channels * bits / 8);
+
+	pos = putId(pos, "fmt ");
+	pos = put32(pos, extensible ? 40 : 16);
+	pos = put16(pos, extensible ? WAV_RIFF_EXTENSIBLE : tag);
+	pos = put16(pos, channels);
+	pos = put32(pos, BENCH_RATE);
+	pos = put32(pos, BENCH_RATE * align);
+	pos = put16(pos, align);
+	pos = put16(pos, bits);
+	if (extensible)
+	{
+		pos = put16(pos, 22);							// cbSize
+		pos = put16(pos, bits);							// Valid bits
+		pos = put32(pos, 3);							// Channel mask
+		pos = put16(pos, tag);							// Sub format GUID, tag first
+		memset(&riffFile[pos], 0, 14);
+		pos += 14;
+	}
+	return pos;
+}
+
+static uint32_t putChunk(uint32_t pos, const char *id, uint32_t size, uint32_t bodyBytes)
+{
+	pos = putId(pos, id);
+	pos = put32(pos, size);
+	memset(&riffFile[pos], 0x5A, bodyBytes);
+	return pos + bodyBytes;
+}
+
+// Build parser case c into riffFile, returns the file size
+static uint32_t buildCase(uint32_t c)
+{
+	uint32_t pos = 12;
+
+	memset(riffFile, 0, sizeof(riffFile));
+	putId(0, "RIFF");
+	putId(8, "WAVE");
+	switch (c)
+	{
+	case 0:		pos = putFmt(pos, WAV_RIFF_PCM, 2, 16, 0); pos = putChunk(pos, "data", 400, 400); break;
+	case 1:		pos = putChunk(pos, "LIST", 27, 28);								// Odd size, padded
+				pos = putFmt(pos, WAV_RIFF_PCM, 2, 16, 0);
+				pos = putChunk(pos, "fact", 4, 4);
+				pos = putChunk(pos, "data", 400, 400); break;
+	case 2:		pos = putFmt(pos, WAV_RIFF_PCM, 2, 24, 1); pos = putChunk(pos, "data", 600, 600); break;
+	case 3:		pos = putFmt(pos, WAV_RIFF_FLOAT, 1, 32, 0); pos = putChunk(pos, "data", 400, 400); break;
+	case 4:		pos = putFmt(pos, WAV_RIFF_PCM, 2, 16, 0); pos = putChunk(pos, "data", 0xFFFFFFFFu, 400); break;
+	case 5:		pos = putFmt(pos, WAV_RIFF_PCM, 2, 16, 0); pos = putChunk(pos, "data", 1000, 400); break;
+	case 6:		pos = putFmt(pos, WAV_RIFF_PCM, 2, 16, 0); pos = putChunk(pos, "data", 401, 401); break;
+	case 7:		putId(0, "RIFX"); pos = putFmt(pos, WAV_RIFF_PCM, 2, 16, 0); pos = putChunk(pos, "data", 400, 400); break;
+	case 8:		pos = putChunk(pos, "data", 400, 400); pos = putFmt(pos, WAV_RIFF_PCM, 2, 16, 0); break;
+	case 9:		pos = putFmt(pos, WAV_RIFF_PCM, 2, 16, 0); pos = putChunk(pos, "LIST", 20, 20); break;
+	case 10:	pos = putFmt(pos, 0x0002, 2, 16, 0); pos = putChunk(pos, "data", 400, 400); break;
+	case 11:	pos = putFmt(pos, WAV_RIFF_PCM, 2, 12, 0); pos = putChunk(pos, "data", 400, 400); break;
+	}
+	put32(4, (c == 4) ? 0 : pos - 8);									// Case 4: sizes never patched
+	return pos;
+}
+
+static int checkRiff(void)
+{
+	static const RiffCase_t cases[] = {
+		{ "canonical 16-bit stereo", WAV_RIFF_OK,           44,  100, 16, WAV_RIFF_PCM },
+		{ "LIST and fact chunks",    WAV_RIFF_OK,           92,  100, 16, WAV_RIFF_PCM },
+		{ "extensible 24-bit",       WAV_RIFF_OK,           68,  100, 24, WAV_RIFF_PCM },
+		{ "float mono",              WAV_RIFF_OK,           44,  100, 32, WAV_RIFF_FLOAT },
+		{ "unpatched sizes",         WAV_RIFF_OK,           44,  100, 16, WAV_RIFF_PCM },
+		{ "truncated data",          WAV_RIFF_OK,           44,  100, 16, WAV_RIFF_PCM },
+		{ "odd data size",           WAV_RIFF_OK,           44,  100, 16, WAV_RIFF_PCM },
+		{ "not RIFF/WAVE",           WAV_RIFF_ERR_NOT_WAVE,  0,    0,  0, 0 },
+		{ "data before fmt",         WAV_RIFF_ERR_NO_FMT,    0,    0,  0, 0 },
+		{ "no data chunk",           WAV_RIFF_ERR_NO_DATA,   0,    0,  0, 0 },
+		{ "MS ADPCM",                WAV_RIFF_ERR_FORMAT,    0,    0,  0, 0 },
+		{ "12-bit container",        WAV_RIFF_ERR_FORMAT,    0,    0,  0, 0 },
+	};
+	int failures = 0;
+
+	printf("RIFF chunk walker\n");
+	for (uint32_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++)
+	{
+		MemFile_t mf = { riffFile, buildCase(c) };
+		WAV_RIFF_InfoTypeDef info;
+		WAV_RIFF_StatusTypeDef status = wavRiff_parse(&info, readMem, &mf, mf.size);
+		bool ok = (status == cases[c].status);
+
+		if (ok && status == WAV_RIFF_OK)
+		{
+			ok = info.dataOffset == cases[c].dataOffset && info.frames == cases[c].frames
+			  && info.bitsPerSample == cases[c].bits && info.encoding == cases[c].encoding
+			  && info.dataBytes == info.frames * info.blockAlign;
+		}
+		printf("  %-26s status %u offset %4u frames %4u %s\n", cases[c].label, status,
+		       status == WAV_RIFF_OK ? info.dataOffset : 0, status == WAV_RIFF_OK ? info.frames : 0,
+		       ok ? "ok" : "FAIL");
+		failures += ok ? 0 : 1;
+	}
+	return failures;
+}
+
+// Stereo 16-bit WAV with a LIST chunk in front of the audio, registered once
+static uint8_t *makeWav(const char *name, uint32_t seconds, uint32_t *dataOffset, uint32_t *dataBytes)
+{
+	const uint32_t bytes = seconds * BENCH_RATE * BENCH_CHANNELS * sizeof(int16_t);
+	const uint32_t listBytes = 8 + 26;
+	uint8_t *wav = malloc(44 + listBytes + bytes);
+
+	if (!wav)
+		return NULL;
+	bench_writeWavHeader(wav, BENCH_RATE, BENCH_CHANNELS, 16, bytes);
+	memmove(wav + 36 + listBytes, wav + 36, 8);						// "data" header after the LIST chunk
+	memcpy(wav + 36, "LIST", 4);
+	memcpy(wav + 40, &(uint32_t){ 26 }, 4);
+	memset(wav + 44, ' ', 26);
+	memcpy(wav + 4, &(uint32_t){ 36 + listBytes + bytes }, 4);
+	bench_fillNoise((int16_t*)(wav + 44 + listBytes), bytes / 2, 11);
+	hostFf_addMemFile(name, wav, 44 + listBytes + bytes);
+	*dataOffset = 44 + listBytes;
+	*dataBytes = bytes;
+	return wav;
+}
+
+// First bytes the player hands to the DMA come from the data chunk, at the seek target
+static int checkPlayerStart(void)
+{
+	const uint32_t slotBytes = WAV_BALANCED_SLOT_FRAMES * BENCH_CHANNELS * sizeof(int16_t);
+	const uint32_t targets[] = { 0, 1234, 3900 };
+	const uint8_t *ring;
+	uint32_t dataOffset, dataBytes;
+	uint8_t *wav = makeWav("start.wav", 4, &dataOffset, &dataBytes);
+	int failures = 0;
+
+	if (!wav)
+		return 1;
+	printf("\nPlayer start and seek (LIST chunk before the audio, echo off)\n");
+	for (uint32_t t = 0; t < sizeof(targets) / sizeof(targets[0]); t++)
+	{
+		uint32_t frame = (uint32_t)((uint64_t)targets[t] * BENCH_RATE / 1000);
+		const uint8_t *expect = wav + dataOffset + frame * BENCH_CHANNELS * sizeof(int16_t);
+		bool ok;
+
+		wavPlayer_fileSelect("start.wav");
+		wavPlayer_seek(targets[t]);
+		wavPlayer_play();
+		ring = (const uint8_t*)hi2s3.pTxBuffPtr;
+		ok = memcmp(ring, expect, slotBytes) == 0 && wavPlayer_getLengthMs() == 4000
+		  && wavPlayer_getPositionMs() == targets[t] + 1000u * 2 * WAV_BALANCED_SLOT_FRAMES / BENCH_RATE;
+
+		// Seek while playing: the slot refilled after the next DMA event holds the new position
+		wavPlayer_seek(targets[t] / 2);
+		hostHal_i2sHalfTransfer();
+		wavPlayer_process();
+		frame = (uint32_t)((uint64_t)(targets[t] / 2) * BENCH_RATE / 1000);
+		expect = wav + dataOffset + frame * BENCH_CHANNELS * sizeof(int16_t);
+		ok = ok && memcmp(ring, expect, slotBytes) == 0;
+		wavPlayer_stop();
+		printf("  start at %4u ms, scrub to %4u ms %s\n", targets[t], targets[t] / 2, ok ? "ok" : "FAIL");
+		failures += ok ? 0 : 1;
+	}
+	return failures;
+}
+
+// Per-sample model of the conversion of the sample at p
+static int16_t refSample(const PcmFormat_t *f, const uint8_t *p)
+{
+	int32_t v;
+	float x;
+
+	switch (f->bits)
+	{
+	case 8:
+		return (int16_t)((p[0] - 128) * 256);
+	case 16:
+		return (int16_t)(p[0] | p[1] << 8);
+	case 24:
+		return (int16_t)(p[1] | p[2] << 8);
+	default:
+		if (f->encoding == WAV_RIFF_PCM)
+			return (int16_t)(p[2] | p[3] << 8);
+		memcpy(&x, p, 4);
+		if (isnan(x))
+			return 0;
+		v = (int32_t)lroundf(fmaxf(fminf(x * 32768.0f, 32767.0f), -32768.0f));
+		return (int16_t)v;
+	}
+}
+
+// Random source data; float sources span ±1.25 with a NaN and both infinities
+static void fillSource(const PcmFormat_t *f, uint8_t *src, uint32_t frames)
+{
+	uint32_t samples = frames * f->channels;
+
+	bench_fillNoise((int16_t*)src, samples * f->bits / 16 + 1, 21);
+	if (f->encoding == WAV_RIFF_FLOAT)
+	{
+		float *x = (float*)src;
+		for (uint32_t i = 0; i < samples; i++)
+		{
+			x[i] = 1.25f * ((int16_t)(i * 2654435761u >> 16)) / 32768.0f;
+		}
+		x[3] = NAN;
+		x[5] = INFINITY;
+		x[7] = -INFINITY;
+	}
+}
+
+// Every kernel against the per-sample model, mono copied to both channels
+static int checkConvert(void)
+{
+	static uint8_t src[BENCH_CONV_FRAMES * PCM_MAX_FRAME_BYTES + 4] __attribute__((aligned(4)));
+	static int16_t dst[BENCH_CONV_FRAMES * 2];
+	int failures = 0;
+
+	printf("\nFormat conversion to 16-bit stereo against the per-sample model (%u frames)\n", BENCH_CONV_FRAMES);
+	for (uint32_t k = 0; k < sizeof(formats) / sizeof(formats[0]); k++)
+	{
+		const PcmFormat_t *f = &formats[k];
+		PCM_ConvertFunc convert = pcmConvert_select(f->encoding, f->bits, f->channels);
+		uint32_t sampleBytes = f->bits / 8u, errors = 0;
+
+		fillSource(f, src, BENCH_CONV_FRAMES);
+		convert(src, dst, BENCH_CONV_FRAMES);
+		for (uint32_t i = 0; i < BENCH_CONV_FRAMES; i++)
+		{
+			const uint8_t *frame = &src[i * f->channels * sampleBytes];
+			int16_t l = refSample(f, frame);
+			int16_t r = refSample(f, frame + (f->channels - 1) * sampleBytes);
+			errors += (dst[2 * i] != l) + (dst[2 * i + 1] != r);
+		}
+		printf("  %-12s %s\n", f->label, errors ? "FAIL" : "ok");
+		failures += errors ? 1 : 0;
+	}
+	return failures;
+}
+
+// Throughput of every kernel on one throughput-profile slot
+static void benchConvert(void)
+{
+	static uint8_t src[WAV_THROUGHPUT_SLOT_FRAMES * PCM_MAX_FRAME_BYTES + 4] __attribute__((aligned(4)));
+	static int16_t dst[WAV_THROUGHPUT_SLOT_FRAMES * 2] __attribute__((aligned(4)));
+
+	bench_printRateHeader("Format conversion throughput (per output sample)");
+	for (uint32_t k = 0; k < sizeof(formats) / sizeof(formats[0]); k++)
+	{
+		const PcmFormat_t *f = &formats[k];
+		PCM_ConvertFunc convert = pcmConvert_select(f->encoding, f->bits, f->channels);
+		uint64_t best = UINT64_MAX;
+
+		fillSource(f, src, WAV_THROUGHPUT_SLOT_FRAMES);
+		for (int r = 0; r < BENCH_REPEATS; r++)
+		{
+			uint64_t t0 = bench_nowNs();
+			for (uint32_t n = 0; n < BENCH_CONV_REPEATS; n++)
+			{
+				convert(src, dst, WAV_THROUGHPUT_SLOT_FRAMES);
+				__asm__ volatile("" : : "r"(dst) : "memory");	// Keep every pass
+			}
+			uint64_t dt = bench_nowNs() - t0;
+			if (dt < best)
+				best = dt;
+		}
+		bench_printRate(f->label, WAV_THROUGHPUT_SLOT_FRAMES, best,
+		                (uint64_t)BENCH_CONV_REPEATS * WAV_THROUGHPUT_SLOT_FRAMES * 2);
+	}
+}
+
+// The player converts mono, 24-bit and float files into the ring
+static int checkPlayerFormats(void)
+{
+	static const uint32_t picks[] = { 0, 4, 9 };			// u8 mono, s24 mono, f32 stereo
+	static const char *names[] = { "u8mono.wav", "s24mono.wav", "f32stereo.wav" };	// Kept by hostFf_addMemFile
+	const uint32_t frames = BENCH_RATE / 2;
+	const uint8_t *ring;
+	int failures = 0;
+
+	printf("\nPlayer ring contents for converted formats (echo off)\n");
+	for (uint32_t k = 0; k < sizeof(picks) / sizeof(picks[0]); k++)
+	{
+		const PcmFormat_t *f = &formats[picks[k]];
+		const uint32_t blockAlign = f->channels * f->bits / 8u;
+		uint8_t *wav = malloc(44 + frames * blockAlign + 4);
+		static int16_t expect[WAV_RING_MAX_BYTES / 2];
+		bool ok;
+
+		if (!wav)
+			return failures + 1;
+		bench_writeWavHeader(wav, BENCH_RATE, f->channels, f->bits, frames * blockAlign);
+		memcpy(wav + 20, &f->encoding, 2);
+		fillSource(f, wav + 44, frames);
+		hostFf_addMemFile(names[k], wav, 44 + frames * blockAlign);		// Registered for good, never freed
+
+		ok = wavPlayer_fileSelect(names[k]);
+		wavPlayer_play();
+		ring = (const uint8_t*)hi2s3.pTxBuffPtr;
+		pcmConvert_select(f->encoding, f->bits, f->channels)(wav + 44, expect, 2 * WAV_BALANCED_SLOT_FRAMES);
+		ok = ok && memcmp(ring, expect, 2 * WAV_BALANCED_SLOT_FRAMES * PCM_OUT_FRAME_BYTES) == 0;
+		// Next half of the ring, refilled from the FIFO during playback
+		hostHal_i2sHalfTransfer();
+		wavPlayer_process();
+		pcmConvert_select(f->encoding, f->bits, f->channels)(wav + 44 + 2 * WAV_BALANCED_SLOT_FRAMES * blockAlign,
+		                                                       expect, WAV_BALANCED_SLOT_FRAMES);
+		ok = ok && memcmp(ring, expect, WAV_BALANCED_SLOT_FRAMES * PCM_OUT_FRAME_BYTES) == 0
+		        && wavPlayer_getLengthMs() == 500;
+		wavPlayer_stop();
+		printf("  %-12s %s\n", f->label, ok ? "ok" : "FAIL");
+		failures += ok ? 0 : 1;
+	}
+	return failures;
+}
+
+// WAV of frames frames in format f at rate, noise or silence, registered for good
+static uint8_t *makeFormatWav(const char *name, const PcmFormat_t *f, uint32_t rate, uint32_t frames, bool silent)
+{
+	const uint32_t bytes = frames * f->channels * f->bits / 8u;
+	uint8_t *wav = calloc(1, 44 + bytes + 4);
+
+	if (!wav)
+		return NULL;
+	bench_writeWavHeader(wav, rate, f->channels, f->bits, bytes);
+	memcpy(wav + 20, &f->encoding, 2);
+	if (!silent)
+		fillSource(f, wav + 44, frames);
+	else if (f->bits == 8)
+		memset(wav + 44, 0x80, bytes);					// Unsigned 8-bit silence
+	hostFf_addMemFile(name, wav, 44 + bytes);
+	return wav;
+}
+
+// Capture the ring half the DMA is about to play, then let it play and run the playlist
+static void playHalf(int16_t *out, uint32_t half)
+{
+	const uint32_t halfFrames = WAV_BALANCED_SLOTS / 2 * WAV_BALANCED_SLOT_FRAMES;
+	const int16_t *ring = (const int16_t*)hi2s3.pTxBuffPtr;
+
+	memcpy(out, &ring[2 * half * halfFrames], halfFrames * PCM_OUT_FRAME_BYTES);
+	if (half == 0)
+		hostHal_i2sHalfTransfer();
+	else
+		hostHal_i2sFullTransfer();
+	playlist_process();
+}
+
+// Play the playlist from its first track for at least frames frames, into out
+static uint32_t playFrames(int16_t *out, uint32_t frames)
+{
+	const uint32_t halfFrames = WAV_BALANCED_SLOTS / 2 * WAV_BALANCED_SLOT_FRAMES;
+	uint32_t captured = 0;
+
+	playlist_start(0);
+	while (captured < frames)
+	{
+		playHalf(&out[2 * captured], (captured / halfFrames) & 1u);
+		captured += halfFrames;
+	}
+	return captured;
+}
+
+// Three tracks in different formats at one rate play back to back as one stream, then a track at
+// another rate follows after a restart, and the echo of one track sounds in the next. Track
+// lengths are not whole slots, so the switches fall inside a slot refill.
+static int checkGapless(void)
+{
+	static const uint32_t picks[] = { 3, 4, 0 };			// s16 stereo, s24 mono, u8 mono
+	static const uint32_t lengths[] = { 3001, 2467, 1999 };
+	static const char *names[] = { "gap_a.wav", "gap_b.wav", "gap_c.wav" };
+	const uint32_t tailFrames = BENCH_RATE * 3 / 2;
+	uint32_t total = 0, captured, mismatch = 0, inits, plls, changes, restarts, echoed = 0;
+	int16_t *expect, *out;
+	uint8_t *wav[3];
+	bool ok;
+	int failures = 0;
+
+	printf("\nGapless playlist (%u Hz)\n", BENCH_RATE);
+	for (uint32_t k = 0; k < 3; k++)
+	{
+		wav[k] = makeFormatWav(names[k], &formats[picks[k]], BENCH_RATE, lengths[k], false);
+		total += lengths[k];
+	}
+	makeFormatWav("gap_44k.wav", &formats[3], 44100, 4410, false);
+	makeFormatWav("gap_silent.wav", &formats[3], BENCH_RATE, tailFrames, true);
+	expect = calloc(tailFrames + 4096, PCM_OUT_FRAME_BYTES);
+	out = calloc(tailFrames + 4096, PCM_OUT_FRAME_BYTES);
+	if (!expect || !out || !wav[0] || !wav[1] || !wav[2])
+		return 1;
+	for (uint32_t k = 0, pos = 0; k < 3; pos += lengths[k], k++)
+	{
+		const PcmFormat_t *f = &formats[picks[k]];
+		pcmConvert_select(f->encoding, f->bits, f->channels)(wav[k] + 44, &expect[2 * pos], lengths[k]);
+	}
+
+	// Mixed formats, echo off: the ring holds the three files back to back, then silence
+	playlist_clear();
+	for (uint32_t k = 0; k < 3; k++)
+		playlist_add(names[k]);
+	playlist_add("gap_missing.wav");					// Skipped at the end
+	changes = wavPlayer_getTrackChanges();
+	restarts = playlist_getRestarts();
+	wavPlayer_fileSelect(names[0]);					// Clock the output for the rate first
+	wavPlayer_play();
+	wavPlayer_stop();
+	inits = hostHal_i2sInitCount();
+	plls = hostHal_pllConfigCount();
+	captured = playFrames(out, total);
+	for (uint32_t n = 0; n < 2 * captured; n++)
+		mismatch += out[n] != expect[n];
+	changes = wavPlayer_getTrackChanges() - changes;
+	ok = mismatch == 0 && changes == 2 && playlist_getRestarts() == restarts && playlist_isFinished()
+	  && hostHal_i2sInitCount() == inits && hostHal_pllConfigCount() == plls && wavPlayer_getFifoUnderruns() == 0;
+	wavPlayer_stop();
+	printf("  s16 stereo, s24 mono, u8 mono: %u of %u samples differ, %u gapless switches, %u I2S inits %s\n",
+	       mismatch, 2 * captured, changes, hostHal_i2sInitCount() - inits, ok ? "ok" : "FAIL");
+	failures += ok ? 0 : 1;
+
+	// Next track at another rate: the stream restarts with the I2S clocked for it
+	playlist_clear();
+	playlist_add(names[2]);
+	playlist_add("gap_44k.wav");
+	inits = hostHal_i2sInitCount();
+	restarts = playlist_getRestarts();
+	playFrames(out, lengths[2] + 2048);
+	ok = playlist_getRestarts() == restarts + 1 && playlist_getCurrent() == 1 && wavPlayer_getOutputRate() == 44100
+	  && hostHal_i2sInitCount() == inits + 1;
+	playlist_stop();
+	printf("  u8 mono 48 kHz, then 44.1 kHz: %u restart, %u I2S init %s\n", playlist_getRestarts() - restarts,
+	       hostHal_i2sInitCount() - inits, ok ? "ok" : "FAIL");
+	failures += ok ? 0 : 1;
+
+	// Echo on: the repeats of the first track sound in the silent track after it
+	hostHal_setPin(GPIOA, GPIO_PIN_2, GPIO_PIN_SET);
+	playlist_clear();
+	playlist_add(names[0]);
+	playlist_add("gap_silent.wav");
+	captured = playFrames(out, tailFrames);
+	for (uint32_t n = 2 * (lengths[0] + 2048); n < 2 * captured; n++)
+		echoed += out[n] != 0;
+	ok = echoed > 0 && playlist_getCurrent() == 1;
+	playlist_stop();
+	hostHal_setPin(GPIOA, GPIO_PIN_2, GPIO_PIN_RESET);
+	printf("  echo tail into the next track: %u nonzero samples %s\n", echoed, ok ? "ok" : "FAIL");
+	failures += ok ? 0 : 1;
+
+	free(expect);
+	free(out);
+	return failures;
+}
+
+// Event trace of one playback: every DMA half and refill recorded in order, the file saved whole.
+// savePath: also save it there (relative to the working directory) for trace_decode, or NULL.
+static int checkTrace(const char *savePath)
+{
+	const uint32_t frames = 40 * WAV_BALANCED_SLOT_FRAMES + 77;
+	uint32_t counts[TRACE_EV_COUNT] = { 0 };
+	uint32_t halves = 0, reads = 0, order = 0, prevTime = 0, open = 0, saved = 0;
+	char dir[64], path[96];
+	uint64_t t0, ns;
+	bool ok, playSeen = false;
+	FILE *fp;
+
+	printf("\nEvent trace (%u records of %u bytes)\n", TRACE_RECORDS, (unsigned)sizeof(TRACE_RecordTypeDef));
+	makeFormatWav("trace.wav", &formats[3], BENCH_RATE, frames, false);		// s16 stereo: file bytes are output bytes
+	trace_init();
+	wavPlayer_fileSelect("trace.wav");
+	wavPlayer_play();
+	while (!wavPlayer_isFinished())
+	{
+		if (halves++ & 1)
+			hostHal_i2sFullTransfer();
+		else
+			hostHal_i2sHalfTransfer();
+		wavPlayer_process();
+	}
+	wavPlayer_stop();
+
+	for (uint32_t i = 0; i < trace_getCount() && i < TRACE_RECORDS; i++)
+	{
+		const TRACE_RecordTypeDef *r = &traceBuffer.ring[i];
+		const uint8_t type = (uint8_t)(r->event >> 24);
+		const uint32_t arg = r->event & TRACE_ARG_MASK;
+
+		counts[type < TRACE_EV_COUNT ? type : 0]++;
+		order += (i > 0 && r->time < prevTime) ? 1u : 0u;		// Host clock: no wrap within a run
+		prevTime = r->time;
+		if (type == TRACE_EV_REFILL_START)
+			order += open++ ? 1u : 0u;							// Refills never nest
+		else if (type == TRACE_EV_REFILL_END)
+			order += open-- ? 0u : 1u;
+		else if (type == TRACE_EV_FILE_READ)
+			reads += arg;
+		else if (type == TRACE_EV_PLAYER && (arg & 0xFu) == TRACE_PLAYER_PLAY)
+			playSeen = (arg >> 4) == BENCH_RATE;
+	}
+	ok = trace_getCount() < TRACE_RECORDS && counts[0] == 0 && order == 0 && open == 0 && playSeen
+	  && counts[TRACE_EV_DMA_HALF] == halves && counts[TRACE_EV_REFILL_START] > 0
+	  && counts[TRACE_EV_REFILL_START] == counts[TRACE_EV_REFILL_END] && counts[TRACE_EV_CODEC_CMD] > 0
+	  && reads == frames * PCM_OUT_FRAME_BYTES && counts[TRACE_EV_UNDERRUN] == 0;
+	printf("  %u events: %u DMA halves, %u refills, %u file reads of %u bytes, %u codec writes, %u out of order %s\n",
+	       trace_getCount(), counts[TRACE_EV_DMA_HALF], counts[TRACE_EV_REFILL_START], counts[TRACE_EV_FILE_READ], reads,
+	       counts[TRACE_EV_CODEC_CMD], order, ok ? "ok" : "FAIL");
+
+	// Saved to the drive as laid out in memory
+	snprintf(dir, sizeof(dir), "/tmp/bench_trace_XXXXXX");
+	if (mkdtemp(dir))
+	{
+		hostFf_setRoot(dir);
+		saved = trace_save(TRACE_FILE) ? 1u : 0u;
+		hostFf_setRoot(".");
+		snprintf(path, sizeof(path), "%s/%s", dir, TRACE_FILE);
+		fp = fopen(path, "rb");
+		if (fp && fseek(fp, 0, SEEK_END) == 0 && ftell(fp) == (long)sizeof(traceBuffer))
+			saved++;
+		if (fp)
+			fclose(fp);
+		remove(path);
+		rmdir(dir);
+	}
+	ok = ok && saved == 2;
+
+	// For the decoder: the middle DMA half preempted the writer before it, which stamped its time after
+	if (savePath)
+	{
+		uint32_t half = counts[TRACE_EV_DMA_HALF] / 2u, j = 1;
+		TRACE_RecordTypeDef *ring = traceBuffer.ring;
+
+		for (; j < trace_getCount(); j++)
+		{
+			if ((ring[j].event >> 24) == TRACE_EV_DMA_HALF && half-- == 0u)
+				break;
+		}
+		if (j < trace_getCount())
+		{
+			uint32_t t = ring[j].time;
+
+			ring[j].time = ring[j - 1].time;
+			ring[j - 1].time = t;
+		}
+		hostFf_setRoot(".");
+		ok = ok && j < trace_getCount() && trace_save(savePath);
+		printf("  saved to %s for trace_decode, records %u and %u stamped out of order %s\n", savePath, j - 1, j,
+		       ok ? "ok" : "FAIL");
+	}
+
+	// Cost of one event
+	t0 = bench_nowNs();
+	for (uint32_t i = 0; i < (1u << 20); i++)
+		trace_event(TRACE_EV_MARK, i);
+	ns = bench_nowNs() - t0;
+	printf("  saved %u bytes %s, %.1f ns per event on the host\n", (unsigned)sizeof(traceBuffer),
+	       saved == 2 ? "ok" : "FAIL", (double)ns / (1u << 20));
+	return ok ? 0 : 1;
+}
+
+// Random seeks in a long recording during playback
+static void reportSeeks(UINT fragments)
+{
+	static uint32_t dataOffset, dataBytes;
+	static uint8_t *wav = NULL;
+	uint32_t reads, lookups, x = 99;
+	uint64_t worst = 0, total = 0;
+
+	if (!wav)
+		wav = makeWav("long.wav", BENCH_LONG_SECONDS, &dataOffset, &dataBytes);
+	if (!wav)
+		return;
+	hostFf_setFragments(fragments);
+	wavPlayer_fileSelect("long.wav");
+	wavPlayer_play();
+	reads = hostFf_readCount();
+	lookups = hostFf_fatLookups();
+	for (uint32_t s = 0; s < BENCH_SEEKS; s++)
+	{
+		x ^= x << 13;
+		x ^= x >> 17;
+		x ^= x << 5;
+		uint64_t t0 = bench_nowNs();
+		wavPlayer_seek(x % (BENCH_LONG_SECONDS * 1000u));
+		uint64_t dt = bench_nowNs() - t0;
+		total += dt;
+		if (dt > worst)
+			worst = dt;
+		hostHal_i2sHalfTransfer();
+		wavPlayer_process();
+	}
+	reads = hostFf_readCount() - reads;
+	lookups = hostFf_fatLookups() - lookups;
+	wavPlayer_stop();
+	printf("%9u %9s %12.1f %12.1f %10.2f %10.2f\n", fragments, wavPlayer_isFastSeek() ? "yes" : "no",
+	       (double)reads / BENCH_SEEKS, (double)lookups / BENCH_SEEKS, total / 1000.0 / BENCH_SEEKS,
+	       worst / 1000.0);
+	hostFf_setFragments(1);
+}
+
+int main(int argc, char **argv)
+{
+	const bool quick = bench_isQuick(argc, argv);
+	const char *savePath = NULL;
+	int failures = 0;
+
+	for (int i = 1; i + 1 < argc; i++)
+	{
+		if (strcmp(argv[i], "--save-trace") == 0)
+			savePath = argv[i + 1];
+	}
+	hostHal_setPin(GPIOA, GPIO_PIN_2, GPIO_PIN_RESET);			// Echo off, the ring holds file data
+	audioI2S_setHandle(&hi2s3);
+
+	failures += checkRiff();
+	failures += checkPlayerStart();
+	failures += checkConvert();
+	if (!quick)
+		benchConvert();
+	failures += checkPlayerFormats();
+	failures += checkGapless();
+	failures += checkTrace(savePath);
+	if (quick)
+		return failures ? 1 : 0;
+
+	printf("\nSeeks during playback of a %u s recording (%u KB clusters, host time of wavPlayer_seek)\n",
+	       BENCH_LONG_SECONDS, USBHFatFS.csize * FF_MAX_SS / 1024);
+	printf("%9s %9s %12s %12s %10s %10s\n", "fragments", "fast-seek", "f_read/seek", "FAT/seek",
+	       "mean us", "max us");
+	reportSeeks(1);
+	reportSeeks(40);
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,19 @@
+/*
+Library:				fatfs.h (host stand-in)
+Written by:				Shridattha M Hebbar
+Date Written:			16/10/2026
+Description:			Host replacement for the CubeMX generated FATFS glue header.
+*/
+
+#ifndef FATFS_H_
+#define FATFS_H_
+
+#include "ff.h"
+
+extern char USBHPath[4];
+extern FATFS USBHFatFS;
+extern FIL USBHFile;
+
+void MX_FATFS_Init(void);
+
+#endif /* FATFS_H_ */
@@ -0,0 +1,145 @@
+/*
+Library:				ff.h (host stand-in)
+Written by:				Shridattha M Hebbar
+Date Written:			16/10/2026
+Description:			Subset of the FatFs API backed by in-memory files or the host file system,
+						used to run the WAV player off-target.
+*/
+
+#ifndef FF_H_
+#define FF_H_
+
+#include <stdint.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef unsigned int	UINT;
+typedef unsigned char	BYTE;
+typedef uint16_t		WORD;
+typedef uint32_t		DWORD;
+typedef char			TCHAR;
+typedef DWORD			FSIZE_t;
+
+typedef enum
+{
+  FR_OK = 0,
+  FR_DISK_ERR,
+  FR_INT_ERR,
+  FR_NOT_READY,
+  FR_NO_FILE,
+  FR_NO_PATH,
+  FR_INVALID_NAME,
+  FR_DENIED,
+  FR_EXIST,
+  FR_INVALID_OBJECT,
+  FR_WRITE_PROTECTED,
+  FR_INVALID_DRIVE,
+  FR_NOT_ENABLED,
+  FR_NO_FILESYSTEM,
+  FR_MKFS_ABORTED,
+  FR_TIMEOUT,
+  FR_LOCKED,
+  FR_NOT_ENOUGH_CORE,
+  FR_TOO_MANY_OPEN_FILES,
+  FR_INVALID_PARAMETER
+}FRESULT;
+
+//File access mode flags
+#define FA_READ				0x01
+#define FA_WRITE			0x02
+#define FA_OPEN_EXISTING	0x00
+#define FA_CREATE_NEW		0x04
+#define FA_CREATE_ALWAYS	0x08
+#define FA_OPEN_ALWAYS		0x10
+
+#define FF_MAX_SS			512		// Sector size
+#define FF_USE_FASTSEEK		1		// Cluster link map (FIL.cltbl)
+
+#define CREATE_LINKMAP		((FSIZE_t)0 - 1)	// f_lseek() offset that builds the link map
+
+//File attributes
+#define AM_RDO				0x01
+#define AM_HID				0x02
+#define AM_SYS				0x04
+#define AM_DIR				0x10
+#define AM_ARC				0x20
+
+#define FF_USE_LFN			2		// Long file names, FILINFO.fname holds up to FF_LFN_BUF characters
+#define FF_LFN_BUF			255
+
+typedef struct
+{
+  WORD csize;			// Sectors per cluster (see hostFf_setClusterSectors)
+}FATFS;
+
+typedef struct
+{
+  FATFS *fs;
+  FSIZE_t objsize;
+}FFOBJID;
+
+typedef struct
+{
+  FFOBJID obj;
+  FSIZE_t fptr;
+  DWORD *cltbl;			// Link map of the fast-seek mode, or NULL
+  const BYTE *mem;		// In-memory backing (hostFf_addMemFile), or NULL
+  FILE *fp;				// Host file backing, or NULL
+}FIL;
+
+typedef struct
+{
+  FATFS *fs;
+  char **names;			// Host directory entries, sorted by name
+  UINT count;
+  UINT index;			// Next entry f_readdir() returns
+  char path[256];		// Host path of the directory
+}DIR;
+
+typedef struct
+{
+  FSIZE_t fsize;
+  WORD fdate;			// Modification date: bits 15-9 year from 1980, 8-5 month, 4-0 day
+  WORD ftime;			// Modification time: bits 15-11 hour, 10-5 minute, 4-0 second / 2
+  BYTE fattrib;
+  TCHAR fname[FF_LFN_BUF + 1];
+}FILINFO;
+
+#define f_size(fp)		((fp)->obj.objsize)
+#define f_tell(fp)		((fp)->fptr)
+#define f_eof(fp)		((int)((fp)->fptr == (fp)->obj.objsize))
+
+FRESULT f_mount(FATFS* fs, const TCHAR* path, BYTE opt);
+FRESULT f_open(FIL* fp, const TCHAR* path, BYTE mode);
+FRESULT f_close(FIL* fp);
+FRESULT f_read(FIL* fp, void* buff, UINT btr, UINT* br);
+FRESULT f_lseek(FIL* fp, FSIZE_t ofs);
+FRESULT f_write(FIL* fp, const void* buff, UINT btw, UINT* bw);
+FRESULT f_opendir(DIR* dp, const TCHAR* path);
+FRESULT f_readdir(DIR* dp, FILINFO* fno);
+FRESULT f_closedir(DIR* dp);
+FRESULT f_stat(const TCHAR* path, FILINFO* fno);
+FRESULT f_unlink(const TCHAR* path);
+FRESULT f_rename(const TCHAR* path_old, const TCHAR* path_new);
+
+//Host simulation hooks
+void hostFf_setRoot(const char *dir);
+int hostFf_addMemFile(const char *name, const void *data, uint32_t size);
+uint32_t hostFf_readCount(void);
+void hostFf_setClusterSectors(WORD sectors);
+void hostFf_setFragments(UINT count);
+uint32_t hostFf_fatLookups(void);
+uint32_t hostFf_windowBytes(void);
+uint32_t hostFf_writeCount(void);
+void hostFf_setWriteSpace(uint32_t bytes);
+uint32_t hostFf_openCount(void);
+uint32_t hostFf_dirBytes(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FF_H_ */
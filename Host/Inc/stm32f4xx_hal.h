@@ -0,0 +1,227 @@
+/*
+Library:				stm32f4xx_hal.h (host stand-in)
+Written by:				Shridattha M Hebbar
+Date Written:			16/10/2026
+Description:			Minimal stand-in for the STM32CubeF4 HAL so that the Core/ sources can be
+						compiled and benchmarked on a development PC. Only the types, macros and
+						functions used by the player, I2S and codec drivers are provided.
+*/
+
+#ifndef STM32F4XX_HAL_H_
+#define STM32F4XX_HAL_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//Compiler / CMSIS keywords
+#define __IO		volatile
+#define __weak		__attribute__((weak))
+
+//HAL status
+typedef enum
+{
+  HAL_OK       = 0x00U,
+  HAL_ERROR    = 0x01U,
+  HAL_BUSY     = 0x02U,
+  HAL_TIMEOUT  = 0x03U
+}HAL_StatusTypeDef;
+
+typedef enum
+{
+  HAL_UNLOCKED = 0x00U,
+  HAL_LOCKED   = 0x01U
+}HAL_LockTypeDef;
+
+#define __HAL_UNLOCK(__HANDLE__)		do{ (__HANDLE__)->Lock = HAL_UNLOCKED; }while (0U)
+
+//--------------------------------------------------------------//
+//--------------------------- GPIO -----------------------------//
+//--------------------------------------------------------------//
+
+typedef enum
+{
+  GPIO_PIN_RESET = 0,
+  GPIO_PIN_SET
+}GPIO_PinState;
+
+typedef struct
+{
+  uint16_t IDR;		// Input levels driven by the host (see hostHal_setPin)
+  uint16_t ODR;		// Output levels written by the application
+}GPIO_TypeDef;
+
+extern GPIO_TypeDef hostGpio[5];
+
+#define GPIOA		(&hostGpio[0])
+#define GPIOB		(&hostGpio[1])
+#define GPIOC		(&hostGpio[2])
+#define GPIOD		(&hostGpio[3])
+#define GPIOH		(&hostGpio[4])
+
+#define GPIO_PIN_0		((uint16_t)0x0001)
+#define GPIO_PIN_1		((uint16_t)0x0002)
+#define GPIO_PIN_2		((uint16_t)0x0004)
+#define GPIO_PIN_3		((uint16_t)0x0008)
+#define GPIO_PIN_4		((uint16_t)0x0010)
+#define GPIO_PIN_12		((uint16_t)0x1000)
+#define GPIO_PIN_13		((uint16_t)0x2000)
+#define GPIO_PIN_14		((uint16_t)0x4000)
+#define GPIO_PIN_15		((uint16_t)0x8000)
+
+GPIO_PinState HAL_GPIO_ReadPin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin);
+void HAL_GPIO_WritePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState);
+void HAL_GPIO_TogglePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin);
+
+//--------------------------------------------------------------//
+//---------------------------- ADC -----------------------------//
+//--------------------------------------------------------------//
+
+typedef struct
+{
+  uint32_t Instance;
+  uint32_t Value;		// Next conversion result (see hostHal_setAdcValue)
+  uint8_t  Running;
+  uint16_t *pDmaBuff;	// Circular DMA destination while converting continuously
+  uint32_t DmaLength;	// DMA length in conversions
+}ADC_HandleTypeDef;
+
+HAL_StatusTypeDef HAL_ADC_Start(ADC_HandleTypeDef *hadc);
+HAL_StatusTypeDef HAL_ADC_Stop(ADC_HandleTypeDef *hadc);
+HAL_StatusTypeDef HAL_ADC_Start_DMA(ADC_HandleTypeDef *hadc, uint32_t *pData, uint32_t Length);
+HAL_StatusTypeDef HAL_ADC_Stop_DMA(ADC_HandleTypeDef *hadc);
+HAL_StatusTypeDef HAL_ADC_PollForConversion(ADC_HandleTypeDef *hadc, uint32_t Timeout);
+uint32_t HAL_ADC_GetValue(ADC_HandleTypeDef *hadc);
+
+//--------------------------------------------------------------//
+//---------------------------- RCC -----------------------------//
+//--------------------------------------------------------------//
+
+#define RCC_PERIPHCLK_I2S		0x00000001U
+
+typedef struct
+{
+  uint32_t PLLI2SN;
+  uint32_t PLLI2SR;
+}RCC_PLLI2SInitTypeDef;
+
+typedef struct
+{
+  uint32_t PeriphClockSelection;
+  RCC_PLLI2SInitTypeDef PLLI2S;
+}RCC_PeriphCLKInitTypeDef;
+
+void HAL_RCCEx_GetPeriphCLKConfig(RCC_PeriphCLKInitTypeDef *PeriphClkInit);
+HAL_StatusTypeDef HAL_RCCEx_PeriphCLKConfig(RCC_PeriphCLKInitTypeDef *PeriphClkInit);
+
+//--------------------------------------------------------------//
+//---------------------------- I2S -----------------------------//
+//--------------------------------------------------------------//
+
+typedef struct
+{
+  uint32_t Enabled;
+}SPI_TypeDef;
+
+extern SPI_TypeDef hostSpi3;
+#define SPI3		(&hostSpi3)
+
+#define I2S_MODE_MASTER_TX			0x00000200U
+#define I2S_STANDARD_PHILIPS		0x00000000U
+#define I2S_DATAFORMAT_16B			0x00000000U
+#define I2S_MCLKOUTPUT_ENABLE		0x00000200U
+#define I2S_CPOL_LOW				0x00000000U
+#define I2S_CLOCK_PLL				0x00000000U
+#define I2S_FULLDUPLEXMODE_DISABLE	0x00000000U
+#define I2S_AUDIOFREQ_44K			44100U
+
+typedef struct
+{
+  uint32_t Mode;
+  uint32_t Standard;
+  uint32_t DataFormat;
+  uint32_t MCLKOutput;
+  uint32_t AudioFreq;
+  uint32_t CPOL;
+  uint32_t ClockSource;
+  uint32_t FullDuplexMode;
+}I2S_InitTypeDef;
+
+typedef struct
+{
+  SPI_TypeDef      *Instance;
+  I2S_InitTypeDef  Init;
+  uint16_t         *pTxBuffPtr;		// DMA source as handed to HAL_I2S_Transmit_DMA
+  uint16_t         TxXferSize;		// DMA length in 16-bit words
+  HAL_LockTypeDef  Lock;
+  uint8_t          Paused;
+}I2S_HandleTypeDef;
+
+#define __HAL_I2S_ENABLE(__HANDLE__)		((__HANDLE__)->Instance->Enabled = 1U)
+#define __HAL_I2S_DISABLE(__HANDLE__)		((__HANDLE__)->Instance->Enabled = 0U)
+
+HAL_StatusTypeDef HAL_I2S_Init(I2S_HandleTypeDef *hi2s);
+HAL_StatusTypeDef HAL_I2S_Transmit_DMA(I2S_HandleTypeDef *hi2s, uint16_t *pData, uint16_t Size);
+HAL_StatusTypeDef HAL_I2S_DMAPause(I2S_HandleTypeDef *hi2s);
+HAL_StatusTypeDef HAL_I2S_DMAResume(I2S_HandleTypeDef *hi2s);
+HAL_StatusTypeDef HAL_I2S_DMAStop(I2S_HandleTypeDef *hi2s);
+void HAL_I2S_TxHalfCpltCallback(I2S_HandleTypeDef *hi2s);
+void HAL_I2S_TxCpltCallback(I2S_HandleTypeDef *hi2s);
+
+//--------------------------------------------------------------//
+//---------------------------- I2C -----------------------------//
+//--------------------------------------------------------------//
+
+#define I2C_MEMADD_SIZE_8BIT		0x00000001U
+
+typedef struct
+{
+  uint32_t Instance;
+}I2C_HandleTypeDef;
+
+HAL_StatusTypeDef HAL_I2C_Mem_Write(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress,
+                                    uint16_t MemAddSize, uint8_t *pData, uint16_t Size, uint32_t Timeout);
+HAL_StatusTypeDef HAL_I2C_Mem_Read(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress,
+                                   uint16_t MemAddSize, uint8_t *pData, uint16_t Size, uint32_t Timeout);
+HAL_StatusTypeDef HAL_I2C_Mem_Write_IT(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress,
+                                       uint16_t MemAddSize, uint8_t *pData, uint16_t Size);
+void HAL_I2C_MemTxCpltCallback(I2C_HandleTypeDef *hi2c);
+void HAL_I2C_ErrorCallback(I2C_HandleTypeDef *hi2c);
+
+//--------------------------------------------------------------//
+//-------------------------- System ----------------------------//
+//--------------------------------------------------------------//
+
+void HAL_Delay(uint32_t Delay);
+uint32_t HAL_GetTick(void);
+
+//--------------------------------------------------------------//
+//------------------- Host simulation hooks --------------------//
+//--------------------------------------------------------------//
+
+void hostHal_setPin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState);
+void hostHal_setAdcValue(uint32_t value);
+void hostHal_i2sHalfTransfer(void);
+void hostHal_i2sFullTransfer(void);
+uint32_t hostHal_i2sInitCount(void);
+uint32_t hostHal_pllConfigCount(void);
+uint32_t hostHal_i2cWriteCount(void);
+bool hostHal_i2cGetWrite(uint32_t index, uint8_t *reg, uint8_t *value);
+uint32_t hostHal_i2cTransferCount(void);
+void hostHal_i2cResetRegisters(void);
+uint8_t hostHal_i2cGetRegister(uint8_t reg);
+void hostHal_i2cSetRegister(uint8_t reg, uint8_t value);
+void hostHal_i2cSetStuck(bool stuck);
+bool hostHal_i2cIrq(void);
+uint64_t hostHal_i2cBusUs(void);
+uint64_t hostHal_i2cBlockedUs(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* STM32F4XX_HAL_H_ */
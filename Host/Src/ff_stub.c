@@ -0,0 +1,467 @@
+/*
+Library:				ff_stub.c
+Written by:				Shridattha M Hebbar
+Date Written:			16/10/2026
+Description:			Host stand-in for FatFs. Files registered with hostFf_addMemFile() are served
+						from memory (for benchmarks), everything else is opened relative to the
+						directory given to hostFf_setRoot().
+						Counts the file system work the real FatFs would do: FAT entries followed
+						when a read or seek crosses clusters without a link map, and bytes copied
+						through the sector window for reads that are not whole aligned sectors.
+						Directories are listed from the host file system in name order, and the
+						directory entry bytes FatFs would read for them are counted. A full drive is
+						simulated with hostFf_setWriteSpace().
+*/
+
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+#include <sys/stat.h>
+#define DIR DIR_HOST			// POSIX DIR, the FatFs DIR takes its name
+#include <dirent.h>
+#undef DIR
+#include "fatfs.h"
+
+#define MEM_FILES_MAX		16
+#define PATH_MAX_LEN		512
+
+typedef struct
+{
+  const char *name;
+  const BYTE *data;
+  uint32_t size;
+}MemFile_t;
+
+char USBHPath[4] = "0:/";
+FATFS USBHFatFS = { 16 };		// 8 KB clusters, common for FAT32 flash drives
+FIL USBHFile;
+
+static MemFile_t memFiles[MEM_FILES_MAX];
+static uint32_t memFileCount = 0;
+static const char *rootDir = ".";
+static uint32_t readCount = 0;
+static uint32_t fatLookups = 0;
+static uint32_t windowBytes = 0;
+static UINT fragments = 1;		// Fragments every file is split into (link map entries needed)
+static uint32_t writeCount = 0;
+static uint32_t openCount = 0;
+static uint32_t writeSpace = UINT32_MAX;	// Bytes left before the drive is full (hostFf_setWriteSpace)
+static uint32_t dirBytes = 0;	// Directory entry bytes read: one 32-byte entry plus one per 13 LFN characters
+
+//--------------------------------------------------------------//
+//---------------------- Static functions ----------------------//
+//--------------------------------------------------------------//
+
+// Strip a FatFs drive prefix ("0:/") and leading separators
+static const char *stripDrive(const TCHAR *path)
+{
+  if(path[0] != '\0' && path[1] == ':')
+  {
+    path += 2;
+  }
+  while(*path == '/')
+  {
+    path++;
+  }
+  return path;
+}
+
+static const MemFile_t *findMemFile(const char *name)
+{
+  for(uint32_t i = 0; i < memFileCount; i++)
+  {
+    if(strcmp(memFiles[i].name, name) == 0)
+    {
+      return &memFiles[i];
+    }
+  }
+  return NULL;
+}
+
+static FSIZE_t clusterBytes(const FIL *fp)
+{
+  return (FSIZE_t)fp->obj.fs->csize * FF_MAX_SS;
+}
+
+// FAT entries followed to move from fptr to ofs, none with a link map
+static void walkChain(const FIL *fp, FSIZE_t ofs)
+{
+  FSIZE_t from = fp->fptr / clusterBytes(fp);
+  FSIZE_t to = ofs / clusterBytes(fp);
+
+  if(fp->cltbl)
+  {
+    return;
+  }
+  fatLookups += (uint32_t)((to >= from) ? to - from : to);	// Backwards seeks restart at the first cluster
+}
+
+// Bytes of a read served through the sector window: partial sectors at either end
+static uint32_t partialBytes(FSIZE_t ofs, UINT btr)
+{
+  FSIZE_t first = (ofs + FF_MAX_SS - 1) / FF_MAX_SS * FF_MAX_SS;
+  FSIZE_t last = (ofs + btr) / FF_MAX_SS * FF_MAX_SS;
+
+  return (last > first) ? btr - (uint32_t)(last - first) : btr;
+}
+
+// f_lseek(fp, CREATE_LINKMAP): one pair of entries per fragment plus the size and terminator
+static FRESULT createLinkMap(FIL *fp)
+{
+  DWORD need = 2u * fragments + 2u;
+  DWORD size = fp->cltbl[0];
+
+  fatLookups += (uint32_t)(fp->obj.objsize / clusterBytes(fp));	// The whole chain is walked once
+  fp->cltbl[0] = need;
+  if(need > size)
+  {
+    return FR_NOT_ENOUGH_CORE;
+  }
+  for(UINT f = 0; f < fragments; f++)
+  {
+    fp->cltbl[1 + 2 * f] = (DWORD)((fp->obj.objsize / clusterBytes(fp) + 1) / fragments);
+    fp->cltbl[2 + 2 * f] = 2u + 1000u * f;
+  }
+  fp->cltbl[need - 1] = 0;
+  return FR_OK;
+}
+
+static void buildHostPath(char *dst, size_t size, const TCHAR *path)
+{
+  const char *name = stripDrive(path);
+
+  snprintf(dst, size, "%s%s%s", rootDir, name[0] ? "/" : "", name);
+}
+
+static int compareNames(const void *a, const void *b)
+{
+  return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+// FAT timestamp of a host modification time
+static void fatTime(time_t t, WORD *date, WORD *time)
+{
+  struct tm tm;
+
+  gmtime_r(&t, &tm);
+  *date = (WORD)(((tm.tm_year - 80) << 9) | ((tm.tm_mon + 1) << 5) | tm.tm_mday);
+  *time = (WORD)((tm.tm_hour << 11) | (tm.tm_min << 5) | (tm.tm_sec / 2));
+}
+
+static FRESULT statHost(const char *path, const char *name, FILINFO *fno)
+{
+  struct stat st;
+  size_t len = strlen(name);
+
+  if(stat(path, &st) != 0)
+  {
+    return FR_NO_FILE;
+  }
+  if(len > FF_LFN_BUF)
+  {
+    len = FF_LFN_BUF;
+  }
+  memcpy(fno->fname, name, len);
+  fno->fname[len] = '\0';
+  fno->fsize = S_ISDIR(st.st_mode) ? 0 : (FSIZE_t)st.st_size;
+  fno->fattrib = S_ISDIR(st.st_mode) ? AM_DIR : AM_ARC;
+  if(name[0] == '.')
+  {
+    fno->fattrib |= AM_HID;
+  }
+  fatTime(st.st_mtime, &fno->fdate, &fno->ftime);
+  return FR_OK;
+}
+
+//--------------------------------------------------------------//
+//---------------------- Public Functions ----------------------//
+//--------------------------------------------------------------//
+
+void MX_FATFS_Init(void)
+{
+}
+
+FRESULT f_mount(FATFS* fs, const TCHAR* path, BYTE opt)
+{
+  (void)fs; (void)path; (void)opt;
+  return FR_OK;
+}
+
+FRESULT f_open(FIL* fp, const TCHAR* path, BYTE mode)
+{
+  const char *name = stripDrive(path);
+  const MemFile_t *mf = findMemFile(name);
+  char hostPath[PATH_MAX_LEN];
+
+  memset(fp, 0, sizeof(*fp));
+  fp->obj.fs = &USBHFatFS;
+  openCount++;
+  if(mf)
+  {
+    if(mode & FA_WRITE)
+    {
+      return FR_DENIED;
+    }
+    fp->mem = mf->data;
+    fp->obj.objsize = mf->size;
+    return FR_OK;
+  }
+
+  snprintf(hostPath, sizeof(hostPath), "%s/%s", rootDir, name);
+  fp->fp = fopen(hostPath, (mode & FA_CREATE_ALWAYS) ? "w+b" : (mode & FA_WRITE) ? "r+b" : "rb");
+  if(!fp->fp)
+  {
+    return FR_NO_FILE;
+  }
+  fseek(fp->fp, 0, SEEK_END);
+  fp->obj.objsize = (FSIZE_t)ftell(fp->fp);
+  fseek(fp->fp, 0, SEEK_SET);
+  return FR_OK;
+}
+
+FRESULT f_close(FIL* fp)
+{
+  if(fp->fp)
+  {
+    fclose(fp->fp);
+  }
+  fp->fp = NULL;
+  fp->mem = NULL;
+  return FR_OK;
+}
+
+FRESULT f_read(FIL* fp, void* buff, UINT btr, UINT* br)
+{
+  FSIZE_t avail;
+
+  *br = 0;
+  if(!fp->mem && !fp->fp)
+  {
+    return FR_INVALID_OBJECT;
+  }
+  readCount++;
+  avail = fp->obj.objsize - fp->fptr;
+  if(btr > avail)
+  {
+    btr = (UINT)avail;
+  }
+  walkChain(fp, fp->fptr + btr);
+  windowBytes += partialBytes(fp->fptr, btr);
+  if(fp->mem)
+  {
+    memcpy(buff, fp->mem + fp->fptr, btr);
+  }
+  else
+  {
+    btr = (UINT)fread(buff, 1, btr, fp->fp);
+  }
+  fp->fptr += btr;
+  *br = btr;
+  return FR_OK;
+}
+
+FRESULT f_lseek(FIL* fp, FSIZE_t ofs)
+{
+  if(!fp->mem && !fp->fp)
+  {
+    return FR_INVALID_OBJECT;
+  }
+  if(ofs == CREATE_LINKMAP && fp->cltbl)
+  {
+    return createLinkMap(fp);
+  }
+  if(ofs > fp->obj.objsize)
+  {
+    ofs = fp->obj.objsize;
+  }
+  walkChain(fp, ofs);
+  fp->fptr = ofs;
+  if(fp->fp)
+  {
+    fseek(fp->fp, (long)ofs, SEEK_SET);
+  }
+  return FR_OK;
+}
+
+FRESULT f_write(FIL* fp, const void* buff, UINT btw, UINT* bw)
+{
+  *bw = 0;
+  if(!fp->fp)
+  {
+    return fp->mem ? FR_DENIED : FR_INVALID_OBJECT;
+  }
+  writeCount++;
+  if(btw > writeSpace)
+  {
+    btw = writeSpace;               // Drive full: FatFs writes what fits and still returns FR_OK
+  }
+  if(writeSpace != UINT32_MAX)
+  {
+    writeSpace -= btw;
+  }
+  btw = (UINT)fwrite(buff, 1, btw, fp->fp);
+  fp->fptr += btw;
+  if(fp->fptr > fp->obj.objsize)
+  {
+    fp->obj.objsize = fp->fptr;
+  }
+  *bw = btw;
+  return FR_OK;
+}
+
+FRESULT f_opendir(DIR* dp, const TCHAR* path)
+{
+  DIR_HOST *hd;
+  struct dirent *de;
+  UINT size = 0;
+
+  memset(dp, 0, sizeof(*dp));
+  dp->fs = &USBHFatFS;
+  buildHostPath(dp->path, sizeof(dp->path), path);
+  hd = opendir(dp->path);
+  if(!hd)
+  {
+    return FR_NO_PATH;
+  }
+  while((de = readdir(hd)) != NULL)
+  {
+    if(strcmp(de->d_name, ".") == 0 || strcmp(de->d_name, "..") == 0)
+    {
+      continue;
+    }
+    if(dp->count == size)
+    {
+      size = size ? 2 * size : 64;
+      dp->names = realloc(dp->names, size * sizeof(char*));
+    }
+    dp->names[dp->count++] = strdup(de->d_name);
+  }
+  closedir(hd);
+  qsort(dp->names, dp->count, sizeof(char*), compareNames);
+  return FR_OK;
+}
+
+FRESULT f_readdir(DIR* dp, FILINFO* fno)
+{
+  char path[PATH_MAX_LEN];
+
+  fno->fname[0] = '\0';
+  while(dp->index < dp->count)
+  {
+    const char *name = dp->names[dp->index++];
+
+    dirBytes += 32u * (1u + ((UINT)strlen(name) + 12u) / 13u);
+    snprintf(path, sizeof(path), "%s/%s", dp->path, name);
+    if(statHost(path, name, fno) == FR_OK)
+    {
+      return FR_OK;
+    }
+  }
+  dirBytes += 32u;									// The free entry that ends the directory
+  return FR_OK;
+}
+
+FRESULT f_closedir(DIR* dp)
+{
+  for(UINT i = 0; i < dp->count; i++)
+  {
+    free(dp->names[i]);
+  }
+  free(dp->names);
+  dp->names = NULL;
+  dp->count = 0;
+  return FR_OK;
+}
+
+FRESULT f_stat(const TCHAR* path, FILINFO* fno)
+{
+  char full[PATH_MAX_LEN];
+  const char *name = strrchr(path, '/');
+
+  buildHostPath(full, sizeof(full), path);
+  return statHost(full, name ? name + 1 : stripDrive(path), fno);
+}
+
+FRESULT f_unlink(const TCHAR* path)
+{
+  char full[PATH_MAX_LEN];
+
+  buildHostPath(full, sizeof(full), path);
+  return (remove(full) == 0) ? FR_OK : FR_NO_FILE;
+}
+
+FRESULT f_rename(const TCHAR* path_old, const TCHAR* path_new)
+{
+  char from[PATH_MAX_LEN], to[PATH_MAX_LEN];
+
+  buildHostPath(from, sizeof(from), path_old);
+  buildHostPath(to, sizeof(to), path_new);
+  return (rename(from, to) == 0) ? FR_OK : FR_NO_FILE;
+}
+
+//--------------------------------------------------------------//
+//------------------- Host simulation hooks --------------------//
+//--------------------------------------------------------------//
+
+void hostFf_setRoot(const char *dir)
+{
+  rootDir = dir;
+}
+
+int hostFf_addMemFile(const char *name, const void *data, uint32_t size)
+{
+  if(memFileCount >= MEM_FILES_MAX)
+  {
+    return -1;
+  }
+  memFiles[memFileCount].name = stripDrive(name);
+  memFiles[memFileCount].data = (const BYTE*)data;
+  memFiles[memFileCount].size = size;
+  memFileCount++;
+  return 0;
+}
+
+uint32_t hostFf_readCount(void)
+{
+  return readCount;
+}
+
+void hostFf_setClusterSectors(WORD sectors)
+{
+  USBHFatFS.csize = sectors;
+}
+
+void hostFf_setFragments(UINT count)
+{
+  fragments = count ? count : 1;
+}
+
+uint32_t hostFf_fatLookups(void)
+{
+  return fatLookups;
+}
+
+uint32_t hostFf_windowBytes(void)
+{
+  return windowBytes;
+}
+
+uint32_t hostFf_writeCount(void)
+{
+  return writeCount;
+}
+
+void hostFf_setWriteSpace(uint32_t bytes)
+{
+  writeSpace = bytes;
+}
+
+uint32_t hostFf_openCount(void)
+{
+  return openCount;
+}
+
+uint32_t hostFf_dirBytes(void)
+{
+  return dirBytes;
+}
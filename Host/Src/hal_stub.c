@@ -0,0 +1,459 @@
+/*
+Library:				hal_stub.c
+Written by:				Shridattha M Hebbar
+Date Written:			16/10/2026
+Description:			Host stand-ins for the HAL peripherals used by the player. GPIO inputs and the
+						ADC result are set by the host program (a continuous ADC DMA buffer follows it
+						at once), I2S DMA transfers are simulated by calling the half/full transfer
+						callbacks on demand and I2C writes are counted and logged. The I2C bus is
+						modelled at 100 kHz: a blocking transfer costs the caller its bus time, an
+						interrupt write completes on hostHal_i2cIrq() or whenever the program waits
+						(HAL_GetTick, HAL_Delay), as the interrupt would on target. Behind the bus
+						sits a CS43L22 register file with its reset values; bit 7 of the register
+						address (MAP INCR) steps the register after every byte, as on the codec.
+						hostHal_i2cSetStuck() holds the bus: the pending write never completes and
+						every HAL_GetTick call moves the clock on by 1 ms, so polled timeouts expire.
+*/
+
+#include "stm32f4xx_hal.h"
+
+GPIO_TypeDef hostGpio[5];
+SPI_TypeDef hostSpi3;
+
+//Peripheral handles normally owned by main.c
+ADC_HandleTypeDef hadc1;
+I2C_HandleTypeDef hi2c1;
+I2S_HandleTypeDef hi2s3;
+
+static I2S_HandleTypeDef *dmaI2S;
+static uint32_t adcValue = 2048;
+static uint32_t i2sInits = 0;			// HAL_I2S_Init calls
+static uint32_t pllConfigs = 0;			// PLLI2S reprogrammings
+static uint32_t i2cWrites = 0;
+static uint32_t i2cTransfers = 0;		// Transactions on the bus, reads included
+static bool i2cPending = false;			// Interrupt write on the bus
+static bool i2cStuck = false;			// Bus held, the pending write never completes
+static I2C_HandleTypeDef *i2cPendingHandle;
+static uint32_t i2cPendingUs;			// Bus time of the pending write
+static uint64_t i2cBusUs = 0;			// Bus time of every write
+static uint64_t i2cBlockedUs = 0;		// Bus time the program waited for: blocking writes, polled interrupt writes
+
+//Register writes as they went out, oldest first, the last HOST_I2C_LOG of them kept
+#define HOST_I2C_LOG			1024u
+#define HOST_I2C_BIT_US			10u		// 100 kHz standard mode
+static uint8_t i2cLogReg[HOST_I2C_LOG];
+static uint8_t i2cLogValue[HOST_I2C_LOG];
+
+//CS43L22 register file, reset values from the datasheet. ID and status registers ignore writes.
+#define HOST_I2C_MAP_INCR		0x80u
+static const uint8_t i2cResetRegs[0x35] = {
+  [0x01] = 0xE3, [0x02] = 0x01, [0x04] = 0x05, [0x05] = 0xA0, [0x08] = 0x81, [0x09] = 0x81,
+  [0x0A] = 0xA5, [0x0D] = 0x60, [0x0E] = 0x02, [0x1F] = 0x88, [0x28] = 0x7F, [0x29] = 0xC0,
+  [0x32] = 0x3B, [0x34] = 0x5F,
+};
+static uint8_t i2cRegs[128];
+static bool i2cRegsReady = false;
+static uint32_t tick = 0;
+
+//--------------------------------------------------------------//
+//---------------------------- GPIO ----------------------------//
+//--------------------------------------------------------------//
+
+GPIO_PinState HAL_GPIO_ReadPin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin)
+{
+  return (GPIOx->IDR & GPIO_Pin) ? GPIO_PIN_SET : GPIO_PIN_RESET;
+}
+
+void HAL_GPIO_WritePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState)
+{
+  if(PinState == GPIO_PIN_SET)
+  {
+    GPIOx->ODR |= GPIO_Pin;
+  }
+  else
+  {
+    GPIOx->ODR &= (uint16_t)~GPIO_Pin;
+  }
+}
+
+void HAL_GPIO_TogglePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin)
+{
+  GPIOx->ODR ^= GPIO_Pin;
+}
+
+//--------------------------------------------------------------//
+//---------------------------- ADC -----------------------------//
+//--------------------------------------------------------------//
+
+HAL_StatusTypeDef HAL_ADC_Start(ADC_HandleTypeDef *hadc)
+{
+  hadc->Running = 1;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_ADC_Stop(ADC_HandleTypeDef *hadc)
+{
+  hadc->Running = 0;
+  return HAL_OK;
+}
+
+// Continuous conversions: the DMA buffer always holds the current host ADC value
+HAL_StatusTypeDef HAL_ADC_Start_DMA(ADC_HandleTypeDef *hadc, uint32_t *pData, uint32_t Length)
+{
+  if(hadc->Running)
+  {
+    return HAL_BUSY;
+  }
+  hadc->Running = 1;
+  hadc->pDmaBuff = (uint16_t*)pData;
+  hadc->DmaLength = Length;
+  hostHal_setAdcValue(adcValue);
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_ADC_Stop_DMA(ADC_HandleTypeDef *hadc)
+{
+  hadc->Running = 0;
+  hadc->pDmaBuff = NULL;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_ADC_PollForConversion(ADC_HandleTypeDef *hadc, uint32_t Timeout)
+{
+  (void)Timeout;
+  if(!hadc->Running)
+  {
+    return HAL_ERROR;
+  }
+  hadc->Value = adcValue;
+  return HAL_OK;
+}
+
+uint32_t HAL_ADC_GetValue(ADC_HandleTypeDef *hadc)
+{
+  return hadc->Value;
+}
+
+//--------------------------------------------------------------//
+//---------------------------- RCC -----------------------------//
+//--------------------------------------------------------------//
+
+void HAL_RCCEx_GetPeriphCLKConfig(RCC_PeriphCLKInitTypeDef *PeriphClkInit)
+{
+  PeriphClkInit->PeriphClockSelection = RCC_PERIPHCLK_I2S;
+  PeriphClkInit->PLLI2S.PLLI2SN = 258;
+  PeriphClkInit->PLLI2S.PLLI2SR = 3;
+}
+
+HAL_StatusTypeDef HAL_RCCEx_PeriphCLKConfig(RCC_PeriphCLKInitTypeDef *PeriphClkInit)
+{
+  (void)PeriphClkInit;
+  pllConfigs++;
+  return HAL_OK;
+}
+
+//--------------------------------------------------------------//
+//---------------------------- I2S -----------------------------//
+//--------------------------------------------------------------//
+
+HAL_StatusTypeDef HAL_I2S_Init(I2S_HandleTypeDef *hi2s)
+{
+  hi2s->Lock = HAL_UNLOCKED;
+  i2sInits++;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_I2S_Transmit_DMA(I2S_HandleTypeDef *hi2s, uint16_t *pData, uint16_t Size)
+{
+  hi2s->pTxBuffPtr = pData;
+  hi2s->TxXferSize = Size;
+  hi2s->Paused = 0;
+  dmaI2S = hi2s;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_I2S_DMAPause(I2S_HandleTypeDef *hi2s)
+{
+  hi2s->Paused = 1;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_I2S_DMAResume(I2S_HandleTypeDef *hi2s)
+{
+  hi2s->Paused = 0;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_I2S_DMAStop(I2S_HandleTypeDef *hi2s)
+{
+  if(dmaI2S == hi2s)
+  {
+    dmaI2S = NULL;
+  }
+  return HAL_OK;
+}
+
+__weak void HAL_I2S_TxHalfCpltCallback(I2S_HandleTypeDef *hi2s)
+{
+  (void)hi2s;
+}
+
+__weak void HAL_I2S_TxCpltCallback(I2S_HandleTypeDef *hi2s)
+{
+  (void)hi2s;
+}
+
+//--------------------------------------------------------------//
+//---------------------------- I2C -----------------------------//
+//--------------------------------------------------------------//
+
+static uint8_t *i2cRegFile(void)
+{
+  if(!i2cRegsReady)
+  {
+    hostHal_i2cResetRegisters();
+  }
+  return i2cRegs;
+}
+
+// Apply and log a memory write and return its bus time: start, address, register, data bytes and stop
+static uint32_t i2cTransfer(uint16_t MemAddress, const uint8_t *pData, uint16_t Size)
+{
+  uint8_t *regs = i2cRegFile();
+  uint8_t reg = (uint8_t)(MemAddress & 0x7Fu);
+
+  for(uint16_t i = 0; i < Size; i++)
+  {
+    if(reg != 0x01 && reg != 0x2E && reg != 0x30 && reg != 0x31)
+    {
+      regs[reg] = pData[i];
+    }
+    i2cLogReg[i2cWrites % HOST_I2C_LOG] = reg;
+    i2cLogValue[i2cWrites % HOST_I2C_LOG] = pData[i];
+    i2cWrites++;
+    if(MemAddress & HOST_I2C_MAP_INCR)
+    {
+      reg = (reg + 1u) & 0x7Fu;
+    }
+  }
+  i2cTransfers++;
+  i2cBusUs += ((2u + Size) * 9u + 2u) * HOST_I2C_BIT_US;
+  return ((2u + Size) * 9u + 2u) * HOST_I2C_BIT_US;
+}
+
+HAL_StatusTypeDef HAL_I2C_Mem_Write(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress,
+                                    uint16_t MemAddSize, uint8_t *pData, uint16_t Size, uint32_t Timeout)
+{
+  (void)DevAddress; (void)MemAddSize; (void)Timeout;
+  if(i2cPending && i2cPendingHandle == hi2c)
+  {
+    return HAL_BUSY;
+  }
+  i2cBlockedUs += i2cTransfer(MemAddress, pData, Size);
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_I2C_Mem_Write_IT(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress,
+                                       uint16_t MemAddSize, uint8_t *pData, uint16_t Size)
+{
+  (void)DevAddress; (void)MemAddSize;
+  if(i2cPending)
+  {
+    return HAL_BUSY;
+  }
+  i2cPendingUs = i2cTransfer(MemAddress, pData, Size);
+  i2cPending = true;
+  i2cPendingHandle = hi2c;
+  return HAL_OK;
+}
+
+__weak void HAL_I2C_MemTxCpltCallback(I2C_HandleTypeDef *hi2c)
+{
+  (void)hi2c;
+}
+
+__weak void HAL_I2C_ErrorCallback(I2C_HandleTypeDef *hi2c)
+{
+  (void)hi2c;
+}
+
+HAL_StatusTypeDef HAL_I2C_Mem_Read(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress,
+                                   uint16_t MemAddSize, uint8_t *pData, uint16_t Size, uint32_t Timeout)
+{
+  uint8_t *regs = i2cRegFile();
+  uint8_t reg = (uint8_t)(MemAddress & 0x7Fu);
+  uint32_t us = ((3u + Size) * 9u + 3u) * HOST_I2C_BIT_US;	// Write of the register, repeated start, read
+
+  (void)DevAddress; (void)MemAddSize; (void)Timeout;
+  if(i2cPending && i2cPendingHandle == hi2c)
+  {
+    return HAL_BUSY;
+  }
+  for(uint16_t i = 0; i < Size; i++)
+  {
+    pData[i] = regs[reg];
+    if(MemAddress & HOST_I2C_MAP_INCR)
+    {
+      reg = (reg + 1u) & 0x7Fu;
+    }
+  }
+  i2cTransfers++;
+  i2cBusUs += us;
+  i2cBlockedUs += us;
+  return HAL_OK;
+}
+
+//--------------------------------------------------------------//
+//--------------------------- System ---------------------------//
+//--------------------------------------------------------------//
+
+// Delays advance a virtual millisecond tick instead of sleeping so that host runs stay fast.
+// Time passes while the program waits, so pending I2C interrupt writes complete.
+void HAL_Delay(uint32_t Delay)
+{
+  while(hostHal_i2cIrq())
+  {
+  }
+  tick += Delay;
+}
+
+uint32_t HAL_GetTick(void)
+{
+  if(i2cStuck)
+  {
+    return tick++;			// The caller spins on the clock
+  }
+  if(i2cPending)
+  {
+    i2cBlockedUs += i2cPendingUs;		// Polling the tick: the caller waits for the write
+    hostHal_i2cIrq();
+  }
+  return tick;
+}
+
+//--------------------------------------------------------------//
+//------------------- Host simulation hooks --------------------//
+//--------------------------------------------------------------//
+
+void hostHal_setPin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState)
+{
+  if(PinState == GPIO_PIN_SET)
+  {
+    GPIOx->IDR |= GPIO_Pin;
+  }
+  else
+  {
+    GPIOx->IDR &= (uint16_t)~GPIO_Pin;
+  }
+}
+
+void hostHal_setAdcValue(uint32_t value)
+{
+  adcValue = value & 0xFFF;
+  if(hadc1.pDmaBuff)
+  {
+    for(uint32_t i = 0; i < hadc1.DmaLength; i++)
+    {
+      hadc1.pDmaBuff[i] = (uint16_t)adcValue;
+    }
+  }
+}
+
+// Simulated DMA progress: the I2S driver sees the same callbacks as on target
+void hostHal_i2sHalfTransfer(void)
+{
+  if(dmaI2S && !dmaI2S->Paused)
+  {
+    HAL_I2S_TxHalfCpltCallback(dmaI2S);
+  }
+}
+
+void hostHal_i2sFullTransfer(void)
+{
+  if(dmaI2S && !dmaI2S->Paused)
+  {
+    HAL_I2S_TxCpltCallback(dmaI2S);
+  }
+}
+
+uint32_t hostHal_i2sInitCount(void)
+{
+  return i2sInits;
+}
+
+uint32_t hostHal_pllConfigCount(void)
+{
+  return pllConfigs;
+}
+
+uint32_t hostHal_i2cWriteCount(void)
+{
+  return i2cWrites;
+}
+
+// Nth register write since start-up, false when it was never made or has left the log
+bool hostHal_i2cGetWrite(uint32_t index, uint8_t *reg, uint8_t *value)
+{
+  if(index >= i2cWrites || i2cWrites - index > HOST_I2C_LOG)
+  {
+    return false;
+  }
+  *reg = i2cLogReg[index % HOST_I2C_LOG];
+  *value = i2cLogValue[index % HOST_I2C_LOG];
+  return true;
+}
+
+// Bus transactions since start-up: one per write or read, however many registers it covers
+uint32_t hostHal_i2cTransferCount(void)
+{
+  return i2cTransfers;
+}
+
+// Codec register file back to its reset values, as after a codec reset
+void hostHal_i2cResetRegisters(void)
+{
+  for(uint32_t i = 0; i < sizeof(i2cRegs); i++)
+  {
+    i2cRegs[i] = (i < sizeof(i2cResetRegs)) ? i2cResetRegs[i] : 0;
+  }
+  i2cRegsReady = true;
+}
+
+uint8_t hostHal_i2cGetRegister(uint8_t reg)
+{
+  return i2cRegFile()[reg & 0x7Fu];
+}
+
+// Set a register behind the driver's back, e.g. state kept by the codec over an MCU reset
+void hostHal_i2cSetRegister(uint8_t reg, uint8_t value)
+{
+  i2cRegFile()[reg & 0x7Fu] = value;
+}
+
+// Hold the I2C bus, e.g. a slave keeping SDA low; the pending write completes once released
+void hostHal_i2cSetStuck(bool stuck)
+{
+  i2cStuck = stuck;
+}
+
+// Completion interrupt of the pending I2C write, false when the bus is idle or held
+bool hostHal_i2cIrq(void)
+{
+  if(!i2cPending || i2cStuck)
+  {
+    return false;
+  }
+  i2cPending = false;
+  HAL_I2C_MemTxCpltCallback(i2cPendingHandle);
+  return true;
+}
+
+uint64_t hostHal_i2cBusUs(void)
+{
+  return i2cBusUs;
+}
+
+uint64_t hostHal_i2cBlockedUs(void)
+{
+  return i2cBlockedUs;
+}
@@ -0,0 +1,498 @@
+/*
+Library:				render.c
+Written by:				Shridattha M Hebbar
+Date Written:			16/10/2026
+Description:			Offline render engine, see render.h. Every input is memory-mapped and parsed with
+						the player's RIFF chunk walker, and every output is created at its final size
+						before the workers start, so the workers only convert, echo and pwrite().
+
+						An FIR echo output sample depends on the input and the last (longest tap delay)
+						frames before it, nothing else: a chunk that first runs those frames through a
+						cleared delay line (output dropped) continues exactly where a one-pass render
+						would be. With a µ-law line this still holds, each sample is coded on its own.
+						Feedback echo recirculates its own output and ADPCM codes each sample against
+						the ones before, so those files are rendered whole and spread over the threads
+						file by file.
+
+						Tasks are dealt out to the workers in contiguous runs, so a worker walks through
+						a file in order; a worker with an empty queue steals from the far end of another
+						worker's queue.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "render.h"
+#include "audio_mem.h"
+#include "wav_riff.h"
+#include "pcm_convert.h"
+
+//Input file and its render state
+typedef struct
+{
+	const char *inPath;
+	const char *outPath;
+	const uint8_t *data;			// Mapping of the whole input file
+	uint32_t size;
+	WAV_RIFF_InfoTypeDef info;
+	PCM_ConvertFunc convert;
+	ECHO_HandleTypeDef echo;		// Engine as the board sets it up for this file, copied by every task
+	uint64_t outFrames;				// Input frames plus the tail
+	uint32_t primeFrames;			// Frames run ahead of a chunk, 0 when the file is rendered whole
+	uint32_t chunks;				// Tasks of this file
+	uint32_t chunksLeft;
+	double t0;						// Start of its first task
+	bool ready;
+	bool failed;
+}RenderFile_t;
+
+//One task: output frames [start, end) of a file
+typedef struct
+{
+	RenderFile_t *file;
+	uint64_t start;
+	uint64_t end;
+}RenderTask_t;
+
+struct RenderRun;
+
+//Worker and its task queue, tasks[head..tail) of the run
+typedef struct
+{
+	struct RenderRun *run;
+	pthread_t thread;
+	bool started;
+	pthread_mutex_t lock;
+	uint32_t head;
+	uint32_t tail;
+	ECHO_HandleTypeDef echo;
+	void *line;						// Private delay line, as large as the board's pool
+	int16_t *block;
+	uint32_t steals;
+	uint64_t primeFrames;
+}RenderWorker_t;
+
+typedef struct RenderRun
+{
+	const RENDER_OptionsTypeDef *opt;
+	RENDER_StatsTypeDef *stats;
+	RenderTask_t *tasks;
+	uint32_t taskCount;
+	RenderWorker_t *workers;
+	uint32_t workerCount;
+	pthread_mutex_t lock;			// File completion, stats and console output
+}RenderRun_t;
+
+//--------------------------------------------------------------//
+//---------------------- Static functions ----------------------//
+//--------------------------------------------------------------//
+
+static double nowSeconds(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// RIFF parser read callback over the mapping
+static uint32_t readMap(void *ctx, uint32_t offset, void *dst, uint32_t bytes)
+{
+	const RenderFile_t *f = ctx;
+
+	if (offset >= f->size)
+		return 0;
+	if (bytes > f->size - offset)
+		bytes = f->size - offset;
+	memcpy(dst, f->data + offset, bytes);
+	return bytes;
+}
+
+static void putWavHeader(uint8_t *h, uint32_t sampleRate, uint32_t dataBytes)
+{
+	const uint32_t fields[] = { 36u + dataBytes, 16u, 0x00020001u, sampleRate, sampleRate * PCM_OUT_FRAME_BYTES,
+	                            (16u << 16) | PCM_OUT_FRAME_BYTES, dataBytes };
+
+	memcpy(h, "RIFF", 4);
+	memcpy(h + 4, &fields[0], 4);
+	memcpy(h + 8, "WAVEfmt ", 8);
+	memcpy(h + 16, &fields[1], 20);				// Size, PCM and 2 channels, rate, byte rate, block align and bits
+	memcpy(h + 36, "data", 4);
+	memcpy(h + 40, &fields[6], 4);
+}
+
+static bool writeAt(int fd, const void *src, size_t bytes, uint64_t offset)
+{
+	while (bytes)
+	{
+		ssize_t n = pwrite(fd, src, bytes, (off_t)offset);
+		if (n <= 0)
+			return false;
+		src = (const uint8_t*)src + n;
+		bytes -= (size_t)n;
+		offset += (uint64_t)n;
+	}
+	return true;
+}
+
+// Map and parse the input, set up its echo the way the board would and create the output at full size
+static bool prepareFile(RenderFile_t *f, const RENDER_OptionsTypeDef *opt)
+{
+	WAV_RIFF_StatusTypeDef status;
+	uint8_t header[RENDER_HEADER_BYTES];
+	struct stat st;
+	bool ok;
+	int fd;
+
+	fd = open(f->inPath, O_RDONLY);
+	if (fd < 0 || fstat(fd, &st) != 0 || st.st_size == 0 || (uint64_t)st.st_size > 0xFFFFFFFFu)
+	{
+		fprintf(stderr, "%s: cannot open\n", f->inPath);
+		if (fd >= 0)
+			close(fd);
+		return false;
+	}
+	f->size = (uint32_t)st.st_size;
+	f->data = mmap(NULL, f->size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (f->data == MAP_FAILED)
+	{
+		fprintf(stderr, "%s: cannot map\n", f->inPath);
+		f->data = NULL;
+		return false;
+	}
+	madvise((void*)f->data, f->size, MADV_SEQUENTIAL);
+
+	status = wavRiff_parse(&f->info, readMap, f, f->size);
+	f->convert = (status == WAV_RIFF_OK) ? pcmConvert_select(f->info.encoding, f->info.bitsPerSample, f->info.channels)
+	                                     : NULL;
+	if (!f->convert)
+	{
+		fprintf(stderr, "%s: not a supported WAV file (status %d)\n", f->inPath, (int)status);
+		return false;
+	}
+	f->outFrames = f->info.frames + (uint64_t)opt->tailMs * f->info.sampleRate / 1000u;
+	if (f->outFrames * PCM_OUT_FRAME_BYTES > 0xFFFFFFFFu - RENDER_HEADER_BYTES)
+	{
+		fprintf(stderr, "%s: output over 4 GB\n", f->inPath);
+		return false;
+	}
+
+	//The player's stream setup: pool reset, then the echo sized for the rate (stereo, as the ring holds)
+	audioMem_reset();
+	echoDecayFactor = opt->level;						// Before configure, so the first block does not ramp
+	echo_setDefaultMode(opt->mode, opt->damping);
+	if (echo_configure(f->info.sampleRate, 2, opt->delayMs, opt->storage) == 0)
+	{
+		fprintf(stderr, "%s: no memory for the echo delay line\n", f->inPath);
+		return false;
+	}
+	f->echo = *echo_getDefault();
+	f->echo.line = NULL;
+	if (!opt->quiet && f->echo.frames < echo_msToFrames(opt->delayMs, f->info.sampleRate))
+	{
+		fprintf(stderr, "%s: echo delay limited to %u ms by the board's delay memory (try -s mulaw or -s adpcm)\n",
+		        f->inPath, (unsigned)((uint64_t)f->echo.frames * 1000u / f->info.sampleRate));
+	}
+
+	//Chunks need an FIR echo on a line whose samples are coded on their own
+	f->primeFrames = 0;
+	f->chunks = 1;
+	if (opt->threads > 1 && f->echo.mode == ECHO_MODE_FIR && f->echo.storage != ECHO_STORAGE_ADPCM)
+	{
+		uint64_t chunk = (uint64_t)opt->chunkMs * f->info.sampleRate / 1000u;
+
+		for (uint8_t k = 0; k < f->echo.numTaps; k++)
+		{
+			if (f->echo.taps[k].delay > f->primeFrames)
+				f->primeFrames = f->echo.taps[k].delay;
+		}
+		if (chunk < 4u * (uint64_t)f->primeFrames)
+			chunk = 4u * (uint64_t)f->primeFrames;				// Keeps the priming under a quarter of the work
+		if (chunk == 0)
+			chunk = 1;
+		f->chunks = (uint32_t)((f->outFrames + chunk - 1u) / chunk);
+		if (f->chunks == 0)
+			f->chunks = 1;
+	}
+	f->chunksLeft = f->chunks;
+
+	fd = open(f->outPath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0)
+	{
+		fprintf(stderr, "%s: cannot write\n", f->outPath);
+		return false;
+	}
+	putWavHeader(header, f->info.sampleRate, (uint32_t)(f->outFrames * PCM_OUT_FRAME_BYTES));
+	ok = writeAt(fd, header, sizeof(header), 0)
+	  && ftruncate(fd, (off_t)(RENDER_HEADER_BYTES + f->outFrames * PCM_OUT_FRAME_BYTES)) == 0;
+	if (close(fd) != 0 || !ok)
+	{
+		fprintf(stderr, "%s: cannot write\n", f->outPath);
+		return false;
+	}
+	return true;
+}
+
+// Input frames [pos, pos + n) as 16-bit stereo, silence past the end of the data
+static void fillBlock(const RenderFile_t *f, uint64_t pos, uint32_t n, int16_t *dst)
+{
+	uint32_t fromFile = 0;
+
+	if (pos < f->info.frames)
+		fromFile = (f->info.frames - pos < n) ? (uint32_t)(f->info.frames - pos) : n;
+	if (fromFile)
+		f->convert(f->data + f->info.dataOffset + pos * f->info.blockAlign, dst, fromFile);
+	memset(&dst[2 * fromFile], 0, (size_t)(n - fromFile) * PCM_OUT_FRAME_BYTES);
+}
+
+// Render one task on the worker's own engine
+static bool runTask(RenderWorker_t *w, const RenderTask_t *t)
+{
+	const RenderFile_t *f = t->file;
+	const uint32_t blockFrames = w->run->opt->blockFrames;
+	uint64_t pos = (t->start > f->primeFrames) ? t->start - f->primeFrames : 0;
+	bool ok = true;
+	int fd;
+
+	echo_init(&w->echo, w->line, f->echo.frames, f->echo.channels, f->echo.storage);
+	echo_setTaps(&w->echo, f->echo.taps, f->echo.numTaps);
+	echo_setMode(&w->echo, f->echo.mode);
+	w->echo.damping = f->echo.damping;
+
+	fd = open(f->outPath, O_WRONLY);
+	if (fd < 0)
+		return false;
+	w->primeFrames += t->start - pos;
+	while (ok && pos < t->end)
+	{
+		const uint64_t stop = (pos < t->start) ? t->start : t->end;		// Priming blocks end at the chunk
+		const uint32_t n = (stop - pos < blockFrames) ? (uint32_t)(stop - pos) : blockFrames;
+
+		fillBlock(f, pos, n, w->block);
+		echo_process(&w->echo, w->block, 2u * n);
+		if (pos >= t->start)
+			ok = writeAt(fd, w->block, (size_t)n * PCM_OUT_FRAME_BYTES, RENDER_HEADER_BYTES + pos * PCM_OUT_FRAME_BYTES);
+		pos += n;
+	}
+	return (close(fd) == 0) && ok;
+}
+
+// Next task from the worker's own queue, or stolen from the back of another one
+static RenderTask_t *takeTask(RenderWorker_t *w)
+{
+	RenderRun_t *run = w->run;
+	RenderTask_t *t = NULL;
+
+	pthread_mutex_lock(&w->lock);
+	if (w->head < w->tail)
+		t = &run->tasks[w->head++];
+	pthread_mutex_unlock(&w->lock);
+
+	for (uint32_t i = 1; i < run->workerCount && !t; i++)
+	{
+		RenderWorker_t *victim = &run->workers[(uint32_t)(w - run->workers + i) % run->workerCount];
+
+		pthread_mutex_lock(&victim->lock);
+		if (victim->head < victim->tail)
+		{
+			t = &run->tasks[--victim->tail];
+			w->steals++;
+		}
+		pthread_mutex_unlock(&victim->lock);
+	}
+	return t;
+}
+
+// Count a finished task, and the file when it was its last
+static void finishTask(RenderRun_t *run, RenderFile_t *f, bool ok)
+{
+	pthread_mutex_lock(&run->lock);
+	f->failed |= !ok;
+	if (--f->chunksLeft == 0)
+	{
+		const double seconds = (double)f->info.frames / f->info.sampleRate;
+		const double wall = nowSeconds() - f->t0;
+
+		if (f->failed)
+		{
+			fprintf(stderr, "%s: write failed\n", f->outPath);
+			run->stats->failed++;
+		}
+		else
+		{
+			run->stats->files++;
+			run->stats->frames += f->outFrames;
+			run->stats->audioSeconds += seconds;
+			run->stats->inBytes += f->info.dataBytes;
+			run->stats->outBytes += RENDER_HEADER_BYTES + f->outFrames * PCM_OUT_FRAME_BYTES;
+			if (!run->opt->quiet)
+			{
+				printf("%s -> %s: %.1f s of %u Hz %u-bit %u ch in %.3f s, %.0fx real time", f->inPath, f->outPath,
+				       seconds, (unsigned)f->info.sampleRate, (unsigned)f->info.bitsPerSample,
+				       (unsigned)f->info.channels, wall, wall > 0 ? seconds / wall : 0.0);
+				printf(f->chunks > 1 ? ", %u chunks\n" : "\n", f->chunks);
+			}
+		}
+		munmap((void*)f->data, f->size);
+		f->data = NULL;
+	}
+	pthread_mutex_unlock(&run->lock);
+}
+
+static void *workerMain(void *arg)
+{
+	RenderWorker_t *w = arg;
+	RenderTask_t *t;
+
+	while ((t = takeTask(w)) != NULL)
+	{
+		pthread_mutex_lock(&w->run->lock);
+		if (t->file->t0 == 0)
+			t->file->t0 = nowSeconds();
+		pthread_mutex_unlock(&w->run->lock);
+		finishTask(w->run, t->file, runTask(w, t));
+	}
+	return NULL;
+}
+
+//--------------------------------------------------------------//
+//---------------------- Public Functions ----------------------//
+//--------------------------------------------------------------//
+
+/**
+ * @brief Default settings: the player's echo, one thread per CPU
+ * @param opt: settings to fill
+ * @retval None
+ */
+void render_defaults(RENDER_OptionsTypeDef *opt)
+{
+	opt->delayMs = ECHO_DELAY_MS;
+	opt->level = echoDecayFactor;
+	opt->mode = ECHO_MODE_FIR;
+	opt->damping = ECHO_DAMPING_DEFAULT;
+	opt->storage = ECHO_STORAGE_PCM16;
+	opt->tailMs = 0;
+	opt->blockFrames = RENDER_BLOCK_FRAMES;
+	opt->threads = render_cpuCount();
+	opt->chunkMs = RENDER_CHUNK_MS;
+	opt->quiet = false;
+}
+
+/**
+ * @brief CPUs online
+ * @param None
+ * @retval CPU count, at least 1
+ */
+uint32_t render_cpuCount(void)
+{
+	long n = sysconf(_SC_NPROCESSORS_ONLN);
+
+	return (n > 0) ? (uint32_t)n : 1u;
+}
+
+/**
+ * @brief Render files, each input to the output of the same index
+ * @note The output does not depend on the thread count, the chunk length or the block size.
+ * @param inPaths: input WAV files
+ * @param outPaths: output WAV files, 16-bit stereo at the input rate
+ * @param count: number of files
+ * @param opt: settings
+ * @param stats: totals, filled in
+ * @retval true when every file was rendered
+ */
+bool render_files(const char *const *inPaths, const char *const *outPaths, uint32_t count,
+                  const RENDER_OptionsTypeDef *opt, RENDER_StatsTypeDef *stats)
+{
+	RenderRun_t run = { opt, stats, NULL, 0, NULL, 0, PTHREAD_MUTEX_INITIALIZER };
+	RenderFile_t *files = calloc(count ? count : 1u, sizeof(RenderFile_t));
+	const double t0 = nowSeconds();
+	bool ok = files != NULL && opt->blockFrames != 0;
+
+	memset(stats, 0, sizeof(*stats));
+
+	//Inputs parsed and outputs created on this thread: the echo setup goes through the player's globals
+	for (uint32_t i = 0; ok && i < count; i++)
+	{
+		files[i].inPath = inPaths[i];
+		files[i].outPath = outPaths[i];
+		files[i].ready = prepareFile(&files[i], opt);
+		if (files[i].ready)
+			run.taskCount += files[i].chunks;
+		else
+			stats->failed++;
+	}
+
+	run.tasks = calloc(run.taskCount ? run.taskCount : 1u, sizeof(RenderTask_t));
+	run.workerCount = (opt->threads == 0) ? 1u : opt->threads;
+	if (run.workerCount > run.taskCount)
+		run.workerCount = run.taskCount ? run.taskCount : 1u;
+	run.workers = calloc(run.workerCount, sizeof(RenderWorker_t));
+	ok = ok && run.tasks && run.workers;
+	for (uint32_t i = 0, n = 0; ok && i < count; i++)
+	{
+		const uint64_t chunk = files[i].ready ? (files[i].outFrames + files[i].chunks - 1u) / files[i].chunks : 0;
+
+		for (uint32_t c = 0; files[i].ready && c < files[i].chunks; c++, n++)
+		{
+			run.tasks[n].file = &files[i];
+			run.tasks[n].start = c * chunk;
+			run.tasks[n].end = (c + 1u == files[i].chunks) ? files[i].outFrames : (c + 1u) * chunk;
+		}
+	}
+	stats->tasks = run.taskCount;
+
+	//Contiguous runs of tasks per worker
+	for (uint32_t w = 0; ok && w < run.workerCount; w++)
+	{
+		RenderWorker_t *worker = &run.workers[w];
+
+		worker->run = &run;
+		pthread_mutex_init(&worker->lock, NULL);
+		worker->head = (uint32_t)((uint64_t)run.taskCount * w / run.workerCount);
+		worker->tail = (uint32_t)((uint64_t)run.taskCount * (w + 1u) / run.workerCount);
+		worker->line = malloc(AUDIO_MEM_POOL_SIZE);
+		worker->block = malloc((size_t)opt->blockFrames * PCM_OUT_FRAME_BYTES);
+		ok = worker->line && worker->block;
+	}
+
+	if (ok)
+	{
+		for (uint32_t w = 1; w < run.workerCount; w++)
+		{
+			run.workers[w].started = pthread_create(&run.workers[w].thread, NULL, workerMain, &run.workers[w]) == 0;
+		}
+		workerMain(&run.workers[0]);
+		for (uint32_t w = 1; w < run.workerCount; w++)
+		{
+			if (run.workers[w].started)
+				pthread_join(run.workers[w].thread, NULL);
+		}
+	}
+
+	for (uint32_t w = 0; run.workers && w < run.workerCount; w++)
+	{
+		stats->steals += run.workers[w].steals;
+		stats->primeFrames += run.workers[w].primeFrames;
+		if (run.workers[w].run)
+			pthread_mutex_destroy(&run.workers[w].lock);
+		free(run.workers[w].line);
+		free(run.workers[w].block);
+	}
+	for (uint32_t i = 0; files && i < count; i++)
+	{
+		if (files[i].data)
+			munmap((void*)files[i].data, files[i].size);
+	}
+	stats->wallSeconds = nowSeconds() - t0;
+	free(run.workers);
+	free(run.tasks);
+	free(files);
+	return ok && stats->failed == 0;
+}
@@ -0,0 +1,60 @@
+/*
+Library:				render.h
+Written by:				Shridattha M Hebbar
+Date Written:			16/10/2026
+Description:			Offline render engine behind wav_render: runs WAV files through the player's
+						format conversion and echo engine on a pool of threads. A file is cut into
+						chunks when its echo allows it, so one long file spreads over every core as
+						well as a batch of files does; the output is bit-identical to rendering each
+						file in one pass.
+*/
+
+#ifndef RENDER_H_
+#define RENDER_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "echo.h"
+
+#define RENDER_BLOCK_FRAMES		65536u		// Default frames per block
+#define RENDER_CHUNK_MS			30000u		// Default audio per chunk of a split file
+#define RENDER_HEADER_BYTES		44u
+
+//Render settings
+typedef struct
+{
+  uint32_t delayMs;             // Echo delay, shortened to what the board's delay memory holds
+  float level;                  // Echo level 0.0 to 1.0 (echoDecayFactor)
+  ECHO_ModeTypeDef mode;
+  float damping;                // Feedback damping 0.0 to 1.0
+  ECHO_StorageTypeDef storage;  // Delay line format
+  uint32_t tailMs;              // Silence rendered after the input so the echo rings out
+  uint32_t blockFrames;         // Frames per block, does not change the output
+  uint32_t threads;             // Worker threads, 1 renders every file in one pass
+  uint32_t chunkMs;             // Audio per chunk when a file is split over the threads
+  bool quiet;                   // No per-file lines or warnings
+}RENDER_OptionsTypeDef;
+
+//Totals of one render_files() call
+typedef struct
+{
+  uint32_t files;               // Files rendered
+  uint32_t failed;              // Files that could not be read or written
+  uint64_t frames;              // Output frames, tails included
+  double audioSeconds;          // Input audio
+  double wallSeconds;
+  uint64_t inBytes;             // Input data chunk bytes
+  uint64_t outBytes;            // Output file bytes
+  uint32_t tasks;               // Files and chunks handed to the pool
+  uint32_t steals;              // Tasks a worker took from another worker's queue
+  uint64_t primeFrames;         // Frames processed only to prime a chunk's delay line
+}RENDER_StatsTypeDef;
+
+/* Render function prototypes */
+
+void render_defaults(RENDER_OptionsTypeDef *opt);
+uint32_t render_cpuCount(void);
+bool render_files(const char *const *inPaths, const char *const *outPaths, uint32_t count,
+                  const RENDER_OptionsTypeDef *opt, RENDER_StatsTypeDef *stats);
+
+#endif /* RENDER_H_ */
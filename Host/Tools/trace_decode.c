@@ -0,0 +1,213 @@
+/*
+Library:				trace_decode.c
+Written by:				Shridattha M Hebbar
+Date Written:			16/10/2026
+Description:			Decodes a trace buffer saved by trace_save() (or dumped from the traceBuffer
+						symbol with a debugger) into a timeline, oldest event first, and sums it up:
+						events per type, refill times, the longest gap between DMA halves, underruns
+						and late refills. Records are in the order they were claimed, not by time: an
+						interrupt taken between a writer's claim and its time stamp leaves a record
+						stamped slightly after the next one. Deltas are therefore read as signed 32-bit
+						values, and such an inversion shows as a small negative delta. A real gap longer
+						than half a counter period (about 12.8 s at 168 MHz) is misread.
+
+						trace_decode [-s] [-g us] trace.bin
+						  -s  summary only
+						  -g  exit with 1 when two DMA halves are further apart than us (a dropout)
+*/
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include "trace.h"
+
+//Per slot refill in progress, matched by slot
+#define DECODE_SLOTS	256u
+
+typedef struct
+{
+	uint32_t count;
+	double total;
+	double max;
+	double maxAt;
+}DecodeSpan_t;
+
+static void spanAdd(DecodeSpan_t *span, double us, double at)
+{
+	span->count++;
+	span->total += us;
+	if (us > span->max)
+	{
+		span->max = us;
+		span->maxAt = at;
+	}
+}
+
+static void describe(char *dst, size_t size, uint8_t type, uint32_t arg)
+{
+	switch (type)
+	{
+	case TRACE_EV_DMA_HALF:
+		snprintf(dst, size, "half %u", arg);
+		break;
+	case TRACE_EV_REFILL_START:
+	case TRACE_EV_REFILL_END:
+	case TRACE_EV_LATE_REFILL:
+	case TRACE_EV_EVENT_OVERRUN:
+		snprintf(dst, size, "slot %u", arg);
+		break;
+	case TRACE_EV_FILE_READ:
+	case TRACE_EV_UNDERRUN:
+		snprintf(dst, size, "%u bytes", arg);
+		break;
+	case TRACE_EV_CODEC_CMD:
+		snprintf(dst, size, "reg 0x%02X x%u = 0x%02X", arg & 0xFFu, (arg >> 8) & 0xFFu, arg >> 16);
+		break;
+	case TRACE_EV_CODEC_ERROR:
+		snprintf(dst, size, "reg 0x%02X", arg & 0xFFu);
+		break;
+	case TRACE_EV_PLAYER:
+		if ((arg & 0xFu) == TRACE_PLAYER_PLAY)
+			snprintf(dst, size, "play at %u Hz", arg >> 4);
+		else if ((arg & 0xFu) == TRACE_PLAYER_TRACK_CHANGE)
+			snprintf(dst, size, "track change %u", arg >> 4);
+		else
+			snprintf(dst, size, "%s", trace_playerName((uint8_t)(arg & 0xFu)));
+		break;
+	case TRACE_EV_USB:
+		snprintf(dst, size, "state %u", arg);
+		break;
+	case TRACE_EV_BUTTON:
+		snprintf(dst, size, "%s", trace_buttonName((uint8_t)arg));
+		break;
+	default:
+		snprintf(dst, size, "0x%06X", arg);
+		break;
+	}
+}
+
+int main(int argc, char **argv)
+{
+	TRACE_BufferTypeDef *buf;
+	TRACE_RecordTypeDef *ring;
+	uint32_t counts[TRACE_EV_COUNT + 1] = { 0 };
+	double refillStart[DECODE_SLOTS];
+	DecodeSpan_t refills = { 0 }, halves = { 0 };
+	double usPerTick, now = 0, lastHalf = -1;
+	uint32_t first, count, prev = 0;
+	double maxGapUs = 0;
+	bool summaryOnly = false;
+	long size;
+	FILE *fp;
+	int c;
+
+	while ((c = getopt(argc, argv, "sg:h")) != -1)
+	{
+		if (c == 's')
+			summaryOnly = true;
+		else if (c == 'g')
+			maxGapUs = atof(optarg);
+		else
+		{
+			fprintf(stderr, "usage: trace_decode [-s] [-g us] trace.bin\n");
+			return 2;
+		}
+	}
+	if (optind + 1 != argc)
+	{
+		fprintf(stderr, "usage: trace_decode [-s] [-g us] trace.bin\n");
+		return 2;
+	}
+
+	fp = fopen(argv[optind], "rb");
+	if (!fp || fseek(fp, 0, SEEK_END) != 0 || (size = ftell(fp)) < (long)offsetof(TRACE_BufferTypeDef, ring))
+	{
+		fprintf(stderr, "%s: cannot read\n", argv[optind]);
+		return 1;
+	}
+	buf = malloc((size_t)size);
+	rewind(fp);
+	if (!buf || fread(buf, 1, (size_t)size, fp) != (size_t)size)
+	{
+		fprintf(stderr, "%s: cannot read\n", argv[optind]);
+		return 1;
+	}
+	fclose(fp);
+
+	//The ring length comes from the file, a firmware built with another TRACE_RECORDS decodes too
+	if (buf->magic != TRACE_MAGIC || buf->version != TRACE_VERSION || buf->recordBytes != sizeof(TRACE_RecordTypeDef)
+	 || buf->records == 0 || (buf->records & (buf->records - 1u)) != 0
+	 || (uint64_t)size < offsetof(TRACE_BufferTypeDef, ring) + (uint64_t)buf->records * sizeof(TRACE_RecordTypeDef))
+	{
+		fprintf(stderr, "%s: not a trace buffer (version %u)\n", argv[optind], TRACE_VERSION);
+		return 1;
+	}
+	ring = (TRACE_RecordTypeDef*)((uint8_t*)buf + offsetof(TRACE_BufferTypeDef, ring));
+	count = (buf->head < buf->records) ? buf->head : buf->records;
+	first = buf->head - count;
+	usPerTick = 1e6 / (buf->tickHz ? buf->tickHz : 1u);
+	for (uint32_t s = 0; s < DECODE_SLOTS; s++)
+		refillStart[s] = -1;
+
+	printf("%u events recorded, the last %u kept, %u ticks per second\n", buf->head, count, buf->tickHz);
+	if (!summaryOnly)
+		printf("%14s %12s  %-14s %s\n", "time us", "delta us", "event", "details");
+	for (uint32_t i = 0; i < count; i++)
+	{
+		const TRACE_RecordTypeDef *r = &ring[(first + i) & (buf->records - 1u)];
+		const uint8_t type = (uint8_t)(r->event >> 24);
+		const uint32_t arg = r->event & TRACE_ARG_MASK;
+		const double delta = (i == 0) ? 0.0 : (int32_t)(r->time - prev) * usPerTick;	// Claim order, see above
+		char details[64];
+
+		now += delta;
+		prev = r->time;
+		counts[type < TRACE_EV_COUNT ? type : TRACE_EV_COUNT]++;
+		if (type == TRACE_EV_DMA_HALF)
+		{
+			if (lastHalf >= 0)
+				spanAdd(&halves, now - lastHalf, now);
+			lastHalf = now;
+		}
+		else if (type == TRACE_EV_REFILL_START && arg < DECODE_SLOTS)
+			refillStart[arg] = now;
+		else if (type == TRACE_EV_REFILL_END && arg < DECODE_SLOTS && refillStart[arg] >= 0)
+		{
+			spanAdd(&refills, now - refillStart[arg], now);
+			refillStart[arg] = -1;
+		}
+		if (!summaryOnly)
+		{
+			describe(details, sizeof(details), type, arg);
+			printf("%14.3f %12.3f  %-14s %s\n", now, delta, trace_eventName(type), details);
+		}
+	}
+
+	printf("\nevents per type:\n");
+	for (uint32_t t = 1; t <= TRACE_EV_COUNT; t++)
+	{
+		if (counts[t])
+			printf("  %-14s %8u\n", t < TRACE_EV_COUNT ? trace_eventName((uint8_t)t) : "unknown", counts[t]);
+	}
+	if (refills.count)
+	{
+		printf("refill: mean %.3f us, max %.3f us at %.3f us\n", refills.total / refills.count, refills.max,
+		       refills.maxAt);
+	}
+	if (halves.count)
+	{
+		printf("DMA halves: mean period %.3f us, longest %.3f us ending at %.3f us\n", halves.total / halves.count,
+		       halves.max, halves.maxAt);
+	}
+	printf("underruns %u, late refills %u, dropped buffer events %u, codec errors %u\n", counts[TRACE_EV_UNDERRUN],
+	       counts[TRACE_EV_LATE_REFILL], counts[TRACE_EV_EVENT_OVERRUN], counts[TRACE_EV_CODEC_ERROR]);
+	free(buf);
+	if (maxGapUs > 0 && halves.max > maxGapUs)
+	{
+		printf("DMA halves %.3f us apart, more than %.3f us\n", halves.max, maxGapUs);
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,133 @@
+/*
+Library:				wav_render.c
+Written by:				Shridattha M Hebbar
+Date Written:			16/10/2026
+Description:			Offline WAV renderer: runs files through the same format conversion and echo
+						engine the player runs on the board, as fast as the host allows (render.c). The
+						output is 16-bit stereo at the input rate, as the ring holds on the board, and is
+						sample for sample what the board plays at that rate with the same settings,
+						whatever the thread count.
+
+						wav_render [options] input.wav output.wav
+						wav_render [options] -o outdir input.wav...
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include "render.h"
+
+static void usage(const RENDER_OptionsTypeDef *opt)
+{
+	fprintf(stderr,
+	        "usage: wav_render [options] input.wav output.wav\n"
+	        "       wav_render [options] -o outdir input.wav...\n"
+	        "  -d ms       echo delay (default %u)\n"
+	        "  -g level    echo level 0.0 to 1.0 (default %.2f)\n"
+	        "  -m mode     fir or feedback (default fir)\n"
+	        "  -p damping  feedback damping 0.0 to 1.0 (default %.2f)\n"
+	        "  -s storage  delay line format: pcm16, mulaw or adpcm (default pcm16)\n"
+	        "  -t ms       silence rendered after the input so the echo rings out (default 0)\n"
+	        "  -j threads  worker threads (default %u, one per CPU), 1 renders each file in one pass\n"
+	        "  -c ms       audio per chunk when a file is split over the threads (default %u)\n"
+	        "  -b frames   frames per block (default %u)\n"
+	        "  -o outdir   render every input to outdir under its own name\n"
+	        "  -q          only print the summary\n",
+	        opt->delayMs, (double)opt->level, (double)opt->damping, opt->threads, opt->chunkMs, opt->blockFrames);
+}
+
+int main(int argc, char **argv)
+{
+	RENDER_OptionsTypeDef opt;
+	RENDER_StatsTypeDef stats;
+	const char **inPaths, **outPaths;
+	const char *outDir = NULL;
+	uint32_t files;
+	bool ok;
+	int c;
+
+	render_defaults(&opt);
+	while ((c = getopt(argc, argv, "d:g:m:p:s:t:j:c:b:o:qh")) != -1)
+	{
+		switch (c)
+		{
+		case 'd': opt.delayMs = (uint32_t)strtoul(optarg, NULL, 10); break;
+		case 'g': opt.level = strtof(optarg, NULL); break;
+		case 'p': opt.damping = strtof(optarg, NULL); break;
+		case 't': opt.tailMs = (uint32_t)strtoul(optarg, NULL, 10); break;
+		case 'j': opt.threads = (uint32_t)strtoul(optarg, NULL, 10); break;
+		case 'c': opt.chunkMs = (uint32_t)strtoul(optarg, NULL, 10); break;
+		case 'b': opt.blockFrames = (uint32_t)strtoul(optarg, NULL, 10); break;
+		case 'o': outDir = optarg; break;
+		case 'q': opt.quiet = true; break;
+		case 'm':
+			if (strcmp(optarg, "fir") == 0)
+				opt.mode = ECHO_MODE_FIR;
+			else if (strcmp(optarg, "feedback") == 0)
+				opt.mode = ECHO_MODE_FEEDBACK;
+			else
+			{
+				usage(&opt);
+				return 2;
+			}
+			break;
+		case 's':
+			if (strcmp(optarg, "pcm16") == 0)
+				opt.storage = ECHO_STORAGE_PCM16;
+			else if (strcmp(optarg, "mulaw") == 0)
+				opt.storage = ECHO_STORAGE_MULAW;
+			else if (strcmp(optarg, "adpcm") == 0)
+				opt.storage = ECHO_STORAGE_ADPCM;
+			else
+			{
+				usage(&opt);
+				return 2;
+			}
+			break;
+		default:
+			usage(&opt);
+			return 2;
+		}
+	}
+	files = (uint32_t)(argc - optind);
+	if (opt.blockFrames == 0 || opt.threads == 0 || (outDir ? files == 0 : files != 2))
+	{
+		usage(&opt);
+		return 2;
+	}
+
+	inPaths = (const char**)&argv[optind];
+	outPaths = calloc(files, sizeof(char*));
+	if (!outPaths)
+		return 1;
+	if (!outDir)
+	{
+		outPaths[0] = argv[optind + 1];
+		files = 1;
+	}
+	for (uint32_t i = 0; outDir && i < files; i++)
+	{
+		const char *name = strrchr(inPaths[i], '/');
+		char *path = malloc(strlen(outDir) + strlen(inPaths[i]) + 2u);
+
+		if (!path)
+			return 1;
+		sprintf(path, "%s/%s", outDir, name ? name + 1 : inPaths[i]);
+		outPaths[i] = path;
+	}
+
+	ok = render_files(inPaths, outPaths, files, &opt, &stats);
+	printf("%u file(s), %.1f s of audio in %.3f s: %.0fx real time, %.1f MB/s in, %.1f MB/s out%s\n",
+	       stats.files, stats.audioSeconds, stats.wallSeconds,
+	       stats.wallSeconds > 0 ? stats.audioSeconds / stats.wallSeconds : 0.0,
+	       stats.wallSeconds > 0 ? stats.inBytes / 1e6 / stats.wallSeconds : 0.0,
+	       stats.wallSeconds > 0 ? stats.outBytes / 1e6 / stats.wallSeconds : 0.0,
+	       stats.failed ? ", some files failed" : "");
+	if (!opt.quiet && opt.threads > 1)
+	{
+		printf("%u task(s) on %u thread(s), %u stolen, %.1f%% extra frames to prime chunks\n", stats.tasks, opt.threads,
+		       stats.steals, stats.frames ? 100.0 * stats.primeFrames / stats.frames : 0.0);
+	}
+	return ok ? 0 : 1;
+}